@@ -0,0 +1,32 @@
+#version 430 core
+layout (location = 0) in vec3 clusterPosition; // Center of mass of the octree cell
+layout (location = 1) in float clusterBodies; // How many bodies the cell holds
+layout (location = 2) in float clusterRadius;
+
+out vec3 transformedPos;
+out float brightness;
+
+const int numLightAttr = 8;
+const int maxNumLights = 20;
+layout (std140, binding = 0) uniform uniformData
+{
+    mat4 view;
+    mat4 projection;
+		float ambientStrength;
+		float specularStrength;
+		float phongExponent;
+		int lightCount; // How many lights to render for this frame
+		vec4 lights[numLightAttr*maxNumLights / 4];  // Each light has 8 attributes, max of 20 lights / 4 since each is a vec4 for tight packing
+};
+
+uniform float pixelsPerUnit; // Pixels covered by a unit length at unit distance
+
+// A distant cluster covers a few pixels, spread the light its bodies would have drawn as impostors over them
+void main()
+{
+   transformedPos = vec3(view * vec4(clusterPosition, 1.0));
+   gl_Position = projection * vec4(transformedPos, 1.0);
+   float pixelRadius = max(0.5, clusterRadius * pixelsPerUnit / length(transformedPos));
+   gl_PointSize = 2.0 * pixelRadius;
+   brightness = clusterBodies / (3.14159265 * pixelRadius * pixelRadius);
+}
@@ -3,6 +3,8 @@ in vec3 transformedPos;
 in vec3 transformedNorm;
 in vec2 uvCoord;
 in mat3 TBN;
+flat in vec4 textureStrengths; // Of the instance's material, see default.vs
+flat in ivec4 textureLayers;
 
 out vec4 FragColor;
 
@@ -20,24 +22,24 @@ layout (std140, binding = 0) uniform uniformData
 		vec4 lights[numLightAttr*maxNumLights / 4];  // Each light has 8 attributes, max of 20 lights / 4 since each is a vec4 for tight packing
 };
 
-uniform float diffuseMapStrength;
-uniform float normalMapStrength;
-uniform float specularMapStrength;
-uniform float emissiveMapStrength;
-
-uniform sampler2D diffuseMap;
-uniform sampler2D normalMap;
-uniform sampler2D specularMap;
-uniform sampler2D emissiveMap;
+uniform sampler2DArray diffuseMap;
+uniform sampler2DArray normalMap;
+uniform sampler2DArray specularMap;
+uniform sampler2DArray emissiveMap;
 
 void main()
 {
-	
+
+  float diffuseMapStrength = textureStrengths.x;
+  float normalMapStrength = textureStrengths.y;
+  float specularMapStrength = textureStrengths.z;
+  float emissiveMapStrength = textureStrengths.w;
+
   // Grab color for fragment from texture
-  vec4 diffuseColor = texture(diffuseMap, uvCoord);
-  vec3 normalMapData = texture(normalMap, uvCoord).rgb;
-  vec4 specularMapData = texture(specularMap, uvCoord);
-  vec4 emissiveMapData = texture(emissiveMap, uvCoord);
+  vec4 diffuseColor = texture(diffuseMap, vec3(uvCoord, textureLayers.x));
+  vec3 normalMapData = texture(normalMap, vec3(uvCoord, textureLayers.y)).rgb;
+  vec4 specularMapData = texture(specularMap, vec3(uvCoord, textureLayers.z));
+  vec4 emissiveMapData = texture(emissiveMap, vec3(uvCoord, textureLayers.w));
 
   // Calculate vectors needed for lighting
   vec3 normal = normalize(transformedNorm);
@@ -3,13 +3,15 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aUV;
 layout (location = 2) in vec3 aNorm;
 layout (location = 3) in vec3 aTan;
-layout (location = 4) in mat4 model;
+layout (location = 4) in uint drawIndex; // The draw's baseInstance, standing in for gl_DrawID which needs GL 4.6
 
 out vec3 transformedPos;
 out vec3 transformedNorm;
 out vec2 uvCoord;
 out mat3 TBN;
 out vec4 texLoc;
+flat out vec4 textureStrengths;
+flat out ivec4 textureLayers;
 
 const int numLightAttr = 8;
 const int maxNumLights = 20;
@@ -24,9 +26,69 @@ layout (std140, binding = 0) uniform uniformData
 		vec4 lights[numLightAttr*maxNumLights / 4];  // Each light has 8 attributes, max of 20 lights / 4 since each is a vec4 for tight packing
 };
 
+struct Instance {
+   vec4 positionScale; // xyz position, w uniform scale
+   vec4 rotation; // Quaternion (x, y, z, w)
+};
+
+// The whole model buffer
+layout (std430, binding = 0) readonly buffer instanceData
+{
+   Instance instances[];
+};
+
+struct Draw {
+   uint visibleOffset; // The draw's instances start at visibleIndices[visibleOffset]
+};
+
+// Per draw parameters of the multi draw, indexed by drawIndex
+layout (std430, binding = 1) readonly buffer drawData
+{
+   Draw draws[];
+};
+
+// Visible instances from the CPU culling pass, as indices into instances
+layout (std430, binding = 2) readonly buffer visibleData
+{
+   uint visibleIndices[];
+};
+
+struct Material {
+   vec4 textureStrengths; // diffuse, normal, specular, emissive
+   ivec4 layers; // Of each map in the bound texture arrays
+};
+
+// Material of each instance, laid out like instances
+layout (std430, binding = 3) readonly buffer instanceMaterialData
+{
+   uint instanceMaterials[];
+};
+
+layout (std430, binding = 4) readonly buffer materialData
+{
+   Material materials[];
+};
+
+// translation * rotation * scale, from the instance's compact record
+mat4 getModelMatrix(uint instanceIndex)
+{
+   vec4 instancePositionScale = instances[instanceIndex].positionScale;
+   vec4 q = instances[instanceIndex].rotation;
+   mat3 rotation = mat3(
+      1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y),
+      2.0 * (q.x * q.y - q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z + q.w * q.x),
+      2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y)
+   ) * instancePositionScale.w;
+   return mat4(vec4(rotation[0], 0.0), vec4(rotation[1], 0.0), vec4(rotation[2], 0.0), vec4(instancePositionScale.xyz, 1.0));
+}
+
 void main()
 {
-   mat4 modelView = view * model;
+   uint instanceIndex = visibleIndices[draws[drawIndex].visibleOffset + gl_InstanceID];
+   Material material = materials[instanceMaterials[instanceIndex]];
+   textureStrengths = material.textureStrengths;
+   textureLayers = material.layers;
+   mat4 modelView = view * getModelMatrix(instanceIndex);
    transformedPos = vec3(modelView * vec4(aPos,1));
    transformedNorm = vec3(modelView * vec4(aNorm,0.0));
    uvCoord = aUV;
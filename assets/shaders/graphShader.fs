@@ -0,0 +1,8 @@
+#version 430 core
+out vec4 FragColor;
+uniform vec4 lineColor;
+
+void main()
+{
+   FragColor = lineColor;
+};
\ No newline at end of file
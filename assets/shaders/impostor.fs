@@ -0,0 +1,62 @@
+#version 430 core
+in vec3 transformedPos;
+flat in vec4 textureStrengths; // Of the instance's material, see impostor.vs
+flat in ivec4 textureLayers;
+
+out vec4 FragColor;
+
+// x,y,z,type(point/spotlight),r,g,b,strength
+const int numLightAttr = 8;
+const int maxNumLights = 20;
+layout (std140, binding = 0) uniform uniformData
+{
+    mat4 view;
+    mat4 projection;
+		float ambientStrength;
+		float specularStrength;
+		float phongExponent;
+		int lightCount; // How many lights to render for this frame
+		vec4 lights[numLightAttr*maxNumLights / 4];  // Each light has 8 attributes, max of 20 lights / 4 since each is a vec4 for tight packing
+};
+
+uniform sampler2DArray diffuseMap;
+uniform sampler2DArray emissiveMap;
+
+void main()
+{
+
+  float diffuseMapStrength = textureStrengths.x;
+  float emissiveMapStrength = textureStrengths.w;
+
+  // Round points
+  vec2 fromCenter = gl_PointCoord * 2.0 - 1.0;
+  if (dot(fromCenter, fromCenter) > 1.0) {
+    discard;
+  }
+
+  // The smallest mip level is the average colour of the whole body
+  vec4 diffuseColor = diffuseMapStrength == 0.0 ? vec4(0.0) : textureLod(diffuseMap, vec3(0.5, 0.5, textureLayers.x), 16.0);
+  vec4 emissiveColor = emissiveMapStrength == 0.0 ? vec4(0.0) : textureLod(emissiveMap, vec3(0.5, 0.5, textureLayers.w), 16.0);
+
+  // Light the body as a whole, by how much of its lit half faces the camera
+  FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+  vec3 viewDir = normalize(transformedPos);
+  for (int i=0; i<lightCount; i++) {
+
+		int lightIndex = numLightAttr * i / 4;
+
+		vec3 lightPos = lights[lightIndex].xyz;
+		vec4 lightColor = vec4(lights[lightIndex+1].xyz, 1.0);
+		float lightStrength = lights[lightIndex+1].w;
+
+		vec3 toLight = normalize(lightPos-transformedPos);
+		float litFraction = 0.5 - 0.5 * dot(viewDir, toLight);
+
+		float distance = length(lightPos - transformedPos);
+		float attenuation = 1.0/( log(max(10.0,distance)) ); // Same falloff as default.fs
+		lightStrength *= attenuation;
+
+		FragColor += lightStrength * (ambientStrength + litFraction) * diffuseColor * lightColor;
+  }
+	FragColor += emissiveColor * emissiveMapStrength;
+};
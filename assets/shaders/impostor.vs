@@ -0,0 +1,77 @@
+#version 430 core
+layout (location = 4) in uint drawIndex; // The draw's baseInstance, standing in for gl_DrawID which needs GL 4.6
+
+out vec3 transformedPos;
+flat out vec4 textureStrengths;
+flat out ivec4 textureLayers;
+
+const int numLightAttr = 8;
+const int maxNumLights = 20;
+layout (std140, binding = 0) uniform uniformData
+{
+    mat4 view;
+    mat4 projection;
+		float ambientStrength;
+		float specularStrength;
+		float phongExponent;
+		int lightCount; // How many lights to render for this frame
+		vec4 lights[numLightAttr*maxNumLights / 4];  // Each light has 8 attributes, max of 20 lights / 4 since each is a vec4 for tight packing
+};
+
+struct Instance {
+   vec4 positionScale; // xyz position, w uniform scale
+   vec4 rotation; // Quaternion (x, y, z, w)
+};
+
+// The whole model buffer
+layout (std430, binding = 0) readonly buffer instanceData
+{
+   Instance instances[];
+};
+
+struct Draw {
+   uint visibleOffset; // The draw's instances start at visibleIndices[visibleOffset]
+};
+
+// Per draw parameters of the multi draw, indexed by drawIndex
+layout (std430, binding = 1) readonly buffer drawData
+{
+   Draw draws[];
+};
+
+// Visible instances from the CPU culling pass, as indices into instances
+layout (std430, binding = 2) readonly buffer visibleData
+{
+   uint visibleIndices[];
+};
+
+struct Material {
+   vec4 textureStrengths; // diffuse, normal, specular, emissive
+   ivec4 layers; // Of each map in the bound texture arrays
+};
+
+// Material of each instance, laid out like instances
+layout (std430, binding = 3) readonly buffer instanceMaterialData
+{
+   uint instanceMaterials[];
+};
+
+layout (std430, binding = 4) readonly buffer materialData
+{
+   Material materials[];
+};
+
+uniform float pixelsPerUnit; // Pixels covered by a unit length at unit distance
+
+// Bodies too small for a mesh are drawn as one point covering their projected size
+void main()
+{
+   uint instanceIndex = visibleIndices[draws[drawIndex].visibleOffset + gl_InstanceID];
+   Material material = materials[instanceMaterials[instanceIndex]];
+   textureStrengths = material.textureStrengths;
+   textureLayers = material.layers;
+   vec4 positionScale = instances[instanceIndex].positionScale;
+   transformedPos = vec3(view * vec4(positionScale.xyz, 1.0));
+   gl_Position = projection * vec4(transformedPos, 1.0);
+   gl_PointSize = max(1.0, 2.0 * positionScale.w * pixelsPerUnit / length(transformedPos));
+}
@@ -10,9 +10,35 @@ Config::Config() {
   m_bloomEnabled = false;
   m_autoExposureEnabled = false;
   m_renderSkyBox = false;
+  m_meshLodPixelRadius = 32.0f;
+  m_impostorPixelRadius = 1.5f;
+  m_clusterMinimumBodies = 20000;
+  m_clusterPixelSize = 4.0f;
   m_autoExposureControl = 1e-2;
   m_auto_exposure_center_range = 0.20;
   m_bloomThreshold = 150.0f;
+  m_checkpointsEnabled = false;
+  m_checkpointFilePrefix = "../checkpoint";
+  m_checkpointIntervalSeconds = 3600.0;
+  m_checkpointRetention = 3;
+  m_trajectoryEnabled = false;
+  m_trajectoryFilePath = "../trajectory.traj";
+  m_trajectoryStride = 100;
+  m_trajectoryFramesPerChunk = 16;
+  m_trajectoryBodiesPerBlock = 4096;
+  m_trajectoryPositionQuantum = 1e-4; // 100m with the default unit scale
+  m_trajectoryVelocityQuantum = 1e-9; // 1mm/s
+  m_timelineMemoryBudgetMB = 512;
+  m_timelineKeyframeInterval = 60;
+  m_traceFilePath = "../trace.json";
+  m_thetaTunerEnabled = false;
+  m_thetaTunerTargetError = 1e-3;
+  m_thetaTunerInterval = 60;
+  m_thetaTunerSampleSize = 32;
+  m_diagnosticsEnabled = false;
+  m_diagnosticsInterval = 60;
+  m_diagnosticsDirectLimit = 4096;
+  m_diagnosticsLogPath = "../diagnostics.csv";
 }
 
 Config* Config::getInstance() {
@@ -62,4 +88,108 @@ float Config::getBloomThreshold() {
 
 bool Config::getSkyBoxEnabled() {
     return m_renderSkyBox;
-}
\ No newline at end of file
+}
+
+float Config::getMeshLodPixelRadius() {
+  return m_meshLodPixelRadius;
+}
+
+float Config::getImpostorPixelRadius() {
+  return m_impostorPixelRadius;
+}
+
+unsigned int Config::getClusterMinimumBodies() {
+  return m_clusterMinimumBodies;
+}
+
+float Config::getClusterPixelSize() {
+  return m_clusterPixelSize;
+}
+
+bool Config::getCheckpointsEnabled() {
+  return m_checkpointsEnabled;
+}
+
+std::string Config::getCheckpointFilePrefix() {
+  return m_checkpointFilePrefix;
+}
+
+double Config::getCheckpointIntervalSeconds() {
+  return m_checkpointIntervalSeconds;
+}
+
+unsigned int Config::getCheckpointRetention() {
+  return m_checkpointRetention;
+}
+
+bool Config::getTrajectoryEnabled() {
+  return m_trajectoryEnabled;
+}
+
+std::string Config::getTrajectoryFilePath() {
+  return m_trajectoryFilePath;
+}
+
+unsigned int Config::getTrajectoryStride() {
+  return m_trajectoryStride;
+}
+
+unsigned int Config::getTrajectoryFramesPerChunk() {
+  return m_trajectoryFramesPerChunk;
+}
+
+unsigned int Config::getTrajectoryBodiesPerBlock() {
+  return m_trajectoryBodiesPerBlock;
+}
+
+double Config::getTrajectoryPositionQuantum() {
+  return m_trajectoryPositionQuantum;
+}
+
+double Config::getTrajectoryVelocityQuantum() {
+  return m_trajectoryVelocityQuantum;
+}
+
+size_t Config::getTimelineMemoryBudgetMB() {
+  return m_timelineMemoryBudgetMB;
+}
+
+unsigned int Config::getTimelineKeyframeInterval() {
+  return m_timelineKeyframeInterval;
+}
+
+std::string Config::getTraceFilePath() {
+  return m_traceFilePath;
+}
+
+bool Config::getThetaTunerEnabled() {
+  return m_thetaTunerEnabled;
+}
+
+double Config::getThetaTunerTargetError() {
+  return m_thetaTunerTargetError;
+}
+
+unsigned int Config::getThetaTunerInterval() {
+  return m_thetaTunerInterval;
+}
+
+unsigned int Config::getThetaTunerSampleSize() {
+  return m_thetaTunerSampleSize;
+}
+
+bool Config::getDiagnosticsEnabled() {
+  return m_diagnosticsEnabled;
+}
+
+unsigned int Config::getDiagnosticsInterval() {
+  return m_diagnosticsInterval;
+}
+
+size_t Config::getDiagnosticsDirectLimit() {
+  return m_diagnosticsDirectLimit;
+}
+
+std::string Config::getDiagnosticsLogPath() {
+  return m_diagnosticsLogPath;
+}
@@ -17,6 +17,38 @@ private:
   float m_autoExposureControl;
   double m_auto_exposure_center_range; // Percent of middle of screen to use for AE calculation
   bool m_renderSkyBox;
+  float m_meshLodPixelRadius; // Projected radius under which bodies use their next coarser mesh, a quarter of it for the one after
+  float m_impostorPixelRadius; // Projected radius under which bodies are drawn as point sprites
+  unsigned int m_clusterMinimumBodies; // Instance groups at least this large draw distant clusters of bodies as one splat
+  float m_clusterPixelSize; // Projected diameter under which a cluster is drawn as one splat
+
+  bool m_checkpointsEnabled;
+  std::string m_checkpointFilePrefix;
+  double m_checkpointIntervalSeconds; // Wall clock time between checkpoints
+  unsigned int m_checkpointRetention; // Number of checkpoint files kept on disk
+
+  bool m_trajectoryEnabled;
+  std::string m_trajectoryFilePath;
+  unsigned int m_trajectoryStride; // Record every Nth physics step
+  unsigned int m_trajectoryFramesPerChunk;
+  unsigned int m_trajectoryBodiesPerBlock;
+  double m_trajectoryPositionQuantum; // Resolution of stored positions in physics units
+  double m_trajectoryVelocityQuantum;
+
+  size_t m_timelineMemoryBudgetMB; // Memory for rewind keyframes and recorded step sizes
+  unsigned int m_timelineKeyframeInterval; // Initial steps between keyframes, doubles when the budget fills
+
+  bool m_thetaTunerEnabled;
+  double m_thetaTunerTargetError; // Mean relative Barnes-Hut force error to stay under
+  unsigned int m_thetaTunerInterval; // Steps between error measurements
+  unsigned int m_thetaTunerSampleSize; // Bodies checked against direct summation per measurement
+
+  bool m_diagnosticsEnabled;
+  unsigned int m_diagnosticsInterval; // Steps between energy/momentum samples
+  size_t m_diagnosticsDirectLimit; // Above this many bodies potential energy comes from an octree
+  std::string m_diagnosticsLogPath; // CSV of every sample, empty for none
+
+  std::string m_traceFilePath; // Written on exit and with T when built with ENABLE_TRACING
 
   Config();
 
@@ -34,5 +66,31 @@ public:
   float getAutoExposureControl();
   float getBloomThreshold();
   bool getSkyBoxEnabled();
+  float getMeshLodPixelRadius();
+  float getImpostorPixelRadius();
+  unsigned int getClusterMinimumBodies();
+  float getClusterPixelSize();
+  bool getCheckpointsEnabled();
+  std::string getCheckpointFilePrefix();
+  double getCheckpointIntervalSeconds();
+  unsigned int getCheckpointRetention();
+  bool getTrajectoryEnabled();
+  std::string getTrajectoryFilePath();
+  unsigned int getTrajectoryStride();
+  unsigned int getTrajectoryFramesPerChunk();
+  unsigned int getTrajectoryBodiesPerBlock();
+  double getTrajectoryPositionQuantum();
+  double getTrajectoryVelocityQuantum();
+  size_t getTimelineMemoryBudgetMB();
+  unsigned int getTimelineKeyframeInterval();
+  std::string getTraceFilePath();
+  bool getThetaTunerEnabled();
+  double getThetaTunerTargetError();
+  unsigned int getThetaTunerInterval();
+  unsigned int getThetaTunerSampleSize();
+  bool getDiagnosticsEnabled();
+  unsigned int getDiagnosticsInterval();
+  size_t getDiagnosticsDirectLimit();
+  std::string getDiagnosticsLogPath();
 
 };
@@ -0,0 +1,403 @@
+#include "distributedSystem.h"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include "../profiling/tracer.h"
+#include "../threading/threadPool.h"
+
+namespace {
+  const int MORTON_BITS = 21; // Per axis, 63 bits in total
+  const size_t SAMPLES_PER_RANK = 64; // Curve samples each rank contributes towards the splitters
+
+  struct CurveSample {
+    uint64_t key;
+    double work;
+  };
+
+  // Spreads the low 21 bits of x so there are two zero bits between each
+  uint64_t spreadBits(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+  }
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+DistributedSystem::DistributedSystem(Transport* transport) {
+  m_transport = transport;
+  m_theta = 0.7f;
+  m_threadCount = 0;
+  m_accelerationsValid = false;
+  m_simulationTime = 0.0;
+  m_stepCount = 0;
+  setSIUnitScaleFactor(1e6f);
+}
+
+void DistributedSystem::setSIUnitScaleFactor(float SIUnitScaleFactor) {
+  m_SIUnitScaleFactor = SIUnitScaleFactor;
+  G = 6.67430e-11 / SIUnitScaleFactor / SIUnitScaleFactor; // Same units as System
+  m_accelerationsValid = false;
+}
+
+float DistributedSystem::getSIUnitScaleFactor() {
+  return m_SIUnitScaleFactor;
+}
+
+float DistributedSystem::getGravitationalConstant() {
+  return G;
+}
+
+void DistributedSystem::setTheta(float theta) {
+  m_theta = theta;
+  m_accelerationsValid = false;
+}
+
+float DistributedSystem::getTheta() {
+  return m_theta;
+}
+
+void DistributedSystem::setThreadCount(unsigned int threadCount) {
+  m_threadCount = threadCount;
+}
+
+void DistributedSystem::addBodies(const std::vector<DistributedBody>& bodies) {
+  m_bodies.insert(m_bodies.end(), bodies.begin(), bodies.end());
+  m_accelerationsValid = false;
+}
+
+void DistributedSystem::generate(const InitialConditionParameters& parameters) {
+  const size_t size = m_transport->getSize();
+  const size_t rank = m_transport->getRank();
+  const size_t share = parameters.bodyCount / size + (rank < parameters.bodyCount % size ? 1 : 0);
+  const uint64_t firstId = rank * (parameters.bodyCount / size) + std::min(rank, parameters.bodyCount % size);
+
+  // Sampled as a distribution of the full mass, then the masses are scaled down to this rank's share of it.
+  // Velocities come from the full potential, so the union over ranks is one equilibrium system.
+  // Only rank 0 gets the central body, which keeps its full mass and takes the last id
+  InitialConditionParameters rankParameters = parameters;
+  rankParameters.bodyCount = share;
+  rankParameters.seed = parameters.seed + (unsigned int)rank;
+  rankParameters.centralMass = rank == 0 ? parameters.centralMass : 0.0f;
+  Snapshot snapshot;
+  InitialConditions::generate(std::vector<InitialConditionParameters>{ rankParameters }, G, snapshot, m_threadCount);
+
+  const size_t central = snapshot.getBodyCount() - share;
+  const float massScale = parameters.bodyCount > 0 ? (float)share / parameters.bodyCount : 0.0f;
+  std::vector<DistributedBody> bodies(snapshot.getBodyCount());
+  for (size_t i = 0; i < bodies.size(); i++) {
+    bool isCentral = i < central;
+    bodies[i].position = snapshot.positions[i];
+    bodies[i].velocity = snapshot.velocities[i];
+    bodies[i].acceleration = glm::vec3(0.0f);
+    bodies[i].mass = isCentral ? snapshot.masses[i] : snapshot.masses[i] * massScale;
+    bodies[i].work = 1.0f;
+    bodies[i].id = isCentral ? parameters.bodyCount : firstId + i - central;
+  }
+  addBodies(bodies);
+}
+
+std::vector<DistributedBody>& DistributedSystem::getBodies() {
+  return m_bodies;
+}
+
+std::vector<uint64_t>& DistributedSystem::getSplitters() {
+  return m_splitters;
+}
+
+Transport* DistributedSystem::getTransport() {
+  return m_transport;
+}
+
+uint64_t DistributedSystem::getMortonKey(glm::vec3 position, glm::vec3 low, glm::vec3 high) {
+  const double cells = (double)((1u << MORTON_BITS) - 1);
+  uint64_t key = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    double extent = (double)high[axis] - low[axis];
+    double t = extent > 0.0 ? ((double)position[axis] - low[axis]) / extent : 0.0;
+    uint64_t cell = (uint64_t)(std::min(std::max(t, 0.0), 1.0) * cells);
+    key |= spreadBits(cell) << axis;
+  }
+  return key;
+}
+
+void DistributedSystem::allGatherBounds(glm::vec3 low, glm::vec3 high, std::vector<glm::vec3>& lows, std::vector<glm::vec3>& highs) {
+  std::vector<glm::vec3> bounds = { low, high };
+  std::vector<char> buffer;
+  packBuffer(bounds, buffer);
+  std::vector<std::vector<char>> received;
+  m_transport->allGather(buffer, received);
+  lows.resize(received.size());
+  highs.resize(received.size());
+  for (size_t r = 0; r < received.size(); r++) {
+    unpackBuffer(received[r], bounds);
+    lows[r] = bounds[0];
+    highs[r] = bounds[1];
+  }
+}
+
+void DistributedSystem::decompose() {
+  TRACE_SCOPE("DistributedSystem::decompose");
+  auto start = std::chrono::steady_clock::now();
+  const int size = m_transport->getSize();
+  const int rank = m_transport->getRank();
+
+  // Global bounding box of the curve
+  glm::vec3 low = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 high = glm::vec3(-std::numeric_limits<float>::max());
+  for (auto const& body : m_bodies) {
+    low = glm::min(low, body.position);
+    high = glm::max(high, body.position);
+  }
+  std::vector<glm::vec3> lows, highs;
+  allGatherBounds(low, high, lows, highs);
+  for (int r = 0; r < size; r++) {
+    low = glm::min(low, lows[r]);
+    high = glm::max(high, highs[r]);
+  }
+
+  // Sort local bodies along the curve
+  std::vector<std::pair<uint64_t, size_t>> keys(m_bodies.size());
+  for (size_t i = 0; i < m_bodies.size(); i++) {
+    keys[i] = std::make_pair(getMortonKey(m_bodies[i].position, low, high), i);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<DistributedBody> sorted(m_bodies.size());
+  double localWork = 0.0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    sorted[i] = m_bodies[keys[i].second];
+    localWork += std::max(sorted[i].work, 1.0f);
+  }
+
+  // Samples at equal steps of local work, each standing for the same amount of it
+  std::vector<CurveSample> samples;
+  const size_t sampleCount = std::min(SAMPLES_PER_RANK * size, sorted.size());
+  if (sampleCount > 0) {
+    const double workPerSample = localWork / sampleCount;
+    double cumulative = 0.0;
+    size_t next = 0;
+    for (size_t i = 0; i < sorted.size() && next < sampleCount; i++) {
+      cumulative += std::max(sorted[i].work, 1.0f);
+      while (next < sampleCount && cumulative >= (next + 0.5) * workPerSample) {
+        samples.push_back({ keys[i].first, workPerSample });
+        next++;
+      }
+    }
+  }
+  std::vector<char> buffer;
+  packBuffer(samples, buffer);
+  std::vector<std::vector<char>> received;
+  m_transport->allGather(buffer, received);
+
+  // Every rank sees the same samples, so every rank picks the same splitters
+  std::vector<CurveSample> allSamples;
+  for (auto const& rankBuffer : received) {
+    std::vector<CurveSample> rankSamples;
+    unpackBuffer(rankBuffer, rankSamples);
+    allSamples.insert(allSamples.end(), rankSamples.begin(), rankSamples.end());
+  }
+  std::sort(allSamples.begin(), allSamples.end(), [](const CurveSample& a, const CurveSample& b) { return a.key < b.key; });
+  double totalWork = 0.0;
+  for (auto const& sample : allSamples) {
+    totalWork += sample.work;
+  }
+  m_splitters.assign(size - 1, std::numeric_limits<uint64_t>::max());
+  double cumulative = 0.0;
+  int splitter = 0;
+  for (auto const& sample : allSamples) {
+    cumulative += sample.work;
+    while (splitter < size - 1 && cumulative >= totalWork * (splitter + 1) / size) {
+      m_splitters[splitter++] = sample.key;
+    }
+  }
+
+  // Migrate. Bodies are sorted, so each destination gets a contiguous run.
+  std::vector<std::vector<char>> outgoing(size);
+  size_t begin = 0;
+  for (int r = 0; r < size; r++) {
+    size_t end = begin;
+    while (end < sorted.size() && (r == size - 1 || keys[end].first < m_splitters[r])) {
+      end++;
+    }
+    std::vector<DistributedBody> run(sorted.begin() + begin, sorted.begin() + end);
+    packBuffer(run, outgoing[r]);
+    if (r != rank) {
+      m_stats.migratedBodies += run.size();
+    }
+    begin = end;
+  }
+  m_transport->exchange(outgoing, received);
+  m_bodies.clear();
+  std::vector<DistributedBody> incoming;
+  for (auto const& rankBuffer : received) {
+    unpackBuffer(rankBuffer, incoming);
+    m_bodies.insert(m_bodies.end(), incoming.begin(), incoming.end());
+  }
+  m_stats.decomposeMilliseconds += millisecondsSince(start);
+}
+
+void DistributedSystem::exchangeEssential() {
+  TRACE_SCOPE("DistributedSystem::exchangeEssential");
+  auto start = std::chrono::steady_clock::now();
+  const int size = m_transport->getSize();
+  const int rank = m_transport->getRank();
+
+  m_localPositions.resize(m_bodies.size());
+  m_localMasses.resize(m_bodies.size());
+  glm::vec3 low = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 high = glm::vec3(-std::numeric_limits<float>::max());
+  for (size_t i = 0; i < m_bodies.size(); i++) {
+    m_localPositions[i] = m_bodies[i].position;
+    m_localMasses[i] = m_bodies[i].mass;
+    low = glm::min(low, m_bodies[i].position);
+    high = glm::max(high, m_bodies[i].position);
+  }
+  m_localTree.build(m_localPositions, m_localMasses);
+
+  std::vector<glm::vec3> lows, highs;
+  allGatherBounds(low, high, lows, highs);
+
+  std::vector<std::vector<char>> outgoing(size);
+  std::vector<glm::vec4> essential;
+  for (int r = 0; r < size; r++) {
+    // A rank without bodies has an inverted box and needs nothing
+    if (r == rank || lows[r].x > highs[r].x) {
+      continue;
+    }
+    essential.clear();
+    m_localTree.collectEssential(lows[r], highs[r], m_theta, essential);
+    packBuffer(essential, outgoing[r]);
+  }
+  std::vector<std::vector<char>> received;
+  m_transport->exchange(outgoing, received);
+
+  m_treePositions = m_localPositions;
+  m_treeMasses = m_localMasses;
+  for (auto const& rankBuffer : received) {
+    unpackBuffer(rankBuffer, essential);
+    for (auto const& item : essential) {
+      m_treePositions.push_back(glm::vec3(item));
+      m_treeMasses.push_back(item.w);
+    }
+    m_stats.importedEssential += essential.size();
+  }
+  m_stats.essentialMilliseconds += millisecondsSince(start);
+}
+
+void DistributedSystem::computeAccelerations() {
+  TRACE_SCOPE("DistributedSystem::computeAccelerations");
+  decompose();
+  exchangeEssential();
+
+  auto start = std::chrono::steady_clock::now();
+  m_tree.build(m_treePositions, m_treeMasses);
+  m_stats.buildMilliseconds += millisecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  const float closeApproach2 = 1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor);
+  std::atomic<unsigned long long> interactions(0);
+  ThreadPool::getInstance()->parallelFor(m_bodies.size(), 16, [&](size_t begin, size_t end) {
+    unsigned long long chunkInteractions = 0;
+    for (size_t i = begin; i < end; i++) {
+      unsigned long long bodyInteractions = 0;
+      glm::dvec3 acceleration = m_tree.acceleration(m_bodies[i].position, (int)i, m_theta, closeApproach2, bodyInteractions);
+      m_bodies[i].acceleration = glm::vec3(acceleration * (double)G);
+      m_bodies[i].work = (float)bodyInteractions;
+      chunkInteractions += bodyInteractions;
+    }
+    interactions += chunkInteractions;
+  }, m_threadCount);
+  m_stats.walkMilliseconds += millisecondsSince(start);
+  m_stats.interactions += interactions;
+  m_stats.forceEvaluations++;
+  m_accelerationsValid = true;
+}
+
+void DistributedSystem::step(float stepSize) {
+  TRACE_SCOPE("DistributedSystem::step");
+  if (!m_accelerationsValid) {
+    computeAccelerations();
+  }
+  const float halfStep = 0.5f * stepSize;
+  for (auto& body : m_bodies) {
+    body.velocity += body.acceleration * halfStep;
+    body.position += body.velocity * stepSize;
+  }
+  computeAccelerations();
+  for (auto& body : m_bodies) {
+    body.velocity += body.acceleration * halfStep;
+  }
+  m_simulationTime += stepSize;
+  m_stepCount++;
+}
+
+double DistributedSystem::getSimulationTime() {
+  return m_simulationTime;
+}
+
+unsigned long long DistributedSystem::getStepCount() {
+  return m_stepCount;
+}
+
+size_t DistributedSystem::getGlobalBodyCount() {
+  std::vector<double> count = { (double)m_bodies.size() };
+  m_transport->allReduceSum(count);
+  return (size_t)count[0];
+}
+
+void DistributedSystem::computeTotals(double& mass, double& kineticEnergy, glm::dvec3& linearMomentum) {
+  std::vector<double> totals(5, 0.0);
+  for (auto const& body : m_bodies) {
+    glm::dvec3 velocity = glm::dvec3(body.velocity);
+    totals[0] += body.mass;
+    totals[1] += 0.5 * body.mass * glm::dot(velocity, velocity);
+    totals[2] += body.mass * velocity.x;
+    totals[3] += body.mass * velocity.y;
+    totals[4] += body.mass * velocity.z;
+  }
+  m_transport->allReduceSum(totals);
+  mass = totals[0];
+  kineticEnergy = totals[1];
+  linearMomentum = glm::dvec3(totals[2], totals[3], totals[4]);
+}
+
+void DistributedSystem::gather(Snapshot& snapshot) {
+  std::vector<char> buffer;
+  packBuffer(m_bodies, buffer);
+  std::vector<std::vector<char>> received;
+  m_transport->allGather(buffer, received);
+
+  std::vector<DistributedBody> all;
+  std::vector<DistributedBody> rankBodies;
+  for (auto const& rankBuffer : received) {
+    unpackBuffer(rankBuffer, rankBodies);
+    all.insert(all.end(), rankBodies.begin(), rankBodies.end());
+  }
+  std::sort(all.begin(), all.end(), [](const DistributedBody& a, const DistributedBody& b) { return a.id < b.id; });
+
+  snapshot.resize(all.size());
+  snapshot.time = m_simulationTime;
+  snapshot.step = m_stepCount;
+  for (size_t i = 0; i < all.size(); i++) {
+    snapshot.masses[i] = all[i].mass;
+    snapshot.positions[i] = all[i].position;
+    snapshot.velocities[i] = all[i].velocity;
+    snapshot.rotations[i] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  }
+}
+
+DistributedStats DistributedSystem::getStats() {
+  return m_stats;
+}
+
+void DistributedSystem::resetStats() {
+  m_stats = DistributedStats();
+}
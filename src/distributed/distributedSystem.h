@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "transport.h"
+#include "../physics/octree.h"
+#include "../physics/snapshot.h"
+#include "../physics/initialConditions.h"
+
+// One body owned by a rank. Plain data so it can travel through a Transport as bytes.
+struct DistributedBody {
+  glm::vec3 position;
+  glm::vec3 velocity;
+  glm::vec3 acceleration; // From the last force evaluation, migrates with the body
+  float mass;
+  float work; // Interactions in the last force evaluation, weights the decomposition
+  uint64_t id; // Global index, stable across migrations
+};
+
+// Work of the last force evaluations on this rank since the last resetStats
+struct DistributedStats {
+  unsigned long long forceEvaluations = 0;
+  unsigned long long interactions = 0;
+  unsigned long long migratedBodies = 0; // Bodies sent to other ranks
+  unsigned long long importedEssential = 0; // Cells and bodies received from other ranks
+  double decomposeMilliseconds = 0.0; // Splitters and migration
+  double essentialMilliseconds = 0.0; // Local tree and essential tree exchange
+  double buildMilliseconds = 0.0;
+  double walkMilliseconds = 0.0;
+};
+
+// Barnes-Hut across the ranks of a Transport, for runs too large for one process. Every force evaluation:
+//  1. Bodies are ordered along a Morton curve over the global bounding box and the curve is cut into one piece per
+//     rank with about equal work, weighted by each body's interactions in the previous evaluation.
+//  2. Bodies migrate to the rank owning their piece of the curve.
+//  3. Each rank sends every other rank the cells and bodies of its own tree needed for forces inside that rank's
+//     bounding box (its local essential tree).
+//  4. Each rank builds one tree from its bodies and everything it received and walks it for its own bodies.
+// Integration is kick-drift-kick leapfrog, like System's. Bodies are kept as plain arrays rather than GravBodies
+// so that 100M+ bodies fit across a small cluster. Every public method that communicates is collective.
+class DistributedSystem {
+private:
+  Transport* m_transport;
+  std::vector<DistributedBody> m_bodies;
+  float G;
+  float m_SIUnitScaleFactor;
+  float m_theta;
+  unsigned int m_threadCount; // Threads for the tree walk, 0 for the whole pool
+  bool m_accelerationsValid;
+  double m_simulationTime;
+  unsigned long long m_stepCount;
+
+  std::vector<uint64_t> m_splitters; // Rank r owns keys in [m_splitters[r - 1], m_splitters[r])
+  std::vector<glm::vec3> m_localPositions;
+  std::vector<float> m_localMasses;
+  std::vector<glm::vec3> m_treePositions; // Local bodies first, then the essential cells and bodies received
+  std::vector<float> m_treeMasses;
+  Octree m_localTree;
+  Octree m_tree;
+  DistributedStats m_stats;
+
+  void decompose();
+  void exchangeEssential();
+  void allGatherBounds(glm::vec3 low, glm::vec3 high, std::vector<glm::vec3>& lows, std::vector<glm::vec3>& highs);
+
+public:
+  DistributedSystem(Transport* transport); // Not owned
+  void setSIUnitScaleFactor(float SIUnitScaleFactor);
+  float getSIUnitScaleFactor();
+  float getGravitationalConstant();
+  void setTheta(float theta);
+  float getTheta();
+  void setThreadCount(unsigned int threadCount);
+  // Adds bodies to this rank. Ranks may start with any split, the next force evaluation migrates them.
+  void addBodies(const std::vector<DistributedBody>& bodies);
+  // Every rank generates its share of the distribution with its own seed. Collective.
+  void generate(const InitialConditionParameters& parameters);
+  std::vector<DistributedBody>& getBodies();
+  std::vector<uint64_t>& getSplitters();
+  Transport* getTransport();
+
+  void computeAccelerations();
+  void step(float stepSize);
+  double getSimulationTime();
+  unsigned long long getStepCount();
+
+  size_t getGlobalBodyCount();
+  // Sums over every rank
+  void computeTotals(double& mass, double& kineticEnergy, glm::dvec3& linearMomentum);
+  // Every body of every rank ordered by id, on every rank. Only for small runs and tests.
+  void gather(Snapshot& snapshot);
+  DistributedStats getStats();
+  void resetStats();
+
+  static uint64_t getMortonKey(glm::vec3 position, glm::vec3 low, glm::vec3 high);
+};
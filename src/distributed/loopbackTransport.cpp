@@ -0,0 +1,60 @@
+#include "loopbackTransport.h"
+
+LoopbackHub::LoopbackHub(int size) {
+  m_size = size;
+  m_mailboxes.assign(size, std::vector<std::vector<char>>(size));
+  m_arrived = 0;
+  m_generation = 0;
+}
+
+int LoopbackHub::getSize() {
+  return m_size;
+}
+
+void LoopbackHub::wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  unsigned long long generation = m_generation;
+  if (++m_arrived == m_size) {
+    m_arrived = 0;
+    m_generation++;
+    m_condition.notify_all();
+    return;
+  }
+  m_condition.wait(lock, [&] { return m_generation != generation; });
+}
+
+std::vector<char>& LoopbackHub::getMailbox(int destination, int source) {
+  return m_mailboxes[destination][source];
+}
+
+LoopbackTransport::LoopbackTransport(LoopbackHub* hub, int rank) {
+  m_hub = hub;
+  m_rank = rank;
+}
+
+int LoopbackTransport::getRank() {
+  return m_rank;
+}
+
+int LoopbackTransport::getSize() {
+  return m_hub->getSize();
+}
+
+void LoopbackTransport::exchange(const std::vector<std::vector<char>>& send, std::vector<std::vector<char>>& received) {
+  const int size = getSize();
+  // Each rank only writes the mailboxes it is the source of, and only reads the ones it is the destination of
+  for (int r = 0; r < size; r++) {
+    m_hub->getMailbox(r, m_rank) = send[r];
+  }
+  m_hub->wait();
+  received.resize(size);
+  for (int r = 0; r < size; r++) {
+    received[r].swap(m_hub->getMailbox(m_rank, r));
+  }
+  // Nobody may start the next exchange before everyone has taken their mail
+  m_hub->wait();
+}
+
+void LoopbackTransport::barrier() {
+  m_hub->wait();
+}
@@ -0,0 +1,123 @@
+#ifdef ENABLE_MPI
+#include "mpiTransport.h"
+#include <mpi.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+namespace {
+  // Bytes each rank may send to each other rank in one collective, so that a rank's counts and displacements,
+  // which MPI takes as int, stay under INT_MAX in total
+  uint64_t getChunkBytes(int size) {
+    return std::max<uint64_t>(INT_MAX / size, 1);
+  }
+
+  // Bytes of a buffer of the given size that fall in the chunk starting at done
+  uint64_t getChunkCount(uint64_t size, uint64_t done, uint64_t chunk) {
+    return done < size ? std::min(chunk, size - done) : 0;
+  }
+}
+
+MPITransport::MPITransport(int* argc, char*** argv) {
+  MPI_Init(argc, argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &m_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &m_size);
+}
+
+MPITransport::~MPITransport() {
+  MPI_Finalize();
+}
+
+int MPITransport::getRank() {
+  return m_rank;
+}
+
+int MPITransport::getSize() {
+  return m_size;
+}
+
+void MPITransport::exchange(const std::vector<std::vector<char>>& send, std::vector<std::vector<char>>& received) {
+  std::vector<uint64_t> sendSizes(m_size), receiveSizes(m_size);
+  uint64_t largest = 0;
+  for (int r = 0; r < m_size; r++) {
+    sendSizes[r] = send[r].size();
+    largest = std::max(largest, sendSizes[r]);
+  }
+  MPI_Alltoall(sendSizes.data(), 1, MPI_UINT64_T, receiveSizes.data(), 1, MPI_UINT64_T, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, &largest, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+  received.assign(m_size, std::vector<char>());
+  for (int r = 0; r < m_size; r++) {
+    received[r].reserve(receiveSizes[r]);
+  }
+
+  // Every rank runs the same number of rounds, each moving at most one chunk per pair of ranks
+  const uint64_t chunk = getChunkBytes(m_size);
+  std::vector<int> sendCounts(m_size), sendOffsets(m_size), receiveCounts(m_size), receiveOffsets(m_size);
+  std::vector<char> sendBuffer, receiveBuffer;
+  for (uint64_t done = 0; done < largest; done += chunk) {
+    sendBuffer.clear();
+    int receiveTotal = 0;
+    for (int r = 0; r < m_size; r++) {
+      sendCounts[r] = (int)getChunkCount(sendSizes[r], done, chunk);
+      sendOffsets[r] = (int)sendBuffer.size();
+      const uint64_t first = std::min(done, sendSizes[r]);
+      sendBuffer.insert(sendBuffer.end(), send[r].begin() + first, send[r].begin() + first + sendCounts[r]);
+      receiveCounts[r] = (int)getChunkCount(receiveSizes[r], done, chunk);
+      receiveOffsets[r] = receiveTotal;
+      receiveTotal += receiveCounts[r];
+    }
+    receiveBuffer.resize(receiveTotal);
+    MPI_Alltoallv(sendBuffer.data(), sendCounts.data(), sendOffsets.data(), MPI_BYTE,
+      receiveBuffer.data(), receiveCounts.data(), receiveOffsets.data(), MPI_BYTE, MPI_COMM_WORLD);
+
+    for (int r = 0; r < m_size; r++) {
+      received[r].insert(received[r].end(), receiveBuffer.begin() + receiveOffsets[r],
+        receiveBuffer.begin() + receiveOffsets[r] + receiveCounts[r]);
+    }
+  }
+}
+
+void MPITransport::allGather(const std::vector<char>& send, std::vector<std::vector<char>>& received) {
+  uint64_t size = send.size();
+  std::vector<uint64_t> sizes(m_size);
+  MPI_Allgather(&size, 1, MPI_UINT64_T, sizes.data(), 1, MPI_UINT64_T, MPI_COMM_WORLD);
+  const uint64_t largest = *std::max_element(sizes.begin(), sizes.end());
+
+  received.assign(m_size, std::vector<char>());
+  for (int r = 0; r < m_size; r++) {
+    received[r].reserve(sizes[r]);
+  }
+
+  const uint64_t chunk = getChunkBytes(m_size);
+  std::vector<int> counts(m_size), offsets(m_size);
+  std::vector<char> receiveBuffer;
+  for (uint64_t done = 0; done < largest; done += chunk) {
+    int total = 0;
+    for (int r = 0; r < m_size; r++) {
+      counts[r] = (int)getChunkCount(sizes[r], done, chunk);
+      offsets[r] = total;
+      total += counts[r];
+    }
+    receiveBuffer.resize(total);
+    MPI_Allgatherv(send.data() + std::min(done, size), counts[m_rank], MPI_BYTE,
+      receiveBuffer.data(), counts.data(), offsets.data(), MPI_BYTE, MPI_COMM_WORLD);
+
+    for (int r = 0; r < m_size; r++) {
+      received[r].insert(received[r].end(), receiveBuffer.begin() + offsets[r], receiveBuffer.begin() + offsets[r] + counts[r]);
+    }
+  }
+}
+
+void MPITransport::allReduceSum(std::vector<double>& values) {
+  const size_t chunk = INT_MAX;
+  for (size_t done = 0; done < values.size(); done += chunk) {
+    int count = (int)std::min(chunk, values.size() - done);
+    MPI_Allreduce(MPI_IN_PLACE, values.data() + done, count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  }
+}
+
+void MPITransport::barrier() {
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#ifdef ENABLE_MPI
+#include "transport.h"
+
+// Transport over MPI_COMM_WORLD. Initialises MPI on construction and finalises it on destruction, so create one
+// per process. MPI counts are ints, so sizes travel as 64 bit values and larger buffers are sent in several rounds.
+class MPITransport : public Transport {
+private:
+  int m_rank;
+  int m_size;
+
+public:
+  MPITransport(int* argc, char*** argv);
+  ~MPITransport();
+  int getRank() override;
+  int getSize() override;
+  void exchange(const std::vector<std::vector<char>>& send, std::vector<std::vector<char>>& received) override;
+  void allGather(const std::vector<char>& send, std::vector<std::vector<char>>& received) override;
+  void allReduceSum(std::vector<double>& values) override;
+  void barrier() override;
+};
+#endif
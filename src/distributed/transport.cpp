@@ -0,0 +1,30 @@
+#include "transport.h"
+
+void Transport::allGather(const std::vector<char>& send, std::vector<std::vector<char>>& received) {
+  std::vector<std::vector<char>> outgoing(getSize(), send);
+  exchange(outgoing, received);
+}
+
+void Transport::allReduceSum(std::vector<double>& values) {
+  std::vector<char> buffer;
+  packBuffer(values, buffer);
+  std::vector<std::vector<char>> received;
+  allGather(buffer, received);
+
+  // Summed in rank order so every rank ends up with bit-identical results
+  std::vector<double> sum(values.size(), 0.0);
+  std::vector<double> other;
+  for (auto const& rankBuffer : received) {
+    unpackBuffer(rankBuffer, other);
+    for (size_t i = 0; i < sum.size() && i < other.size(); i++) {
+      sum[i] += other[i];
+    }
+  }
+  values = sum;
+}
+
+void Transport::barrier() {
+  std::vector<std::vector<char>> outgoing(getSize());
+  std::vector<std::vector<char>> received;
+  exchange(outgoing, received);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+// Collective communication between the ranks of a distributed run. Every rank calls each collective in the same
+// order, like MPI. Buffers are raw bytes so callers can send arrays of plain structs without another copy.
+// allGather and allReduceSum are built on exchange and may be overridden by backends with something faster.
+class Transport {
+public:
+  virtual ~Transport() {}
+  virtual int getRank() = 0;
+  virtual int getSize() = 0;
+  // send[r] goes to rank r, received[r] is what rank r sent here. send must have getSize() entries.
+  virtual void exchange(const std::vector<std::vector<char>>& send, std::vector<std::vector<char>>& received) = 0;
+  // received[r] is rank r's buffer, including this rank's own
+  virtual void allGather(const std::vector<char>& send, std::vector<std::vector<char>>& received);
+  // Element-wise sum over every rank, in place. Every rank must pass the same count.
+  virtual void allReduceSum(std::vector<double>& values);
+  virtual void barrier();
+};
+
+// Copies an array of plain structs in and out of a transport buffer
+template <typename T>
+void packBuffer(const std::vector<T>& items, std::vector<char>& buffer) {
+  buffer.resize(items.size() * sizeof(T));
+  if (!items.empty()) {
+    std::copy((const char*)items.data(), (const char*)items.data() + buffer.size(), buffer.data());
+  }
+}
+
+template <typename T>
+void unpackBuffer(const std::vector<char>& buffer, std::vector<T>& items) {
+  items.resize(buffer.size() / sizeof(T));
+  if (!items.empty()) {
+    std::copy(buffer.data(), buffer.data() + items.size() * sizeof(T), (char*)items.data());
+  }
+}
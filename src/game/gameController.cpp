@@ -1,9 +1,13 @@
 #include "gameController.h"
+#include <cstdio>
 #include <iostream>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "../graphics/screen/screenManager.h"
 #include "../config.h"
+#include "../profiling/tracer.h"
+#include "../profiling/gpuProfiler.h"
 
 GameController* GameController::m_instance = nullptr;
 
@@ -13,10 +17,12 @@ double GameController::m_deltaX = 0;
 double GameController::m_deltaY = 0;
 std::unordered_set<unsigned int> GameController::m_heldKeys;
 bool GameController::m_showGui = false;
+bool GameController::m_showPerfHud = false;
 
 GLFWwindow* GameController::m_window = nullptr;
 Scene* GameController::m_boundScene = nullptr;
 Gui* GameController::gui = nullptr;
+PerfHud* GameController::perfHud = nullptr;
 int GameController::m_focusedBody = -1;
 GravBody* target = nullptr;
 
@@ -25,6 +31,7 @@ GameController* GameController::getInstance(GLFWwindow* window, Scene* scene) {
   if (m_instance == nullptr) {
     m_instance = new GameController(window, scene);
     gui = new Gui();
+    perfHud = new PerfHud();
   }
   return m_instance;
 }
@@ -62,6 +69,24 @@ void GameController::processKeyInput(GLFWwindow* window, int key, int scancode,
     toggleGUI();
   }
 
+  if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+    togglePerfHud();
+  }
+
+#ifdef ENABLE_TRACING
+  if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+    Tracer::getInstance()->writeChromeTrace(config->getTraceFilePath());
+  }
+#endif
+
+  // Scrub time by a month of simulated time
+  if (key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS) {
+    seekBy(-SEEK_SECONDS);
+  }
+  if (key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS) {
+    seekBy(SEEK_SECONDS);
+  }
+
   // Store keys to be held
   if (key == GLFW_KEY_W && action == GLFW_PRESS) {
     m_heldKeys.insert(GLFW_KEY_W);
@@ -207,6 +232,22 @@ void GameController::toggleGUI() {
 
 }
 
+void GameController::togglePerfHud() {
+  m_showPerfHud = !m_showPerfHud;
+
+  // GPU timer queries are only worth their cost while someone is looking
+  GpuProfiler::getInstance()->setEnabled(m_showPerfHud);
+}
+
+void GameController::seekBy(double seconds) {
+  System* physicsSystem = m_boundScene->getPhysicsSystem();
+  double targetTime = std::max(physicsSystem->getSimulationTime() + seconds, 0.0);
+
+  double startTime = glfwGetTime();
+  physicsSystem->seek(targetTime);
+  std::cout << "Seeked to " << physicsSystem->getSimulationTime() / 86400.0 << " days in " << (glfwGetTime() - startTime) * 1000 << " ms" << std::endl;
+}
+
 void GameController::updateCamera(float deltaT) {
 
   Config* config = Config::getInstance();
@@ -247,12 +288,17 @@ void GameController::updateCamera(float deltaT) {
 }
 
 void GameController::update(float deltaT) {
-  m_boundScene->getPhysicsSystem()->update(deltaT);
+  TRACE_SCOPE("GameController::update");
+  {
+    CpuSectionTimer timer(PERF_PHYSICS);
+    m_boundScene->getPhysicsSystem()->update(deltaT);
+  }
   updateCamera(deltaT);
   updateFocusedPlanet();
 }
 
 void GameController::render(float deltaT) {
+  TRACE_SCOPE("GameController::render");
 
   // Create framebuffer and setup screen to render to
   ScreenManager* screenManager = ScreenManager::getInstance();
@@ -273,13 +319,31 @@ void GameController::render(float deltaT) {
   screenManager->renderToScreen(deltaT);
 
   // Render GUI ontop
+  TRACE_SCOPE("Gui::render");
+  PerfScope perfScope(PERF_GUI);
+  std::vector<std::string> info;
   if (target == nullptr)
   {
-      gui->render(1.0f / deltaT, m_showGui, {"Solar System View"});
+      info.push_back("Solar System View");
   }
   else
   {
-      gui->render(1.0f / deltaT, m_showGui, target->getPlanetInfo());
+      info = target->getPlanetInfo();
+  }
+
+  // Lines are drawn bottom up, so the conservation stats sit above the view info
+  ConservationSample sample;
+  if (m_showGui && m_boundScene->getPhysicsSystem()->getDiagnostics()->getLatest(sample)) {
+      char buffer[128];
+      std::snprintf(buffer, sizeof(buffer), "Energy drift: %.3e  Virial 2K/|U|: %.3f", sample.energyDrift, sample.virialRatio);
+      info.push_back(buffer);
+      std::snprintf(buffer, sizeof(buffer), "|P|: %.3e  |L|: %.3e", glm::length(sample.linearMomentum), glm::length(sample.angularMomentum));
+      info.push_back(buffer);
+  }
+  gui->render(1.0f / deltaT, m_showGui, info);
+
+  if (m_showPerfHud) {
+    perfHud->render(gui);
   }
 
 }
@@ -3,6 +3,7 @@
 #include <unordered_set>
 #include "../scene/scene.h"
 #include "../graphics/gui/gui.h"
+#include "../graphics/gui/perfHud.h"
 
 // Registers all key presses and updates camera accordingly
 class GameController {
@@ -15,13 +16,17 @@ private:
 	static double m_deltaY;
 	static std::unordered_set<unsigned int> m_heldKeys;
 	static bool m_showGui;
+	static bool m_showPerfHud;
 
 	static GLFWwindow* m_window;
 	static Scene* m_boundScene;
 	static Gui* gui;
+	static PerfHud* perfHud;
 
 	static int m_focusedBody;
 
+	static constexpr double SEEK_SECONDS = 30.0 * 86400.0;
+
 
 	GameController(GLFWwindow* window, Scene* scene);
 
@@ -32,6 +37,8 @@ private:
 	static void updateCamera(float deltaT);
 	static void updateFocusedPlanet();
 	static void toggleGUI();
+	static void togglePerfHud();
+	static void seekBy(double seconds);
 
 public:
 
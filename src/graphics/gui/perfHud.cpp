@@ -0,0 +1,133 @@
+#include <GL/glew.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstdio>
+
+#include "perfHud.h"
+#include "../../config.h"
+#include "../shader/shaderManager.h"
+
+namespace {
+    const glm::vec3 sectionColors[PERF_SECTION_COUNT] = {
+        glm::vec3(0.9f, 0.9f, 0.9f), // Frame
+        glm::vec3(0.9f, 0.4f, 0.3f), // Physics
+        glm::vec3(0.9f, 0.8f, 0.2f), // Model matrices
+        glm::vec3(0.3f, 0.8f, 0.3f), // Scene draw
+        glm::vec3(0.4f, 0.6f, 1.0f), // Bloom
+        glm::vec3(0.8f, 0.4f, 0.9f), // Luminance
+        glm::vec3(0.3f, 0.9f, 0.9f)  // GUI
+    };
+}
+
+PerfHud::PerfHud()
+{
+    glGenVertexArrays(1, &graphVAO);
+    glGenBuffers(1, &graphVBO);
+    glBindVertexArray(graphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, graphVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * FrameStats::getInstance()->getHistoryLength(), NULL, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+std::string PerfHud::formatPercentiles(PerfSection section, bool gpu)
+{
+    FrameStats* frameStats = FrameStats::getInstance();
+    FramePercentiles stats = gpu ? frameStats->getGpuPercentiles(section) : frameStats->getCpuPercentiles(section);
+    if (stats.sampleCount == 0) {
+        return "-";
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.2f %.2f %.2f", stats.p50, stats.p95, stats.p99);
+    return buffer;
+}
+
+void PerfHud::render(Gui* gui)
+{
+    glEnable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+
+    Config* config = Config::getInstance();
+    float width = config->getScreenWidth();
+    float height = config->getScreenHeight();
+    glm::mat4 projection = glm::ortho(0.0f, width, 0.0f, height);
+
+    unsigned int textShaderProgram = gui->getShader();
+    glUseProgram(textShaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(textShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    // Table of p50 / p95 / p99 in ms
+    float textScale = 0.3f;
+    float left = width - 420;
+    float y = height - 60;
+    gui->renderText("ms p50 p95 p99", left + 120, y, textScale, glm::vec3(0.8f));
+    gui->renderText("CPU", left + 120, y - 16, textScale, glm::vec3(0.8f));
+    gui->renderText("GPU", left + 270, y - 16, textScale, glm::vec3(0.8f));
+    y -= 36;
+    for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+        PerfSection section = (PerfSection)i;
+        gui->renderText(FrameStats::getSectionName(section), left, y, textScale, sectionColors[i]);
+        gui->renderText(formatPercentiles(section, false), left + 120, y, textScale, sectionColors[i]);
+        gui->renderText(formatPercentiles(section, true), left + 270, y, textScale, sectionColors[i]);
+        y -= 18;
+    }
+
+    renderGraph(left, y - 130, 400, 120, projection);
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
+
+// CPU time history of every section, scaled so the worst recent frame fits
+void PerfHud::renderGraph(float left, float bottom, float graphWidth, float graphHeight, glm::mat4& projection)
+{
+    FrameStats* frameStats = FrameStats::getInstance();
+    size_t historyLength = frameStats->getHistoryLength();
+
+    float scale = std::max(frameStats->getCpuPercentiles(PERF_FRAME).p99 * 1.2f, 1.0f);
+
+    ShaderManager* shaderManager = ShaderManager::getInstance();
+    shaderManager->bindShader(graph_vertShaderPath, graph_fragShaderPath);
+    unsigned int shaderProgram = shaderManager->getBoundShader();
+    glUseProgram(shaderProgram); // Gui switches programs behind the manager's back
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    unsigned int colorLoc = glGetUniformLocation(shaderProgram, "lineColor");
+
+    glBindVertexArray(graphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, graphVBO);
+
+    // Frame outline
+    float outline[] = {
+        left, bottom, left + graphWidth, bottom,
+        left + graphWidth, bottom + graphHeight, left, bottom + graphHeight
+    };
+    glUniform4f(colorLoc, 0.5f, 0.5f, 0.5f, 0.6f);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(outline), outline);
+    glDrawArrays(GL_LINE_LOOP, 0, 4);
+
+    for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+        frameStats->getCpuHistory((PerfSection)i, history);
+        if (history.size() < 2) {
+            continue;
+        }
+
+        lineVertices.clear();
+        float step = graphWidth / (historyLength - 1);
+        float x = left + graphWidth - step * (history.size() - 1); // Newest sample on the right edge
+        for (float sample : history) {
+            lineVertices.push_back(x);
+            lineVertices.push_back(bottom + std::min(sample / scale, 1.0f) * graphHeight);
+            x += step;
+        }
+
+        glUniform4f(colorLoc, sectionColors[i].x, sectionColors[i].y, sectionColors[i].z, 1.0f);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * lineVertices.size(), lineVertices.data());
+        glDrawArrays(GL_LINE_STRIP, 0, history.size());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
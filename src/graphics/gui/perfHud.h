@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "gui.h"
+#include "../../profiling/frameStats.h"
+
+// Frame time overlay: p50/p95/p99 per section (CPU and GPU) and a rolling graph of the CPU times.
+// Data comes from FrameStats; GPU timer queries are only issued while the HUD is visible.
+class PerfHud {
+private:
+	unsigned int graphVAO, graphVBO;
+	std::string graph_vertShaderPath = "../assets/shaders/graphShader.vs";
+	std::string graph_fragShaderPath = "../assets/shaders/graphShader.fs";
+	std::vector<float> history;
+	std::vector<float> lineVertices;
+
+	std::string formatPercentiles(PerfSection section, bool gpu);
+	void renderGraph(float left, float bottom, float graphWidth, float graphHeight, glm::mat4& projection);
+
+public:
+	PerfHud();
+	void render(Gui* gui);
+};
@@ -1,11 +1,22 @@
 #include "meshManager.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <GL/glew.h>
 #include "./meshImporter.h"
+#include "../../profiling/tracer.h"
 
 MeshManager* MeshManager::m_instance = nullptr;
 std::vector<unsigned int> MeshManager::m_bufferInfo;
 std::unordered_map<std::string, std::vector<unsigned int>> MeshManager::m_meshMap;
+std::unordered_map<std::string, float> MeshManager::m_boundingRadii;
+unsigned int MeshManager::m_sharedVAO = 0;
+unsigned int MeshManager::m_sharedVBO = 0;
+unsigned int MeshManager::m_sharedVertexCount = 0;
+unsigned int MeshManager::m_sharedVertexCapacity = 0;
+
+static const unsigned int numDataPoints = 11; // Each vertex has pos(3), tex(2), norm(3), tan(3)
 
 MeshManager::MeshManager() {};
 
@@ -20,42 +31,88 @@ std::vector<unsigned int> MeshManager::getBufferInfo() {
     return m_bufferInfo;
 }
 
+unsigned int MeshManager::getSharedVAO() {
+    return m_sharedVAO;
+}
+
+// Points the VAO's attributes at the shared vertex buffer, starting from firstVertex
+void MeshManager::setVertexAttributes(unsigned int VAO, unsigned int firstVertex) {
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_sharedVBO);
+    size_t base = sizeof(float) * numDataPoints * firstVertex;
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(base)); // Position Data
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(base + 3 * sizeof(float))); // Texture data
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(base + 5 * sizeof(float))); // Normal data
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(base + 8 * sizeof(float))); // Tangent data
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+}
+
+// Grows the shared vertex buffer to hold vertexCount vertices, copying the meshes over and re-pointing every VAO at it
+void MeshManager::reserveSharedVertices(unsigned int vertexCount) {
+    if (vertexCount <= m_sharedVertexCapacity) {
+        return;
+    }
+    unsigned int capacity = std::max(vertexCount, 2 * m_sharedVertexCapacity);
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(float) * numDataPoints * capacity, nullptr, GL_STATIC_DRAW);
+    if (m_sharedVBO != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_sharedVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(float) * numDataPoints * m_sharedVertexCount);
+        glDeleteBuffers(1, &m_sharedVBO);
+    }
+    else {
+        glGenVertexArrays(1, &m_sharedVAO);
+    }
+    m_sharedVBO = VBO;
+    m_sharedVertexCapacity = capacity;
+
+    setVertexAttributes(m_sharedVAO, 0);
+    for (auto& itr : m_meshMap) {
+        itr.second[1] = m_sharedVBO;
+        setVertexAttributes(itr.second[0], itr.second[3]);
+    }
+}
+
 void MeshManager::bindMesh(std::string meshFilePath) {
 
     // Shaders are cached so they aren't built every time
     std::string meshKey = meshFilePath;
 
     if (m_meshMap.count(meshKey) == 0) {
+        TRACE_SCOPE("Load mesh");
 
         MeshImporter importer;
         std::vector<float> meshData = importer.readSepTriMesh(meshFilePath);
         float* vertices = &meshData[0];
 
-        unsigned int numDataPoints = 11; // Each vertex has pos(3), tex(2), norm(3), tan(3)
         unsigned int numVertices = meshData.size() / numDataPoints;
 
-        // Setup buffers for data
-        unsigned int VBO, VAO;
+        // Append the mesh to the shared vertex buffer and give it a VAO starting at it
+        unsigned int firstVertex = m_sharedVertexCount;
+        reserveSharedVertices(m_sharedVertexCount + numVertices);
+        glBindBuffer(GL_ARRAY_BUFFER, m_sharedVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * numDataPoints * firstVertex, sizeof(float) * numDataPoints * numVertices, vertices);
+        m_sharedVertexCount += numVertices;
+
+        unsigned int VAO;
         glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * numDataPoints * numVertices, vertices, GL_STATIC_DRAW);
-
-        // Add attribute data
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)0); // Position Data
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(3 * sizeof(float))); // Texture data
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(5 * sizeof(float))); // Normal data
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, numDataPoints * sizeof(float), (void*)(8 * sizeof(float))); // Tangent data
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glEnableVertexAttribArray(3);
+        setVertexAttributes(VAO, firstVertex);
 
         // Add to map
-        m_meshMap[meshKey] = std::vector<unsigned int>{ VAO, VBO, numVertices };
+        m_meshMap[meshKey] = std::vector<unsigned int>{ VAO, m_sharedVBO, numVertices, firstVertex };
+
+        float boundingRadius = 0.0f;
+        for (unsigned int i = 0; i < numVertices; i++) {
+            const float* position = &meshData[i * numDataPoints];
+            boundingRadius = std::max(boundingRadius, std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]));
+        }
+        m_boundingRadii[meshKey] = boundingRadius;
 
     }
 
@@ -63,4 +120,24 @@ void MeshManager::bindMesh(std::string meshFilePath) {
     m_bufferInfo = m_meshMap.at(meshKey);
     glBindVertexArray(m_bufferInfo[0]);
 
-}
\ No newline at end of file
+}
+
+float MeshManager::getBoundingRadius(std::string meshFilePath) {
+    auto const& itr = m_boundingRadii.find(meshFilePath);
+    return itr == m_boundingRadii.end() ? 0.0f : itr->second;
+}
+
+std::vector<std::string> MeshManager::getLodMeshPaths(std::string meshFilePath) {
+    std::vector<std::string> lodPaths;
+    size_t extension = meshFilePath.find_last_of('.');
+    if (extension == std::string::npos) {
+        return lodPaths;
+    }
+    for (int level = 1; ; level++) {
+        std::string lodPath = meshFilePath.substr(0, extension) + "_lod" + std::to_string(level) + meshFilePath.substr(extension);
+        if (!std::ifstream(lodPath).good()) {
+            return lodPaths;
+        }
+        lodPaths.push_back(lodPath);
+    }
+}
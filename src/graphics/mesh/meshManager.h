@@ -9,13 +9,27 @@
 class MeshManager {
 private:
     static MeshManager* m_instance;
-    static std::vector<unsigned int> m_bufferInfo; // Contains filename -> [vao, vbo, vertexCount]
-    static std::unordered_map<std::string, std::vector<unsigned int>> m_meshMap; // Contains filename -> [vao, vbo, vertexCount]
+    static std::vector<unsigned int> m_bufferInfo; // Contains filename -> [vao, vbo, vertexCount, firstVertex]
+    static std::unordered_map<std::string, std::vector<unsigned int>> m_meshMap; // Contains filename -> [vao, vbo, vertexCount, firstVertex]
+    static std::unordered_map<std::string, float> m_boundingRadii; // Contains filename -> furthest vertex from the origin
+    // Every mesh is stored in one vertex buffer, so draws of different meshes can share a VAO
+    static unsigned int m_sharedVAO;
+    static unsigned int m_sharedVBO;
+    static unsigned int m_sharedVertexCount;
+    static unsigned int m_sharedVertexCapacity;
     MeshManager();
+    void setVertexAttributes(unsigned int VAO, unsigned int firstVertex);
+    void reserveSharedVertices(unsigned int vertexCount);
 
 public:
     static MeshManager* getInstance();
-    // Contains filename -> [vao, vbo, vertexCount]
+    // Contains filename -> [vao, vbo, vertexCount, firstVertex]. The VAO starts at the mesh, so draws from 0 to vertexCount.
     std::vector<unsigned int> getBufferInfo();
+    // VAO over the whole shared vertex buffer, draw a mesh from its firstVertex
+    unsigned int getSharedVAO();
     void bindMesh(std::string meshFilePath);
+    // Radius of the sphere around the model's origin holding every vertex, for culling. The mesh must have been bound once.
+    float getBoundingRadius(std::string meshFilePath);
+    // Coarser versions of a mesh found next to it as <name>_lod1.obj, <name>_lod2.obj, ... in order of detail
+    std::vector<std::string> getLodMeshPaths(std::string meshFilePath);
 };
\ No newline at end of file
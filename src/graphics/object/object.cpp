@@ -71,6 +71,43 @@ void Object::setParamsFromJSON(float SIUnitScaleFactor, json jsonData) {
   rotate(glm::angleAxis(3.14159f / 2, defaultRotationAxis));
 }
 
+void Object::setParamsFromSceneFile(const SceneFile& sceneFile, size_t index, const std::vector<std::string>& strings) {
+  // Values are already in system units
+  setName(strings[sceneFile.getStringId(SCENE_STRING_NAME, index)]);
+  setScale(sceneFile.getScales()[index]);
+  setPosition(sceneFile.getPositions()[index]);
+  setMesh(strings[sceneFile.getStringId(SCENE_STRING_MESH, index)]);
+  setShaders(
+    strings[sceneFile.getStringId(SCENE_STRING_VERTEX_SHADER, index)],
+    strings[sceneFile.getStringId(SCENE_STRING_FRAGMENT_SHADER, index)]
+  );
+  uint32_t diffuseMap = sceneFile.getStringId(SCENE_STRING_DIFFUSE_MAP, index);
+  if (diffuseMap != SceneFile::NO_STRING) {
+    setDiffuseMap(strings[diffuseMap]);
+  }
+  uint32_t normalMap = sceneFile.getStringId(SCENE_STRING_NORMAL_MAP, index);
+  if (normalMap != SceneFile::NO_STRING) {
+    setNormalMap(strings[normalMap]);
+  }
+  uint32_t specularMap = sceneFile.getStringId(SCENE_STRING_SPECULAR_MAP, index);
+  if (specularMap != SceneFile::NO_STRING) {
+    setSpecularMap(strings[specularMap]);
+  }
+  uint32_t emissiveMap = sceneFile.getStringId(SCENE_STRING_EMISSIVE_MAP, index);
+  if (emissiveMap != SceneFile::NO_STRING) {
+    setEmissiveMap(strings[emissiveMap]);
+  }
+  setDiffuseMapStrength(sceneFile.getMapStrengths(SCENE_STRENGTH_DIFFUSE)[index]);
+  setNormalMapStrength(sceneFile.getMapStrengths(SCENE_STRENGTH_NORMAL)[index]);
+  setSpecularMapStrength(sceneFile.getMapStrengths(SCENE_STRENGTH_SPECULAR)[index]);
+  setEmissiveMapStrength(sceneFile.getMapStrengths(SCENE_STRENGTH_EMISSIVE)[index]);
+  setIsParticle(sceneFile.isParticle(index));
+
+  // Rotate model to begin with north pole facing upward
+  const glm::vec3 defaultRotationAxis = glm::vec3(1.0f, 0.0f, 0.0f);
+  rotate(glm::angleAxis(3.14159f / 2, defaultRotationAxis));
+}
+
 void Object::setName(std::string name) {
   m_name = name;
 }
@@ -99,6 +136,14 @@ void Object::rotate(glm::quat rotation) {
   m_rotation = rotation * m_rotation;
 }
 
+glm::quat Object::getRotation() {
+  return m_rotation;
+}
+
+void Object::setRotation(glm::quat rotation) {
+  m_rotation = rotation;
+}
+
 glm::mat4 Object::getRotationMat() {
   return glm::toMat4(m_rotation);
 }
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include "nlohmann/json.hpp"
+#include "../../io/sceneFile.h"
 
 class Object {
   private:
@@ -32,6 +33,8 @@ class Object {
   public:
     Object();
     void setParamsFromJSON(float SIUnitScaleFactor, nlohmann::json jsonData);
+    // strings holds every string of the scene file, resolved once for all bodies
+    void setParamsFromSceneFile(const SceneFile& sceneFile, size_t index, const std::vector<std::string>& strings);
     void setName(std::string name);
     std::string getName();
     glm::vec3 getPosition();
@@ -39,6 +42,8 @@ class Object {
     void setPosition(glm::vec3 position);
     void setRotation(float angle, glm::vec3 axis);
     void rotate(glm::quat quat);
+    glm::quat getRotation();
+    void setRotation(glm::quat rotation);
     glm::mat4 getRotationMat();
     float getScale();
     void setScale(float scale);
@@ -3,6 +3,8 @@
 #include "screenManager.h"
 #include "../shader/shaderManager.h"
 #include "../../config.h"
+#include "../../profiling/tracer.h"
+#include "../../profiling/gpuProfiler.h"
 #include <math.h>
 
 ScreenManager* ScreenManager::m_instance = nullptr;
@@ -100,6 +102,7 @@ unsigned int get1DArrayPositionFrom2D(int x, int y, int rowWidth) {
 }
 
 float ScreenManager::calculateLuminance() {
+  TRACE_SCOPE("ScreenManager::calculateLuminance");
 
   Config* config = Config::getInstance();
   auto width = config->getScreenWidth();
@@ -109,6 +112,7 @@ float ScreenManager::calculateLuminance() {
     // No need to calculate luminance
     return 1.0f;
   }
+  PerfScope perfScope(PERF_LUMINANCE);
 
   double range = config->getAutoExposureRange();
   int rangeX = width * range;
@@ -166,6 +170,7 @@ void ScreenManager::calculateExposure(float deltaT, float luminance) {
 }
 
 void ScreenManager::applyBloom() {
+  TRACE_SCOPE("ScreenManager::applyBloom");
 
   ShaderManager* shaderManager = ShaderManager::getInstance();
   Config* config = Config::getInstance();
@@ -173,6 +178,7 @@ void ScreenManager::applyBloom() {
   if (!config->getBloomEnabled()) {
     return;
   }
+  PerfScope perfScope(PERF_BLOOM);
 
   const unsigned int width = config->getScreenWidth();
   const unsigned int height = config->getScreenHeight();
@@ -248,6 +254,7 @@ void ScreenManager::clearScreenBuffer() {
 }
 
 void ScreenManager::renderToScreen(float deltaT) {
+  TRACE_SCOPE("ScreenManager::renderToScreen");
   applyBloom();
 
   // Bind the quad to render screen texture on
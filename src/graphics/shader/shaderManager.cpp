@@ -3,6 +3,7 @@
 #include <fstream>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include "../../profiling/tracer.h"
 
 ShaderManager* ShaderManager::m_instance = nullptr;
 unsigned int ShaderManager::m_boundShader = 0;
@@ -35,6 +36,7 @@ void ShaderManager::bindComputeShader(std::string computeShaderPath) {
 	std::string shaderKey = computeShaderPath;
 
 	if (m_shaderMap.count(shaderKey) == 0) {
+		TRACE_SCOPE("Build compute shader");
 
 		std::string rawComputeShader = readShader(computeShaderPath);
 		const char* computeShaderSource = rawComputeShader.c_str();
@@ -85,6 +87,7 @@ void ShaderManager::bindShader(std::string vertexShaderPath, std::string fragSha
 	std::string shaderKey = vertexShaderPath + fragShaderPath;
 
 	if (m_shaderMap.count(shaderKey) == 0) {
+		TRACE_SCOPE("Build shader");
 
 		std::string rawVertexShader = readShader(vertexShaderPath);
 		std::string rawFragShader = readShader(fragShaderPath);
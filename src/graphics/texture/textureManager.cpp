@@ -3,12 +3,19 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../../lib/std_image.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <GL/glew.h>
 #include "../shader/shaderManager.h"
+#include "../../profiling/tracer.h"
 
 TextureManager* TextureManager::m_instance = nullptr;
 unsigned int TextureManager::m_boundTexture = 0;
 std::unordered_map<std::string, unsigned int> TextureManager::m_textureMap;
+std::vector<TextureManager::TextureArray> TextureManager::m_textureArrays;
+std::unordered_map<std::string, int> TextureManager::m_textureArrayIds;
+std::unordered_map<std::string, TextureArrayLayer> TextureManager::m_textureLayers;
+unsigned int TextureManager::m_defaultTextureArray = 0;
 
 TextureManager::TextureManager() {};
 
@@ -60,6 +67,7 @@ void TextureManager::bindTextures(std::vector<std::string>& textureFilePaths, st
 	
 		// Textures are cached so they aren't built every time
 		if (m_textureMap.count(path) == 0) {
+			TRACE_SCOPE("Load texture");
 
 			// Load the file
 			int width, height = -1;
@@ -108,3 +116,124 @@ void TextureManager::bindTextures(std::vector<std::string>& textureFilePaths, st
 
 }
 
+// Doubles the array's layers, copying the layers in use to the new texture.
+// Only the base level is copied, the array is about to gain a layer and have its mip maps regenerated anyway.
+void TextureManager::growTextureArray(TextureArray& textureArray) {
+
+	int layerCapacity = std::max(1, 2 * textureArray.layerCapacity);
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, textureArray.levels, textureArray.internalFormat, textureArray.width, textureArray.height, layerCapacity);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (textureArray.layerCount > 0) {
+		glCopyImageSubData(textureArray.texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, textureArray.width, textureArray.height, textureArray.layerCount);
+		glDeleteTextures(1, &textureArray.texture);
+	}
+	textureArray.texture = texture;
+	textureArray.layerCapacity = layerCapacity;
+
+}
+
+TextureArrayLayer TextureManager::getTextureArrayLayer(const std::string& textureFilePath, int location) {
+
+	if (textureFilePath.empty()) {
+		return { -1, 0 };
+	}
+
+	// Textures are cached so they aren't built every time
+	std::string textureType = getMapTypeFromLocation(location);
+	std::string layerKey = textureFilePath + '\n' + textureType;
+	auto const& itr = m_textureLayers.find(layerKey);
+	if (itr != m_textureLayers.end()) {
+		return itr->second;
+	}
+	TRACE_SCOPE("Load texture layer");
+
+	// Load the file
+	int width, height = -1;
+	int nrChannels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(textureFilePath.c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+
+	if (height == -1) {
+		std::cout << "Could not find load image: " << textureFilePath << std::endl;
+		m_textureLayers[layerKey] = { -1, 0 };
+		return { -1, 0 };
+	}
+
+	// Find or make the array of this size
+	unsigned int internalFormat = textureType == "diffuseMap" ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	std::string arrayKey = std::to_string(width) + 'x' + std::to_string(height) + 'x' + std::to_string(internalFormat);
+	auto const& arrayItr = m_textureArrayIds.find(arrayKey);
+	int arrayId = m_textureArrays.size();
+	if (arrayItr == m_textureArrayIds.end()) {
+		TextureArray textureArray;
+		textureArray.texture = 0;
+		textureArray.width = width;
+		textureArray.height = height;
+		textureArray.internalFormat = internalFormat;
+		textureArray.levels = (int)std::floor(std::log2((float)std::max(width, height))) + 1;
+		textureArray.layerCount = 0;
+		textureArray.layerCapacity = 0;
+		textureArray.mipmapsDirty = false;
+		m_textureArrays.push_back(textureArray);
+		m_textureArrayIds[arrayKey] = arrayId;
+	}
+	else {
+		arrayId = arrayItr->second;
+	}
+
+	// Send the texture to its layer, the mip maps are generated when the array is next bound
+	TextureArray& textureArray = m_textureArrays[arrayId];
+	if (textureArray.layerCount == textureArray.layerCapacity) {
+		growTextureArray(textureArray);
+	}
+	int layer = textureArray.layerCount++;
+	glActiveTexture(GL_TEXTURE0 + location);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.texture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	textureArray.mipmapsDirty = true;
+
+	// Free memory from cpu
+	stbi_image_free(data);
+
+	m_textureLayers[layerKey] = { arrayId, layer };
+	return { arrayId, layer };
+
+}
+
+void TextureManager::bindTextureArrays(const std::vector<int>& arrays) {
+
+	unsigned int shaderID = ShaderManager::getInstance()->getBoundShader();
+
+	if (m_defaultTextureArray == 0) {
+		const unsigned char black[4] = { 0, 0, 0, 255 };
+		glGenTextures(1, &m_defaultTextureArray);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_defaultTextureArray);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, 1, 1, 1);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, black);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	for (size_t i = 0; i < arrays.size(); i++) {
+		glUniform1i(glGetUniformLocation(shaderID, getMapTypeFromLocation((int)i).c_str()), (int)i);
+		glActiveTexture(GL_TEXTURE0 + i);
+		if (arrays[i] == -1) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_defaultTextureArray);
+			continue;
+		}
+		TextureArray& textureArray = m_textureArrays[arrays[i]];
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.texture);
+		if (textureArray.mipmapsDirty) {
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			textureArray.mipmapsDirty = false;
+		}
+	}
+
+}
@@ -3,6 +3,12 @@
 #include <vector>
 #include <unordered_map>
 
+// Where a texture lives when packed into an array of same size textures
+struct TextureArrayLayer {
+  int array; // Index of the array in TextureManager, stays the same when the array grows. -1 for no texture.
+  int layer;
+};
+
 // Singleton pattern (I think it's fine since this class takes over code in the main)
 // I could decouple, but I really like the caching feature
 // NOT THREAD SAFE
@@ -11,11 +17,33 @@ private:
   static TextureManager* m_instance;
   static unsigned int m_boundTexture;
   static std::unordered_map<std::string, unsigned int> m_textureMap; 
+
+  // Textures of the same size and colour space share a GL_TEXTURE_2D_ARRAY, one layer each
+  struct TextureArray {
+    unsigned int texture;
+    int width;
+    int height;
+    unsigned int internalFormat;
+    int levels;
+    int layerCount;
+    int layerCapacity;
+    bool mipmapsDirty; // Layers were uploaded since the mip maps were last generated
+  };
+  static std::vector<TextureArray> m_textureArrays;
+  static std::unordered_map<std::string, int> m_textureArrayIds; // width x height x format -> index in m_textureArrays
+  static std::unordered_map<std::string, TextureArrayLayer> m_textureLayers; // path + map type -> where it was packed
+  static unsigned int m_defaultTextureArray; // One black layer, bound for missing maps so nothing stale is sampled
   TextureManager();
+  void growTextureArray(TextureArray& textureArray);
 
 public:
   static TextureManager* getInstance();
   unsigned int getBoundTexture();
   std::string getMapTypeFromLocation(int location);
   void bindTextures(std::vector<std::string>& textureFilePaths, std::vector<float>& textureStrengths);
+  // Loads the texture into the array of its size the first time, the location picks the map type as in bindTextures
+  TextureArrayLayer getTextureArrayLayer(const std::string& textureFilePath, int location);
+  // Binds arrays[i] to unit i as the bound shader's sampler2DArray of map type i, a black default array for -1s.
+  // Arrays that gained layers get their mip maps generated here, once, rather than on every upload.
+  void bindTextureArrays(const std::vector<int>& arrays);
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "checkpointWriter.h"
+#include <cstdio>
+#include <iostream>
+#include "snapshotFile.h"
+#include "../profiling/tracer.h"
+
+CheckpointWriter::CheckpointWriter() {
+  m_captureIndex = 0;
+  m_writePending = false;
+  m_running = false;
+  m_enabled = false;
+  m_filePrefix = "../checkpoint";
+  m_intervalSeconds = 3600.0;
+  m_retention = 3;
+  m_lastCheckpoint = std::chrono::steady_clock::now();
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  if (m_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+  }
+}
+
+void CheckpointWriter::configure(bool enabled, std::string filePrefix, double intervalSeconds, unsigned int retention) {
+  m_enabled = enabled;
+  m_filePrefix = filePrefix;
+  m_intervalSeconds = intervalSeconds;
+  m_retention = retention > 0 ? retention : 1;
+  m_lastCheckpoint = std::chrono::steady_clock::now();
+
+  // Only spin up the background thread once checkpoints are actually wanted
+  if (m_enabled && !m_thread.joinable()) {
+    m_running = true;
+    m_thread = std::thread(&CheckpointWriter::run, this);
+  }
+}
+
+bool CheckpointWriter::isEnabled() {
+  return m_enabled;
+}
+
+bool CheckpointWriter::isCheckpointDue() {
+  if (!m_enabled) {
+    return false;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_lastCheckpoint;
+  return elapsed.count() >= m_intervalSeconds;
+}
+
+Snapshot* CheckpointWriter::acquireBuffer() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_writePending) {
+    return nullptr;
+  }
+  return &m_buffers[m_captureIndex];
+}
+
+void CheckpointWriter::submit() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Swap buffers, the writer thread now owns the captured one
+    m_captureIndex = 1 - m_captureIndex;
+    m_writePending = true;
+  }
+  m_lastCheckpoint = std::chrono::steady_clock::now();
+  m_condition.notify_all();
+}
+
+void CheckpointWriter::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this] { return !m_writePending; });
+}
+
+void CheckpointWriter::run() {
+  TRACE_THREAD_NAME("Checkpoint writer");
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return m_writePending || !m_running; });
+    if (!m_writePending && !m_running) {
+      return;
+    }
+
+    // The buffer not being captured into belongs to this thread until the write finishes
+    const Snapshot& snapshot = m_buffers[1 - m_captureIndex];
+    lock.unlock();
+    writeCheckpoint(snapshot);
+    lock.lock();
+
+    m_writePending = false;
+    m_condition.notify_all();
+  }
+}
+
+void CheckpointWriter::writeCheckpoint(const Snapshot& snapshot) {
+  TRACE_SCOPE("Write checkpoint");
+  std::string filePath = m_filePrefix + "_" + std::to_string(snapshot.step) + ".snap";
+  if (!SnapshotFile::write(filePath, snapshot, true)) {
+    return;
+  }
+  m_writtenFiles.push_back(filePath);
+
+  // Drop the oldest checkpoints beyond the retention count
+  while (m_writtenFiles.size() > m_retention) {
+    std::remove(m_writtenFiles.front().c_str());
+    m_writtenFiles.pop_front();
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "../physics/snapshot.h"
+
+// Writes periodic checkpoints of a System without stalling the simulation thread.
+// The simulation thread copies body state into the capture buffer at a step boundary and hands it off;
+// a background thread then encodes, compresses and writes it. Only two snapshots ever exist (capture + write),
+// so if the previous checkpoint is still being written the new one is simply retried on a later step.
+class CheckpointWriter {
+private:
+  Snapshot m_buffers[2];
+  unsigned int m_captureIndex;
+  bool m_writePending;
+  bool m_running;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+
+  bool m_enabled;
+  std::string m_filePrefix; // Checkpoints are written to <prefix>_<step>.snap
+  double m_intervalSeconds; // Wall clock time between checkpoints
+  unsigned int m_retention; // Number of checkpoint files kept on disk
+  std::chrono::steady_clock::time_point m_lastCheckpoint;
+  std::deque<std::string> m_writtenFiles;
+
+  void run();
+  void writeCheckpoint(const Snapshot& snapshot);
+
+public:
+  CheckpointWriter();
+  ~CheckpointWriter();
+  void configure(bool enabled, std::string filePrefix, double intervalSeconds, unsigned int retention);
+  bool isEnabled();
+  bool isCheckpointDue();
+  // Returns the buffer to capture into, or nullptr if the previous checkpoint hasn't finished writing
+  Snapshot* acquireBuffer();
+  void submit();
+  // Blocks until any pending checkpoint is on disk
+  void flush();
+};
@@ -0,0 +1,143 @@
+#include "compression.h"
+#include <cstring>
+
+namespace {
+  const size_t MIN_MATCH = 4;
+  const size_t MAX_OFFSET = 65535;
+  const unsigned int HASH_BITS = 16;
+
+  uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  void emitSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount, size_t matchLength, size_t offset) {
+    Compression::writeVarint(out, literalCount);
+    out.insert(out.end(), literals, literals + literalCount);
+    // A match length of 0 marks the final (literal only) sequence
+    Compression::writeVarint(out, matchLength == 0 ? 0 : matchLength - MIN_MATCH + 1);
+    if (matchLength != 0) {
+      Compression::writeVarint(out, offset);
+    }
+  }
+}
+
+void Compression::writeVarint(std::vector<unsigned char>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((unsigned char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((unsigned char)value);
+}
+
+bool Compression::readVarint(const unsigned char* data, size_t size, size_t& position, uint64_t& value) {
+  value = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    if (position >= size) {
+      return false;
+    }
+    unsigned char byte = data[position++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<unsigned char> Compression::compress(const unsigned char* data, size_t size) {
+  std::vector<unsigned char> out;
+  out.reserve(size / 2 + 16);
+
+  std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+  size_t position = 0;
+  size_t anchor = 0;
+
+  while (position + MIN_MATCH <= size) {
+    uint32_t sequence = read32(data + position);
+    uint32_t slot = hash(sequence);
+    int64_t candidate = table[slot];
+    table[slot] = (int64_t)position;
+
+    if (candidate >= 0 && position - candidate <= MAX_OFFSET && read32(data + candidate) == sequence) {
+      size_t length = MIN_MATCH;
+      while (position + length < size && data[candidate + length] == data[position + length]) {
+        length++;
+      }
+      emitSequence(out, data + anchor, position - anchor, length, position - (size_t)candidate);
+      position += length;
+      anchor = position;
+    }
+    else {
+      // Skip faster through data that isn't compressing
+      position += 1 + ((position - anchor) >> 6);
+    }
+  }
+
+  emitSequence(out, data + anchor, size - anchor, 0, 0);
+  return out;
+}
+
+bool Compression::decompress(const unsigned char* data, size_t size, size_t rawSize, std::vector<unsigned char>& result) {
+  result.clear();
+  result.reserve(rawSize);
+  size_t position = 0;
+
+  while (true) {
+    uint64_t literalCount, matchCode;
+    if (!readVarint(data, size, position, literalCount) || literalCount > size - position) {
+      return false;
+    }
+    result.insert(result.end(), data + position, data + position + literalCount);
+    position += literalCount;
+
+    if (!readVarint(data, size, position, matchCode)) {
+      return false;
+    }
+    if (matchCode == 0) {
+      break;
+    }
+
+    uint64_t offset;
+    if (!readVarint(data, size, position, offset) || offset == 0 || offset > result.size()) {
+      return false;
+    }
+    size_t length = matchCode - 1 + MIN_MATCH;
+    if (result.size() + length > rawSize) {
+      return false;
+    }
+    // Copy byte by byte since the match may overlap the bytes it is producing
+    size_t start = result.size() - offset;
+    for (size_t i = 0; i < length; i++) {
+      result.push_back(result[start + i]);
+    }
+  }
+
+  return result.size() == rawSize;
+}
+
+void Compression::shuffle(const unsigned char* data, size_t size, size_t elementSize, unsigned char* result) {
+  size_t count = size / elementSize;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t b = 0; b < elementSize; b++) {
+      result[b * count + i] = data[i * elementSize + b];
+    }
+  }
+  // Trailing bytes that don't make up a whole element are copied as is
+  std::memcpy(result + count * elementSize, data + count * elementSize, size - count * elementSize);
+}
+
+void Compression::unshuffle(const unsigned char* data, size_t size, size_t elementSize, unsigned char* result) {
+  size_t count = size / elementSize;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t b = 0; b < elementSize; b++) {
+      result[i * elementSize + b] = data[b * count + i];
+    }
+  }
+  std::memcpy(result + count * elementSize, data + count * elementSize, size - count * elementSize);
+}
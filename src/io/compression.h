@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Small self-contained codecs for simulation output.
+// compress() is a byte-oriented LZ77 variant (hashed 4 byte matches, 64KB window) that favours speed over ratio.
+// Float data compresses far better once shuffled so that equal-significance bytes sit next to each other.
+class Compression {
+public:
+  static std::vector<unsigned char> compress(const unsigned char* data, size_t size);
+  static bool decompress(const unsigned char* data, size_t size, size_t rawSize, std::vector<unsigned char>& result);
+
+  // Transposes an array of elementSize byte elements into elementSize planes of bytes (and back)
+  static void shuffle(const unsigned char* data, size_t size, size_t elementSize, unsigned char* result);
+  static void unshuffle(const unsigned char* data, size_t size, size_t elementSize, unsigned char* result);
+
+  static void writeVarint(std::vector<unsigned char>& out, uint64_t value);
+  static bool readVarint(const unsigned char* data, size_t size, size_t& position, uint64_t& value);
+};
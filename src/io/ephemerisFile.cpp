@@ -0,0 +1,77 @@
+#include "ephemerisFile.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace {
+  const char MAGIC[8] = { 'S', 'S', 'E', 'P', 'H', 'M', '\0', '\0' };
+  const uint32_t VERSION = 1;
+
+  struct EphemerisHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t degree;
+    uint64_t intervalCount;
+    uint64_t bodyCount;
+    double startTime;
+    double intervalLength;
+  };
+}
+
+bool EphemerisFile::write(std::string filePath, Ephemeris& ephemeris) {
+  EphemerisHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.degree = ephemeris.getDegree();
+  header.intervalCount = ephemeris.getIntervalCount();
+  header.bodyCount = ephemeris.getBodyCount();
+  header.startTime = ephemeris.getStartTime();
+  header.intervalLength = ephemeris.getIntervalLength();
+
+  // Same temp file + rename approach as SnapshotFile so a half written file never replaces a good one
+  std::string tempPath = filePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    std::vector<double>& coefficients = ephemeris.getCoefficients();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(coefficients.data()), coefficients.size() * sizeof(double));
+    if (!file) {
+      std::cout << "Failed to write ephemeris: " << tempPath << std::endl;
+      return false;
+    }
+  }
+
+  std::remove(filePath.c_str());
+  if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+    std::cout << "Failed to move ephemeris into place: " << filePath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool EphemerisFile::read(std::string filePath, Ephemeris& ephemeris) {
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file) {
+    std::cout << "Could not open ephemeris: " << filePath << std::endl;
+    return false;
+  }
+
+  EphemerisHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.intervalLength <= 0.0) {
+    std::cout << "Invalid ephemeris file: " << filePath << std::endl;
+    return false;
+  }
+
+  ephemeris.reset(header.startTime, header.intervalLength, header.degree, header.intervalCount, header.bodyCount);
+  std::vector<double>& coefficients = ephemeris.getCoefficients();
+  file.read(reinterpret_cast<char*>(coefficients.data()), coefficients.size() * sizeof(double));
+  if (!file) {
+    std::cout << "Ephemeris file is truncated: " << filePath << std::endl;
+    ephemeris.reset(0.0, 1.0, 0, 0, 0);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include "../physics/ephemeris.h"
+
+// Binary on-disk format for an Ephemeris.
+// Layout: fixed header (magic, version, degree, counts, time span) followed by the raw coefficient array
+// in Ephemeris order. Coefficients are doubles in host (little endian) order.
+class EphemerisFile {
+public:
+  static bool write(std::string filePath, Ephemeris& ephemeris);
+  static bool read(std::string filePath, Ephemeris& ephemeris);
+};
@@ -0,0 +1,131 @@
+#include "mappedFile.h"
+#include <iostream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr) {
+}
+
+bool MappedFile::open(std::string filePath) {
+  close();
+  m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    std::cout << "Could not open file: " << filePath << std::endl;
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_file, &size)) {
+    close();
+    return false;
+  }
+  m_size = (size_t)size.QuadPart;
+  if (m_size == 0) {
+    // Empty files can't be mapped, but are still valid
+    return true;
+  }
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping == nullptr) {
+    std::cout << "Could not map file: " << filePath << std::endl;
+    close();
+    return false;
+  }
+  m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (m_data == nullptr) {
+    std::cout << "Could not map file: " << filePath << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data != nullptr) {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(m_file);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_mapping = nullptr;
+  m_file = INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::isOpen() {
+  return m_file != INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_file(-1) {
+}
+
+bool MappedFile::open(std::string filePath) {
+  close();
+  m_file = ::open(filePath.c_str(), O_RDONLY);
+  if (m_file < 0) {
+    std::cout << "Could not open file: " << filePath << std::endl;
+    return false;
+  }
+  struct stat status;
+  if (fstat(m_file, &status) != 0) {
+    close();
+    return false;
+  }
+  m_size = (size_t)status.st_size;
+  if (m_size == 0) {
+    // Empty files can't be mapped, but are still valid
+    return true;
+  }
+  void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+  if (data == MAP_FAILED) {
+    std::cout << "Could not map file: " << filePath << std::endl;
+    close();
+    return false;
+  }
+  m_data = (const unsigned char*)data;
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data != nullptr) {
+    munmap((void*)m_data, m_size);
+  }
+  if (m_file >= 0) {
+    ::close(m_file);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_file = -1;
+}
+
+bool MappedFile::isOpen() {
+  return m_file >= 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+const unsigned char* MappedFile::getData() {
+  return m_data;
+}
+
+size_t MappedFile::getSize() {
+  return m_size;
+}
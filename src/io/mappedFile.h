@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read only memory mapping of a whole file. The pages are loaded by the OS as they are touched,
+// so opening is constant time and only the parts of the file that are read cost anything.
+class MappedFile {
+private:
+  const unsigned char* m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void* m_file;
+  void* m_mapping;
+#else
+  int m_file;
+#endif
+
+public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(std::string filePath);
+  void close();
+  bool isOpen();
+  const unsigned char* getData();
+  size_t getSize();
+};
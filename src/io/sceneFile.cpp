@@ -0,0 +1,686 @@
+#include "sceneFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "sceneJSONReader.h"
+#include "snapshotFile.h"
+
+namespace {
+  const char MAGIC[8] = { 'S', 'S', 'S', 'C', 'E', 'N', 'E', '\0' };
+  const uint32_t VERSION = 1;
+  const uint8_t FLAG_PARTICLE = 1;
+
+  struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t bodyCount;
+    uint64_t lightCount;
+    uint64_t stringCount;
+    uint64_t infoCount;
+    uint64_t stringBytes;
+    float SIUnitScaleFactor;
+    float universeScaleFactor;
+    float cameraPosition[3];
+    float ambientStrength;
+    float specularStrength;
+    float phongExponent;
+  };
+
+  const size_t FLOATS_PER_LIGHT = 7; // position(3), color(3), intensity
+
+  // Planet info keys in the order GravBody lists them, with the label shown for each
+  const char* PLANET_INFO_KEYS[SCENE_INFO_COUNT][2] = {
+    { "Type", "Type: " },
+    { "Radius", "Radius: " },
+    { "Orbital Period", "Orbital Period: " },
+    { "Length of Day", "Length of a Day: " },
+    { "Temperature", "Temperature: " }
+  };
+
+  const char* STRING_KEYS[SCENE_STRING_COUNT] = {
+    "name", "meshFilePath", "vertexShaderPath", "fragmentShaderPath", "diffuseMap", "normalMap", "specularMap", "emissiveMap"
+  };
+  const char* STRENGTH_KEYS[SCENE_STRENGTH_COUNT] = {
+    "diffuseMapStrength", "normalMapStrength", "specularMapStrength", "emissiveMapStrength"
+  };
+
+  size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+  }
+
+  // Byte offsets of every section, derived from the header counts alone
+  struct SceneFileLayout {
+    size_t lights;
+    size_t masses;
+    size_t scales;
+    size_t tilts;
+    size_t rotationPeriods;
+    size_t positions;
+    size_t velocities;
+    size_t strengths;
+    size_t flags;
+    size_t stringIds;
+    size_t infoOffsets;
+    size_t infoIds;
+    size_t stringOffsets;
+    size_t strings;
+    size_t end;
+  };
+
+  SceneFileLayout getLayout(const SceneFileHeader& header) {
+    const size_t bodies = header.bodyCount;
+    SceneFileLayout layout;
+    size_t offset = align8(sizeof(SceneFileHeader));
+    auto section = [&offset](size_t bytes) {
+      size_t start = offset;
+      offset = align8(offset + bytes);
+      return start;
+    };
+    layout.lights = section(header.lightCount * FLOATS_PER_LIGHT * sizeof(float));
+    layout.masses = section(bodies * sizeof(float));
+    layout.scales = section(bodies * sizeof(float));
+    layout.tilts = section(bodies * sizeof(float));
+    layout.rotationPeriods = section(bodies * sizeof(float));
+    layout.positions = section(bodies * 3 * sizeof(float));
+    layout.velocities = section(bodies * 3 * sizeof(float));
+    layout.strengths = section(bodies * SCENE_STRENGTH_COUNT * sizeof(float));
+    layout.flags = section(bodies * sizeof(uint8_t));
+    layout.stringIds = section(bodies * SCENE_STRING_COUNT * sizeof(uint32_t));
+    layout.infoOffsets = section((bodies + 1) * sizeof(uint32_t));
+    layout.infoIds = section(header.infoCount * sizeof(uint32_t));
+    layout.stringOffsets = section((header.stringCount + 1) * sizeof(uint64_t));
+    layout.strings = section(header.stringBytes);
+    layout.end = offset;
+    return layout;
+  }
+
+  // Same temporary file and rename as snapshots, so a failed compile never leaves half a scene
+  bool writeSceneFile(const std::vector<unsigned char>& encoded, std::string filePath) {
+    std::string tempPath = filePath + ".tmp";
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        std::cout << "Could not open scene file for writing: " << tempPath << std::endl;
+        return false;
+      }
+      file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+      if (!file) {
+        std::cout << "Failed writing scene file: " << tempPath << std::endl;
+        return false;
+      }
+    }
+    std::remove(filePath.c_str());
+    if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+      std::cout << "Could not move scene file into place: " << filePath << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  template <typename T>
+  void writeSection(std::vector<unsigned char>& result, size_t offset, const std::vector<T>& values) {
+    if (!values.empty()) {
+      std::memcpy(result.data() + offset, values.data(), values.size() * sizeof(T));
+    }
+  }
+}
+
+// Deduplicates strings into one block of characters, ids in order of first use
+class SceneStringTable {
+private:
+  std::unordered_map<std::string, uint32_t> m_ids;
+  std::vector<uint64_t> m_offsets = { 0 };
+  std::string m_characters;
+
+public:
+  uint32_t add(const std::string& text) {
+    auto found = m_ids.find(text);
+    if (found != m_ids.end()) {
+      return found->second;
+    }
+    uint32_t id = (uint32_t)m_ids.size();
+    m_ids[text] = id;
+    m_characters += text;
+    m_offsets.push_back(m_characters.size());
+    return id;
+  }
+  size_t getCount() const { return m_offsets.size() - 1; }
+  const std::vector<uint64_t>& getOffsets() const { return m_offsets; }
+  const std::string& getCharacters() const { return m_characters; }
+};
+
+const uint32_t SceneFile::NO_STRING;
+
+SceneFileBody::SceneFileBody() {
+  for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+    hasString[field] = false;
+  }
+  for (int map = 0; map < SCENE_STRENGTH_COUNT; map++) {
+    mapStrengths[map] = 1.0f;
+  }
+  for (int info = 0; info < SCENE_INFO_COUNT; info++) {
+    hasPlanetInfo[info] = false;
+  }
+  mass = 0.0f;
+  radius = 0.0f;
+  tilt = 0.0f;
+  rotationPeriod = 0.0f;
+  position = glm::vec3(0.0f);
+  velocity = glm::vec3(0.0f);
+  isParticle = false;
+}
+
+SceneFileBuilder::SceneFileBuilder() : m_strings(new SceneStringTable()) {
+  m_SIUnitScaleFactor = 1.0f;
+  m_universeScaleFactor = 1.0f;
+  m_cameraPosition = glm::vec3(0.0f);
+  m_ambientStrength = 0.0f;
+  m_specularStrength = 0.0f;
+  m_phongExponent = 0.0f;
+  m_bodyCount = 0;
+  m_inSystemUnits = false;
+  m_infoOffsets.push_back(0);
+  for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+    m_previousIds[field] = SceneFile::NO_STRING;
+  }
+}
+
+SceneFileBuilder::~SceneFileBuilder() {
+}
+
+void SceneFileBuilder::setSIUnitScaleFactor(float SIUnitScaleFactor) {
+  m_SIUnitScaleFactor = SIUnitScaleFactor;
+}
+
+void SceneFileBuilder::setUniverseScaleFactor(float universeScaleFactor) {
+  m_universeScaleFactor = universeScaleFactor;
+}
+
+void SceneFileBuilder::setCameraPosition(glm::vec3 position) {
+  m_cameraPosition = position;
+}
+
+void SceneFileBuilder::setLighting(float ambientStrength, float specularStrength, float phongExponent) {
+  m_ambientStrength = ambientStrength;
+  m_specularStrength = specularStrength;
+  m_phongExponent = phongExponent;
+}
+
+void SceneFileBuilder::addLight(glm::vec3 position, glm::vec3 color, float intensity) {
+  m_lights.insert(m_lights.end(), { position.x, position.y, position.z, color.x, color.y, color.z, intensity });
+}
+
+void SceneFileBuilder::addBody(const SceneFileBody& body) {
+  m_masses.push_back(body.mass);
+  m_scales.push_back(body.radius);
+  m_tilts.push_back(body.tilt);
+  m_rotationPeriods.push_back(body.rotationPeriod);
+  m_positions.insert(m_positions.end(), { body.position.x, body.position.y, body.position.z });
+  m_velocities.insert(m_velocities.end(), { body.velocity.x, body.velocity.y, body.velocity.z });
+  m_strengths.insert(m_strengths.end(), body.mapStrengths, body.mapStrengths + SCENE_STRENGTH_COUNT);
+  m_flags.push_back(body.isParticle ? FLAG_PARTICLE : 0);
+  for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+    if (!body.hasString[field]) {
+      m_stringIds.push_back(SceneFile::NO_STRING);
+      continue;
+    }
+    // Neighbouring bodies nearly always share their paths, a compare is much cheaper than hashing them again
+    if (m_previousIds[field] == SceneFile::NO_STRING || body.strings[field] != m_previousStrings[field]) {
+      m_previousIds[field] = m_strings->add(body.strings[field]);
+      m_previousStrings[field] = body.strings[field];
+    }
+    m_stringIds.push_back(m_previousIds[field]);
+  }
+  for (int info = 0; info < SCENE_INFO_COUNT; info++) {
+    if (body.hasPlanetInfo[info]) {
+      m_infoIds.push_back(m_strings->add(SceneFile::getPlanetInfoLabel((ScenePlanetInfo)info) + body.planetInfo[info]));
+    }
+  }
+  m_infoOffsets.push_back((uint32_t)m_infoIds.size());
+  m_bodyCount++;
+}
+
+void SceneFileBuilder::setInSystemUnits(bool inSystemUnits) {
+  m_inSystemUnits = inSystemUnits;
+}
+
+size_t SceneFileBuilder::getBodyCount() {
+  return m_bodyCount;
+}
+
+std::vector<unsigned char> SceneFileBuilder::finish() {
+  // Bodies may come before SIUnitScaleFactor in the JSON, so units are only converted here
+  const float SIUnitScaleFactor = m_inSystemUnits ? 1.0f : m_SIUnitScaleFactor;
+  const size_t bodyCount = m_bodyCount;
+  auto toSystemUnits = [SIUnitScaleFactor](std::vector<float>& values) {
+    for (float& value : values) {
+      value = value / SIUnitScaleFactor;
+    }
+  };
+  toSystemUnits(m_masses);
+  toSystemUnits(m_scales);
+  toSystemUnits(m_positions);
+  toSystemUnits(m_velocities);
+  for (size_t i = 0; i < m_lights.size(); i += FLOATS_PER_LIGHT) {
+    for (size_t axis = 0; axis < 3; axis++) {
+      m_lights[i + axis] = m_lights[i + axis] / SIUnitScaleFactor;
+    }
+  }
+
+  // Bodies were added as rows, the file stores one array per field
+  std::vector<float> strengths(bodyCount * SCENE_STRENGTH_COUNT);
+  for (size_t body = 0; body < bodyCount; body++) {
+    for (size_t map = 0; map < SCENE_STRENGTH_COUNT; map++) {
+      strengths[map * bodyCount + body] = m_strengths[body * SCENE_STRENGTH_COUNT + map];
+    }
+  }
+  std::vector<uint32_t> stringIds(bodyCount * SCENE_STRING_COUNT);
+  for (size_t body = 0; body < bodyCount; body++) {
+    for (size_t field = 0; field < SCENE_STRING_COUNT; field++) {
+      stringIds[field * bodyCount + body] = m_stringIds[body * SCENE_STRING_COUNT + field];
+    }
+  }
+
+  SceneFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.bodyCount = bodyCount;
+  header.lightCount = m_lights.size() / FLOATS_PER_LIGHT;
+  header.stringCount = m_strings->getCount();
+  header.infoCount = m_infoIds.size();
+  header.stringBytes = m_strings->getCharacters().size();
+  header.SIUnitScaleFactor = m_SIUnitScaleFactor;
+  header.universeScaleFactor = m_universeScaleFactor;
+  header.cameraPosition[0] = m_cameraPosition.x / SIUnitScaleFactor;
+  header.cameraPosition[1] = m_cameraPosition.y / SIUnitScaleFactor;
+  header.cameraPosition[2] = m_cameraPosition.z / SIUnitScaleFactor;
+  header.ambientStrength = m_ambientStrength;
+  header.specularStrength = m_specularStrength;
+  header.phongExponent = m_phongExponent;
+
+  SceneFileLayout layout = getLayout(header);
+  std::vector<unsigned char> result(layout.end, 0);
+  std::memcpy(result.data(), &header, sizeof(header));
+  writeSection(result, layout.lights, m_lights);
+  writeSection(result, layout.masses, m_masses);
+  writeSection(result, layout.scales, m_scales);
+  writeSection(result, layout.tilts, m_tilts);
+  writeSection(result, layout.rotationPeriods, m_rotationPeriods);
+  writeSection(result, layout.positions, m_positions);
+  writeSection(result, layout.velocities, m_velocities);
+  writeSection(result, layout.strengths, strengths);
+  writeSection(result, layout.flags, m_flags);
+  writeSection(result, layout.stringIds, stringIds);
+  writeSection(result, layout.infoOffsets, m_infoOffsets);
+  writeSection(result, layout.infoIds, m_infoIds);
+  writeSection(result, layout.stringOffsets, m_strings->getOffsets());
+  std::memcpy(result.data() + layout.strings, m_strings->getCharacters().data(), header.stringBytes);
+  return result;
+}
+
+std::vector<unsigned char> SceneFile::encode(const nlohmann::json& jScene) {
+  SceneFileBuilder builder;
+  builder.setSIUnitScaleFactor(jScene.at("SIUnitScaleFactor").get<float>());
+  builder.setUniverseScaleFactor(jScene.at("UniverseScaleFactor").get<float>());
+  const nlohmann::json& cameraJSON = jScene.at("CameraPosition");
+  builder.setCameraPosition(glm::vec3(cameraJSON.at("x").get<float>(), cameraJSON.at("y").get<float>(), cameraJSON.at("z").get<float>()));
+  builder.setLighting(
+    jScene.at("ambientStrength").get<float>(),
+    jScene.at("specularStrength").get<float>(),
+    jScene.at("phongExponent").get<float>()
+  );
+
+  if (jScene.contains("Lights")) {
+    for (auto const& lightJSON : jScene.at("Lights")) {
+      const nlohmann::json& position = lightJSON.at("position");
+      const nlohmann::json& color = lightJSON.at("color");
+      builder.addLight(
+        glm::vec3(position.at("x").get<float>(), position.at("y").get<float>(), position.at("z").get<float>()),
+        glm::vec3(color.at("red").get<float>(), color.at("green").get<float>(), color.at("blue").get<float>()),
+        lightJSON.at("intensity").get<float>()
+      );
+    }
+  }
+
+  for (auto const& bodyJSON : jScene.at("GravBodies")) {
+    SceneFileBody body;
+    body.mass = bodyJSON.at("mass").get<float>();
+    body.radius = bodyJSON.at("radius").get<float>();
+    body.tilt = bodyJSON.at("tilt").get<float>();
+    body.rotationPeriod = bodyJSON.at("rotationPeriod").get<float>();
+    const nlohmann::json& position = bodyJSON.at("position");
+    body.position = glm::vec3(position.at("x").get<float>(), position.at("y").get<float>(), position.at("z").get<float>());
+    const nlohmann::json& velocity = bodyJSON.at("velocity");
+    body.velocity = glm::vec3(velocity.at("x").get<float>(), velocity.at("y").get<float>(), velocity.at("z").get<float>());
+    for (int map = 0; map < SCENE_STRENGTH_COUNT; map++) {
+      const char* key = getMapStrengthKey((SceneMapStrength)map);
+      if (bodyJSON.contains(key)) {
+        body.mapStrengths[map] = bodyJSON.at(key).get<float>();
+      }
+    }
+    body.isParticle = bodyJSON.contains("isParticle") && bodyJSON.at("isParticle").get<bool>();
+    // The first four are required, like the JSON loader
+    for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+      const char* key = getStringKey((SceneString)field);
+      if (field <= SCENE_STRING_FRAGMENT_SHADER || bodyJSON.contains(key)) {
+        body.strings[field] = bodyJSON.at(key).get<std::string>();
+        body.hasString[field] = true;
+      }
+    }
+    for (int info = 0; info < SCENE_INFO_COUNT; info++) {
+      const char* key = getPlanetInfoKey((ScenePlanetInfo)info);
+      if (bodyJSON.contains(key)) {
+        body.planetInfo[info] = bodyJSON.at(key).get<std::string>();
+        body.hasPlanetInfo[info] = true;
+      }
+    }
+    builder.addBody(body);
+  }
+  return builder.finish();
+}
+
+bool SceneFile::compile(std::string jsonFilePath, std::string filePath) {
+  std::vector<unsigned char> encoded;
+  if (!SceneJSONReader::read(jsonFilePath, encoded)) {
+    return false;
+  }
+
+  return writeSceneFile(encoded, filePath);
+}
+
+std::vector<unsigned char> SceneFile::encode(const Snapshot& snapshot, const SceneFile& templateScene) {
+  // Everything is copied in system units, galaxy masses in kg wouldn't even fit a float
+  SceneFileBuilder builder;
+  builder.setInSystemUnits(true);
+  builder.setSIUnitScaleFactor(templateScene.getSIUnitScaleFactor());
+  builder.setUniverseScaleFactor(templateScene.getUniverseScaleFactor());
+  builder.setCameraPosition(templateScene.getCameraPosition());
+  builder.setLighting(templateScene.getAmbientStrength(), templateScene.getSpecularStrength(), templateScene.getPhongExponent());
+  for (size_t i = 0; i < templateScene.getLightCount(); i++) {
+    SceneLight light = templateScene.getLight(i);
+    builder.addLight(light.position, light.color, light.intensity);
+  }
+
+  SceneFileBody body;
+  body.radius = templateScene.getScales()[0];
+  body.tilt = templateScene.getTilts()[0];
+  body.rotationPeriod = templateScene.getRotationPeriods()[0];
+  body.isParticle = templateScene.isParticle(0);
+  for (int map = 0; map < SCENE_STRENGTH_COUNT; map++) {
+    body.mapStrengths[map] = templateScene.getMapStrengths((SceneMapStrength)map)[0];
+  }
+  for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+    uint32_t id = templateScene.getStringId((SceneString)field, 0);
+    body.hasString[field] = id != NO_STRING;
+    if (body.hasString[field]) {
+      body.strings[field] = templateScene.getString(id);
+    }
+  }
+  // Info lines are stored with their labels, the builder adds them back
+  for (uint32_t id : templateScene.getPlanetInfoIds(0)) {
+    std::string line = templateScene.getString(id);
+    for (int info = 0; info < SCENE_INFO_COUNT; info++) {
+      std::string label = getPlanetInfoLabel((ScenePlanetInfo)info);
+      if (line.compare(0, label.size(), label) == 0) {
+        body.planetInfo[info] = line.substr(label.size());
+        body.hasPlanetInfo[info] = true;
+        break;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < snapshot.getBodyCount(); i++) {
+    body.mass = snapshot.masses[i];
+    body.position = snapshot.positions[i];
+    body.velocity = snapshot.velocities[i];
+    builder.addBody(body);
+  }
+  return builder.finish();
+}
+
+bool SceneFile::compileSnapshot(std::string snapshotFilePath, std::string templateFilePath, std::string filePath) {
+  Snapshot snapshot;
+  if (!SnapshotFile::read(snapshotFilePath, snapshot)) {
+    return false;
+  }
+
+  SceneFile templateScene;
+  if (isSceneFile(templateFilePath)) {
+    if (!templateScene.open(templateFilePath)) {
+      return false;
+    }
+  }
+  else {
+    std::vector<unsigned char> encoded;
+    if (!SceneJSONReader::read(templateFilePath, encoded) || !templateScene.open(std::move(encoded))) {
+      return false;
+    }
+  }
+  if (templateScene.getBodyCount() == 0) {
+    std::cout << "Scene template " << templateFilePath << " needs a body for the snapshot's bodies to copy" << std::endl;
+    return false;
+  }
+
+  return writeSceneFile(encode(snapshot, templateScene), filePath);
+}
+
+bool SceneFile::isSceneFile(std::string filePath) {
+  std::ifstream file(filePath, std::ios::binary);
+  char magic[sizeof(MAGIC)];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+SceneFile::SceneFile() {
+  m_bodyCount = 0;
+  m_lightCount = 0;
+  m_stringCount = 0;
+}
+
+bool SceneFile::open(std::string filePath) {
+  m_buffer.clear();
+  if (!m_file.open(filePath)) {
+    return false;
+  }
+  if (!parse(m_file.getData(), m_file.getSize())) {
+    std::cout << "Invalid scene file: " << filePath << std::endl;
+    m_file.close();
+    return false;
+  }
+  return true;
+}
+
+bool SceneFile::open(std::vector<unsigned char> data) {
+  m_file.close();
+  m_buffer = std::move(data);
+  return parse(m_buffer.data(), m_buffer.size());
+}
+
+// Points the arrays into data after checking that every section and reference is in bounds
+bool SceneFile::parse(const unsigned char* data, size_t size) {
+  SceneFileHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+    return false;
+  }
+  // Counts that large can only come from a corrupt header, and would overflow the layout
+  const uint64_t LIMIT = (uint64_t)1 << 40;
+  if (header.bodyCount >= NO_STRING || header.lightCount > LIMIT || header.stringCount >= NO_STRING ||
+    header.infoCount >= NO_STRING || header.stringBytes > LIMIT) {
+    return false;
+  }
+  SceneFileLayout layout = getLayout(header);
+  if (layout.end != size) {
+    return false;
+  }
+
+  m_bodyCount = header.bodyCount;
+  m_lightCount = header.lightCount;
+  m_stringCount = header.stringCount;
+  m_lights = (const float*)(data + layout.lights);
+  m_masses = (const float*)(data + layout.masses);
+  m_scales = (const float*)(data + layout.scales);
+  m_tilts = (const float*)(data + layout.tilts);
+  m_rotationPeriods = (const float*)(data + layout.rotationPeriods);
+  m_positions = (const glm::vec3*)(data + layout.positions);
+  m_velocities = (const glm::vec3*)(data + layout.velocities);
+  m_strengths = (const float*)(data + layout.strengths);
+  m_flags = (const uint8_t*)(data + layout.flags);
+  m_stringIds = (const uint32_t*)(data + layout.stringIds);
+  m_infoOffsets = (const uint32_t*)(data + layout.infoOffsets);
+  m_infoIds = (const uint32_t*)(data + layout.infoIds);
+  m_stringOffsets = (const uint64_t*)(data + layout.stringOffsets);
+  m_strings = (const char*)(data + layout.strings);
+
+  for (size_t i = 0; i < m_stringCount; i++) {
+    if (m_stringOffsets[i] > m_stringOffsets[i + 1]) {
+      return false;
+    }
+  }
+  if (m_stringOffsets[0] != 0 || m_stringOffsets[m_stringCount] != header.stringBytes) {
+    return false;
+  }
+  for (size_t i = 0; i < m_bodyCount * SCENE_STRING_COUNT; i++) {
+    if (m_stringIds[i] >= m_stringCount && m_stringIds[i] != NO_STRING) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_bodyCount; i++) {
+    if (m_infoOffsets[i] > m_infoOffsets[i + 1]) {
+      return false;
+    }
+  }
+  if (m_infoOffsets[0] != 0 || m_infoOffsets[m_bodyCount] != header.infoCount) {
+    return false;
+  }
+  for (size_t i = 0; i < header.infoCount; i++) {
+    if (m_infoIds[i] >= m_stringCount) {
+      return false;
+    }
+  }
+
+  m_SIUnitScaleFactor = header.SIUnitScaleFactor;
+  m_universeScaleFactor = header.universeScaleFactor;
+  m_cameraPosition = glm::vec3(header.cameraPosition[0], header.cameraPosition[1], header.cameraPosition[2]);
+  m_ambientStrength = header.ambientStrength;
+  m_specularStrength = header.specularStrength;
+  m_phongExponent = header.phongExponent;
+  return true;
+}
+
+float SceneFile::getSIUnitScaleFactor() const {
+  return m_SIUnitScaleFactor;
+}
+
+float SceneFile::getUniverseScaleFactor() const {
+  return m_universeScaleFactor;
+}
+
+glm::vec3 SceneFile::getCameraPosition() const {
+  return m_cameraPosition;
+}
+
+float SceneFile::getAmbientStrength() const {
+  return m_ambientStrength;
+}
+
+float SceneFile::getSpecularStrength() const {
+  return m_specularStrength;
+}
+
+float SceneFile::getPhongExponent() const {
+  return m_phongExponent;
+}
+
+size_t SceneFile::getLightCount() const {
+  return m_lightCount;
+}
+
+SceneLight SceneFile::getLight(size_t index) const {
+  const float* light = m_lights + index * FLOATS_PER_LIGHT;
+  SceneLight result;
+  result.position = glm::vec3(light[0], light[1], light[2]);
+  result.color = glm::vec3(light[3], light[4], light[5]);
+  result.intensity = light[6];
+  return result;
+}
+
+const char* SceneFile::getStringKey(SceneString field) {
+  return STRING_KEYS[field];
+}
+
+const char* SceneFile::getMapStrengthKey(SceneMapStrength map) {
+  return STRENGTH_KEYS[map];
+}
+
+const char* SceneFile::getPlanetInfoKey(ScenePlanetInfo info) {
+  return PLANET_INFO_KEYS[info][0];
+}
+
+std::string SceneFile::getPlanetInfoLabel(ScenePlanetInfo info) {
+  return PLANET_INFO_KEYS[info][1];
+}
+
+size_t SceneFile::getBodyCount() const {
+  return m_bodyCount;
+}
+
+const float* SceneFile::getMasses() const {
+  return m_masses;
+}
+
+const float* SceneFile::getScales() const {
+  return m_scales;
+}
+
+const float* SceneFile::getTilts() const {
+  return m_tilts;
+}
+
+const float* SceneFile::getRotationPeriods() const {
+  return m_rotationPeriods;
+}
+
+const glm::vec3* SceneFile::getPositions() const {
+  return m_positions;
+}
+
+const glm::vec3* SceneFile::getVelocities() const {
+  return m_velocities;
+}
+
+const float* SceneFile::getMapStrengths(SceneMapStrength map) const {
+  return m_strengths + map * m_bodyCount;
+}
+
+bool SceneFile::isParticle(size_t body) const {
+  return (m_flags[body] & FLAG_PARTICLE) != 0;
+}
+
+uint32_t SceneFile::getStringId(SceneString field, size_t body) const {
+  return m_stringIds[field * m_bodyCount + body];
+}
+
+size_t SceneFile::getStringCount() const {
+  return m_stringCount;
+}
+
+std::string SceneFile::getString(uint32_t id) const {
+  if (id >= m_stringCount) {
+    return "";
+  }
+  return std::string(m_strings + m_stringOffsets[id], m_strings + m_stringOffsets[id + 1]);
+}
+
+std::vector<uint32_t> SceneFile::getPlanetInfoIds(size_t body) const {
+  return std::vector<uint32_t>(m_infoIds + m_infoOffsets[body], m_infoIds + m_infoOffsets[body + 1]);
+}
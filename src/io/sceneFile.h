@@ -0,0 +1,203 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+#include "nlohmann/json.hpp"
+#include "mappedFile.h"
+#include "../physics/snapshot.h"
+
+// Per body strings, each stored once in the string table however many bodies use it
+enum SceneString {
+  SCENE_STRING_NAME,
+  SCENE_STRING_MESH,
+  SCENE_STRING_VERTEX_SHADER,
+  SCENE_STRING_FRAGMENT_SHADER,
+  SCENE_STRING_DIFFUSE_MAP,
+  SCENE_STRING_NORMAL_MAP,
+  SCENE_STRING_SPECULAR_MAP,
+  SCENE_STRING_EMISSIVE_MAP,
+  SCENE_STRING_COUNT
+};
+
+enum SceneMapStrength {
+  SCENE_STRENGTH_DIFFUSE,
+  SCENE_STRENGTH_NORMAL,
+  SCENE_STRENGTH_SPECULAR,
+  SCENE_STRENGTH_EMISSIVE,
+  SCENE_STRENGTH_COUNT
+};
+
+// Optional description lines shown for a body, in display order
+enum ScenePlanetInfo {
+  SCENE_INFO_TYPE,
+  SCENE_INFO_RADIUS,
+  SCENE_INFO_ORBITAL_PERIOD,
+  SCENE_INFO_LENGTH_OF_DAY,
+  SCENE_INFO_TEMPERATURE,
+  SCENE_INFO_COUNT
+};
+
+struct SceneLight {
+  glm::vec3 position;
+  glm::vec3 color;
+  float intensity;
+};
+
+// One GravBodies entry of a scene JSON file, in its SI units
+struct SceneFileBody {
+  std::string strings[SCENE_STRING_COUNT];
+  bool hasString[SCENE_STRING_COUNT];
+  float mass;
+  float radius;
+  float tilt;
+  float rotationPeriod;
+  glm::vec3 position;
+  glm::vec3 velocity;
+  float mapStrengths[SCENE_STRENGTH_COUNT]; // 1 unless given, like Object
+  bool isParticle;
+  std::string planetInfo[SCENE_INFO_COUNT]; // Values without their labels
+  bool hasPlanetInfo[SCENE_INFO_COUNT];
+
+  SceneFileBody();
+};
+
+class SceneStringTable;
+
+// Collects a scene piece by piece and lays it out as a compiled scene file, so the JSON readers never hold more than
+// the output. Values are given in SI units and converted once SIUnitScaleFactor is known, in finish().
+class SceneFileBuilder {
+private:
+  float m_SIUnitScaleFactor;
+  float m_universeScaleFactor;
+  glm::vec3 m_cameraPosition;
+  float m_ambientStrength;
+  float m_specularStrength;
+  float m_phongExponent;
+  size_t m_bodyCount;
+  std::vector<float> m_lights;
+  std::vector<float> m_masses;
+  std::vector<float> m_scales;
+  std::vector<float> m_tilts;
+  std::vector<float> m_rotationPeriods;
+  std::vector<float> m_positions;
+  std::vector<float> m_velocities;
+  std::vector<float> m_strengths; // Per body rows, transposed in finish()
+  std::vector<uint8_t> m_flags;
+  std::vector<uint32_t> m_stringIds; // Per body rows, transposed in finish()
+  std::vector<uint32_t> m_infoOffsets;
+  std::vector<uint32_t> m_infoIds;
+  std::unique_ptr<SceneStringTable> m_strings;
+  std::string m_previousStrings[SCENE_STRING_COUNT];
+  uint32_t m_previousIds[SCENE_STRING_COUNT];
+  bool m_inSystemUnits;
+
+public:
+  SceneFileBuilder();
+  ~SceneFileBuilder();
+  void setSIUnitScaleFactor(float SIUnitScaleFactor);
+  void setUniverseScaleFactor(float universeScaleFactor);
+  void setCameraPosition(glm::vec3 position);
+  void setLighting(float ambientStrength, float specularStrength, float phongExponent);
+  void addLight(glm::vec3 position, glm::vec3 color, float intensity);
+  void addBody(const SceneFileBody& body);
+  // Every value is taken as already divided by SIUnitScaleFactor, e.g. when copied from a compiled scene or snapshot
+  void setInSystemUnits(bool inSystemUnits);
+  size_t getBodyCount();
+  // The encoded file, for SceneFile::open or writing out. The builder can't be used afterwards.
+  std::vector<unsigned char> finish();
+};
+
+// Compiled form of a scene JSON file, loaded by memory mapping it.
+// Layout: fixed header (magic, version, counts, scene constants) followed by 8 byte aligned sections:
+// lights, per body float arrays (mass, scale, tilt, rotation period, positions, velocities, map strengths),
+// particle flags, string ids per SceneString, planet info ranges and ids, then the deduplicated string table.
+// Values are stored already divided by SIUnitScaleFactor the way GravBody's JSON constructor does,
+// so a compiled scene loads into exactly the same System as its JSON. Data is in host (little endian) order.
+class SceneFile {
+private:
+  MappedFile m_file;
+  std::vector<unsigned char> m_buffer; // Owned copy when opened from memory instead of a file
+
+  float m_SIUnitScaleFactor;
+  float m_universeScaleFactor;
+  glm::vec3 m_cameraPosition;
+  float m_ambientStrength;
+  float m_specularStrength;
+  float m_phongExponent;
+  size_t m_bodyCount;
+  size_t m_lightCount;
+  size_t m_stringCount;
+
+  const float* m_lights;
+  const float* m_masses;
+  const float* m_scales;
+  const float* m_tilts;
+  const float* m_rotationPeriods;
+  const glm::vec3* m_positions;
+  const glm::vec3* m_velocities;
+  const float* m_strengths;
+  const uint8_t* m_flags;
+  const uint32_t* m_stringIds;
+  const uint32_t* m_infoOffsets;
+  const uint32_t* m_infoIds;
+  const uint64_t* m_stringOffsets;
+  const char* m_strings;
+
+  bool parse(const unsigned char* data, size_t size);
+
+public:
+  static const uint32_t NO_STRING = 0xffffffff;
+
+  static std::vector<unsigned char> encode(const nlohmann::json& jScene);
+  // Streams a scene JSON file (see sceneJSONReader.h) and writes its compiled form
+  static bool compile(std::string jsonFilePath, std::string filePath);
+  // A scene of the snapshot's bodies (e.g. from icgen) with the constants and lights of a template scene, every body
+  // getting the name, radius, tilt, rotation, paths, map strengths and info of the template's first body.
+  // The snapshot must be in the template's SIUnitScaleFactor.
+  static std::vector<unsigned char> encode(const Snapshot& snapshot, const SceneFile& templateScene);
+  // Same from files, the template may be scene JSON or a compiled scene
+  static bool compileSnapshot(std::string snapshotFilePath, std::string templateFilePath, std::string filePath);
+  // True when the file starts with the compiled scene magic, so callers can accept either format
+  static bool isSceneFile(std::string filePath);
+  // JSON keys of the per body fields
+  static const char* getStringKey(SceneString field);
+  static const char* getMapStrengthKey(SceneMapStrength map);
+  static const char* getPlanetInfoKey(ScenePlanetInfo info);
+  static std::string getPlanetInfoLabel(ScenePlanetInfo info); // e.g. "Type: "
+
+  SceneFile();
+  SceneFile(const SceneFile&) = delete;
+  SceneFile& operator=(const SceneFile&) = delete;
+  bool open(std::string filePath);
+  bool open(std::vector<unsigned char> data);
+
+  float getSIUnitScaleFactor() const;
+  float getUniverseScaleFactor() const;
+  glm::vec3 getCameraPosition() const;
+  float getAmbientStrength() const;
+  float getSpecularStrength() const;
+  float getPhongExponent() const;
+
+  size_t getLightCount() const;
+  SceneLight getLight(size_t index) const;
+
+  // Arrays of getBodyCount() values, pointing into the mapped file
+  size_t getBodyCount() const;
+  const float* getMasses() const;
+  const float* getScales() const;
+  const float* getTilts() const; // Degrees
+  const float* getRotationPeriods() const; // Hours
+  const glm::vec3* getPositions() const;
+  const glm::vec3* getVelocities() const;
+  const float* getMapStrengths(SceneMapStrength map) const;
+  bool isParticle(size_t body) const;
+
+  // NO_STRING for optional maps the body doesn't have
+  uint32_t getStringId(SceneString field, size_t body) const;
+  size_t getStringCount() const;
+  std::string getString(uint32_t id) const;
+  // The planet info lines after the name, e.g. "Type: Terrestrial"
+  std::vector<uint32_t> getPlanetInfoIds(size_t body) const;
+};
@@ -0,0 +1,450 @@
+#include "sceneJSONReader.h"
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+  using json = nlohmann::json;
+
+  // Required keys, as bits of a mask that is checked when the enclosing object closes
+  enum SceneKey {
+    SCENE_KEY_SI_UNIT_SCALE_FACTOR = 1 << 0,
+    SCENE_KEY_UNIVERSE_SCALE_FACTOR = 1 << 1,
+    SCENE_KEY_CAMERA_X = 1 << 2,
+    SCENE_KEY_CAMERA_Y = 1 << 3,
+    SCENE_KEY_CAMERA_Z = 1 << 4,
+    SCENE_KEY_AMBIENT_STRENGTH = 1 << 5,
+    SCENE_KEY_SPECULAR_STRENGTH = 1 << 6,
+    SCENE_KEY_PHONG_EXPONENT = 1 << 7,
+    SCENE_KEYS_REQUIRED = (1 << 8) - 1
+  };
+
+  enum BodyKey {
+    BODY_KEY_MASS = 1 << 0,
+    BODY_KEY_RADIUS = 1 << 1,
+    BODY_KEY_TILT = 1 << 2,
+    BODY_KEY_ROTATION_PERIOD = 1 << 3,
+    BODY_KEY_POSITION_X = 1 << 4,
+    BODY_KEY_VELOCITY_X = 1 << 7,
+    BODY_KEY_STRINGS = 1 << 10, // One bit per SceneString
+    BODY_KEYS_REQUIRED = (1 << (10 + SCENE_STRING_FRAGMENT_SHADER + 1)) - 1
+  };
+
+  enum LightKey {
+    LIGHT_KEY_POSITION_X = 1 << 0,
+    LIGHT_KEY_COLOR_RED = 1 << 3,
+    LIGHT_KEY_INTENSITY = 1 << 6,
+    LIGHT_KEYS_REQUIRED = (1 << 7) - 1
+  };
+
+  // Every key the reader acts on, looked up once per key so the handler only compares integers
+  enum KeyId {
+    KEY_UNKNOWN,
+    KEY_ELEMENT, // Path entry of the root object and array elements, which have no key
+    KEY_SI_UNIT_SCALE_FACTOR,
+    KEY_UNIVERSE_SCALE_FACTOR,
+    KEY_AMBIENT_STRENGTH,
+    KEY_SPECULAR_STRENGTH,
+    KEY_PHONG_EXPONENT,
+    KEY_CAMERA_POSITION,
+    KEY_GRAV_BODIES,
+    KEY_LIGHTS,
+    KEY_MASS,
+    KEY_RADIUS,
+    KEY_TILT,
+    KEY_ROTATION_PERIOD,
+    KEY_POSITION,
+    KEY_VELOCITY,
+    KEY_IS_PARTICLE,
+    KEY_COLOR,
+    KEY_INTENSITY,
+    KEY_X,
+    KEY_Y,
+    KEY_Z,
+    KEY_RED,
+    KEY_GREEN,
+    KEY_BLUE,
+    KEY_STRING, // One per SceneString from here
+    KEY_MAP_STRENGTH = KEY_STRING + SCENE_STRING_COUNT,
+    KEY_PLANET_INFO = KEY_MAP_STRENGTH + SCENE_STRENGTH_COUNT,
+    KEY_COUNT = KEY_PLANET_INFO + SCENE_INFO_COUNT
+  };
+
+  class KeyTable {
+  private:
+    std::unordered_map<std::string, int> m_ids;
+    std::vector<std::string> m_names;
+
+    void add(std::string name, int id) {
+      m_ids[name] = id;
+      m_names[id] = name;
+    }
+
+  public:
+    KeyTable() : m_names(KEY_COUNT) {
+      add("SIUnitScaleFactor", KEY_SI_UNIT_SCALE_FACTOR);
+      add("UniverseScaleFactor", KEY_UNIVERSE_SCALE_FACTOR);
+      add("ambientStrength", KEY_AMBIENT_STRENGTH);
+      add("specularStrength", KEY_SPECULAR_STRENGTH);
+      add("phongExponent", KEY_PHONG_EXPONENT);
+      add("CameraPosition", KEY_CAMERA_POSITION);
+      add("GravBodies", KEY_GRAV_BODIES);
+      add("Lights", KEY_LIGHTS);
+      add("mass", KEY_MASS);
+      add("radius", KEY_RADIUS);
+      add("tilt", KEY_TILT);
+      add("rotationPeriod", KEY_ROTATION_PERIOD);
+      add("position", KEY_POSITION);
+      add("velocity", KEY_VELOCITY);
+      add("isParticle", KEY_IS_PARTICLE);
+      add("color", KEY_COLOR);
+      add("intensity", KEY_INTENSITY);
+      add("x", KEY_X);
+      add("y", KEY_Y);
+      add("z", KEY_Z);
+      add("red", KEY_RED);
+      add("green", KEY_GREEN);
+      add("blue", KEY_BLUE);
+      for (int field = 0; field < SCENE_STRING_COUNT; field++) {
+        add(SceneFile::getStringKey((SceneString)field), KEY_STRING + field);
+      }
+      for (int map = 0; map < SCENE_STRENGTH_COUNT; map++) {
+        add(SceneFile::getMapStrengthKey((SceneMapStrength)map), KEY_MAP_STRENGTH + map);
+      }
+      for (int info = 0; info < SCENE_INFO_COUNT; info++) {
+        add(SceneFile::getPlanetInfoKey((ScenePlanetInfo)info), KEY_PLANET_INFO + info);
+      }
+    }
+
+    int find(const std::string& name) const {
+      auto found = m_ids.find(name);
+      return found == m_ids.end() ? KEY_UNKNOWN : found->second;
+    }
+
+    const std::string& getName(int id) const {
+      return m_names[id];
+    }
+  };
+
+  enum ValueType {
+    VALUE_NUMBER,
+    VALUE_STRING,
+    VALUE_BOOLEAN,
+    VALUE_OTHER // null or binary
+  };
+
+  struct ScalarValue {
+    ValueType type;
+    float number;
+    bool boolean;
+    const std::string* text;
+  };
+
+  // The SAX handler. m_path holds the key of every enclosing object or array, so e.g. a body's position.x arrives
+  // with m_path { ELEMENT, GRAV_BODIES, ELEMENT, POSITION } and m_key KEY_X.
+  class SceneHandler : public nlohmann::json_sax<json> {
+  private:
+    const KeyTable& m_keys;
+    SceneFileBuilder* m_builder;
+    std::vector<int> m_path;
+    int m_key;
+    std::string m_error;
+
+    unsigned int m_sceneKeys;
+    float m_SIUnitScaleFactor;
+    float m_universeScaleFactor;
+    glm::vec3 m_cameraPosition;
+    float m_ambientStrength;
+    float m_specularStrength;
+    float m_phongExponent;
+
+    SceneFileBody m_body;
+    unsigned int m_bodyKeys;
+
+    glm::vec3 m_lightPosition;
+    glm::vec3 m_lightColor;
+    float m_lightIntensity;
+    unsigned int m_lightKeys;
+    size_t m_lightCount;
+
+    bool inArray(int array) {
+      return m_path.size() >= 3 && m_path[1] == array;
+    }
+
+    bool isElementOf(int array) {
+      return m_path.size() == 3 && m_path[1] == array;
+    }
+
+    std::string describeBody() {
+      std::string name = m_body.hasString[SCENE_STRING_NAME] ? " (" + m_body.strings[SCENE_STRING_NAME] + ")" : "";
+      return "GravBodies[" + std::to_string(m_builder->getBodyCount()) + "]" + name;
+    }
+
+    bool fail(std::string error) {
+      m_error = error;
+      return false;
+    }
+
+    bool expectNumber(const ScalarValue& value, float& target, unsigned int& keys, unsigned int bit) {
+      if (value.type != VALUE_NUMBER) {
+        return fail("Expected a number for " + m_keys.getName(m_key));
+      }
+      target = value.number;
+      keys |= bit;
+      return true;
+    }
+
+    bool expectString(const ScalarValue& value, std::string& target) {
+      if (value.type != VALUE_STRING) {
+        return fail("Expected a string for " + m_keys.getName(m_key));
+      }
+      target = *value.text;
+      return true;
+    }
+
+    bool sceneValue(const ScalarValue& value) {
+      if (m_path.size() == 1) {
+        switch (m_key) {
+          case KEY_SI_UNIT_SCALE_FACTOR: return expectNumber(value, m_SIUnitScaleFactor, m_sceneKeys, SCENE_KEY_SI_UNIT_SCALE_FACTOR);
+          case KEY_UNIVERSE_SCALE_FACTOR: return expectNumber(value, m_universeScaleFactor, m_sceneKeys, SCENE_KEY_UNIVERSE_SCALE_FACTOR);
+          case KEY_AMBIENT_STRENGTH: return expectNumber(value, m_ambientStrength, m_sceneKeys, SCENE_KEY_AMBIENT_STRENGTH);
+          case KEY_SPECULAR_STRENGTH: return expectNumber(value, m_specularStrength, m_sceneKeys, SCENE_KEY_SPECULAR_STRENGTH);
+          case KEY_PHONG_EXPONENT: return expectNumber(value, m_phongExponent, m_sceneKeys, SCENE_KEY_PHONG_EXPONENT);
+          default: return true;
+        }
+      }
+      if (m_path.size() == 2 && m_path[1] == KEY_CAMERA_POSITION && m_key >= KEY_X && m_key <= KEY_Z) {
+        int axis = m_key - KEY_X;
+        return expectNumber(value, m_cameraPosition[axis], m_sceneKeys, SCENE_KEY_CAMERA_X << axis);
+      }
+      return true;
+    }
+
+    bool bodyValue(const ScalarValue& value) {
+      if (m_path.size() == 4) {
+        if (m_key < KEY_X || m_key > KEY_Z) {
+          return true;
+        }
+        int axis = m_key - KEY_X;
+        if (m_path[3] == KEY_POSITION) return expectNumber(value, m_body.position[axis], m_bodyKeys, BODY_KEY_POSITION_X << axis);
+        if (m_path[3] == KEY_VELOCITY) return expectNumber(value, m_body.velocity[axis], m_bodyKeys, BODY_KEY_VELOCITY_X << axis);
+        return true;
+      }
+      if (m_path.size() != 3) {
+        return true;
+      }
+
+      switch (m_key) {
+        case KEY_MASS: return expectNumber(value, m_body.mass, m_bodyKeys, BODY_KEY_MASS);
+        case KEY_RADIUS: return expectNumber(value, m_body.radius, m_bodyKeys, BODY_KEY_RADIUS);
+        case KEY_TILT: return expectNumber(value, m_body.tilt, m_bodyKeys, BODY_KEY_TILT);
+        case KEY_ROTATION_PERIOD: return expectNumber(value, m_body.rotationPeriod, m_bodyKeys, BODY_KEY_ROTATION_PERIOD);
+        case KEY_IS_PARTICLE:
+          if (value.type != VALUE_BOOLEAN) {
+            return fail("Expected true or false for isParticle");
+          }
+          m_body.isParticle = value.boolean;
+          return true;
+        default:
+          break;
+      }
+      if (m_key >= KEY_STRING && m_key < KEY_MAP_STRENGTH) {
+        int field = m_key - KEY_STRING;
+        m_body.hasString[field] = true;
+        m_bodyKeys |= BODY_KEY_STRINGS << field;
+        return expectString(value, m_body.strings[field]);
+      }
+      if (m_key >= KEY_MAP_STRENGTH && m_key < KEY_PLANET_INFO) {
+        unsigned int optional = 0;
+        return expectNumber(value, m_body.mapStrengths[m_key - KEY_MAP_STRENGTH], optional, 0);
+      }
+      if (m_key >= KEY_PLANET_INFO && m_key < KEY_COUNT) {
+        int info = m_key - KEY_PLANET_INFO;
+        m_body.hasPlanetInfo[info] = true;
+        return expectString(value, m_body.planetInfo[info]);
+      }
+      return true;
+    }
+
+    bool lightValue(const ScalarValue& value) {
+      if (m_path.size() == 3 && m_key == KEY_INTENSITY) {
+        return expectNumber(value, m_lightIntensity, m_lightKeys, LIGHT_KEY_INTENSITY);
+      }
+      if (m_path.size() == 4 && m_path[3] == KEY_POSITION && m_key >= KEY_X && m_key <= KEY_Z) {
+        int axis = m_key - KEY_X;
+        return expectNumber(value, m_lightPosition[axis], m_lightKeys, LIGHT_KEY_POSITION_X << axis);
+      }
+      if (m_path.size() == 4 && m_path[3] == KEY_COLOR && m_key >= KEY_RED && m_key <= KEY_BLUE) {
+        int channel = m_key - KEY_RED;
+        return expectNumber(value, m_lightColor[channel], m_lightKeys, LIGHT_KEY_COLOR_RED << channel);
+      }
+      return true;
+    }
+
+    bool scalar(const ScalarValue& value) {
+      if (inArray(KEY_GRAV_BODIES)) {
+        return bodyValue(value);
+      }
+      if (inArray(KEY_LIGHTS)) {
+        return lightValue(value);
+      }
+      return sceneValue(value);
+    }
+
+    bool scalarNumber(float number) {
+      ScalarValue value = { VALUE_NUMBER, number, false, nullptr };
+      return scalar(value);
+    }
+
+    void push() {
+      m_path.push_back(m_key);
+      m_key = KEY_ELEMENT;
+    }
+
+    void pop() {
+      m_key = m_path.back();
+      m_path.pop_back();
+    }
+
+  public:
+    SceneHandler(const KeyTable& keys, SceneFileBuilder* builder) : m_keys(keys), m_builder(builder) {
+      m_key = KEY_ELEMENT;
+      m_sceneKeys = 0;
+      m_SIUnitScaleFactor = 1.0f;
+      m_universeScaleFactor = 1.0f;
+      m_cameraPosition = glm::vec3(0.0f);
+      m_ambientStrength = 0.0f;
+      m_specularStrength = 0.0f;
+      m_phongExponent = 0.0f;
+      m_bodyKeys = 0;
+      m_lightPosition = glm::vec3(0.0f);
+      m_lightColor = glm::vec3(0.0f);
+      m_lightIntensity = 0.0f;
+      m_lightKeys = 0;
+      m_lightCount = 0;
+    }
+
+    std::string getError() {
+      return m_error;
+    }
+
+    // Called once the whole text parsed, for the keys outside bodies and lights
+    bool finish() {
+      if ((m_sceneKeys & SCENE_KEYS_REQUIRED) != SCENE_KEYS_REQUIRED) {
+        return fail("Missing one of SIUnitScaleFactor, UniverseScaleFactor, CameraPosition, ambientStrength, specularStrength or phongExponent");
+      }
+      m_builder->setSIUnitScaleFactor(m_SIUnitScaleFactor);
+      m_builder->setUniverseScaleFactor(m_universeScaleFactor);
+      m_builder->setCameraPosition(m_cameraPosition);
+      m_builder->setLighting(m_ambientStrength, m_specularStrength, m_phongExponent);
+      return true;
+    }
+
+    bool null() override {
+      ScalarValue value = { VALUE_OTHER, 0.0f, false, nullptr };
+      return scalar(value);
+    }
+
+    bool boolean(bool boolean) override {
+      ScalarValue value = { VALUE_BOOLEAN, 0.0f, boolean, nullptr };
+      return scalar(value);
+    }
+
+    // Same conversions as json::get<float>
+    bool number_integer(number_integer_t number) override {
+      return scalarNumber(static_cast<float>(number));
+    }
+
+    bool number_unsigned(number_unsigned_t number) override {
+      return scalarNumber(static_cast<float>(number));
+    }
+
+    bool number_float(number_float_t number, const string_t&) override {
+      return scalarNumber(static_cast<float>(number));
+    }
+
+    bool string(string_t& text) override {
+      ScalarValue value = { VALUE_STRING, 0.0f, false, &text };
+      return scalar(value);
+    }
+
+    bool binary(binary_t&) override {
+      return null();
+    }
+
+    bool key(string_t& key) override {
+      m_key = m_keys.find(key);
+      return true;
+    }
+
+    bool start_object(std::size_t) override {
+      push();
+      if (isElementOf(KEY_GRAV_BODIES)) {
+        m_body = SceneFileBody();
+        m_bodyKeys = 0;
+      }
+      else if (isElementOf(KEY_LIGHTS)) {
+        m_lightKeys = 0;
+      }
+      return true;
+    }
+
+    bool end_object() override {
+      if (isElementOf(KEY_GRAV_BODIES)) {
+        if ((m_bodyKeys & BODY_KEYS_REQUIRED) != BODY_KEYS_REQUIRED) {
+          return fail(describeBody() + " is missing one of name, radius, mass, position, velocity, tilt, rotationPeriod, "
+            "meshFilePath, vertexShaderPath or fragmentShaderPath");
+        }
+        m_builder->addBody(m_body);
+      }
+      else if (isElementOf(KEY_LIGHTS)) {
+        if ((m_lightKeys & LIGHT_KEYS_REQUIRED) != LIGHT_KEYS_REQUIRED) {
+          return fail("Lights[" + std::to_string(m_lightCount) + "] is missing one of position, color or intensity");
+        }
+        m_builder->addLight(m_lightPosition, m_lightColor, m_lightIntensity);
+        m_lightCount++;
+      }
+      pop();
+      return true;
+    }
+
+    bool start_array(std::size_t) override {
+      push();
+      return true;
+    }
+
+    bool end_array() override {
+      pop();
+      return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& exception) override {
+      return fail("Parse error at byte " + std::to_string(position) + ": " + exception.what());
+    }
+  };
+}
+
+bool SceneJSONReader::read(std::string jsonFilePath, std::vector<unsigned char>& encoded) {
+  std::ifstream file(jsonFilePath, std::ios::binary);
+  if (!file) {
+    std::cout << "Could not open scene file: " << jsonFilePath << std::endl;
+    return false;
+  }
+  if (!read(file, encoded)) {
+    std::cout << "Invalid scene file: " << jsonFilePath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SceneJSONReader::read(std::istream& stream, std::vector<unsigned char>& encoded) {
+  static const KeyTable keys;
+  SceneFileBuilder builder;
+  SceneHandler handler(keys, &builder);
+  if (!json::sax_parse(stream, &handler) || !handler.finish()) {
+    std::cout << handler.getError() << std::endl;
+    return false;
+  }
+  encoded = builder.finish();
+  return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <istream>
+#include "sceneFile.h"
+
+// Streaming reader for scene JSON files. Walks the text with nlohmann's SAX interface and hands each body and light
+// to a SceneFileBuilder as soon as it is complete, so memory grows with the compiled output instead of a DOM of the
+// whole file. The result is the same as SceneFile::encode of the parsed file: the same keys are required, unknown
+// keys are skipped, and a missing key or a value of the wrong type is reported with its body and fails the read.
+class SceneJSONReader {
+public:
+  static bool read(std::string jsonFilePath, std::vector<unsigned char>& encoded);
+  static bool read(std::istream& stream, std::vector<unsigned char>& encoded);
+};
@@ -0,0 +1,162 @@
+#include "snapshotFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include "compression.h"
+
+namespace {
+  const char MAGIC[8] = { 'S', 'S', 'S', 'N', 'A', 'P', '\0', '\0' };
+  const uint32_t VERSION = 1;
+  const uint32_t FLAG_COMPRESSED = 1;
+
+  struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t bodyCount;
+    uint64_t step;
+    double time;
+    uint64_t rawSize;
+    uint64_t payloadSize;
+  };
+
+  // Floats per body in the payload: mass(1), position(3), velocity(3), rotation(4)
+  const size_t FLOATS_PER_BODY = 11;
+}
+
+std::vector<unsigned char> SnapshotFile::encode(const Snapshot& snapshot, bool compress) {
+  const size_t bodyCount = snapshot.getBodyCount();
+
+  // Lay the state out as consecutive float arrays
+  std::vector<float> raw;
+  raw.reserve(bodyCount * FLOATS_PER_BODY);
+  raw.insert(raw.end(), snapshot.masses.begin(), snapshot.masses.end());
+  for (auto const& position : snapshot.positions) {
+    raw.insert(raw.end(), { position.x, position.y, position.z });
+  }
+  for (auto const& velocity : snapshot.velocities) {
+    raw.insert(raw.end(), { velocity.x, velocity.y, velocity.z });
+  }
+  for (auto const& rotation : snapshot.rotations) {
+    raw.insert(raw.end(), { rotation.x, rotation.y, rotation.z, rotation.w });
+  }
+
+  const unsigned char* rawBytes = reinterpret_cast<const unsigned char*>(raw.data());
+  const size_t rawSize = raw.size() * sizeof(float);
+
+  std::vector<unsigned char> payload;
+  if (compress) {
+    std::vector<unsigned char> shuffled(rawSize);
+    Compression::shuffle(rawBytes, rawSize, sizeof(float), shuffled.data());
+    payload = Compression::compress(shuffled.data(), rawSize);
+  }
+  else {
+    payload.assign(rawBytes, rawBytes + rawSize);
+  }
+
+  SnapshotHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.flags = compress ? FLAG_COMPRESSED : 0;
+  header.bodyCount = bodyCount;
+  header.step = snapshot.step;
+  header.time = snapshot.time;
+  header.rawSize = rawSize;
+  header.payloadSize = payload.size();
+
+  std::vector<unsigned char> result(sizeof(header) + payload.size());
+  std::memcpy(result.data(), &header, sizeof(header));
+  std::memcpy(result.data() + sizeof(header), payload.data(), payload.size());
+  return result;
+}
+
+bool SnapshotFile::decode(const unsigned char* data, size_t size, Snapshot& snapshot) {
+  SnapshotHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+    return false;
+  }
+  if (header.payloadSize > size - sizeof(header) || header.rawSize != header.bodyCount * FLOATS_PER_BODY * sizeof(float)) {
+    return false;
+  }
+
+  const unsigned char* payload = data + sizeof(header);
+  std::vector<float> raw(header.bodyCount * FLOATS_PER_BODY);
+
+  if (header.flags & FLAG_COMPRESSED) {
+    std::vector<unsigned char> shuffled;
+    if (!Compression::decompress(payload, header.payloadSize, header.rawSize, shuffled)) {
+      return false;
+    }
+    Compression::unshuffle(shuffled.data(), shuffled.size(), sizeof(float), reinterpret_cast<unsigned char*>(raw.data()));
+  }
+  else {
+    if (header.payloadSize != header.rawSize) {
+      return false;
+    }
+    std::memcpy(raw.data(), payload, header.rawSize);
+  }
+
+  const size_t bodyCount = header.bodyCount;
+  snapshot.resize(bodyCount);
+  snapshot.time = header.time;
+  snapshot.step = header.step;
+
+  const float* masses = raw.data();
+  const float* positions = masses + bodyCount;
+  const float* velocities = positions + 3 * bodyCount;
+  const float* rotations = velocities + 3 * bodyCount;
+  for (size_t i = 0; i < bodyCount; i++) {
+    snapshot.masses[i] = masses[i];
+    snapshot.positions[i] = glm::vec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+    snapshot.velocities[i] = glm::vec3(velocities[3 * i], velocities[3 * i + 1], velocities[3 * i + 2]);
+    snapshot.rotations[i] = glm::quat(rotations[4 * i + 3], rotations[4 * i], rotations[4 * i + 1], rotations[4 * i + 2]);
+  }
+
+  return true;
+}
+
+bool SnapshotFile::write(std::string filePath, const Snapshot& snapshot, bool compress) {
+  std::vector<unsigned char> encoded = encode(snapshot, compress);
+
+  std::string tempPath = filePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cout << "Could not open snapshot file for writing: " << tempPath << std::endl;
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    if (!file) {
+      std::cout << "Failed writing snapshot file: " << tempPath << std::endl;
+      return false;
+    }
+  }
+
+  // rename() won't replace an existing file on every platform
+  std::remove(filePath.c_str());
+  if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+    std::cout << "Could not move snapshot into place: " << filePath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SnapshotFile::read(std::string filePath, Snapshot& snapshot) {
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file) {
+    std::cout << "Could not open snapshot file: " << filePath << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (!decode(data.data(), data.size(), snapshot)) {
+    std::cout << "Invalid snapshot file: " << filePath << std::endl;
+    return false;
+  }
+  return true;
+}
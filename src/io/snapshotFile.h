@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../physics/snapshot.h"
+
+// Binary on-disk format for a Snapshot.
+// Layout: fixed header (magic, version, flags, counts, time) followed by the payload.
+// The payload holds masses, positions, velocities and rotations as consecutive float arrays,
+// byte shuffled and LZ compressed when the compressed flag is set. Data is written in host (little endian) order.
+class SnapshotFile {
+public:
+  static std::vector<unsigned char> encode(const Snapshot& snapshot, bool compress);
+  static bool decode(const unsigned char* data, size_t size, Snapshot& snapshot);
+
+  // Writes to a temporary file first and renames it, so an interrupted write never replaces a good file
+  static bool write(std::string filePath, const Snapshot& snapshot, bool compress);
+  static bool read(std::string filePath, Snapshot& snapshot);
+};
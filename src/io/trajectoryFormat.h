@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout shared by TrajectoryWriter and TrajectoryReader.
+//
+// <path>      : TrajectoryFileHeader, then chunks appended one after another.
+//               Each chunk is a TrajectoryChunkHeader, the frame times and steps,
+//               a table of TrajectoryBlockEntry (one per block of bodies) and the compressed blocks.
+// <path>.idx  : TrajectoryIndexHeader, then one fixed size TrajectoryIndexEntry per chunk.
+//
+// An index entry is only appended once its chunk is fully written and flushed,
+// so readers that trust the index can follow a file that is still being recorded.
+//
+// Inside a block every (body, component) pair is one column holding that value for every frame of the chunk.
+// Values are quantized to integers, delta encoded along time, zigzag + varint packed and LZ compressed.
+
+namespace TrajectoryFormat {
+  const char FILE_MAGIC[8] = { 'S', 'S', 'T', 'R', 'A', 'J', '\0', '\0' };
+  const char INDEX_MAGIC[8] = { 'S', 'S', 'T', 'I', 'D', 'X', '\0', '\0' };
+  const uint32_t CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+  const uint32_t VERSION = 1;
+  const unsigned int COMPONENTS = 6; // position xyz, velocity xyz
+}
+
+struct TrajectoryFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t bodiesPerBlock;
+  uint64_t bodyCount;
+  double positionQuantum;
+  double velocityQuantum;
+};
+
+struct TrajectoryChunkHeader {
+  uint32_t magic;
+  uint32_t frameCount;
+  uint32_t blockCount;
+  uint32_t reserved;
+};
+
+struct TrajectoryBlockEntry {
+  uint64_t offset; // From the start of the chunk
+  uint64_t compressedSize;
+  uint64_t rawSize;
+};
+
+struct TrajectoryIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct TrajectoryIndexEntry {
+  uint64_t chunkOffset;
+  uint64_t chunkSize;
+  uint64_t firstStep;
+  uint64_t lastStep;
+  double firstTime;
+  double lastTime;
+  uint32_t frameCount;
+  uint32_t reserved;
+};
@@ -0,0 +1,246 @@
+#include "trajectoryReader.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "compression.h"
+
+TrajectoryReader::TrajectoryReader() {
+  std::memset(&m_header, 0, sizeof(m_header));
+  m_frameCount = 0;
+}
+
+bool TrajectoryReader::open(std::string filePath) {
+  m_filePath = filePath;
+  m_dataFile.open(filePath, std::ios::binary);
+  if (!m_dataFile) {
+    std::cout << "Could not open trajectory file: " << filePath << std::endl;
+    return false;
+  }
+
+  m_dataFile.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+  if (!m_dataFile || std::memcmp(m_header.magic, TrajectoryFormat::FILE_MAGIC, sizeof(m_header.magic)) != 0 ||
+    m_header.version != TrajectoryFormat::VERSION || m_header.bodiesPerBlock == 0) {
+    std::cout << "Invalid trajectory file: " << filePath << std::endl;
+    return false;
+  }
+
+  return refresh();
+}
+
+bool TrajectoryReader::refresh() {
+  std::ifstream indexFile(m_filePath + ".idx", std::ios::binary | std::ios::ate);
+  if (!indexFile) {
+    std::cout << "Could not open trajectory index: " << m_filePath << ".idx" << std::endl;
+    return false;
+  }
+
+  // Only whole entries count, the writer may be halfway through appending one
+  const std::streamoff indexSize = indexFile.tellg();
+  if (indexSize < (std::streamoff)sizeof(TrajectoryIndexHeader)) {
+    return false;
+  }
+  const size_t entryCount = (indexSize - sizeof(TrajectoryIndexHeader)) / sizeof(TrajectoryIndexEntry);
+
+  TrajectoryIndexHeader indexHeader;
+  indexFile.seekg(0);
+  indexFile.read(reinterpret_cast<char*>(&indexHeader), sizeof(indexHeader));
+  if (!indexFile || std::memcmp(indexHeader.magic, TrajectoryFormat::INDEX_MAGIC, sizeof(indexHeader.magic)) != 0) {
+    std::cout << "Invalid trajectory index: " << m_filePath << ".idx" << std::endl;
+    return false;
+  }
+
+  m_index.resize(entryCount);
+  indexFile.read(reinterpret_cast<char*>(m_index.data()), entryCount * sizeof(TrajectoryIndexEntry));
+
+  m_firstFrameOfChunk.resize(entryCount);
+  m_frameCount = 0;
+  for (size_t i = 0; i < entryCount; i++) {
+    m_firstFrameOfChunk[i] = m_frameCount;
+    m_frameCount += m_index[i].frameCount;
+  }
+
+  return true;
+}
+
+size_t TrajectoryReader::getBodyCount() {
+  return m_header.bodyCount;
+}
+
+size_t TrajectoryReader::getFrameCount() {
+  return m_frameCount;
+}
+
+bool TrajectoryReader::findChunk(size_t frame, size_t& chunk, size_t& frameInChunk) {
+  if (frame >= m_frameCount) {
+    return false;
+  }
+  auto itr = std::upper_bound(m_firstFrameOfChunk.begin(), m_firstFrameOfChunk.end(), frame);
+  chunk = (itr - m_firstFrameOfChunk.begin()) - 1;
+  frameInChunk = frame - m_firstFrameOfChunk[chunk];
+  return true;
+}
+
+bool TrajectoryReader::readChunkTimes(size_t chunk, std::vector<double>& times) {
+  const TrajectoryIndexEntry& entry = m_index[chunk];
+  times.resize(entry.frameCount);
+  m_dataFile.clear(); // The writer may have grown the file past our last EOF
+  m_dataFile.seekg(entry.chunkOffset + sizeof(TrajectoryChunkHeader));
+  m_dataFile.read(reinterpret_cast<char*>(times.data()), entry.frameCount * sizeof(double));
+  return (bool)m_dataFile;
+}
+
+double TrajectoryReader::getFrameTime(size_t frame) {
+  size_t chunk, frameInChunk;
+  std::vector<double> times;
+  if (!findChunk(frame, chunk, frameInChunk) || !readChunkTimes(chunk, times)) {
+    return 0.0;
+  }
+  return times[frameInChunk];
+}
+
+size_t TrajectoryReader::findFrame(double time) {
+  if (m_index.empty()) {
+    return 0;
+  }
+
+  // Last chunk starting at or before time
+  auto itr = std::upper_bound(m_index.begin(), m_index.end(), time,
+    [](double t, const TrajectoryIndexEntry& entry) { return t < entry.firstTime; });
+  if (itr == m_index.begin()) {
+    return 0;
+  }
+  size_t chunk = (itr - m_index.begin()) - 1;
+
+  std::vector<double> times;
+  if (!readChunkTimes(chunk, times)) {
+    return m_firstFrameOfChunk[chunk];
+  }
+  size_t frameInChunk = (std::upper_bound(times.begin(), times.end(), time) - times.begin()) - 1;
+  return m_firstFrameOfChunk[chunk] + frameInChunk;
+}
+
+bool TrajectoryReader::decodeBlock(size_t chunk, size_t block, std::vector<int64_t>& values, size_t& frameCount) {
+  const TrajectoryIndexEntry& entry = m_index[chunk];
+
+  TrajectoryChunkHeader header;
+  m_dataFile.clear();
+  m_dataFile.seekg(entry.chunkOffset);
+  m_dataFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!m_dataFile || header.magic != TrajectoryFormat::CHUNK_MAGIC || block >= header.blockCount) {
+    std::cout << "Corrupt trajectory chunk " << chunk << " in " << m_filePath << std::endl;
+    return false;
+  }
+  frameCount = header.frameCount;
+
+  TrajectoryBlockEntry blockEntry;
+  m_dataFile.seekg(entry.chunkOffset + sizeof(header) + frameCount * (sizeof(double) + sizeof(uint64_t)) + block * sizeof(TrajectoryBlockEntry));
+  m_dataFile.read(reinterpret_cast<char*>(&blockEntry), sizeof(blockEntry));
+
+  std::vector<unsigned char> compressed(blockEntry.compressedSize);
+  m_dataFile.seekg(entry.chunkOffset + blockEntry.offset);
+  m_dataFile.read(reinterpret_cast<char*>(compressed.data()), compressed.size());
+
+  std::vector<unsigned char> packed;
+  if (!m_dataFile || !Compression::decompress(compressed.data(), compressed.size(), blockEntry.rawSize, packed)) {
+    std::cout << "Could not decompress trajectory block " << block << " of chunk " << chunk << std::endl;
+    return false;
+  }
+
+  const size_t firstBody = block * m_header.bodiesPerBlock;
+  const size_t bodiesInBlock = std::min<size_t>(m_header.bodiesPerBlock, m_header.bodyCount - firstBody);
+  const size_t columnCount = bodiesInBlock * TrajectoryFormat::COMPONENTS;
+  values.resize(columnCount * frameCount);
+
+  // Undo zigzag and the delta along each column
+  size_t position = 0;
+  for (size_t column = 0; column < columnCount; column++) {
+    int64_t previous = 0;
+    for (size_t frame = 0; frame < frameCount; frame++) {
+      uint64_t zigzag;
+      if (!Compression::readVarint(packed.data(), packed.size(), position, zigzag)) {
+        return false;
+      }
+      int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+      previous += delta;
+      values[column * frameCount + frame] = previous;
+    }
+  }
+
+  return true;
+}
+
+bool TrajectoryReader::readBody(size_t bodyId, size_t frame, glm::vec3& position, glm::vec3& velocity) {
+  size_t chunk, frameInChunk, frameCount;
+  std::vector<int64_t> values;
+  if (bodyId >= m_header.bodyCount || !findChunk(frame, chunk, frameInChunk) ||
+    !decodeBlock(chunk, bodyId / m_header.bodiesPerBlock, values, frameCount)) {
+    return false;
+  }
+
+  const size_t firstColumn = (bodyId % m_header.bodiesPerBlock) * TrajectoryFormat::COMPONENTS;
+  for (int c = 0; c < 3; c++) {
+    position[c] = (float)(values[(firstColumn + c) * frameCount + frameInChunk] * m_header.positionQuantum);
+    velocity[c] = (float)(values[(firstColumn + 3 + c) * frameCount + frameInChunk] * m_header.velocityQuantum);
+  }
+  return true;
+}
+
+bool TrajectoryReader::readBodyHistory(size_t bodyId, std::vector<double>& times, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& velocities) {
+  if (bodyId >= m_header.bodyCount) {
+    return false;
+  }
+  times.clear();
+  positions.clear();
+  velocities.clear();
+
+  const size_t block = bodyId / m_header.bodiesPerBlock;
+  const size_t firstColumn = (bodyId % m_header.bodiesPerBlock) * TrajectoryFormat::COMPONENTS;
+  std::vector<int64_t> values;
+  std::vector<double> chunkTimes;
+
+  for (size_t chunk = 0; chunk < m_index.size(); chunk++) {
+    size_t frameCount;
+    if (!readChunkTimes(chunk, chunkTimes) || !decodeBlock(chunk, block, values, frameCount)) {
+      return false;
+    }
+    for (size_t frame = 0; frame < frameCount; frame++) {
+      glm::vec3 position, velocity;
+      for (int c = 0; c < 3; c++) {
+        position[c] = (float)(values[(firstColumn + c) * frameCount + frame] * m_header.positionQuantum);
+        velocity[c] = (float)(values[(firstColumn + 3 + c) * frameCount + frame] * m_header.velocityQuantum);
+      }
+      times.push_back(chunkTimes[frame]);
+      positions.push_back(position);
+      velocities.push_back(velocity);
+    }
+  }
+  return true;
+}
+
+bool TrajectoryReader::readFrame(size_t frame, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& velocities) {
+  size_t chunk, frameInChunk;
+  if (!findChunk(frame, chunk, frameInChunk)) {
+    return false;
+  }
+  positions.resize(m_header.bodyCount);
+  velocities.resize(m_header.bodyCount);
+
+  const size_t blockCount = (m_header.bodyCount + m_header.bodiesPerBlock - 1) / m_header.bodiesPerBlock;
+  std::vector<int64_t> values;
+  for (size_t block = 0; block < blockCount; block++) {
+    size_t frameCount;
+    if (!decodeBlock(chunk, block, values, frameCount)) {
+      return false;
+    }
+    const size_t firstBody = block * m_header.bodiesPerBlock;
+    const size_t bodiesInBlock = values.size() / (TrajectoryFormat::COMPONENTS * frameCount);
+    for (size_t local = 0; local < bodiesInBlock; local++) {
+      const size_t firstColumn = local * TrajectoryFormat::COMPONENTS;
+      for (int c = 0; c < 3; c++) {
+        positions[firstBody + local][c] = (float)(values[(firstColumn + c) * frameCount + frameInChunk] * m_header.positionQuantum);
+        velocities[firstBody + local][c] = (float)(values[(firstColumn + 3 + c) * frameCount + frameInChunk] * m_header.velocityQuantum);
+      }
+    }
+  }
+  return true;
+}
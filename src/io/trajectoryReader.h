@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <glm/glm.hpp>
+#include "trajectoryFormat.h"
+
+// Random access reader for files written by TrajectoryWriter.
+// Only chunks listed in the index are visible; call refresh() to pick up chunks appended since opening.
+class TrajectoryReader {
+private:
+  std::string m_filePath;
+  std::ifstream m_dataFile;
+  TrajectoryFileHeader m_header;
+  std::vector<TrajectoryIndexEntry> m_index;
+  std::vector<size_t> m_firstFrameOfChunk;
+  size_t m_frameCount;
+
+  bool findChunk(size_t frame, size_t& chunk, size_t& frameInChunk);
+  bool readChunkTimes(size_t chunk, std::vector<double>& times);
+  bool decodeBlock(size_t chunk, size_t block, std::vector<int64_t>& values, size_t& frameCount);
+
+public:
+  TrajectoryReader();
+  bool open(std::string filePath);
+  bool refresh();
+  size_t getBodyCount();
+  size_t getFrameCount();
+  double getFrameTime(size_t frame);
+  // Index of the last recorded frame at or before time (0 if time precedes the recording)
+  size_t findFrame(double time);
+  bool readBody(size_t bodyId, size_t frame, glm::vec3& position, glm::vec3& velocity);
+  bool readBodyHistory(size_t bodyId, std::vector<double>& times, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& velocities);
+  bool readFrame(size_t frame, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& velocities);
+};
@@ -0,0 +1,261 @@
+#include "trajectoryWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "compression.h"
+#include "trajectoryFormat.h"
+#include "../profiling/tracer.h"
+
+void TrajectoryWriter::Chunk::clear() {
+  times.clear();
+  steps.clear();
+  positions.clear();
+  velocities.clear();
+}
+
+TrajectoryWriter::TrajectoryWriter() {
+  m_fillIndex = 0;
+  m_writePending = false;
+  m_running = false;
+  m_enabled = false;
+  m_filePath = "../trajectory.traj";
+  m_stride = 100;
+  m_framesPerChunk = 16;
+  m_chunkFrames = 16;
+  m_bodiesPerBlock = 4096;
+  m_positionQuantum = 1e-4;
+  m_velocityQuantum = 1e-9;
+  m_bodyCount = 0;
+  m_dataOffset = 0;
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  if (m_thread.joinable()) {
+    flush();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+  }
+}
+
+void TrajectoryWriter::configure(bool enabled, std::string filePath, unsigned int stride, unsigned int framesPerChunk,
+  unsigned int bodiesPerBlock, double positionQuantum, double velocityQuantum) {
+  m_enabled = enabled;
+  m_filePath = filePath;
+  m_stride = stride > 0 ? stride : 1;
+  m_framesPerChunk = framesPerChunk > 0 ? framesPerChunk : 1;
+  m_bodiesPerBlock = bodiesPerBlock > 0 ? bodiesPerBlock : 1;
+  m_positionQuantum = positionQuantum;
+  m_velocityQuantum = velocityQuantum;
+
+  if (m_enabled && !m_thread.joinable()) {
+    m_running = true;
+    m_thread = std::thread(&TrajectoryWriter::run, this);
+  }
+}
+
+bool TrajectoryWriter::isEnabled() {
+  return m_enabled;
+}
+
+bool TrajectoryWriter::isFrameDue(unsigned long long step) {
+  return m_enabled && step % m_stride == 0;
+}
+
+bool TrajectoryWriter::isStarted() {
+  return m_dataFile.is_open();
+}
+
+bool TrajectoryWriter::openFiles() {
+  m_dataFile.open(m_filePath, std::ios::binary | std::ios::trunc);
+  m_indexFile.open(m_filePath + ".idx", std::ios::binary | std::ios::trunc);
+  if (!m_dataFile || !m_indexFile) {
+    std::cout << "Could not open trajectory file for writing: " << m_filePath << std::endl;
+    return false;
+  }
+
+  TrajectoryFileHeader fileHeader;
+  std::memcpy(fileHeader.magic, TrajectoryFormat::FILE_MAGIC, sizeof(fileHeader.magic));
+  fileHeader.version = TrajectoryFormat::VERSION;
+  fileHeader.bodiesPerBlock = m_bodiesPerBlock;
+  fileHeader.bodyCount = m_bodyCount;
+  fileHeader.positionQuantum = m_positionQuantum;
+  fileHeader.velocityQuantum = m_velocityQuantum;
+  m_dataFile.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+  m_dataFile.flush();
+  m_dataOffset = sizeof(fileHeader);
+
+  TrajectoryIndexHeader indexHeader;
+  std::memcpy(indexHeader.magic, TrajectoryFormat::INDEX_MAGIC, sizeof(indexHeader.magic));
+  indexHeader.version = TrajectoryFormat::VERSION;
+  indexHeader.reserved = 0;
+  m_indexFile.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+  m_indexFile.flush();
+
+  return true;
+}
+
+void TrajectoryWriter::appendFrame(const Snapshot& snapshot) {
+  if (!m_enabled) {
+    return;
+  }
+  TRACE_SCOPE("Append trajectory frame");
+
+  if (!m_dataFile.is_open()) {
+    m_bodyCount = snapshot.getBodyCount();
+    size_t frameBytes = std::max<size_t>(m_bodyCount, 1) * 2 * sizeof(glm::vec3);
+    m_chunkFrames = std::max<size_t>(1, std::min<size_t>(m_framesPerChunk, CHUNK_BYTE_BUDGET / frameBytes));
+    if (!openFiles()) {
+      m_enabled = false;
+      return;
+    }
+  }
+
+  if (snapshot.getBodyCount() != m_bodyCount) {
+    std::cout << "Trajectory expects " << m_bodyCount << " bodies but got " << snapshot.getBodyCount() << std::endl;
+    return;
+  }
+
+  Chunk& chunk = m_chunks[m_fillIndex];
+  if (chunk.times.empty()) {
+    chunk.positions.reserve(m_chunkFrames * m_bodyCount);
+    chunk.velocities.reserve(m_chunkFrames * m_bodyCount);
+  }
+  chunk.times.push_back(snapshot.time);
+  chunk.steps.push_back(snapshot.step);
+  chunk.positions.insert(chunk.positions.end(), snapshot.positions.begin(), snapshot.positions.end());
+  chunk.velocities.insert(chunk.velocities.end(), snapshot.velocities.begin(), snapshot.velocities.end());
+
+  if (chunk.times.size() >= m_chunkFrames) {
+    submitChunk();
+  }
+}
+
+void TrajectoryWriter::submitChunk() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Only stalls if the writer has fallen a whole chunk behind
+    m_condition.wait(lock, [this] { return !m_writePending; });
+    m_fillIndex = 1 - m_fillIndex;
+    m_chunks[m_fillIndex].clear();
+    m_writePending = true;
+  }
+  m_condition.notify_all();
+}
+
+void TrajectoryWriter::flush() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  if (!m_chunks[m_fillIndex].times.empty()) {
+    submitChunk();
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this] { return !m_writePending; });
+}
+
+void TrajectoryWriter::run() {
+  TRACE_THREAD_NAME("Trajectory writer");
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return m_writePending || !m_running; });
+    if (!m_writePending && !m_running) {
+      return;
+    }
+
+    const Chunk& chunk = m_chunks[1 - m_fillIndex];
+    lock.unlock();
+    writeChunk(chunk);
+    lock.lock();
+
+    m_writePending = false;
+    m_condition.notify_all();
+  }
+}
+
+std::vector<unsigned char> TrajectoryWriter::encodeBlock(const Chunk& chunk, size_t firstBody, size_t lastBody, uint64_t& rawSize) {
+  const size_t frameCount = chunk.times.size();
+  std::vector<unsigned char> packed;
+  packed.reserve((lastBody - firstBody) * TrajectoryFormat::COMPONENTS * frameCount * 2);
+
+  for (size_t body = firstBody; body < lastBody; body++) {
+    for (unsigned int component = 0; component < TrajectoryFormat::COMPONENTS; component++) {
+      const bool isPosition = component < 3;
+      const std::vector<glm::vec3>& values = isPosition ? chunk.positions : chunk.velocities;
+      const double quantum = isPosition ? m_positionQuantum : m_velocityQuantum;
+
+      // Deltas are taken between quantized values so the error never accumulates over the chunk
+      int64_t previous = 0;
+      for (size_t frame = 0; frame < frameCount; frame++) {
+        double value = values[frame * m_bodyCount + body][component % 3];
+        int64_t quantized = std::isfinite(value) ? (int64_t)std::llround(value / quantum) : 0;
+        int64_t delta = quantized - previous;
+        previous = quantized;
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+        Compression::writeVarint(packed, zigzag);
+      }
+    }
+  }
+
+  rawSize = packed.size();
+  return Compression::compress(packed.data(), packed.size());
+}
+
+void TrajectoryWriter::writeChunk(const Chunk& chunk) {
+  TRACE_SCOPE("Write trajectory chunk");
+  const uint32_t frameCount = chunk.times.size();
+  const uint32_t blockCount = (m_bodyCount + m_bodiesPerBlock - 1) / m_bodiesPerBlock;
+
+  TrajectoryChunkHeader header;
+  header.magic = TrajectoryFormat::CHUNK_MAGIC;
+  header.frameCount = frameCount;
+  header.blockCount = blockCount;
+  header.reserved = 0;
+
+  std::vector<TrajectoryBlockEntry> entries(blockCount);
+  std::vector<std::vector<unsigned char>> blocks(blockCount);
+  uint64_t offset = sizeof(header) + frameCount * (sizeof(double) + sizeof(uint64_t)) + blockCount * sizeof(TrajectoryBlockEntry);
+
+  for (uint32_t block = 0; block < blockCount; block++) {
+    size_t firstBody = (size_t)block * m_bodiesPerBlock;
+    size_t lastBody = std::min(firstBody + m_bodiesPerBlock, m_bodyCount);
+    blocks[block] = encodeBlock(chunk, firstBody, lastBody, entries[block].rawSize);
+    entries[block].offset = offset;
+    entries[block].compressedSize = blocks[block].size();
+    offset += blocks[block].size();
+  }
+
+  std::vector<uint64_t> steps(chunk.steps.begin(), chunk.steps.end());
+  m_dataFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_dataFile.write(reinterpret_cast<const char*>(chunk.times.data()), frameCount * sizeof(double));
+  m_dataFile.write(reinterpret_cast<const char*>(steps.data()), frameCount * sizeof(uint64_t));
+  m_dataFile.write(reinterpret_cast<const char*>(entries.data()), blockCount * sizeof(TrajectoryBlockEntry));
+  for (auto const& block : blocks) {
+    m_dataFile.write(reinterpret_cast<const char*>(block.data()), block.size());
+  }
+  m_dataFile.flush();
+
+  if (!m_dataFile) {
+    std::cout << "Failed writing trajectory chunk to " << m_filePath << std::endl;
+    return;
+  }
+
+  // Publish the chunk to readers only once its data is on disk
+  TrajectoryIndexEntry entry;
+  entry.chunkOffset = m_dataOffset;
+  entry.chunkSize = offset;
+  entry.firstStep = chunk.steps.front();
+  entry.lastStep = chunk.steps.back();
+  entry.firstTime = chunk.times.front();
+  entry.lastTime = chunk.times.back();
+  entry.frameCount = frameCount;
+  entry.reserved = 0;
+  m_indexFile.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+  m_indexFile.flush();
+
+  m_dataOffset += offset;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "../physics/snapshot.h"
+
+// Records body positions and velocities every Kth step into a chunked, compressed columnar file (see trajectoryFormat.h).
+// Frames are copied into the current chunk on the simulation thread; full chunks are encoded and written on a
+// background thread. There are two chunk buffers, so recording only waits if a whole chunk is still being written.
+class TrajectoryWriter {
+private:
+  static const size_t CHUNK_BYTE_BUDGET = 64 * 1024 * 1024; // Per chunk buffer, large runs get fewer frames per chunk
+
+  struct Chunk {
+    std::vector<double> times;
+    std::vector<unsigned long long> steps;
+    std::vector<glm::vec3> positions;  // frame major: frame * bodyCount + body
+    std::vector<glm::vec3> velocities;
+    void clear();
+  };
+
+  Chunk m_chunks[2];
+  unsigned int m_fillIndex;
+  bool m_writePending;
+  bool m_running;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+
+  bool m_enabled;
+  std::string m_filePath;
+  unsigned int m_stride;
+  unsigned int m_framesPerChunk;
+  size_t m_chunkFrames; // m_framesPerChunk, or fewer to keep a chunk within CHUNK_BYTE_BUDGET
+  unsigned int m_bodiesPerBlock;
+  double m_positionQuantum;
+  double m_velocityQuantum;
+  size_t m_bodyCount;
+
+  std::ofstream m_dataFile;
+  std::ofstream m_indexFile;
+  unsigned long long m_dataOffset;
+
+  bool openFiles();
+  void submitChunk();
+  void run();
+  void writeChunk(const Chunk& chunk);
+  std::vector<unsigned char> encodeBlock(const Chunk& chunk, size_t firstBody, size_t lastBody, uint64_t& rawSize);
+
+public:
+  TrajectoryWriter();
+  ~TrajectoryWriter();
+  void configure(bool enabled, std::string filePath, unsigned int stride, unsigned int framesPerChunk,
+    unsigned int bodiesPerBlock, double positionQuantum, double velocityQuantum);
+  bool isEnabled();
+  bool isFrameDue(unsigned long long step);
+  // Whether a frame has been recorded since the writer was enabled
+  bool isStarted();
+  void appendFrame(const Snapshot& snapshot);
+  // Writes the partially filled chunk and waits for it to reach disk
+  void flush();
+};
@@ -10,6 +10,8 @@
 #include "config.h"
 #include "./game/gameController.h"
 #include "./graphics/screen/screenManager.h"
+#include "./profiling/tracer.h"
+#include "./profiling/gpuProfiler.h"
 
 // Prototypes
 GLFWwindow* createWindow();
@@ -33,6 +35,8 @@ int main()
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     #endif
 
+    TRACE_THREAD_NAME("Main");
+
     // Make window 
     GLFWwindow* window = createWindow();
 
@@ -61,20 +65,31 @@ int main()
     {
 
       double startTime = glfwGetTime();
+      TRACE_SCOPE("Frame");
 
-      game->update((float)frameTime);
-      game->render((float)frameTime);
+      {
+        PerfScope perfScope(PERF_FRAME);
+        game->update((float)frameTime);
+        game->render((float)frameTime);
 
-      // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-      glfwSwapBuffers(window);
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        TRACE_SCOPE("Swap buffers");
+        glfwSwapBuffers(window);
+      }
       glfwPollEvents();
 
       // Measure performance
       double endTime = glfwGetTime();
       frameTime = endTime - startTime;
+      GpuProfiler::getInstance()->endFrame();
+      FrameStats::getInstance()->endFrame();
 
     }
 
+#ifdef ENABLE_TRACING
+    Tracer::getInstance()->writeChromeTrace(Config::getInstance()->getTraceFilePath());
+#endif
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
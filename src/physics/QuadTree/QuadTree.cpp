@@ -1,4 +1,5 @@
 #include "QuadTree.h"
+#include <algorithm>
 
 QuadTree::~QuadTree() {
 	// Delete all the aggregate bodies (non-leaf nodes)
@@ -18,6 +19,8 @@ QuadTree::QuadTree(Boundary& boundary) {
 	m_Q2 = nullptr;
 	m_Q3 = nullptr;
 	m_Q4 = nullptr;
+	m_minZ = 0.0f;
+	m_maxZ = 0.0f;
 }
 
 bool QuadTree::insert(GravBody* bodyToInsert) {
@@ -113,28 +116,40 @@ GravBody* QuadTree::aggregateCenterAndTotalMass() {
 			GravBody* aggQ4 = m_Q4->aggregateCenterAndTotalMass();
 
 			std::vector<GravBody*> nonNullBodies;
-			if (aggQ1 != nullptr) nonNullBodies.push_back(aggQ1);
-			if (aggQ2 != nullptr) nonNullBodies.push_back(aggQ2);
-			if (aggQ3 != nullptr) nonNullBodies.push_back(aggQ3);
-			if (aggQ4 != nullptr) nonNullBodies.push_back(aggQ4);
+			std::vector<QuadTree*> nonEmptyQuadrants;
+			if (aggQ1 != nullptr) { nonNullBodies.push_back(aggQ1); nonEmptyQuadrants.push_back(m_Q1); }
+			if (aggQ2 != nullptr) { nonNullBodies.push_back(aggQ2); nonEmptyQuadrants.push_back(m_Q2); }
+			if (aggQ3 != nullptr) { nonNullBodies.push_back(aggQ3); nonEmptyQuadrants.push_back(m_Q3); }
+			if (aggQ4 != nullptr) { nonNullBodies.push_back(aggQ4); nonEmptyQuadrants.push_back(m_Q4); }
+
+			m_minZ = nonEmptyQuadrants[0]->m_minZ;
+			m_maxZ = nonEmptyQuadrants[0]->m_maxZ;
+			for (auto quadrant : nonEmptyQuadrants) {
+				m_minZ = std::min(m_minZ, quadrant->m_minZ);
+				m_maxZ = std::max(m_maxZ, quadrant->m_maxZ);
+			}
 
 			float mass = 0.0;
-			glm::vec2 centerOfMass = glm::vec2(0.0);
+			glm::vec3 centerOfMass = glm::vec3(0.0); // Depth included, bodies are only partitioned in x and y
 
 			for (auto body : nonNullBodies) {
 
 				const float bodyMass = body->getMass();
 				mass += bodyMass;
-				centerOfMass += glm::vec2(body->getPosition() * bodyMass);
+				centerOfMass += body->getPosition() * bodyMass;
 
 			}
 			centerOfMass /= mass;
 
 			m_body->setMass(mass);
-			m_body->setPosition(glm::vec3(centerOfMass, 0.0f));
+			m_body->setPosition(centerOfMass);
 
 		}
 	}
+	else if (m_Q1 == nullptr) {
+		m_minZ = m_body->getPosition().z;
+		m_maxZ = m_minZ;
+	}
 	return m_body;
 }
 
@@ -159,7 +174,7 @@ void QuadTree::barnesHutQuery(GravBody* body, float theta, std::vector<GravBody*
 	glm::vec2 COM = m_body->getPosition();
 	glm::vec2 bodyPosition = glm::vec2(body->getPosition());
 	float distanceToCenterOfCell = glm::length(COM - bodyPosition);
-	float cellWidth = m_boundary.getDimensions().x;
+	float cellWidth = std::max(m_boundary.getDimensions().x, m_maxZ - m_minZ);
 	float thisTheta = cellWidth/distanceToCenterOfCell;
 
 	if (thisTheta < theta) {
@@ -12,6 +12,10 @@ private:
     QuadTree* m_Q2;
     QuadTree* m_Q3;
     QuadTree* m_Q4;
+    // Range of depth (z) of the bodies below, set by aggregateCenterAndTotalMass.
+    // Cells are only split in x and y, so a cell can be much deeper than it is wide.
+    float m_minZ;
+    float m_maxZ;
 
 public:
     ~QuadTree();
@@ -0,0 +1,214 @@
+#include "diagnostics.h"
+#include <iostream>
+#include <cmath>
+#include "../profiling/tracer.h"
+
+DiagnosticsMonitor::DiagnosticsMonitor() {
+  m_captureIndex = 0;
+  m_pending = false;
+  m_discardPending = false;
+  m_running = false;
+  m_G = 0.0f;
+  m_closeApproach2 = 0.0f;
+  m_enabled = false;
+  m_interval = 60;
+  m_directLimit = 4096;
+  m_hasSample = false;
+  m_hasBaseline = false;
+  m_baselineEnergy = 0.0;
+}
+
+DiagnosticsMonitor::~DiagnosticsMonitor() {
+  if (m_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+  }
+}
+
+void DiagnosticsMonitor::configure(bool enabled, unsigned int interval, size_t directLimit, std::string logPath) {
+  flush();
+  m_enabled = enabled;
+  m_interval = interval > 0 ? interval : 1;
+  m_directLimit = directLimit;
+  m_logPath = logPath;
+
+  // Only spin up the background thread once samples are actually wanted
+  if (m_enabled && !m_thread.joinable()) {
+    m_running = true;
+    m_thread = std::thread(&DiagnosticsMonitor::run, this);
+  }
+}
+
+bool DiagnosticsMonitor::isEnabled() {
+  return m_enabled;
+}
+
+bool DiagnosticsMonitor::isDue(unsigned long long step) {
+  return m_enabled && step % m_interval == 0;
+}
+
+Snapshot* DiagnosticsMonitor::acquireBuffer() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_pending) {
+    return nullptr;
+  }
+  return &m_buffers[m_captureIndex];
+}
+
+void DiagnosticsMonitor::submit(float G, float closeApproach2) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Swap buffers, the background thread now owns the captured one
+    m_captureIndex = 1 - m_captureIndex;
+    m_G = G;
+    m_closeApproach2 = closeApproach2;
+    m_pending = true;
+  }
+  m_condition.notify_all();
+}
+
+void DiagnosticsMonitor::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this] { return !m_pending; });
+}
+
+void DiagnosticsMonitor::resetBaseline() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_hasBaseline = false;
+  m_discardPending = m_pending;
+}
+
+bool DiagnosticsMonitor::getLatest(ConservationSample& sample) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  sample = m_latest;
+  return m_hasSample;
+}
+
+void DiagnosticsMonitor::run() {
+  TRACE_THREAD_NAME("Diagnostics");
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return m_pending || !m_running; });
+    if (!m_pending && !m_running) {
+      return;
+    }
+
+    // The buffer not being captured into belongs to this thread until the sample is done
+    const Snapshot& snapshot = m_buffers[1 - m_captureIndex];
+    const float G = m_G;
+    const float closeApproach2 = m_closeApproach2;
+    lock.unlock();
+    ConservationSample sample = computeSample(snapshot, G, closeApproach2, m_directLimit, m_octree);
+    lock.lock();
+
+    if (m_discardPending) {
+      m_discardPending = false;
+      m_pending = false;
+      m_condition.notify_all();
+      continue;
+    }
+
+    if (!m_hasBaseline) {
+      m_baselineEnergy = sample.totalEnergy;
+      m_hasBaseline = true;
+    }
+    if (m_baselineEnergy != 0.0) {
+      sample.energyDrift = (sample.totalEnergy - m_baselineEnergy) / std::abs(m_baselineEnergy);
+    }
+    m_latest = sample;
+    m_hasSample = true;
+
+    lock.unlock();
+    writeLog(sample);
+    lock.lock();
+
+    m_pending = false;
+    m_condition.notify_all();
+  }
+}
+
+void DiagnosticsMonitor::writeLog(const ConservationSample& sample) {
+  if (m_logPath.empty()) {
+    return;
+  }
+  if (!m_log.is_open()) {
+    m_log.open(m_logPath);
+    if (!m_log.is_open()) {
+      std::cout << "Could not open " << m_logPath << ", diagnostics will not be logged" << std::endl;
+      m_logPath = "";
+      return;
+    }
+    m_log << "step,time,kinetic,potential,total,energy_drift,px,py,pz,lx,ly,lz,virial_ratio\n";
+  }
+  m_log << sample.step << "," << sample.time << "," << sample.kineticEnergy << "," << sample.potentialEnergy << ","
+        << sample.totalEnergy << "," << sample.energyDrift << "," << sample.linearMomentum.x << ","
+        << sample.linearMomentum.y << "," << sample.linearMomentum.z << "," << sample.angularMomentum.x << ","
+        << sample.angularMomentum.y << "," << sample.angularMomentum.z << "," << sample.virialRatio << std::endl;
+}
+
+ConservationSample DiagnosticsMonitor::computeSample(const Snapshot& snapshot, float G, float closeApproach2, size_t directLimit, Octree& octree) {
+  TRACE_SCOPE("Conservation sample");
+  ConservationSample sample;
+  sample.step = snapshot.step;
+  sample.time = snapshot.time;
+  const size_t bodyCount = snapshot.getBodyCount();
+  if (bodyCount == 0) {
+    return sample;
+  }
+
+  // Centre of mass frame for the angular momentum
+  double totalMass = 0.0;
+  glm::dvec3 centerOfMass = glm::dvec3(0.0);
+  glm::dvec3 centerOfMassVelocity = glm::dvec3(0.0);
+  for (size_t i = 0; i < bodyCount; i++) {
+    totalMass += snapshot.masses[i];
+    centerOfMass += glm::dvec3(snapshot.positions[i]) * (double)snapshot.masses[i];
+    centerOfMassVelocity += glm::dvec3(snapshot.velocities[i]) * (double)snapshot.masses[i];
+  }
+  if (totalMass > 0.0) {
+    centerOfMass /= totalMass;
+    centerOfMassVelocity /= totalMass;
+  }
+
+  for (size_t i = 0; i < bodyCount; i++) {
+    const double mass = snapshot.masses[i];
+    const glm::dvec3 velocity = glm::dvec3(snapshot.velocities[i]);
+    sample.kineticEnergy += 0.5 * mass * glm::dot(velocity, velocity);
+    sample.linearMomentum += mass * velocity;
+    sample.angularMomentum += mass * glm::cross(glm::dvec3(snapshot.positions[i]) - centerOfMass, velocity - centerOfMassVelocity);
+  }
+
+  // U = -G * sum over pairs of m_i m_j / r_ij
+  double potential = 0.0;
+  if (bodyCount <= directLimit) {
+    for (size_t i = 0; i < bodyCount; i++) {
+      const glm::dvec3 position = glm::dvec3(snapshot.positions[i]);
+      double sum = 0.0;
+      for (size_t j = i + 1; j < bodyCount; j++) {
+        glm::dvec3 r = glm::dvec3(snapshot.positions[j]) - position;
+        double r2 = glm::dot(r, r);
+        if (r2 >= closeApproach2) {
+          sum += snapshot.masses[j] / std::sqrt(r2);
+        }
+      }
+      potential += snapshot.masses[i] * sum;
+    }
+  }
+  else {
+    octree.build(snapshot.positions, snapshot.masses);
+    for (size_t i = 0; i < bodyCount; i++) {
+      potential += snapshot.masses[i] * octree.potential(snapshot.positions[i], (int)i, 0.5f, closeApproach2);
+    }
+    potential *= 0.5; // Every pair was counted from both ends
+  }
+  sample.potentialEnergy = -G * potential;
+  sample.totalEnergy = sample.kineticEnergy + sample.potentialEnergy;
+  if (sample.potentialEnergy != 0.0) {
+    sample.virialRatio = 2.0 * sample.kineticEnergy / std::abs(sample.potentialEnergy);
+  }
+  return sample;
+}
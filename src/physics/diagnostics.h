@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include "snapshot.h"
+#include "octree.h"
+
+// Conserved quantities of one snapshot, about the centre of mass
+struct ConservationSample {
+  unsigned long long step = 0;
+  double time = 0.0;
+  double kineticEnergy = 0.0;
+  double potentialEnergy = 0.0;
+  double totalEnergy = 0.0;
+  double energyDrift = 0.0; // (E - E0) / |E0| with E0 the first sample since the last reset
+  glm::dvec3 linearMomentum = glm::dvec3(0.0);
+  glm::dvec3 angularMomentum = glm::dvec3(0.0);
+  double virialRatio = 0.0; // 2K / |U|, 1 in equilibrium
+};
+
+// Tracks energy and momentum conservation without slowing the simulation down.
+// Works like CheckpointWriter: every m_interval steps the simulation thread copies the bodies into the idle buffer
+// and a background thread computes the sample and appends it to the log. If the previous sample is still being
+// computed, the next due step simply tries again.
+// Potential energy is summed exactly up to m_directLimit bodies and with an octree walk (theta 0.5) above it.
+class DiagnosticsMonitor {
+private:
+  Snapshot m_buffers[2];
+  unsigned int m_captureIndex;
+  bool m_pending;
+  bool m_discardPending; // The pending snapshot predates a resetBaseline, so it is dropped once computed
+  bool m_running;
+  float m_G; // Of the pending snapshot
+  float m_closeApproach2;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+
+  bool m_enabled;
+  unsigned int m_interval; // Steps between samples
+  size_t m_directLimit;
+  std::string m_logPath; // CSV, empty for none
+  std::ofstream m_log; // Only touched by the background thread
+
+  ConservationSample m_latest;
+  bool m_hasSample;
+  bool m_hasBaseline;
+  double m_baselineEnergy;
+  Octree m_octree;
+
+  void run();
+  void writeLog(const ConservationSample& sample);
+
+public:
+  DiagnosticsMonitor();
+  ~DiagnosticsMonitor();
+  void configure(bool enabled, unsigned int interval, size_t directLimit, std::string logPath);
+  bool isEnabled();
+  bool isDue(unsigned long long step);
+  // Returns the buffer to capture into, or nullptr if the previous sample is still being computed
+  Snapshot* acquireBuffer();
+  // G and the close approach clamp of the system the snapshot came from
+  void submit(float G, float closeApproach2);
+  // Blocks until the pending sample is done
+  void flush();
+  // Next sample becomes the new energy reference. A sample already submitted is dropped, it belongs to the old state.
+  void resetBaseline();
+  // False until the first sample is done
+  bool getLatest(ConservationSample& sample);
+  // Computes a sample on the calling thread, without touching the baseline or log
+  static ConservationSample computeSample(const Snapshot& snapshot, float G, float closeApproach2, size_t directLimit, Octree& octree);
+};
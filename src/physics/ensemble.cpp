@@ -0,0 +1,294 @@
+#include "ensemble.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "diagnostics.h"
+#include "octree.h"
+#include "../threading/threadPool.h"
+
+namespace {
+  // Largest distance of any body from the centre of mass
+  double maxRadius(const Snapshot& snapshot, glm::dvec3& centerOfMass) {
+    double totalMass = 0.0;
+    centerOfMass = glm::dvec3(0.0);
+    for (size_t i = 0; i < snapshot.getBodyCount(); i++) {
+      totalMass += snapshot.masses[i];
+      centerOfMass += glm::dvec3(snapshot.positions[i]) * (double)snapshot.masses[i];
+    }
+    if (totalMass > 0.0) {
+      centerOfMass /= totalMass;
+    }
+    double radius = 0.0;
+    for (auto const& position : snapshot.positions) {
+      radius = std::max(radius, glm::length(glm::dvec3(position) - centerOfMass));
+    }
+    return radius;
+  }
+
+  double momentumScale(const Snapshot& snapshot) {
+    double sum = 0.0;
+    for (size_t i = 0; i < snapshot.getBodyCount(); i++) {
+      sum += snapshot.masses[i] * glm::length(glm::dvec3(snapshot.velocities[i]));
+    }
+    return sum;
+  }
+}
+
+Ensemble::Ensemble() {
+  m_SIUnitScaleFactor = 1.0f;
+}
+
+Ensemble::~Ensemble() {
+  clear();
+}
+
+void Ensemble::clear() {
+  for (auto body : m_prototypes) {
+    delete body;
+  }
+  m_prototypes.clear();
+  m_names.clear();
+  m_baseState = Snapshot();
+  m_summaries.clear();
+}
+
+bool Ensemble::loadSpec(std::string filePath, EnsembleSpec& spec) {
+  std::ifstream file(filePath);
+  if (!file.is_open()) {
+    std::cout << "Could not open ensemble spec " << filePath << std::endl;
+    return false;
+  }
+  nlohmann::json jSpec = nlohmann::json::parse(file, nullptr, false);
+  if (jSpec.is_discarded() || !jSpec.is_object()) {
+    std::cout << "Ensemble spec " << filePath << " is not a JSON object" << std::endl;
+    return false;
+  }
+
+  spec.scenePath = jSpec.value("Scene", spec.scenePath);
+  if (jSpec.contains("Generate")) {
+    nlohmann::json jGenerate = jSpec["Generate"];
+    spec.generate = true;
+    if (!InitialConditions::parseDistribution(jGenerate.value("Distribution", std::string("plummer")), spec.generated.distribution)) {
+      std::cout << "Unknown distribution in ensemble spec" << std::endl;
+      return false;
+    }
+    spec.generated.bodyCount = jGenerate.value("Bodies", spec.generated.bodyCount);
+    spec.generated.totalMass = jGenerate.value("TotalMass", spec.generated.totalMass);
+    spec.generated.radius = jGenerate.value("Radius", spec.generated.radius);
+    spec.generatedSIUnitScaleFactor = jGenerate.value("SIUnitScaleFactor", spec.generatedSIUnitScaleFactor);
+  }
+  if (!spec.generate && spec.scenePath.empty()) {
+    std::cout << "Ensemble spec needs a Scene or Generate entry" << std::endl;
+    return false;
+  }
+
+  spec.members = jSpec.value("Members", spec.members);
+  spec.seed = jSpec.value("Seed", spec.seed);
+  spec.duration = jSpec.value("Duration", spec.duration);
+  spec.stepSize = jSpec.value("StepSize", spec.stepSize);
+  spec.theta = jSpec.value("Theta", spec.theta);
+  spec.ejectionRadiusFactor = jSpec.value("EjectionRadiusFactor", spec.ejectionRadiusFactor);
+  spec.directLimit = jSpec.value("DirectLimit", spec.directLimit);
+  spec.threads = jSpec.value("Threads", spec.threads);
+  spec.summaryPath = jSpec.value("Summary", spec.summaryPath);
+
+  std::string engine = jSpec.value("Engine", std::string(spec.forceMethod == FORCE_NAIVE ? "naive" : "tree"));
+  if (engine == "naive") spec.forceMethod = FORCE_NAIVE;
+  else if (engine == "tree") spec.forceMethod = FORCE_BARNES_HUT;
+  else {
+    std::cout << "Unknown engine " << engine << " (only naive and tree exist)" << std::endl;
+    return false;
+  }
+  std::string integrator = jSpec.value("Integrator", std::string(spec.integrator == INTEGRATOR_LEAPFROG ? "leapfrog" : "euler"));
+  if (integrator == "euler") spec.integrator = INTEGRATOR_SEMI_IMPLICIT_EULER;
+  else if (integrator == "leapfrog") spec.integrator = INTEGRATOR_LEAPFROG;
+  else {
+    std::cout << "Unknown integrator " << integrator << std::endl;
+    return false;
+  }
+
+  spec.perturbations.clear();
+  for (auto& jPerturbation : jSpec.value("Perturbations", nlohmann::json::array())) {
+    EnsemblePerturbation perturbation;
+    if (jPerturbation.contains("Bodies")) {
+      perturbation.bodies = jPerturbation["Bodies"].get<std::vector<std::string>>();
+    }
+    perturbation.positionSigma = jPerturbation.value("Position", 0.0);
+    perturbation.velocitySigma = jPerturbation.value("Velocity", 0.0);
+    perturbation.massSigma = jPerturbation.value("Mass", 0.0);
+    spec.perturbations.push_back(perturbation);
+  }
+  return true;
+}
+
+bool Ensemble::prepare(const EnsembleSpec& spec) {
+  clear();
+  m_spec = spec;
+  if (m_spec.stepSize <= 0.0f) {
+    std::cout << "Ensemble step size must be positive" << std::endl;
+    return false;
+  }
+  if (m_spec.generate) {
+    m_SIUnitScaleFactor = m_spec.generatedSIUnitScaleFactor;
+    return true;
+  }
+
+  std::ifstream file(m_spec.scenePath);
+  if (!file.is_open()) {
+    std::cout << "Could not open scene " << m_spec.scenePath << std::endl;
+    return false;
+  }
+  nlohmann::json jScene = nlohmann::json::parse(file, nullptr, false);
+  if (jScene.is_discarded()) {
+    std::cout << "Scene " << m_spec.scenePath << " is not valid JSON" << std::endl;
+    return false;
+  }
+
+  // The base system only exists to turn the JSON into bodies and a snapshot, members copy both
+  System base;
+  base.getThetaTuner()->setEnabled(false);
+  base.loadBodies(jScene);
+  m_SIUnitScaleFactor = base.getSIUnitScaleFactor();
+  m_prototypes = base.getBodies();
+  for (auto body : m_prototypes) {
+    m_names.push_back(body->getName());
+  }
+  base.captureSnapshot(m_baseState);
+  return true;
+}
+
+unsigned int Ensemble::getMemberSeed(unsigned int specSeed, unsigned int member) {
+  return specSeed + member;
+}
+
+void Ensemble::applyPerturbations(Snapshot& snapshot, const std::vector<std::string>& names, const std::vector<EnsemblePerturbation>& perturbations, float SIUnitScaleFactor, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  for (auto const& perturbation : perturbations) {
+    const double positionSigma = perturbation.positionSigma / SIUnitScaleFactor;
+    const double velocitySigma = perturbation.velocitySigma / SIUnitScaleFactor;
+    for (size_t i = 0; i < snapshot.getBodyCount(); i++) {
+      if (!perturbation.bodies.empty()) {
+        if (i >= names.size() || std::find(perturbation.bodies.begin(), perturbation.bodies.end(), names[i]) == perturbation.bodies.end()) {
+          continue;
+        }
+      }
+      // Always draw, so the noise of one body doesn't depend on which sigmas are zero
+      glm::dvec3 dx = glm::dvec3(normal(generator), normal(generator), normal(generator));
+      glm::dvec3 dv = glm::dvec3(normal(generator), normal(generator), normal(generator));
+      double dm = normal(generator);
+      snapshot.positions[i] = glm::vec3(glm::dvec3(snapshot.positions[i]) + dx * positionSigma);
+      snapshot.velocities[i] = glm::vec3(glm::dvec3(snapshot.velocities[i]) + dv * velocitySigma);
+      snapshot.masses[i] = (float)std::max(snapshot.masses[i] * (1.0 + dm * perturbation.massSigma), 0.0);
+    }
+  }
+}
+
+EnsembleMemberSummary Ensemble::runMember(unsigned int member) {
+  auto start = std::chrono::steady_clock::now();
+  EnsembleMemberSummary summary;
+  summary.member = member;
+  summary.seed = getMemberSeed(m_spec.seed, member);
+
+  // Members already run in parallel, so each System stays on its own thread
+  System system;
+  system.setThreadCount(1);
+  system.setForceMethod(m_spec.forceMethod);
+  system.setIntegrator(m_spec.integrator);
+  if (m_spec.theta > 0.0f) {
+    system.getThetaTuner()->setEnabled(false);
+    system.setTheta(m_spec.theta);
+  }
+  system.setSIUnitScaleFactor(m_SIUnitScaleFactor);
+
+  if (m_spec.generate) {
+    InitialConditionParameters parameters = m_spec.generated;
+    parameters.seed = summary.seed;
+    InitialConditions::generate(&system, parameters, 1);
+  }
+  else {
+    for (auto prototype : m_prototypes) {
+      system.addBody(new GravBody(*prototype));
+    }
+    Snapshot initial = m_baseState;
+    if (member > 0) {
+      applyPerturbations(initial, m_names, m_spec.perturbations, m_SIUnitScaleFactor, summary.seed);
+    }
+    system.restoreSnapshot(initial);
+  }
+
+  const float G = system.getGravitationalConstant();
+  const float closeApproach2 = 1e14f / (m_SIUnitScaleFactor * m_SIUnitScaleFactor);
+  Octree octree;
+  Snapshot state;
+  system.captureSnapshot(state);
+  summary.bodyCount = state.getBodyCount();
+  ConservationSample first = DiagnosticsMonitor::computeSample(state, G, closeApproach2, m_spec.directLimit, octree);
+  glm::dvec3 centerOfMass;
+  const double initialRadius = maxRadius(state, centerOfMass);
+  const double initialMomentumScale = momentumScale(state);
+
+  const unsigned long long steps = (unsigned long long)std::ceil(m_spec.duration / m_spec.stepSize);
+  for (unsigned long long i = 0; i < steps; i++) {
+    system.step(m_spec.stepSize);
+  }
+  summary.steps = steps;
+
+  system.captureSnapshot(state);
+  ConservationSample last = DiagnosticsMonitor::computeSample(state, G, closeApproach2, m_spec.directLimit, octree);
+  const double finalRadius = maxRadius(state, centerOfMass);
+  for (auto const& position : state.positions) {
+    if (glm::length(glm::dvec3(position) - centerOfMass) > m_spec.ejectionRadiusFactor * initialRadius) {
+      summary.ejected++;
+    }
+  }
+
+  summary.initialEnergy = first.totalEnergy;
+  summary.finalEnergy = last.totalEnergy;
+  summary.energyDrift = first.totalEnergy != 0.0 ? (last.totalEnergy - first.totalEnergy) / std::abs(first.totalEnergy) : 0.0;
+  summary.momentumDrift = initialMomentumScale > 0.0 ? glm::length(last.linearMomentum - first.linearMomentum) / initialMomentumScale : 0.0;
+  const double angularMomentum = glm::length(first.angularMomentum);
+  summary.angularMomentumDrift = angularMomentum > 0.0 ? glm::length(last.angularMomentum - first.angularMomentum) / angularMomentum : 0.0;
+  summary.finalVirialRatio = last.virialRatio;
+  summary.maxRadiusRatio = initialRadius > 0.0 ? finalRadius / initialRadius : 0.0;
+
+  for (auto body : system.getBodies()) {
+    delete body;
+  }
+  summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return summary;
+}
+
+void Ensemble::run() {
+  m_summaries.assign(m_spec.members, EnsembleMemberSummary());
+  // One member per chunk, they are long and uneven
+  ThreadPool::getInstance()->parallelFor(m_spec.members, 1, [&](size_t begin, size_t end) {
+    for (size_t member = begin; member < end; member++) {
+      m_summaries[member] = runMember((unsigned int)member);
+    }
+  }, m_spec.threads);
+}
+
+std::vector<EnsembleMemberSummary>& Ensemble::getSummaries() {
+  return m_summaries;
+}
+
+bool Ensemble::writeSummaries(std::string filePath) {
+  std::ofstream file(filePath);
+  if (!file.is_open()) {
+    std::cout << "Could not write ensemble summary " << filePath << std::endl;
+    return false;
+  }
+  file.precision(10);
+  file << "member,seed,bodies,steps,wall_seconds,initial_energy,final_energy,energy_drift,momentum_drift,"
+    << "angular_momentum_drift,final_virial_ratio,max_radius_ratio,ejected\n";
+  for (auto const& s : m_summaries) {
+    file << s.member << "," << s.seed << "," << s.bodyCount << "," << s.steps << "," << s.wallSeconds << ","
+      << s.initialEnergy << "," << s.finalEnergy << "," << s.energyDrift << "," << s.momentumDrift << ","
+      << s.angularMomentumDrift << "," << s.finalVirialRatio << "," << s.maxRadiusRatio << "," << s.ejected << "\n";
+  }
+  return true;
+}
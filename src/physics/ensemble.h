@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "system.h"
+#include "initialConditions.h"
+
+// Gaussian noise added to the initial state of every member but the first.
+// Sigmas are in SI units (m, m/s), mass is relative.
+struct EnsemblePerturbation {
+  std::vector<std::string> bodies; // Names of the bodies affected, empty for all
+  double positionSigma = 0.0;
+  double velocitySigma = 0.0;
+  double massSigma = 0.0;
+};
+
+struct EnsembleSpec {
+  std::string scenePath; // Base scene, unused when generating
+  bool generate = false; // Each member generates its own bodies from seed + member index instead
+  InitialConditionParameters generated;
+  float generatedSIUnitScaleFactor = 1e3f;
+
+  unsigned int members = 100;
+  unsigned int seed = 1;
+  double duration = 3.15576e7; // Simulated seconds per member
+  float stepSize = 3600.0f; // Simulated seconds per step
+  ForceMethod forceMethod = FORCE_BARNES_HUT;
+  Integrator integrator = INTEGRATOR_LEAPFROG;
+  float theta = 0.0f; // 0 keeps System's default theta (1.5), tuned only if Config enables the tuner
+  std::vector<EnsemblePerturbation> perturbations;
+  double ejectionRadiusFactor = 2.0; // Bodies further from the centre of mass than this times the initial maximum are ejected
+  size_t directLimit = 4096; // Exact potential energy up to this many bodies
+  unsigned int threads = 0; // Pool threads, 0 for all
+  std::string summaryPath = "ensemble.csv";
+};
+
+struct EnsembleMemberSummary {
+  unsigned int member = 0;
+  unsigned int seed = 0;
+  size_t bodyCount = 0;
+  unsigned long long steps = 0;
+  double wallSeconds = 0.0;
+  double initialEnergy = 0.0; // In the system's scaled units
+  double finalEnergy = 0.0;
+  double energyDrift = 0.0; // (E - E0) / |E0|
+  double momentumDrift = 0.0; // |P - P0| over the sum of |m v| at the start
+  double angularMomentumDrift = 0.0; // |L - L0| / |L0|
+  double finalVirialRatio = 0.0;
+  double maxRadiusRatio = 0.0; // Largest distance from the centre of mass at the end over the largest at the start
+  size_t ejected = 0;
+};
+
+// Runs many independent copies of one system with perturbed initial conditions, e.g. for Monte-Carlo stability studies.
+// The base scene is parsed once and kept as a read-only set of prototype bodies and a snapshot of their state.
+// Members are spread over the thread pool one per task, each with a single threaded System of its own, so
+// hundreds of members run at full utilisation without paying startup, window or asset costs each time.
+// Member 0 is always the unperturbed base, and every member is deterministic given the spec seed.
+class Ensemble {
+private:
+  EnsembleSpec m_spec;
+  std::vector<GravBody*> m_prototypes;
+  std::vector<std::string> m_names;
+  Snapshot m_baseState;
+  float m_SIUnitScaleFactor;
+  std::vector<EnsembleMemberSummary> m_summaries;
+
+  void clear();
+  EnsembleMemberSummary runMember(unsigned int member);
+
+public:
+  Ensemble();
+  ~Ensemble();
+  static bool loadSpec(std::string filePath, EnsembleSpec& spec);
+  // Loads the base scene, relative to the working directory
+  bool prepare(const EnsembleSpec& spec);
+  // Blocks until every member has finished
+  void run();
+  std::vector<EnsembleMemberSummary>& getSummaries();
+  bool writeSummaries(std::string filePath);
+  // Adds each perturbation's noise to the matching bodies, converting sigmas to the scene's units
+  static void applyPerturbations(Snapshot& snapshot, const std::vector<std::string>& names, const std::vector<EnsemblePerturbation>& perturbations, float SIUnitScaleFactor, unsigned int seed);
+  static unsigned int getMemberSeed(unsigned int specSeed, unsigned int member);
+};
@@ -0,0 +1,261 @@
+#include "ephemeris.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "system.h"
+#include "snapshot.h"
+
+Ephemeris::Ephemeris() {
+  m_startTime = 0.0;
+  m_intervalLength = 1.0;
+  m_degree = 0;
+  m_intervalCount = 0;
+  m_bodyCount = 0;
+}
+
+void Ephemeris::reset(double startTime, double intervalLength, unsigned int degree, size_t intervalCount, size_t bodyCount) {
+  m_startTime = startTime;
+  m_intervalLength = intervalLength;
+  m_degree = degree;
+  m_intervalCount = intervalCount;
+  m_bodyCount = bodyCount;
+  m_coefficients.assign(intervalCount * bodyCount * 3 * (degree + 1), 0.0);
+}
+
+// Least squares fit of a Chebyshev series to samples at evenly spaced x in [-1, 1].
+// Every interval samples at the same normalised times, so the fit reduces to one matrix shared by all intervals,
+// bodies and components. Rows of the system are the M+1 positions followed by the M+1 velocities (in dx units).
+// The result is the (degree+1) x 2(M+1) matrix mapping those samples to coefficients.
+bool Ephemeris::computeFitMatrix(unsigned int degree, unsigned int samplesPerInterval, std::vector<double>& fitMatrix) {
+  const size_t terms = degree + 1;
+  const size_t sampleCount = samplesPerInterval + 1;
+  const size_t rows = 2 * sampleCount;
+
+  // Design matrix, rows x terms
+  std::vector<double> design(rows * terms);
+  for (size_t k = 0; k < sampleCount; k++) {
+    double x = -1.0 + 2.0 * k / samplesPerInterval;
+    double t0 = 1.0, t1 = x;
+    double d0 = 0.0, d1 = 1.0;
+    for (size_t j = 0; j < terms; j++) {
+      double t = j == 0 ? t0 : t1;
+      double d = j == 0 ? d0 : d1;
+      design[k * terms + j] = t;
+      design[(sampleCount + k) * terms + j] = d;
+      if (j >= 1) {
+        double t2 = 2.0 * x * t1 - t0;
+        double d2 = 2.0 * t1 + 2.0 * x * d1 - d0;
+        t0 = t1; t1 = t2;
+        d0 = d1; d1 = d2;
+      }
+    }
+  }
+
+  // Solve (AᵀA) F = Aᵀ with Gauss-Jordan elimination
+  const size_t width = terms + rows;
+  std::vector<double> augmented(terms * width, 0.0);
+  for (size_t i = 0; i < terms; i++) {
+    for (size_t j = 0; j < terms; j++) {
+      double sum = 0.0;
+      for (size_t r = 0; r < rows; r++) {
+        sum += design[r * terms + i] * design[r * terms + j];
+      }
+      augmented[i * width + j] = sum;
+    }
+    for (size_t r = 0; r < rows; r++) {
+      augmented[i * width + terms + r] = design[r * terms + i];
+    }
+  }
+
+  for (size_t col = 0; col < terms; col++) {
+    size_t pivot = col;
+    for (size_t i = col + 1; i < terms; i++) {
+      if (std::abs(augmented[i * width + col]) > std::abs(augmented[pivot * width + col])) {
+        pivot = i;
+      }
+    }
+    if (std::abs(augmented[pivot * width + col]) < 1e-12) {
+      return false;
+    }
+    if (pivot != col) {
+      std::swap_ranges(augmented.begin() + pivot * width, augmented.begin() + (pivot + 1) * width, augmented.begin() + col * width);
+    }
+
+    double scale = 1.0 / augmented[col * width + col];
+    for (size_t j = 0; j < width; j++) {
+      augmented[col * width + j] *= scale;
+    }
+    for (size_t i = 0; i < terms; i++) {
+      double factor = augmented[i * width + col];
+      if (i == col || factor == 0.0) {
+        continue;
+      }
+      for (size_t j = 0; j < width; j++) {
+        augmented[i * width + j] -= factor * augmented[col * width + j];
+      }
+    }
+  }
+
+  fitMatrix.resize(terms * rows);
+  for (size_t i = 0; i < terms; i++) {
+    std::copy(augmented.begin() + i * width + terms, augmented.begin() + (i + 1) * width, fitMatrix.begin() + i * rows);
+  }
+  return true;
+}
+
+bool Ephemeris::build(System* system, double duration, double intervalLength, unsigned int degree, unsigned int samplesPerInterval) {
+  if (duration <= 0.0 || intervalLength <= 0.0 || samplesPerInterval == 0) {
+    std::cout << "Invalid ephemeris span" << std::endl;
+    return false;
+  }
+
+  std::vector<double> fitMatrix;
+  if (2 * (samplesPerInterval + 1) < degree + 1 || !computeFitMatrix(degree, samplesPerInterval, fitMatrix)) {
+    std::cout << "Not enough samples per interval for a degree " << degree << " ephemeris" << std::endl;
+    return false;
+  }
+
+  Snapshot original;
+  system->captureSnapshot(original);
+
+  // Tuning at the sample step size would record thetas the real run later replays, so the copy keeps theta fixed
+  System sampler;
+  sampler.setThreadCount(system->getThreadCount());
+  sampler.setForceMethod(system->getForceMethod());
+  sampler.setIntegrator(system->getIntegrator());
+  sampler.getThetaTuner()->setEnabled(false);
+  sampler.setTheta(system->getTheta());
+  sampler.setSIUnitScaleFactor(system->getSIUnitScaleFactor());
+  for (auto body : system->getBodies()) {
+    sampler.addBody(new GravBody(*body));
+  }
+  sampler.restoreSnapshot(original);
+
+  const size_t bodyCount = original.getBodyCount();
+  const size_t intervalCount = (size_t)std::ceil(duration / intervalLength);
+  reset(original.time, intervalLength, degree, intervalCount, bodyCount);
+
+  const size_t terms = degree + 1;
+  const size_t sampleCount = samplesPerInterval + 1;
+  const size_t rows = 2 * sampleCount;
+  const float stepSize = (float)(intervalLength / samplesPerInterval);
+  const double velocityScale = intervalLength / 2.0; // d/dt to d/dx
+
+  // samples[k * bodyCount + body], the last sample of one interval is the first of the next
+  std::vector<glm::vec3> positions(sampleCount * bodyCount);
+  std::vector<glm::vec3> velocities(sampleCount * bodyCount);
+  std::copy(original.positions.begin(), original.positions.end(), positions.begin());
+  std::copy(original.velocities.begin(), original.velocities.end(), velocities.begin());
+
+  Snapshot sample;
+  std::vector<double> rhs(rows);
+  for (size_t interval = 0; interval < intervalCount; interval++) {
+    for (size_t k = 1; k < sampleCount; k++) {
+      sampler.step(stepSize);
+      sampler.captureSnapshot(sample);
+      std::copy(sample.positions.begin(), sample.positions.end(), positions.begin() + k * bodyCount);
+      std::copy(sample.velocities.begin(), sample.velocities.end(), velocities.begin() + k * bodyCount);
+    }
+
+    for (size_t body = 0; body < bodyCount; body++) {
+      for (int component = 0; component < 3; component++) {
+        for (size_t k = 0; k < sampleCount; k++) {
+          rhs[k] = positions[k * bodyCount + body][component];
+          rhs[sampleCount + k] = velocities[k * bodyCount + body][component] * velocityScale;
+        }
+        double* coefficients = &m_coefficients[((interval * bodyCount + body) * 3 + component) * terms];
+        for (size_t j = 0; j < terms; j++) {
+          double sum = 0.0;
+          for (size_t r = 0; r < rows; r++) {
+            sum += fitMatrix[j * rows + r] * rhs[r];
+          }
+          coefficients[j] = sum;
+        }
+      }
+    }
+
+    std::copy(positions.end() - bodyCount, positions.end(), positions.begin());
+    std::copy(velocities.end() - bodyCount, velocities.end(), velocities.begin());
+  }
+
+  for (auto body : sampler.getBodies()) {
+    delete body;
+  }
+  return true;
+}
+
+double Ephemeris::getStartTime() {
+  return m_startTime;
+}
+
+double Ephemeris::getEndTime() {
+  return m_startTime + m_intervalCount * m_intervalLength;
+}
+
+double Ephemeris::getIntervalLength() {
+  return m_intervalLength;
+}
+
+unsigned int Ephemeris::getDegree() {
+  return m_degree;
+}
+
+size_t Ephemeris::getIntervalCount() {
+  return m_intervalCount;
+}
+
+size_t Ephemeris::getBodyCount() {
+  return m_bodyCount;
+}
+
+bool Ephemeris::contains(double time) {
+  return m_intervalCount > 0 && time >= getStartTime() && time <= getEndTime();
+}
+
+std::vector<double>& Ephemeris::getCoefficients() {
+  return m_coefficients;
+}
+
+bool Ephemeris::evaluate(size_t bodyId, double time, glm::vec3& position, glm::vec3& velocity) {
+  if (bodyId >= m_bodyCount || m_intervalCount == 0) {
+    return false;
+  }
+
+  double offset = std::min(std::max(time - m_startTime, 0.0), m_intervalCount * m_intervalLength);
+  size_t interval = std::min((size_t)(offset / m_intervalLength), m_intervalCount - 1);
+  double x = 2.0 * (offset - interval * m_intervalLength) / m_intervalLength - 1.0;
+
+  const size_t terms = m_degree + 1;
+  const double* coefficients = &m_coefficients[(interval * m_bodyCount + bodyId) * 3 * terms];
+
+  // Tₙ and Tₙ' by their recurrences, evaluated once and shared by the three components
+  double p[3] = { 0.0, 0.0, 0.0 };
+  double v[3] = { 0.0, 0.0, 0.0 };
+  double t0 = 1.0, t1 = x;
+  double d0 = 0.0, d1 = 1.0;
+  for (size_t j = 0; j < terms; j++) {
+    double t = j == 0 ? t0 : t1;
+    double d = j == 0 ? d0 : d1;
+    for (int component = 0; component < 3; component++) {
+      p[component] += coefficients[component * terms + j] * t;
+      v[component] += coefficients[component * terms + j] * d;
+    }
+    if (j >= 1) {
+      double t2 = 2.0 * x * t1 - t0;
+      double d2 = 2.0 * t1 + 2.0 * x * d1 - d0;
+      t0 = t1; t1 = t2;
+      d0 = d1; d1 = d2;
+    }
+  }
+
+  const double velocityScale = 2.0 / m_intervalLength;
+  position = glm::vec3(p[0], p[1], p[2]);
+  velocity = glm::vec3(v[0] * velocityScale, v[1] * velocityScale, v[2] * velocityScale);
+  return true;
+}
+
+glm::vec3 Ephemeris::getPosition(size_t bodyId, double time) {
+  glm::vec3 position(0.0f), velocity(0.0f);
+  evaluate(bodyId, time, position, velocity);
+  return position;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+class System;
+
+// Piecewise Chebyshev fit of every body's trajectory, in the spirit of the JPL DE ephemerides.
+// The covered time span is cut into equal intervals; in each interval every position component of every body
+// is a Chebyshev series in the normalised time x = [-1, 1]. Velocities are the derivative of the same series.
+// Looking up a state is an index computation plus one series evaluation, independent of how far the date is.
+class Ephemeris {
+private:
+  double m_startTime;
+  double m_intervalLength;
+  unsigned int m_degree;
+  size_t m_intervalCount;
+  size_t m_bodyCount;
+
+  // [interval][body][component][coefficient]
+  std::vector<double> m_coefficients;
+
+  static bool computeFitMatrix(unsigned int degree, unsigned int samplesPerInterval, std::vector<double>& fitMatrix);
+
+public:
+  Ephemeris();
+  void reset(double startTime, double intervalLength, unsigned int degree, size_t intervalCount, size_t bodyCount);
+
+  // Integrates system forward for duration simulated seconds and fits the result.
+  // samplesPerInterval steps are taken per interval and both position and velocity of each sample are fitted.
+  // The steps are taken by a private copy at the system's current theta, so system itself is left untouched:
+  // its tuner history, cached accelerations, stats and phase listener never see the sample steps.
+  bool build(System* system, double duration, double intervalLength, unsigned int degree, unsigned int samplesPerInterval);
+
+  double getStartTime();
+  double getEndTime();
+  double getIntervalLength();
+  unsigned int getDegree();
+  size_t getIntervalCount();
+  size_t getBodyCount();
+  bool contains(double time);
+  std::vector<double>& getCoefficients();
+
+  // Times outside the covered span are clamped to it
+  bool evaluate(size_t bodyId, double time, glm::vec3& position, glm::vec3& velocity);
+  glm::vec3 getPosition(size_t bodyId, double time);
+};
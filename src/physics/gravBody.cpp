@@ -40,6 +40,19 @@ GravBody::GravBody(float SIUnitScaleFactor, json jsonData) {
   }
 }
 
+GravBody::GravBody(const SceneFile& sceneFile, size_t index, const std::vector<std::string>& strings) {
+  setParamsFromSceneFile(sceneFile, index, strings);
+
+  addPlanetInfo(strings[sceneFile.getStringId(SCENE_STRING_NAME, index)]);
+  setMass(sceneFile.getMasses()[index]);
+  setVelocity(sceneFile.getVelocities()[index]);
+  setTilt(sceneFile.getTilts()[index]);
+  setRotationSpeedFromPeriod(sceneFile.getRotationPeriods()[index]);
+  for (uint32_t info : sceneFile.getPlanetInfoIds(index)) {
+    addPlanetInfo(strings[info]);
+  }
+}
+
 glm::vec3 GravBody::getVelocity() {
   return m_velocity;
 }
@@ -14,6 +14,7 @@ class GravBody : public Object {
 	public:
 	  GravBody();
 		GravBody(float SIUnitScaleFactor, nlohmann::json jsonData);
+		GravBody(const SceneFile& sceneFile, size_t index, const std::vector<std::string>& strings);
 	  glm::vec3 getVelocity();
 	  void setVelocity(float x, float y, float z);
 	  void setVelocity(glm::vec3 velocity);
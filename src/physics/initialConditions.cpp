@@ -0,0 +1,424 @@
+#include "initialConditions.h"
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include "../threading/threadPool.h"
+
+namespace {
+  const size_t CHUNK_SIZE = 16384; // Bodies per random stream
+  const float PLUMMER_CUTOFF = 5.0f; // In scale radii, keeps clusters well inside the tree bounds
+  const float DISK_CUTOFF = 5.0f;
+  const float HERNQUIST_CUTOFF = 10.0f;
+  const int TABLE_SIZE = 512;
+
+  glm::vec3 randomDirection(std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+    float z = uniform(rng);
+    float phi = angle(rng);
+    float s = std::sqrt(1.0f - z * z);
+    return glm::vec3(s * std::cos(phi), s * std::sin(phi), z);
+  }
+
+  bool isSpherical(Distribution distribution) {
+    return distribution == DISTRIBUTION_PLUMMER || distribution == DISTRIBUTION_HERNQUIST || distribution == DISTRIBUTION_NFW;
+  }
+
+  double plummerMass(double x) {
+    return x * x * x / std::pow(1.0 + x * x, 1.5);
+  }
+
+  double diskMass(double x) {
+    return 1.0 - (1.0 + x) * std::exp(-x);
+  }
+
+  double hernquistMass(double x) {
+    return x * x / ((1.0 + x) * (1.0 + x));
+  }
+
+  double nfwMass(double x) {
+    return std::log(1.0 + x) - x / (1.0 + x);
+  }
+
+  // Outermost radius a component reaches
+  double cutoffRadius(const InitialConditionParameters& p) {
+    switch (p.distribution) {
+      case DISTRIBUTION_PLUMMER: return PLUMMER_CUTOFF * p.radius;
+      case DISTRIBUTION_DISK: return DISK_CUTOFF * p.radius;
+      case DISTRIBUTION_HERNQUIST: return HERNQUIST_CUTOFF * p.radius;
+      case DISTRIBUTION_NFW: return p.concentration * p.radius;
+      default: return p.radius;
+    }
+  }
+
+  // Fraction of the component's mass (excluding the central mass) within r of the centre.
+  // Disks and belts are treated as if their mass inside r were spherical.
+  double enclosedFraction(const InitialConditionParameters& p, double r) {
+    const double x = std::min(r, cutoffRadius(p)) / p.radius;
+    switch (p.distribution) {
+      case DISTRIBUTION_PLUMMER: return plummerMass(x) / plummerMass(PLUMMER_CUTOFF);
+      case DISTRIBUTION_UNIFORM: return x * x * x;
+      case DISTRIBUTION_DISK: return diskMass(x) / diskMass(DISK_CUTOFF);
+      case DISTRIBUTION_HERNQUIST: return hernquistMass(x) / hernquistMass(HERNQUIST_CUTOFF);
+      case DISTRIBUTION_NFW: return nfwMass(x) / nfwMass(p.concentration);
+      case DISTRIBUTION_BELT: {
+        if (r >= p.radius) return 1.0;
+        double width = p.radius - p.innerRadius;
+        return width > 0.0 ? std::max(r - p.innerRadius, 0.0) / width : 0.0;
+      }
+    }
+    return 0.0;
+  }
+
+  double totalEnclosedMass(const std::vector<InitialConditionParameters>& components, double r) {
+    double mass = 0.0;
+    for (auto const& p : components) {
+      mass += p.totalMass * enclosedFraction(p, r) + p.centralMass;
+    }
+    return mass;
+  }
+
+  // Unnormalised density of the spherical components
+  double density(const InitialConditionParameters& p, double r) {
+    const double x = r / p.radius;
+    if (r > cutoffRadius(p)) {
+      return 0.0;
+    }
+    switch (p.distribution) {
+      case DISTRIBUTION_PLUMMER: return std::pow(1.0 + x * x, -2.5);
+      case DISTRIBUTION_HERNQUIST: return 1.0 / (x * std::pow(1.0 + x, 3.0));
+      case DISTRIBUTION_NFW: return 1.0 / (x * (1.0 + x) * (1.0 + x));
+      default: return 0.0;
+    }
+  }
+
+  // Precomputed once per spherical component, read by every chunk
+  struct SphericalTables {
+    bool exactPlummer = false;
+    std::vector<double> logRadius; // Evenly spaced
+    std::vector<double> dispersion2; // Isotropic Jeans velocity dispersion squared
+    std::vector<double> escape2; // Escape speed squared, 2 |potential|
+    std::vector<double> nfwMassFraction; // Cumulative mass at each radius, for inverting the NFW profile
+  };
+
+  double interpolate(const SphericalTables& tables, const std::vector<double>& values, double r) {
+    const double logR = std::log(r);
+    const double step = tables.logRadius[1] - tables.logRadius[0];
+    double t = (logR - tables.logRadius[0]) / step;
+    t = std::min(std::max(t, 0.0), (double)(TABLE_SIZE - 1));
+    int i = std::min((int)t, TABLE_SIZE - 2);
+    double f = t - i;
+    return values[i] * (1.0 - f) + values[i + 1] * f;
+  }
+
+  // sigma^2(r) = 1 / rho(r) * integral from r to the cutoff of rho G M(<r') / r'^2, with M of every component
+  SphericalTables buildTables(const std::vector<InitialConditionParameters>& components, size_t index, float G) {
+    const InitialConditionParameters& p = components[index];
+    SphericalTables tables;
+    bool alone = components.size() == 1 && p.centralMass == 0.0f;
+    tables.exactPlummer = p.distribution == DISTRIBUTION_PLUMMER && alone;
+    if (!isSpherical(p.distribution) || tables.exactPlummer) {
+      return tables;
+    }
+
+    const double rMin = 1e-4 * p.radius;
+    const double rMax = cutoffRadius(p);
+    tables.logRadius.resize(TABLE_SIZE);
+    std::vector<double> gravity(TABLE_SIZE); // G M(<r) / r^2
+    for (int i = 0; i < TABLE_SIZE; i++) {
+      tables.logRadius[i] = std::log(rMin) + (std::log(rMax) - std::log(rMin)) * i / (TABLE_SIZE - 1);
+      double r = std::exp(tables.logRadius[i]);
+      gravity[i] = G * totalEnclosedMass(components, r) / (r * r);
+    }
+
+    tables.dispersion2.assign(TABLE_SIZE, 0.0);
+    tables.escape2.assign(TABLE_SIZE, 0.0);
+    double pressure = 0.0; // Integral of rho g from r outwards
+    double potential = G * totalEnclosedMass(components, rMax) / rMax; // |potential| at the cutoff
+    tables.escape2[TABLE_SIZE - 1] = 2.0 * potential;
+    for (int i = TABLE_SIZE - 2; i >= 0; i--) {
+      double r0 = std::exp(tables.logRadius[i]);
+      double r1 = std::exp(tables.logRadius[i + 1]);
+      double rho0 = density(p, r0);
+      double rho1 = density(p, std::min(r1, rMax));
+      pressure += 0.5 * (rho0 * gravity[i] + rho1 * gravity[i + 1]) * (r1 - r0);
+      potential += 0.5 * (gravity[i] + gravity[i + 1]) * (r1 - r0);
+      tables.dispersion2[i] = rho0 > 0.0 ? pressure / rho0 : 0.0;
+      tables.escape2[i] = 2.0 * potential;
+    }
+
+    if (p.distribution == DISTRIBUTION_NFW) {
+      tables.nfwMassFraction.resize(TABLE_SIZE);
+      for (int i = 0; i < TABLE_SIZE; i++) {
+        tables.nfwMassFraction[i] = enclosedFraction(p, std::exp(tables.logRadius[i]));
+      }
+    }
+    return tables;
+  }
+
+  // Aarseth, Henon & Wielen (1974). Radii past the cutoff are redrawn to keep the cluster well inside the tree bounds.
+  void samplePlummer(std::mt19937& rng, float G, float totalMass, float radius, glm::vec3& position, glm::vec3& velocity) {
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    float r;
+    do {
+      float massFraction = std::max(uniform(rng), 1e-6f);
+      r = radius / std::sqrt(std::pow(massFraction, -2.0f / 3.0f) - 1.0f);
+    } while (r > PLUMMER_CUTOFF * radius);
+    position = r * randomDirection(rng);
+
+    // Speed as a fraction q of the local escape speed, drawn from g(q) = q^2 (1 - q^2)^3.5 by rejection
+    float q, g;
+    do {
+      q = uniform(rng);
+      g = 0.1f * uniform(rng);
+    } while (g > q * q * std::pow(1.0f - q * q, 3.5f));
+    float escapeSpeed = std::sqrt(2.0f * G * totalMass) * std::pow(r * r + radius * radius, -0.25f);
+    velocity = q * escapeSpeed * randomDirection(rng);
+  }
+
+  double sampleSphericalRadius(std::mt19937& rng, const InitialConditionParameters& p, const SphericalTables& tables) {
+    std::uniform_real_distribution<double> uniform(1e-9, 1.0);
+    switch (p.distribution) {
+      case DISTRIBUTION_PLUMMER: {
+        double r;
+        do {
+          r = p.radius / std::sqrt(std::pow(uniform(rng), -2.0 / 3.0) - 1.0);
+        } while (r > PLUMMER_CUTOFF * p.radius);
+        return r;
+      }
+      case DISTRIBUTION_HERNQUIST: {
+        // M(<x) = x^2 / (1 + x)^2 inverts directly
+        double s = std::sqrt(uniform(rng) * hernquistMass(HERNQUIST_CUTOFF));
+        return p.radius * s / (1.0 - s);
+      }
+      default: {
+        // NFW has no closed form inverse, search the tabulated mass fraction
+        double u = uniform(rng);
+        auto it = std::lower_bound(tables.nfwMassFraction.begin(), tables.nfwMassFraction.end(), u);
+        size_t i = std::min<size_t>(std::max<size_t>(it - tables.nfwMassFraction.begin(), 1), TABLE_SIZE - 1);
+        double m0 = tables.nfwMassFraction[i - 1];
+        double m1 = tables.nfwMassFraction[i];
+        double f = m1 > m0 ? (u - m0) / (m1 - m0) : 0.0;
+        return std::exp(tables.logRadius[i - 1] + f * (tables.logRadius[i] - tables.logRadius[i - 1]));
+      }
+    }
+  }
+
+  // Isotropic Gaussian with the local Jeans dispersion, redrawn above the escape speed
+  void sampleSpherical(std::mt19937& rng, const InitialConditionParameters& p, const SphericalTables& tables, glm::vec3& position, glm::vec3& velocity) {
+    double r = sampleSphericalRadius(rng, p, tables);
+    position = (float)r * randomDirection(rng);
+
+    std::normal_distribution<double> normal(0.0, 1.0);
+    double sigma = std::sqrt(interpolate(tables, tables.dispersion2, r));
+    double escape2 = interpolate(tables, tables.escape2, r);
+    glm::dvec3 v;
+    do {
+      v = glm::dvec3(normal(rng), normal(rng), normal(rng)) * sigma;
+    } while (glm::dot(v, v) >= escape2);
+    velocity = glm::vec3(v);
+  }
+
+  void sampleUniform(std::mt19937& rng, float radius, glm::vec3& position, glm::vec3& velocity) {
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    position = radius * std::cbrt(uniform(rng)) * randomDirection(rng);
+    velocity = glm::vec3(0.0f);
+  }
+
+  // Exponential surface density with scale length radius in the xy plane, truncated at the cutoff
+  void sampleDisk(std::mt19937& rng, const std::vector<InitialConditionParameters>& components, float G, float radius, glm::vec3& position, glm::vec3& velocity) {
+    std::uniform_real_distribution<float> uniform(1e-7f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+    std::normal_distribution<float> thickness(0.0f, 0.02f * radius);
+
+    // R/Rd follows x e^-x, the sum of two unit exponentials
+    float x;
+    do {
+      x = -std::log(uniform(rng) * uniform(rng));
+    } while (x > DISK_CUTOFF);
+    float R = x * radius;
+    float phi = angle(rng);
+    position = glm::vec3(R * std::cos(phi), R * std::sin(phi), thickness(rng));
+
+    // Circular speed from the rotation curve of every component
+    float speed = (float)std::sqrt(G * totalEnclosedMass(components, R) / R);
+    velocity = speed * glm::vec3(-std::sin(phi), std::cos(phi), 0.0f);
+  }
+
+  // Uniform semi-major axis, eccentricity and inclination up to their maxima, uniform angles
+  void sampleBelt(std::mt19937& rng, const std::vector<InitialConditionParameters>& components, const InitialConditionParameters& p, float G, glm::vec3& position, glm::vec3& velocity) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double twoPi = glm::two_pi<double>();
+    double a = std::max(p.innerRadius + uniform(rng) * (p.radius - p.innerRadius), 1e-3 * p.radius);
+    double e = uniform(rng) * std::min(p.maxEccentricity, 0.99f);
+    double inclination = uniform(rng) * glm::radians((double)p.maxInclination);
+    double ascendingNode = uniform(rng) * twoPi;
+    double periapsis = uniform(rng) * twoPi;
+    double meanAnomaly = uniform(rng) * twoPi;
+
+    // Kepler's equation by Newton's method
+    double E = meanAnomaly;
+    for (int i = 0; i < 8; i++) {
+      E -= (E - e * std::sin(E) - meanAnomaly) / (1.0 - e * std::cos(E));
+    }
+
+    // In the orbital plane, then rotated by periapsis, inclination and ascending node
+    double mu = G * totalEnclosedMass(components, a);
+    double n = std::sqrt(mu / (a * a * a));
+    double b = a * std::sqrt(1.0 - e * e);
+    double denominator = 1.0 - e * std::cos(E);
+    glm::dvec2 planePosition = glm::dvec2(a * (std::cos(E) - e), b * std::sin(E));
+    glm::dvec2 planeVelocity = glm::dvec2(-a * n * std::sin(E) / denominator, b * n * std::cos(E) / denominator);
+
+    auto toSpace = [&](glm::dvec2 v) {
+      double cw = std::cos(periapsis), sw = std::sin(periapsis);
+      double ci = std::cos(inclination), si = std::sin(inclination);
+      double cO = std::cos(ascendingNode), sO = std::sin(ascendingNode);
+      double x = cw * v.x - sw * v.y;
+      double y = sw * v.x + cw * v.y;
+      double z = si * y;
+      y = ci * y;
+      return glm::vec3((float)(cO * x - sO * y), (float)(sO * x + cO * y), (float)z);
+    };
+    position = toSpace(planePosition);
+    velocity = toSpace(planeVelocity);
+  }
+
+  void generateChunk(const std::vector<InitialConditionParameters>& components, size_t index, const SphericalTables& tables,
+    float G, size_t chunk, size_t offset, Snapshot& snapshot) {
+    const InitialConditionParameters& p = components[index];
+    std::seed_seq seed = { (unsigned int)p.seed, (unsigned int)index, (unsigned int)chunk };
+    std::mt19937 rng(seed);
+    const float bodyMass = p.bodyCount > 0 ? p.totalMass / p.bodyCount : 0.0f;
+    const size_t begin = chunk * CHUNK_SIZE;
+    const size_t end = std::min(begin + CHUNK_SIZE, p.bodyCount);
+    for (size_t i = begin; i < end; i++) {
+      glm::vec3 position, velocity;
+      switch (p.distribution) {
+        case DISTRIBUTION_PLUMMER:
+          if (tables.exactPlummer) {
+            samplePlummer(rng, G, p.totalMass, p.radius, position, velocity);
+          }
+          else {
+            sampleSpherical(rng, p, tables, position, velocity);
+          }
+          break;
+        case DISTRIBUTION_HERNQUIST:
+        case DISTRIBUTION_NFW:
+          sampleSpherical(rng, p, tables, position, velocity);
+          break;
+        case DISTRIBUTION_UNIFORM:
+          sampleUniform(rng, p.radius, position, velocity);
+          break;
+        case DISTRIBUTION_DISK:
+          sampleDisk(rng, components, G, p.radius, position, velocity);
+          break;
+        case DISTRIBUTION_BELT:
+          sampleBelt(rng, components, p, G, position, velocity);
+          break;
+      }
+      snapshot.masses[offset + i] = bodyMass;
+      snapshot.positions[offset + i] = position;
+      snapshot.velocities[offset + i] = velocity;
+      snapshot.rotations[offset + i] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+  }
+}
+
+size_t InitialConditions::getBodyCount(const InitialConditionParameters& parameters) {
+  return parameters.bodyCount + (parameters.centralMass > 0.0f ? 1 : 0);
+}
+
+void InitialConditions::generate(const std::vector<InitialConditionParameters>& components, float G, Snapshot& snapshot, unsigned int threadCount) {
+  size_t bodyCount = 0;
+  for (auto const& p : components) {
+    bodyCount += getBodyCount(p);
+  }
+  snapshot.resize(bodyCount);
+  snapshot.time = 0.0;
+  snapshot.step = 0;
+
+  // Central bodies first in each component, then fixed size chunks of the rest
+  struct Chunk {
+    size_t component;
+    size_t chunk;
+    size_t offset;
+  };
+  std::vector<Chunk> chunks;
+  std::vector<SphericalTables> tables;
+  size_t offset = 0;
+  for (size_t c = 0; c < components.size(); c++) {
+    const InitialConditionParameters& p = components[c];
+    tables.push_back(buildTables(components, c, G));
+    if (p.centralMass > 0.0f) {
+      snapshot.masses[offset] = p.centralMass;
+      snapshot.positions[offset] = glm::vec3(0.0f);
+      snapshot.velocities[offset] = glm::vec3(0.0f);
+      snapshot.rotations[offset] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+      offset++;
+    }
+    for (size_t chunk = 0; chunk * CHUNK_SIZE < p.bodyCount; chunk++) {
+      chunks.push_back({ c, chunk, offset });
+    }
+    offset += p.bodyCount;
+  }
+
+  ThreadPool::getInstance()->parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      generateChunk(components, chunks[i].component, tables[chunks[i].component], G, chunks[i].chunk, chunks[i].offset, snapshot);
+    }
+  }, threadCount);
+
+  // Centre the system on its centre of mass so it doesn't drift towards the tree bounds
+  double totalMass = 0.0;
+  glm::dvec3 meanPosition = glm::dvec3(0.0);
+  glm::dvec3 meanVelocity = glm::dvec3(0.0);
+  for (size_t i = 0; i < bodyCount; i++) {
+    totalMass += snapshot.masses[i];
+    meanPosition += glm::dvec3(snapshot.positions[i]) * (double)snapshot.masses[i];
+    meanVelocity += glm::dvec3(snapshot.velocities[i]) * (double)snapshot.masses[i];
+  }
+  if (totalMass > 0.0) {
+    glm::vec3 positionOffset = glm::vec3(meanPosition / totalMass);
+    glm::vec3 velocityOffset = glm::vec3(meanVelocity / totalMass);
+    for (size_t i = 0; i < bodyCount; i++) {
+      snapshot.positions[i] -= positionOffset;
+      snapshot.velocities[i] -= velocityOffset;
+    }
+  }
+}
+
+void InitialConditions::generate(System* system, const InitialConditionParameters& parameters, unsigned int threadCount) {
+  Snapshot snapshot;
+  generate(std::vector<InitialConditionParameters>{ parameters }, system->getGravitationalConstant(), snapshot, threadCount);
+  for (size_t i = 0; i < snapshot.getBodyCount(); i++) {
+    GravBody* body = new GravBody();
+    body->setMass(snapshot.masses[i]);
+    body->setPosition(snapshot.positions[i]);
+    body->setVelocity(snapshot.velocities[i]);
+    system->addBody(body);
+  }
+}
+
+std::string InitialConditions::getDistributionName(Distribution distribution) {
+  switch (distribution) {
+    case DISTRIBUTION_PLUMMER: return "plummer";
+    case DISTRIBUTION_UNIFORM: return "uniform";
+    case DISTRIBUTION_DISK: return "disk";
+    case DISTRIBUTION_HERNQUIST: return "hernquist";
+    case DISTRIBUTION_NFW: return "nfw";
+    case DISTRIBUTION_BELT: return "belt";
+    default: return "";
+  }
+}
+
+bool InitialConditions::parseDistribution(std::string name, Distribution& distribution) {
+  for (int i = DISTRIBUTION_PLUMMER; i <= DISTRIBUTION_BELT; i++) {
+    if (name == getDistributionName((Distribution)i)) {
+      distribution = (Distribution)i;
+      return true;
+    }
+  }
+  return false;
+}
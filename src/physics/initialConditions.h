@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "system.h"
+#include "snapshot.h"
+
+enum Distribution {
+  DISTRIBUTION_PLUMMER, // Spherical cluster in virial equilibrium
+  DISTRIBUTION_UNIFORM, // Cold uniform sphere
+  DISTRIBUTION_DISK, // Thin exponential disk on circular orbits
+  DISTRIBUTION_HERNQUIST, // Bulge or halo, density ~ r^-1 inside the scale radius and r^-4 outside, cut at 10 scale radii
+  DISTRIBUTION_NFW, // Dark matter halo, density ~ r^-1 inside the scale radius and r^-3 outside, cut at concentration scale radii
+  DISTRIBUTION_BELT // Keplerian orbits from random orbital elements, e.g. an asteroid belt around centralMass
+};
+
+struct InitialConditionParameters {
+  Distribution distribution = DISTRIBUTION_PLUMMER;
+  size_t bodyCount = 1000;
+  float totalMass = 1e24f; // In the system's mass units, not counting centralMass
+  float radius = 1e9f; // Scale radius in the system's distance units, largest semi-major axis for belts
+  unsigned int seed = 1;
+  float concentration = 10.0f; // NFW truncation radius over scale radius
+  float innerRadius = 0.0f; // Smallest semi-major axis of a belt
+  float maxEccentricity = 0.1f; // Belt
+  float maxInclination = 5.0f; // Belt, in degrees from the xy plane
+  float centralMass = 0.0f; // Extra body at the centre, e.g. the star of a belt or the black hole of a galaxy
+};
+
+// Synthetic body distributions for benchmarks, stress tests and galaxy scenes. Equal mass bodies per component.
+// Bodies are generated in fixed size chunks, each with its own random stream seeded from (seed, component, chunk),
+// so the result depends only on the parameters and not on how many threads generated it.
+class InitialConditions {
+public:
+  // Adds the bodies to the system, using its gravitational constant for the velocities.
+  // threadCount limits the pool threads used, 1 when called from inside a parallelFor.
+  static void generate(System* system, const InitialConditionParameters& parameters, unsigned int threadCount = 0);
+  // Fills snapshot with the bodies of every component in order, centred on the centre of mass.
+  // Disks and belts orbit on the rotation curve of all components together and halos get Jeans velocity dispersions in
+  // the combined potential, so e.g. an NFW halo plus a disk plus a central mass is one galaxy close to equilibrium.
+  // A Plummer sphere on its own uses its exact distribution function instead.
+  static void generate(const std::vector<InitialConditionParameters>& components, float G, Snapshot& snapshot, unsigned int threadCount = 0);
+  // Including the central body, if any
+  static size_t getBodyCount(const InitialConditionParameters& parameters);
+  static std::string getDistributionName(Distribution distribution);
+  static bool parseDistribution(std::string name, Distribution& distribution);
+};
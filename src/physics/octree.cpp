@@ -0,0 +1,320 @@
+#include "octree.h"
+#include <algorithm>
+#include <cmath>
+
+Octree::Octree() {
+  m_positions = nullptr;
+  m_masses = nullptr;
+  m_builtRadius = 0.0;
+}
+
+int Octree::childFor(const Node& node, glm::vec3 position) {
+  glm::dvec3 p = glm::dvec3(position);
+  return (p.x >= node.center.x ? 1 : 0) | (p.y >= node.center.y ? 2 : 0) | (p.z >= node.center.z ? 4 : 0);
+}
+
+void Octree::subdivide(int nodeIndex) {
+  const int firstChild = m_nodes.size();
+  const double quarter = m_nodes[nodeIndex].halfSize * 0.5;
+  const glm::dvec3 center = m_nodes[nodeIndex].center;
+  for (int i = 0; i < 8; i++) {
+    Node child;
+    child.center = center + glm::dvec3((i & 1) ? quarter : -quarter, (i & 2) ? quarter : -quarter, (i & 4) ? quarter : -quarter);
+    child.halfSize = quarter;
+    child.centerOfMass = glm::dvec3(0.0);
+    child.mass = 0.0;
+    child.radius = 0.0;
+    child.firstChild = -1;
+    child.firstBody = -1;
+    m_nodes.push_back(child); // May reallocate, so the parent is only touched by index
+  }
+  m_nodes[nodeIndex].firstChild = firstChild;
+}
+
+void Octree::build(const std::vector<glm::vec3>& positions, const std::vector<float>& masses) {
+  m_positions = &positions;
+  m_masses = &masses;
+  m_nodes.clear();
+  m_nextBody.assign(positions.size(), -1);
+  m_builtRadius = 0.0;
+  if (positions.empty()) {
+    return;
+  }
+
+  // Cube around every body
+  glm::vec3 low = positions[0];
+  glm::vec3 high = positions[0];
+  for (auto const& position : positions) {
+    low = glm::min(low, position);
+    high = glm::max(high, position);
+  }
+  glm::dvec3 extent = glm::dvec3(high) - glm::dvec3(low);
+  Node root;
+  root.center = (glm::dvec3(low) + glm::dvec3(high)) * 0.5;
+  root.halfSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1.0)) * 0.5 * 1.0001;
+  root.centerOfMass = glm::dvec3(0.0);
+  root.mass = 0.0;
+  root.radius = 0.0;
+  root.firstChild = -1;
+  root.firstBody = -1;
+  m_nodes.reserve(positions.size() * 2);
+  m_nodes.push_back(root);
+
+  for (int body = 0; body < (int)positions.size(); body++) {
+    int nodeIndex = 0;
+    int depth = 0;
+    while (true) {
+      if (m_nodes[nodeIndex].firstChild != -1) {
+        nodeIndex = m_nodes[nodeIndex].firstChild + childFor(m_nodes[nodeIndex], positions[body]);
+        depth++;
+        continue;
+      }
+      int resident = m_nodes[nodeIndex].firstBody;
+      if (resident == -1 || depth >= MAX_DEPTH) {
+        m_nextBody[body] = resident;
+        m_nodes[nodeIndex].firstBody = body;
+        break;
+      }
+      // Occupied leaf: split it and push the resident down, then keep descending with this body
+      subdivide(nodeIndex);
+      m_nodes[nodeIndex].firstBody = -1;
+      int residentChild = m_nodes[nodeIndex].firstChild + childFor(m_nodes[nodeIndex], positions[resident]);
+      m_nodes[residentChild].firstBody = resident;
+    }
+  }
+
+  computeMoments();
+  m_builtRadius = getRadiusSum();
+}
+
+// Children always come after their parent, so a reverse pass sees every child before its parent
+void Octree::computeMoments() {
+  const std::vector<glm::vec3>& positions = *m_positions;
+  const std::vector<float>& masses = *m_masses;
+  for (int i = (int)m_nodes.size() - 1; i >= 0; i--) {
+    Node& node = m_nodes[i];
+    glm::dvec3 weighted = glm::dvec3(0.0);
+    double mass = 0.0;
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        weighted += glm::dvec3(positions[body]) * (double)masses[body];
+        mass += masses[body];
+      }
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        const Node& child = m_nodes[node.firstChild + c];
+        weighted += child.centerOfMass * child.mass;
+        mass += child.mass;
+      }
+    }
+    node.mass = mass;
+    node.centerOfMass = mass > 0.0 ? weighted / mass : node.center;
+
+    // Bounding sphere of the bodies, or of the children's spheres
+    double radius = 0.0;
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        radius = std::max(radius, glm::length(glm::dvec3(positions[body]) - node.centerOfMass));
+      }
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        const Node& child = m_nodes[node.firstChild + c];
+        if (child.mass > 0.0) {
+          radius = std::max(radius, glm::length(child.centerOfMass - node.centerOfMass) + child.radius);
+        }
+      }
+    }
+    node.radius = radius;
+  }
+}
+
+double Octree::getRadiusSum() {
+  double sum = 0.0;
+  for (const Node& node : m_nodes) {
+    sum += node.radius;
+  }
+  return sum;
+}
+
+void Octree::refit() {
+  if (m_nodes.empty()) {
+    return;
+  }
+  computeMoments();
+}
+
+bool Octree::needsRebuild() {
+  return getRadiusSum() > 2.0 * m_builtRadius;
+}
+
+double Octree::potential(glm::vec3 position, int excludeBody, float theta, float closeApproach2) {
+  if (m_nodes.empty()) {
+    return 0.0;
+  }
+  const glm::dvec3 p = glm::dvec3(position);
+  double sum = 0.0;
+
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (node.mass == 0.0) {
+      continue;
+    }
+
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        if (body == excludeBody) {
+          continue;
+        }
+        glm::dvec3 r = glm::dvec3((*m_positions)[body]) - p;
+        double r2 = glm::dot(r, r);
+        if (r2 >= closeApproach2) {
+          sum += (*m_masses)[body] / std::sqrt(r2);
+        }
+      }
+      continue;
+    }
+
+    // With theta <= 0.5 a cell holding the query point never passes, so excludeBody is never lumped in
+    glm::dvec3 r = node.centerOfMass - p;
+    double distance = std::sqrt(glm::dot(r, r));
+    if (distance > 0.0 && 2.0 * node.halfSize < theta * distance) {
+      sum += node.mass / distance;
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        stack.push_back(node.firstChild + c);
+      }
+    }
+  }
+  return sum;
+}
+
+glm::dvec3 Octree::acceleration(glm::vec3 position, int excludeBody, float theta, float closeApproach2, unsigned long long& interactions) {
+  glm::dvec3 sum = glm::dvec3(0.0);
+  if (m_nodes.empty()) {
+    return sum;
+  }
+  const glm::dvec3 p = glm::dvec3(position);
+
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (node.mass == 0.0) {
+      continue;
+    }
+
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        if (body == excludeBody) {
+          continue;
+        }
+        glm::dvec3 r = glm::dvec3((*m_positions)[body]) - p;
+        double r2 = glm::dot(r, r);
+        interactions++;
+        if (r2 >= closeApproach2) {
+          sum += r * ((*m_masses)[body] / (r2 * std::sqrt(r2)));
+        }
+      }
+      continue;
+    }
+
+    glm::dvec3 offset = glm::abs(p - node.center);
+    bool contains = offset.x <= node.halfSize && offset.y <= node.halfSize && offset.z <= node.halfSize;
+    glm::dvec3 r = node.centerOfMass - p;
+    double r2 = glm::dot(r, r);
+    if (!contains && 4.0 * node.halfSize * node.halfSize < theta * theta * r2) {
+      interactions++;
+      sum += r * (node.mass / (r2 * std::sqrt(r2)));
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        stack.push_back(node.firstChild + c);
+      }
+    }
+  }
+  return sum;
+}
+
+void Octree::collectEssential(glm::vec3 low, glm::vec3 high, float theta, std::vector<glm::vec4>& essential) {
+  if (m_nodes.empty()) {
+    return;
+  }
+  const glm::dvec3 boxLow = glm::dvec3(low);
+  const glm::dvec3 boxHigh = glm::dvec3(high);
+
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (node.mass == 0.0) {
+      continue;
+    }
+
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        essential.push_back(glm::vec4((*m_positions)[body], (*m_masses)[body]));
+      }
+      continue;
+    }
+
+    // Every point of the box is at least this far from the centre of mass
+    glm::dvec3 nearest = glm::clamp(node.centerOfMass, boxLow, boxHigh);
+    glm::dvec3 r = node.centerOfMass - nearest;
+    double r2 = glm::dot(r, r);
+    if (4.0 * node.halfSize * node.halfSize < theta * theta * r2) {
+      essential.push_back(glm::vec4(glm::vec3(node.centerOfMass), (float)node.mass));
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        stack.push_back(node.firstChild + c);
+      }
+    }
+  }
+}
+
+void Octree::collectRenderCut(glm::vec3 eye, float maxAngularSize, std::vector<OctreeCell>& cells, std::vector<int>& bodies) {
+  if (m_nodes.empty()) {
+    return;
+  }
+  const glm::dvec3 p = glm::dvec3(eye);
+
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (node.mass == 0.0) {
+      continue;
+    }
+
+    if (node.firstChild == -1) {
+      for (int body = node.firstBody; body != -1; body = m_nextBody[body]) {
+        bodies.push_back(body);
+      }
+      continue;
+    }
+
+    // The radius bounds the bodies even after refitting, unlike the cell's size
+    double distance = glm::length(node.centerOfMass - p);
+    if (distance > node.radius && 2.0 * node.radius < maxAngularSize * distance) {
+      cells.push_back({ glm::vec3(node.centerOfMass), (float)node.mass, (float)node.radius });
+    }
+    else {
+      for (int c = 0; c < 8; c++) {
+        stack.push_back(node.firstChild + c);
+      }
+    }
+  }
+}
+
+size_t Octree::getNodeCount() {
+  return m_nodes.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// A cell of the tree seen as one body, for drawing far away clusters as a single splat
+struct OctreeCell {
+  glm::vec3 centerOfMass;
+  float mass;
+  float radius; // Of a sphere around the centre of mass holding every body in the cell
+};
+
+// Flat array octree over a set of point masses, for queries that need full 3D accuracy off the simulation thread.
+// Nodes live in one vector with the 8 children of a node stored consecutively, so building allocates nothing per
+// node and walking is a loop over indices. Bodies are referred to by index into the arrays given to build.
+class Octree {
+private:
+  static const int MAX_DEPTH = 48; // Bodies closer than the cell size at this depth share a leaf
+
+  struct Node {
+    glm::dvec3 center; // Geometric centre of the cell
+    double halfSize;
+    glm::dvec3 centerOfMass;
+    double mass;
+    double radius; // Bounding sphere of the cell's bodies around the centre of mass
+    int firstChild; // Index of the first of 8 children, -1 for a leaf
+    int firstBody; // Leaf bodies, chained through m_nextBody, -1 if empty
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<int> m_nextBody;
+  const std::vector<glm::vec3>* m_positions;
+  const std::vector<float>* m_masses;
+  double m_builtRadius; // Sum of the node radii right after building
+
+  int childFor(const Node& node, glm::vec3 position);
+  void subdivide(int nodeIndex);
+  void computeMoments();
+  double getRadiusSum();
+
+public:
+  Octree();
+  // The arrays must outlive any query
+  void build(const std::vector<glm::vec3>& positions, const std::vector<float>& masses);
+  // Sum of m/r over every body except excludeBody, opening cells whose size/distance is at least theta (at most 0.5).
+  // Pairs closer than sqrt(closeApproach2) are skipped, matching the force clamp.
+  double potential(glm::vec3 position, int excludeBody, float theta, float closeApproach2);
+  // Sum of m r / |r|^3 over every body except excludeBody, multiply by G for the acceleration. Cells containing the
+  // position are always opened, so any theta works. Adds the number of body and cell terms to interactions.
+  glm::dvec3 acceleration(glm::vec3 position, int excludeBody, float theta, float closeApproach2, unsigned long long& interactions);
+  // Smallest set of cells and bodies that reproduces the tree's forces anywhere inside the box [low, high] for the
+  // given theta: cells passing the opening criterion from the nearest point of the box are exported as one mass.
+  // Appends (position, mass) to essential.
+  void collectEssential(glm::vec3 low, glm::vec3 high, float theta, std::vector<glm::vec4>& essential);
+  // Recomputes the masses, centres of mass and radii after the bodies moved, keeping every body in its cell. Forces stay
+  // exact to the opening criterion only while bodies are near their cells, so refit trees are for drawing.
+  // needsRebuild() reports when the cells' radii have grown to twice their built size.
+  void refit();
+  bool needsRebuild();
+  // Screen space cut through the tree seen from eye: cells that don't hold the eye and whose diameter over distance is
+  // under maxAngularSize are appended to cells, the bodies of the leaves reached are appended to bodies. Their number
+  // depends on the angular size, not on how many bodies the cells hold.
+  void collectRenderCut(glm::vec3 eye, float maxAngularSize, std::vector<OctreeCell>& cells, std::vector<int>& bodies);
+  size_t getNodeCount();
+};
@@ -0,0 +1,19 @@
+#include "snapshot.h"
+
+void Snapshot::resize(size_t bodyCount) {
+  masses.resize(bodyCount);
+  positions.resize(bodyCount);
+  velocities.resize(bodyCount);
+  rotations.resize(bodyCount);
+}
+
+size_t Snapshot::getBodyCount() const {
+  return positions.size();
+}
+
+size_t Snapshot::getSizeBytes() const {
+  return masses.size() * sizeof(float) +
+    positions.size() * sizeof(glm::vec3) +
+    velocities.size() * sizeof(glm::vec3) +
+    rotations.size() * sizeof(glm::quat);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Plain copy of the dynamic state of every body in a System at a step boundary.
+// Bodies are stored in the same order as System::getBodies().
+struct Snapshot {
+  double time = 0.0; // Simulated seconds since the scene was loaded
+  unsigned long long step = 0;
+  std::vector<float> masses;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> velocities;
+  std::vector<glm::quat> rotations;
+
+  void resize(size_t bodyCount);
+  size_t getBodyCount() const;
+  size_t getSizeBytes() const;
+};
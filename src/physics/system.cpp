@@ -1,13 +1,67 @@
 #include "system.h"
-#include <unordered_map>
 #include <iostream>
-#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <random>
 #include "../config.h"
+#include "../profiling/tracer.h"
 #include "QuadTree/QuadTree.h"
+#include "../io/snapshotFile.h"
+#include "../io/ephemerisFile.h"
+#include "../threading/threadPool.h"
 
 System::System() {
   m_timeFactor = 60 * 60 * 23.9345; // Default Once earth day per second;
   m_SIUnitScaleFactor = 1e6f;
+  m_simulationTime = 0.0;
+  m_stepCount = 0;
+  m_forceMethod = FORCE_BARNES_HUT;
+  m_integrator = INTEGRATOR_SEMI_IMPLICIT_EULER;
+  m_theta = 1.5f;
+  m_threadCount = 0;
+  m_accelerationsValid = false;
+  m_phaseListener = nullptr;
+
+  Config* config = Config::getInstance();
+  m_thetaTuner.configure(
+    config->getThetaTunerEnabled(),
+    config->getThetaTunerTargetError(),
+    config->getThetaTunerInterval(),
+    config->getThetaTunerSampleSize(),
+    0.1f,
+    m_theta
+  );
+  m_timeline.configure(
+    config->getTimelineMemoryBudgetMB() * 1024 * 1024,
+    config->getTimelineKeyframeInterval()
+  );
+}
+
+// The writers' files and the diagnostics log are the app's, so only its System configures them. Ensemble members,
+// tests and tools construct Systems of their own and leave them off.
+void System::applyConfig() {
+  Config* config = Config::getInstance();
+  m_diagnostics.configure(
+    config->getDiagnosticsEnabled(),
+    config->getDiagnosticsInterval(),
+    config->getDiagnosticsDirectLimit(),
+    config->getDiagnosticsLogPath()
+  );
+  m_checkpointWriter.configure(
+    config->getCheckpointsEnabled(),
+    config->getCheckpointFilePrefix(),
+    config->getCheckpointIntervalSeconds(),
+    config->getCheckpointRetention()
+  );
+  m_trajectoryWriter.configure(
+    config->getTrajectoryEnabled(),
+    config->getTrajectoryFilePath(),
+    config->getTrajectoryStride(),
+    config->getTrajectoryFramesPerChunk(),
+    config->getTrajectoryBodiesPerBlock(),
+    config->getTrajectoryPositionQuantum(),
+    config->getTrajectoryVelocityQuantum()
+  );
 }
 
 float System::getSIUnitScaleFactor() {
@@ -17,60 +71,103 @@ float System::getSIUnitScaleFactor() {
 void System::setSIUnitScaleFactor(float SIUnitScaleFactor) {
   m_SIUnitScaleFactor = SIUnitScaleFactor;
   G = 6.67430e-11 / SIUnitScaleFactor / SIUnitScaleFactor; // Since newton is kg*m
+  m_accelerationsValid = false;
 }
 
 void System::addBody(GravBody* body) {
   m_bodies.push_back(body);
+  m_accelerationsValid = false;
 }
 
-std::vector<GravBody*> System::getBodies() {
-  return m_bodies;
+void System::loadBodies(nlohmann::json& jScene) {
+  float SIUnitScaleFactor = jScene["SIUnitScaleFactor"].get<float>();
+  setSIUnitScaleFactor(SIUnitScaleFactor);
+  for (auto gravBodyJSON : jScene["GravBodies"]) {
+    addBody(new GravBody(SIUnitScaleFactor, gravBodyJSON));
+  }
 }
 
-void System::updateUsingNaive(float adjustedTimeFactor, std::unordered_map<int, std::pair<glm::vec3, glm::vec3>>& map) {
-
-  for (int i = 0; i < m_bodies.size(); i++) {
-    glm::vec3 force = glm::vec3(0.0);
-    const float M1 = m_bodies[i]->getMass();
-
-    for (int j = 0; j < m_bodies.size(); j++) {
-      if (m_bodies[j] != m_bodies[i]) { // Don't do gravity with itself
-
-        // (G*M1*M2)/R^2
-        float M2 = m_bodies[j]->getMass();
-
-        // Below avoids sqrt (otherwise one can use distance)
-        glm::vec3 r = m_bodies[j]->getPosition() - m_bodies[i]->getPosition();
-        float r2 = glm::dot(r, r);
-        if (r2 < (1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor))) {
-          // Clamp force if two bodies pass close (1e7m) to each other.
-          // Effect is that they will continue current velocity.
-          continue;
-        }
-        float magnitude = (G * M1 * M2) / r2;
-
-
-        glm::vec3 direction = glm::normalize(r);
+void System::loadBodies(const SceneFile& sceneFile) {
+  setSIUnitScaleFactor(sceneFile.getSIUnitScaleFactor());
 
-        force = force + (magnitude * direction); // Sum up all forces on object
-
-      }
+  // Each distinct path becomes a std::string once, instead of once per body
+  std::vector<std::string> strings(sceneFile.getStringCount());
+  for (size_t i = 0; i < strings.size(); i++) {
+    strings[i] = sceneFile.getString((uint32_t)i);
+  }
+  // Constructing the bodies is all string copies and allocations, so it is spread over the pool
+  size_t first = m_bodies.size();
+  m_bodies.resize(first + sceneFile.getBodyCount());
+  ThreadPool::getInstance()->parallelFor(sceneFile.getBodyCount(), 4096, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      m_bodies[first + i] = new GravBody(sceneFile, i, strings);
     }
+  }, m_threadCount);
+  m_accelerationsValid = false;
+}
 
-    // Determine new velocity 
-    // vf=vi+a*t where a=F/bodies
+std::vector<GravBody*> System::getBodies() {
+  return m_bodies;
+}
 
-    glm::vec3 acceleration = force / M1;
-    glm::vec3 velocity = m_bodies[i]->getVelocity() + (adjustedTimeFactor * acceleration);
-    glm::vec3 position = m_bodies[i]->getPosition() + (adjustedTimeFactor * velocity);
-    map[i] = std::make_pair(velocity, position);
+// Acceleration on a body at position from another body, zero when they pass too close
+static inline glm::vec3 gravitationalAcceleration(float G, float closeApproach2, glm::vec3 position, GravBody* other) {
+  // Below avoids sqrt until the direction is needed (otherwise one can use distance)
+  glm::vec3 r = other->getPosition() - position;
+  float r2 = glm::dot(r, r);
+  if (r2 < closeApproach2) {
+    // Clamp force if two bodies pass close (1e7m) to each other.
+    // Effect is that they will continue current velocity.
+    return glm::vec3(0.0);
+  }
+  // a = F/M1 = (G*M2)/R^2
+  float magnitude = (G * other->getMass()) / r2;
+  return magnitude * glm::normalize(r);
+}
 
+void System::beginPhase(PhysicsPhase phase) {
+  if (m_phaseListener != nullptr) {
+    m_phaseListener->beginPhase(phase);
   }
+  m_phaseStart = std::chrono::steady_clock::now();
+}
 
+void System::endPhase(PhysicsPhase phase) {
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_phaseStart;
+  switch (phase) {
+    case PHYSICS_PHASE_BUILD: m_stats.buildMilliseconds += elapsed.count(); break;
+    case PHYSICS_PHASE_AGGREGATE: m_stats.aggregateMilliseconds += elapsed.count(); break;
+    case PHYSICS_PHASE_WALK: m_stats.walkMilliseconds += elapsed.count(); break;
+    default: break;
+  }
+  if (m_phaseListener != nullptr) {
+    m_phaseListener->endPhase(phase);
+  }
 }
 
+void System::computeAccelerationsUsingNaive(std::vector<glm::vec3>& accelerations) {
+  TRACE_SCOPE("Calculate forces");
+  beginPhase(PHYSICS_PHASE_WALK);
+  const float closeApproach2 = 1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor);
+
+  ThreadPool::getInstance()->parallelFor(m_bodies.size(), 64, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      glm::vec3 acceleration = glm::vec3(0.0);
+      const glm::vec3 position = m_bodies[i]->getPosition();
+      for (size_t j = 0; j < m_bodies.size(); j++) {
+        if (j != i) { // Don't do gravity with itself
+          acceleration += gravitationalAcceleration(G, closeApproach2, position, m_bodies[j]);
+        }
+      }
+      accelerations[i] = acceleration;
+    }
+  }, m_threadCount);
+
+  m_stats.interactions += (unsigned long long)m_bodies.size() * (m_bodies.size() - 1);
+  endPhase(PHYSICS_PHASE_WALK);
+}
 
-void System::updateUsingBarnesHut(float adjustedTimeFactor, std::unordered_map<int, std::pair<glm::vec3, glm::vec3>>& map) {
+void System::computeAccelerationsUsingBarnesHut(std::vector<glm::vec3>& accelerations) {
 
   // First build the quad tree
   glm::vec2 boundStart = glm::vec2(-1e10, -1e10);
@@ -78,108 +175,439 @@ void System::updateUsingBarnesHut(float adjustedTimeFactor, std::unordered_map<i
   Boundary bounds(boundStart, boundRange);
   QuadTree qTree(bounds);
 
-  double startTime = glfwGetTime();
-
   // Insert all bodies into quad tree
-  for (auto body : m_bodies) {
-    qTree.insert(body);
+  beginPhase(PHYSICS_PHASE_BUILD);
+  {
+    TRACE_SCOPE("Build tree");
+    for (auto body : m_bodies) {
+      qTree.insert(body);
+    }
   }
+  endPhase(PHYSICS_PHASE_BUILD);
 
-  std::cout << "\nTime to build tree: " << (glfwGetTime() - startTime) * 1000 << " ms" << std::endl;
-  double startAgg = glfwGetTime();
+  // Caclulate center of mass and total mass of quad trees
+  beginPhase(PHYSICS_PHASE_AGGREGATE);
+  {
+    TRACE_SCOPE("Aggregate tree");
+    qTree.aggregateCenterAndTotalMass();
+  }
+  endPhase(PHYSICS_PHASE_AGGREGATE);
+
+  TRACE_SCOPE("Calculate forces");
+  beginPhase(PHYSICS_PHASE_WALK);
+  const float closeApproach2 = 1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor);
+  std::atomic<unsigned long long> interactions(0);
+
+  // The tree is only read from here on, so bodies can walk it in parallel
+  ThreadPool::getInstance()->parallelFor(m_bodies.size(), 16, [&](size_t begin, size_t end) {
+    std::vector<GravBody*> relevantBodies;
+    unsigned long long chunkInteractions = 0;
+    for (size_t i = begin; i < end; i++) {
+      relevantBodies.clear();
+      qTree.barnesHutQuery(m_bodies[i], m_theta, relevantBodies);
+
+      glm::vec3 acceleration = glm::vec3(0.0);
+      const glm::vec3 position = m_bodies[i]->getPosition();
+      for (auto other : relevantBodies) {
+        if (other != m_bodies[i]) { // Don't do gravity with itself
+          acceleration += gravitationalAcceleration(G, closeApproach2, position, other);
+          chunkInteractions++;
+        }
+      }
+      accelerations[i] = acceleration;
+    }
+    interactions += chunkInteractions;
+  }, m_threadCount);
 
+  m_stats.interactions += interactions;
+  endPhase(PHYSICS_PHASE_WALK);
+}
 
-  // Caclulate center of mass and total mass of quad trees
-  qTree.aggregateCenterAndTotalMass();
-  std::cout << "Time to aggregate tree: " << (glfwGetTime() - startAgg) * 1000 << " ms" << std::endl;
+void System::computeAccelerations(std::vector<glm::vec3>& accelerations) {
+  accelerations.resize(m_bodies.size());
+  if (m_forceMethod == FORCE_NAIVE) {
+    computeAccelerationsUsingNaive(accelerations);
+  }
+  else {
+    computeAccelerationsUsingBarnesHut(accelerations);
+  }
+  m_stats.forceEvaluations++;
+}
 
-  double calculateForceStart = glfwGetTime();
+glm::vec3 System::computeDirectAcceleration(size_t bodyIndex) {
+  const float closeApproach2 = 1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor);
+  const glm::vec3 position = m_bodies[bodyIndex]->getPosition();
 
-  const float theta = 1.5;
-  for (int i = 0; i < m_bodies.size(); i++) {
-    glm::vec3 force = glm::vec3(0.0);
-    const float M1 = m_bodies[i]->getMass();
+  // Summed in double so the reference is well below the error being measured
+  glm::dvec3 acceleration = glm::dvec3(0.0);
+  for (size_t j = 0; j < m_bodies.size(); j++) {
+    if (j != bodyIndex) {
+      acceleration += glm::dvec3(gravitationalAcceleration(G, closeApproach2, position, m_bodies[j]));
+    }
+  }
+  return glm::vec3(acceleration);
+}
 
-    const std::vector<GravBody*> relevantBodies = qTree.barnesHutQuery(m_bodies[i], theta);
+void System::update(float deltaT) {
+  if (deltaT > 0.1f) {
+    // Don't calculate physics when deltaT is large, introduces error into calculation
+    return;
+  }
 
-    for (int j = 0; j < relevantBodies.size(); j++) {
-      if (relevantBodies[j] != m_bodies[i]) { // Don't do gravity with itself
+  // Let compute shader calculate large simulations
+  if (m_bodies.size() > 1000) {
+    return;
+  }
 
-        // (G*M1*M2)/R^2
-        float M2 = relevantBodies[j]->getMass();
+  TRACE_SCOPE("System::update");
 
-        // Below avoids sqrt (otherwise one can use distance)
-        glm::vec3 r = relevantBodies[j]->getPosition() - m_bodies[i]->getPosition();
-        float r2 = glm::dot(r, r);
-        if (r2 < (1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor))) {
-          // Clamp force if two bodies pass close (1e7m) to each other.
-          // Effect is that they will continue current velocity.
-          continue;
-        }
-        float magnitude = (G * M1 * M2) / r2;
+  // The physics is made framerate independent by dividing by framerate for deltaT
+  float adjustedTimeFactor = m_timeFactor * deltaT;
 
+  // After seeking back, play the recorded steps again so the run stays identical to the first pass
+  const bool replaying = m_timeline.getRecordedStepSize(m_stepCount, adjustedTimeFactor);
 
-        glm::vec3 direction = glm::normalize(r);
+  // The state before the first step is recorded too, so the trajectory replays from where recording started
+  if (!replaying && m_trajectoryWriter.isEnabled() && !m_trajectoryWriter.isStarted()) {
+    captureSnapshot(m_trajectoryFrame);
+    m_trajectoryWriter.appendFrame(m_trajectoryFrame);
+  }
+  advance(adjustedTimeFactor);
+
+  // Checkpoints are captured between steps so the copy is consistent; writing happens off this thread
+  if (!replaying && m_checkpointWriter.isCheckpointDue()) {
+    Snapshot* checkpoint = m_checkpointWriter.acquireBuffer();
+    if (checkpoint != nullptr) {
+      TRACE_SCOPE("Capture checkpoint");
+      captureSnapshot(*checkpoint);
+      m_checkpointWriter.submit();
+    }
+  }
 
-        force = force + (magnitude * direction); // Sum up all forces on object
+  if (!replaying && m_trajectoryWriter.isFrameDue(m_stepCount)) {
+    captureSnapshot(m_trajectoryFrame);
+    m_trajectoryWriter.appendFrame(m_trajectoryFrame);
+  }
 
-      }
+  // Energy and momentum are summed on the diagnostics thread, this only copies the bodies
+  if (!replaying && m_diagnostics.isDue(m_stepCount)) {
+    Snapshot* sample = m_diagnostics.acquireBuffer();
+    if (sample != nullptr) {
+      captureSnapshot(*sample);
+      m_diagnostics.submit(G, 1e14 / (m_SIUnitScaleFactor * m_SIUnitScaleFactor));
     }
+  }
+
+}
+
+// Takes one step, keeping the timeline up to date so it can be replayed later
+void System::advance(float adjustedTimeFactor) {
+  if (m_timeline.isKeyframeDue(m_stepCount)) {
+    Snapshot keyframe;
+    captureSnapshot(keyframe);
+    m_timeline.addKeyframe(std::move(keyframe));
+  }
+  m_timeline.recordStep(m_stepCount, adjustedTimeFactor);
+
+  if (m_ephemeris != nullptr && m_ephemeris->contains(m_simulationTime + adjustedTimeFactor)) {
+    stepUsingEphemeris(adjustedTimeFactor);
+  }
+  else {
+    step(adjustedTimeFactor);
+  }
+}
 
-    // Determine new velocity 
-    // vf=vi+a*t where a=F/bodies
+// Moves the simulation to the last step at or before targetTime.
+// Restores the closest keyframe and replays the recorded steps from there; past the recorded history new steps are
+// integrated at the most recent step size.
+bool System::seek(double targetTime) {
+  TRACE_SCOPE("System::seek");
+  const Snapshot* keyframe = m_timeline.findKeyframe(targetTime);
 
-    glm::vec3 acceleration = force / M1;
-    glm::vec3 velocity = m_bodies[i]->getVelocity() + (adjustedTimeFactor * acceleration);
-    glm::vec3 position = m_bodies[i]->getPosition() + (adjustedTimeFactor * velocity);
-    map[i] = std::make_pair(velocity, position);
+  // Going forward within what is already loaded needs no restore unless a later keyframe is closer
+  if (keyframe != nullptr && (targetTime < m_simulationTime || keyframe->time > m_simulationTime)) {
+    restoreSnapshot(*keyframe);
+  }
+  if (targetTime < m_simulationTime) {
+    std::cout << "Cannot seek to " << targetTime << ", history starts at " << m_simulationTime << std::endl;
+    return false;
+  }
 
+  float stepSize = m_timeFactor / Config::getInstance()->getTargetFramerate();
+  if (m_stepCount > 0) {
+    m_timeline.getRecordedStepSize(m_stepCount - 1, stepSize);
   }
 
-  std::cout << "Time to calculate forces: " << (glfwGetTime() - calculateForceStart) * 1000 << " ms" << std::endl;
+  while (true) {
+    m_timeline.getRecordedStepSize(m_stepCount, stepSize);
+    if (m_simulationTime + stepSize > targetTime) {
+      break;
+    }
+    advance(stepSize);
+  }
+  return true;
 }
 
-void System::update(float deltaT) {
-  if (deltaT > 0.1f) {
-    // Don't calculate physics when deltaT is large, introduces error into calculation
+Timeline* System::getTimeline() {
+  return &m_timeline;
+}
+
+// Compares the tree accelerations just computed for a few random bodies with direct summation and lets the tuner
+// pick the theta for the following steps. Costs sampleSize * N interactions, so it runs every few steps only.
+void System::tuneTheta() {
+  if (m_forceMethod != FORCE_BARNES_HUT || m_bodies.size() < 2 || !m_thetaTuner.isDue(m_stepCount)) {
     return;
   }
+  TRACE_SCOPE("Tune theta");
+
+  // Seeded by step so runs from the same state are reproducible
+  std::mt19937 rng((unsigned int)m_stepCount);
+  std::uniform_int_distribution<size_t> pick(0, m_bodies.size() - 1);
+  const size_t samples = std::min<size_t>(m_thetaTuner.getSampleSize(), m_bodies.size());
+
+  double errorSum = 0.0;
+  size_t measured = 0;
+  for (size_t s = 0; s < samples; s++) {
+    size_t i = samples == m_bodies.size() ? s : pick(rng);
+    glm::vec3 reference = computeDirectAcceleration(i);
+    float referenceLength = glm::length(reference);
+    if (referenceLength > 0.0f) {
+      errorSum += glm::length(m_accelerations[i] - reference) / referenceLength;
+      measured++;
+    }
+  }
+  if (measured > 0) {
+    m_theta = m_thetaTuner.adjust(m_stepCount, m_theta, errorSum / measured);
+  }
+}
 
-  // Let compute shader calculate large simulations
-  if (m_bodies.size() > 1000) {
-    return;
+// Advances the simulation by adjustedTimeFactor simulated seconds
+void System::step(float adjustedTimeFactor) {
+
+  // Replayed steps use the theta they were first taken with
+  if (m_thetaTuner.isEnabled()) {
+    float previousTheta = m_theta;
+    m_thetaTuner.getRecordedTheta(m_stepCount, m_theta);
+    if (m_theta != previousTheta) {
+      m_accelerationsValid = false;
+    }
   }
 
-  // The physics is made framerate independent by dividing by framerate for deltaT
-  float adjustedTimeFactor = m_timeFactor * deltaT;
+  if (m_integrator == INTEGRATOR_LEAPFROG) {
+    // Kick-drift-kick. The closing kick's accelerations open the next step.
+    if (!m_accelerationsValid) {
+      computeAccelerations(m_accelerations);
+    }
+    const float halfStep = 0.5f * adjustedTimeFactor;
+    for (int i = 0; i < m_bodies.size(); i++) {
+      GravBody* body = m_bodies[i];
+      glm::vec3 velocity = body->getVelocity() + (halfStep * m_accelerations[i]);
+      body->setVelocity(velocity);
+      body->setPosition(body->getPosition() + (adjustedTimeFactor * velocity));
+    }
+    computeAccelerations(m_accelerations);
+    const float closingTheta = m_theta;
+    tuneTheta();
+    for (int i = 0; i < m_bodies.size(); i++) {
+      GravBody* body = m_bodies[i];
+      body->setVelocity(body->getVelocity() + (halfStep * m_accelerations[i]));
+    }
+    // A new theta opens the next step with accelerations of its own, as a replay after a seek would
+    m_accelerationsValid = m_theta == closingTheta;
+  }
+  else {
+    // Calculate physics
+    computeAccelerations(m_accelerations);
+    tuneTheta();
+
+    // Determine new velocity then position from it
+    // vf=vi+a*t
+    for (int i = 0; i < m_bodies.size(); i++) {
+      GravBody* body = m_bodies[i];
+      glm::vec3 velocity = body->getVelocity() + (adjustedTimeFactor * m_accelerations[i]);
+      body->setVelocity(velocity);
+      body->setPosition(body->getPosition() + (adjustedTimeFactor * velocity));
+    }
+    m_accelerationsValid = false;
+  }
+
+  for (auto body : m_bodies) {
+    body->rotate(glm::angleAxis(
+      body->getRotationSpeed() * adjustedTimeFactor,
+      body->getAxis()
+    ));
+  }
 
-  // Holds the velocity and position as calculated for each object
-  std::unordered_map<int, std::pair<glm::vec3, glm::vec3>> map;
+  m_simulationTime += adjustedTimeFactor;
+  m_stepCount++;
+
+}
 
-  double startTime = glfwGetTime();
+double System::getSimulationTime() {
+  return m_simulationTime;
+}
 
-  // Calculate physics
-  updateUsingBarnesHut(adjustedTimeFactor, map);
+unsigned long long System::getStepCount() {
+  return m_stepCount;
+}
 
-  // Update position and velocity
+void System::captureSnapshot(Snapshot& snapshot) {
+  snapshot.resize(m_bodies.size());
+  snapshot.time = m_simulationTime;
+  snapshot.step = m_stepCount;
   for (int i = 0; i < m_bodies.size(); i++) {
+    GravBody* body = m_bodies[i];
+    snapshot.masses[i] = body->getMass();
+    snapshot.positions[i] = body->getPosition();
+    snapshot.velocities[i] = body->getVelocity();
+    snapshot.rotations[i] = body->getRotation();
+  }
+}
 
+bool System::restoreSnapshot(const Snapshot& snapshot) {
+  if (snapshot.getBodyCount() != m_bodies.size()) {
+    std::cout << "Snapshot has " << snapshot.getBodyCount() << " bodies but the system has " << m_bodies.size() << std::endl;
+    return false;
+  }
+  for (int i = 0; i < m_bodies.size(); i++) {
     GravBody* body = m_bodies[i];
+    body->setMass(snapshot.masses[i]);
+    body->setPosition(snapshot.positions[i]);
+    body->setVelocity(snapshot.velocities[i]);
+    body->setRotation(snapshot.rotations[i]);
+  }
+  m_simulationTime = snapshot.time;
+  m_stepCount = snapshot.step;
+  m_accelerationsValid = false;
+  if (m_thetaTuner.isEnabled()) {
+    m_thetaTuner.getRecordedTheta(m_stepCount, m_theta);
+  }
+  return true;
+}
 
-    float period = (2 * 3.14159265f) / body->getRotationSpeed();
-    float rotSpeed = body->getRotationSpeed() * period;
+bool System::loadCheckpoint(std::string filePath) {
+  Snapshot snapshot;
+  if (!SnapshotFile::read(filePath, snapshot) || !restoreSnapshot(snapshot)) {
+    return false;
+  }
+  // The recorded history belongs to a different run
+  m_timeline.clear();
+  m_thetaTuner.clear();
+  m_diagnostics.resetBaseline();
+  return true;
+}
 
-    body->setVelocity(map[i].first);
-    body->setPosition(map[i].second);
+CheckpointWriter* System::getCheckpointWriter() {
+  return &m_checkpointWriter;
+}
+
+TrajectoryWriter* System::getTrajectoryWriter() {
+  return &m_trajectoryWriter;
+}
+
+void System::stepUsingEphemeris(float adjustedTimeFactor) {
+  applyEphemeris(m_simulationTime + adjustedTimeFactor);
+  for (auto body : m_bodies) {
     body->rotate(glm::angleAxis(
       body->getRotationSpeed() * adjustedTimeFactor,
       body->getAxis()
     ));
+  }
+  m_stepCount++;
+}
+
+void System::setEphemeris(Ephemeris* ephemeris) {
+  if (m_ephemeris.get() != ephemeris) {
+    m_ephemeris.reset(ephemeris);
+  }
+}
+
+Ephemeris* System::getEphemeris() {
+  return m_ephemeris.get();
+}
+
+bool System::loadEphemeris(std::string filePath) {
+  Ephemeris* ephemeris = new Ephemeris();
+  if (!EphemerisFile::read(filePath, *ephemeris) || ephemeris->getBodyCount() != m_bodies.size()) {
+    std::cout << "Ephemeris " << filePath << " does not match the loaded scene" << std::endl;
+    delete ephemeris;
+    return false;
+  }
+  setEphemeris(ephemeris);
+  return true;
+}
 
+// Jumps every body to its fitted state at time without integrating
+bool System::applyEphemeris(double time) {
+  if (m_ephemeris == nullptr || m_ephemeris->getBodyCount() != m_bodies.size()) {
+    return false;
   }
+  for (int i = 0; i < m_bodies.size(); i++) {
+    glm::vec3 position, velocity;
+    m_ephemeris->evaluate(i, time, position, velocity);
+    m_bodies[i]->setPosition(position);
+    m_bodies[i]->setVelocity(velocity);
+  }
+  m_simulationTime = time;
+  m_accelerationsValid = false;
+  return true;
+}
 
-  double endTime = glfwGetTime();
-  std::cout << "\nTime to process physics: " << (endTime - startTime) * 1000 << " ms" << std::endl;
+float System::getGravitationalConstant() {
+  return G;
+}
+
+void System::setForceMethod(ForceMethod forceMethod) {
+  m_forceMethod = forceMethod;
+  m_accelerationsValid = false;
+}
+
+ForceMethod System::getForceMethod() {
+  return m_forceMethod;
+}
 
+void System::setIntegrator(Integrator integrator) {
+  m_integrator = integrator;
+  m_accelerationsValid = false;
 }
 
+Integrator System::getIntegrator() {
+  return m_integrator;
+}
+
+void System::setTheta(float theta) {
+  m_theta = theta;
+  m_accelerationsValid = false;
+}
+
+float System::getTheta() {
+  return m_theta;
+}
+
+ThetaTuner* System::getThetaTuner() {
+  return &m_thetaTuner;
+}
+
+DiagnosticsMonitor* System::getDiagnostics() {
+  return &m_diagnostics;
+}
+
+void System::setThreadCount(unsigned int threadCount) {
+  m_threadCount = threadCount;
+}
+
+unsigned int System::getThreadCount() {
+  return m_threadCount;
+}
+
+PhysicsStats System::getStats() {
+  return m_stats;
+}
+
+void System::resetStats() {
+  m_stats = PhysicsStats();
+}
+
+void System::setPhaseListener(PhysicsPhaseListener* listener) {
+  m_phaseListener = listener;
+}
@@ -1,6 +1,51 @@
 #pragma once
 #include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
 #include "gravBody.h"
+#include "snapshot.h"
+#include "ephemeris.h"
+#include "timeline.h"
+#include "thetaTuner.h"
+#include "diagnostics.h"
+#include "../io/checkpointWriter.h"
+#include "../io/trajectoryWriter.h"
+
+enum ForceMethod {
+  FORCE_NAIVE, // Direct summation over every pair
+  FORCE_BARNES_HUT
+};
+
+enum Integrator {
+  INTEGRATOR_SEMI_IMPLICIT_EULER,
+  INTEGRATOR_LEAPFROG // Kick-drift-kick, one force evaluation per step once started
+};
+
+// Work done by the force evaluations since the last resetStats
+struct PhysicsStats {
+  unsigned long long forceEvaluations = 0;
+  unsigned long long interactions = 0; // Body-body and body-cell terms summed
+  double buildMilliseconds = 0.0; // Tree insertion
+  double aggregateMilliseconds = 0.0; // Tree centre of mass pass
+  double walkMilliseconds = 0.0; // Force summation (tree walk for Barnes-Hut)
+};
+
+// Stages of a force evaluation. Barnes-Hut goes through all three, direct summation only walks.
+enum PhysicsPhase {
+  PHYSICS_PHASE_BUILD,
+  PHYSICS_PHASE_AGGREGATE,
+  PHYSICS_PHASE_WALK,
+  PHYSICS_PHASE_COUNT
+};
+
+// Notified on the simulation thread around every phase, e.g. to sample hardware counters
+class PhysicsPhaseListener {
+public:
+  virtual ~PhysicsPhaseListener() {}
+  virtual void beginPhase(PhysicsPhase phase) = 0;
+  virtual void endPhase(PhysicsPhase phase) = 0;
+};
 
 class System {
   private:
@@ -12,14 +57,83 @@ class System {
     // The scaling factor is needed to avoid float errors with using just SI units.
     float m_SIUnitScaleFactor;
 
-    void updateUsingBarnesHut(float adjustedTimeFactor, std::unordered_map<int, std::pair<glm::vec3, glm::vec3>>& map);
-    void updateUsingNaive(float adjustedTimeFactor, std::unordered_map<int, std::pair<glm::vec3, glm::vec3>>& map);
+    double m_simulationTime; // Simulated seconds since the scene was loaded
+    unsigned long long m_stepCount;
+
+    CheckpointWriter m_checkpointWriter;
+    TrajectoryWriter m_trajectoryWriter;
+    Snapshot m_trajectoryFrame; // Reused between recorded frames to avoid reallocating
+
+    std::unique_ptr<Ephemeris> m_ephemeris; // When set, playback inside its span reads positions from it instead of integrating
+
+    Timeline m_timeline;
+
+    DiagnosticsMonitor m_diagnostics;
+
+    ForceMethod m_forceMethod;
+    Integrator m_integrator;
+    float m_theta; // Barnes-Hut opening angle, cells with width/distance below it are taken as one body
+    ThetaTuner m_thetaTuner;
+    unsigned int m_threadCount; // Threads used for the force pass, 0 for the whole pool
+    std::vector<glm::vec3> m_accelerations;
+    bool m_accelerationsValid; // Leapfrog reuses the previous step's accelerations while the state is untouched
+    PhysicsStats m_stats;
+    PhysicsPhaseListener* m_phaseListener;
+    std::chrono::steady_clock::time_point m_phaseStart;
+
+    void stepUsingEphemeris(float adjustedTimeFactor);
+    void advance(float adjustedTimeFactor);
+
+    void beginPhase(PhysicsPhase phase);
+    void endPhase(PhysicsPhase phase);
+    void tuneTheta();
+    void computeAccelerationsUsingBarnesHut(std::vector<glm::vec3>& accelerations);
+    void computeAccelerationsUsingNaive(std::vector<glm::vec3>& accelerations);
 
   public:
 	  System();
+    // Sets up diagnostics and the checkpoint and trajectory writers from Config, for the app's own System only
+    void applyConfig();
     float getSIUnitScaleFactor();
     void setSIUnitScaleFactor(float physicsDistanceFactor);
     void addBody(GravBody* body);
+    // Sets the unit scale and adds the GravBodies of a parsed scene file
+    void loadBodies(nlohmann::json& jScene);
+    // Same for a compiled scene, see src/io/sceneFile.h
+    void loadBodies(const SceneFile& sceneFile);
     std::vector<GravBody*> getBodies();
     void update(float deltaT);
+    void step(float adjustedTimeFactor);
+    double getSimulationTime();
+    unsigned long long getStepCount();
+    void captureSnapshot(Snapshot& snapshot);
+    bool restoreSnapshot(const Snapshot& snapshot);
+    bool loadCheckpoint(std::string filePath);
+    CheckpointWriter* getCheckpointWriter();
+    TrajectoryWriter* getTrajectoryWriter();
+    void setEphemeris(Ephemeris* ephemeris); // Takes ownership, nullptr goes back to integrating
+    Ephemeris* getEphemeris();
+    bool loadEphemeris(std::string filePath);
+    bool applyEphemeris(double time);
+    bool seek(double targetTime);
+    Timeline* getTimeline();
+
+    float getGravitationalConstant();
+    void setForceMethod(ForceMethod forceMethod);
+    ForceMethod getForceMethod();
+    void setIntegrator(Integrator integrator);
+    Integrator getIntegrator();
+    void setTheta(float theta);
+    float getTheta();
+    ThetaTuner* getThetaTuner();
+    DiagnosticsMonitor* getDiagnostics();
+    void setThreadCount(unsigned int threadCount);
+    unsigned int getThreadCount();
+    // Acceleration of every body from the current positions using the selected force method
+    void computeAccelerations(std::vector<glm::vec3>& accelerations);
+    // Exact acceleration of one body by direct summation, the reference for force error
+    glm::vec3 computeDirectAcceleration(size_t bodyIndex);
+    PhysicsStats getStats();
+    void resetStats();
+    void setPhaseListener(PhysicsPhaseListener* listener); // Not owned, nullptr to stop
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "thetaTuner.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  const double ERROR_EXPONENT = 2.5; // Monopole error ~ theta^2.5, measured with the benchmark
+  const double SETPOINT = 0.8; // Aim a little under the target
+  const float MAX_SHRINK = 0.5f;
+  const float MAX_GROWTH = 1.25f;
+}
+
+ThetaTuner::ThetaTuner() {
+  configure(false, 1e-3, 60, 32, 0.1f, 1.5f);
+}
+
+void ThetaTuner::configure(bool enabled, double targetError, unsigned int interval, unsigned int sampleSize, float minTheta, float maxTheta) {
+  m_enabled = enabled;
+  m_targetError = targetError;
+  m_interval = std::max(interval, 1u);
+  m_sampleSize = std::max(sampleSize, 1u);
+  m_minTheta = minTheta;
+  m_maxTheta = maxTheta;
+  clear();
+}
+
+void ThetaTuner::setEnabled(bool enabled) {
+  m_enabled = enabled;
+}
+
+bool ThetaTuner::isEnabled() {
+  return m_enabled;
+}
+
+void ThetaTuner::clear() {
+  m_history.clear();
+  m_hasEvaluated = false;
+  m_lastEvaluatedStep = 0;
+  m_lastError = 0.0;
+}
+
+bool ThetaTuner::isDue(unsigned long long step) {
+  if (!m_enabled || step % m_interval != 0) {
+    return false;
+  }
+  return !m_hasEvaluated || step > m_lastEvaluatedStep;
+}
+
+float ThetaTuner::adjust(unsigned long long step, float theta, double measuredError) {
+  if (m_history.empty()) {
+    m_history.push_back(std::make_pair(0ull, theta));
+  }
+  m_hasEvaluated = true;
+  m_lastEvaluatedStep = step;
+  m_lastError = measuredError;
+
+  float factor = 1.0f;
+  if (measuredError > m_targetError) {
+    factor = (float)std::pow(SETPOINT * m_targetError / measuredError, 1.0 / ERROR_EXPONENT);
+    factor = std::max(factor, MAX_SHRINK);
+  }
+  else if (measuredError < 0.5 * m_targetError) {
+    factor = measuredError > 0.0 ? (float)std::pow(SETPOINT * m_targetError / measuredError, 1.0 / ERROR_EXPONENT) : MAX_GROWTH;
+    factor = std::min(factor, MAX_GROWTH);
+  }
+
+  float newTheta = std::min(std::max(theta * factor, m_minTheta), m_maxTheta);
+  if (newTheta != theta) {
+    m_history.push_back(std::make_pair(step + 1, newTheta));
+  }
+  return newTheta;
+}
+
+bool ThetaTuner::getRecordedTheta(unsigned long long step, float& theta) {
+  if (!m_hasEvaluated || step > m_lastEvaluatedStep + 1 || m_history.empty()) {
+    return false;
+  }
+  // Last change at or before step
+  auto it = std::upper_bound(m_history.begin(), m_history.end(), step,
+    [](unsigned long long s, const std::pair<unsigned long long, float>& entry) { return s < entry.first; });
+  if (it == m_history.begin()) {
+    return false;
+  }
+  theta = (it - 1)->second;
+  return true;
+}
+
+double ThetaTuner::getTargetError() {
+  return m_targetError;
+}
+
+unsigned int ThetaTuner::getSampleSize() {
+  return m_sampleSize;
+}
+
+double ThetaTuner::getLastError() {
+  return m_lastError;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+// Keeps the Barnes-Hut opening angle as large (cheap) as possible while the force error stays under a target.
+// Every m_interval steps System measures the mean relative error of the tree forces of a few random bodies
+// against direct summation and passes it to adjust, which scales theta assuming error grows like theta^2.5.
+// Errors inside [target / 2, target] leave theta alone so sampling noise doesn't make it oscillate.
+// Every change is recorded by step, so replaying steps after a seek uses the same theta as the first pass.
+// Only monopole cells exist, so theta is the only knob.
+class ThetaTuner {
+private:
+  bool m_enabled;
+  double m_targetError; // Mean relative force error
+  unsigned int m_interval; // Steps between measurements
+  unsigned int m_sampleSize; // Bodies measured each time
+  float m_minTheta;
+  float m_maxTheta;
+  double m_lastError;
+
+  std::vector<std::pair<unsigned long long, float>> m_history; // (first step using theta, theta), ordered by step
+  bool m_hasEvaluated;
+  unsigned long long m_lastEvaluatedStep;
+
+public:
+  ThetaTuner();
+  void configure(bool enabled, double targetError, unsigned int interval, unsigned int sampleSize, float minTheta, float maxTheta);
+  void setEnabled(bool enabled);
+  bool isEnabled();
+  void clear();
+
+  // Measurements are only due on steps that haven't been measured before, replayed steps reuse the recorded theta
+  bool isDue(unsigned long long step);
+  // Returns the theta to use from the next step on
+  float adjust(unsigned long long step, float theta, double measuredError);
+  // True (and sets theta) if step lies within the recorded history
+  bool getRecordedTheta(unsigned long long step, float& theta);
+
+  double getTargetError();
+  unsigned int getSampleSize();
+  double getLastError();
+};
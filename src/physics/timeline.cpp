@@ -0,0 +1,128 @@
+#include "timeline.h"
+#include <algorithm>
+
+Timeline::Timeline() {
+  m_memoryBudget = 256ull * 1024 * 1024;
+  m_keyframeInterval = 100;
+  m_keyframeBytes = 0;
+  m_firstRecordedStep = 0;
+}
+
+void Timeline::configure(size_t memoryBudget, unsigned int keyframeInterval) {
+  m_memoryBudget = memoryBudget;
+  m_keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+  thinKeyframes();
+}
+
+void Timeline::clear() {
+  m_keyframes.clear();
+  m_stepSizes.clear();
+  m_firstRecordedStep = 0;
+  m_keyframeBytes = 0;
+}
+
+bool Timeline::isKeyframeDue(unsigned long long step) {
+  if (step % m_keyframeInterval != 0) {
+    return false;
+  }
+  // Replaying over old history doesn't need the keyframes again
+  return m_keyframes.empty() || step > m_keyframes.back().step;
+}
+
+void Timeline::addKeyframe(Snapshot&& keyframe) {
+  m_keyframeBytes += keyframe.getSizeBytes();
+  m_keyframes.push_back(std::move(keyframe));
+  thinKeyframes();
+}
+
+void Timeline::thinKeyframes() {
+  while (getMemoryUsage() > m_memoryBudget && m_keyframes.size() > 1) {
+    // Thinning keyframes can't shrink the step sizes, only dropping the oldest history can
+    if (getStepSizeBytes() > m_keyframeBytes) {
+      dropOldestKeyframe();
+      continue;
+    }
+    m_keyframeInterval *= 2;
+
+    // Keep keyframes on the new interval. The first one always stays so every recorded time can be reached.
+    std::deque<Snapshot> kept;
+    m_keyframeBytes = 0;
+    for (size_t i = 0; i < m_keyframes.size(); i++) {
+      if (i == 0 || m_keyframes[i].step % m_keyframeInterval == 0) {
+        m_keyframeBytes += m_keyframes[i].getSizeBytes();
+        kept.push_back(std::move(m_keyframes[i]));
+      }
+    }
+
+    if (kept.size() == m_keyframes.size()) {
+      // Nothing lined up with the interval; fall back to dropping the newest
+      m_keyframeBytes -= kept.back().getSizeBytes();
+      kept.pop_back();
+    }
+    m_keyframes.swap(kept);
+  }
+}
+
+void Timeline::dropOldestKeyframe() {
+  m_keyframeBytes -= m_keyframes.front().getSizeBytes();
+  m_keyframes.pop_front();
+
+  unsigned long long firstStep = m_keyframes.front().step;
+  size_t dropped = (size_t)std::min<unsigned long long>(firstStep - std::min(firstStep, m_firstRecordedStep), m_stepSizes.size());
+  m_stepSizes.erase(m_stepSizes.begin(), m_stepSizes.begin() + dropped);
+  m_firstRecordedStep += dropped;
+}
+
+size_t Timeline::getStepSizeBytes() {
+  return m_stepSizes.size() * sizeof(float);
+}
+
+const Snapshot* Timeline::findKeyframe(double time) {
+  auto itr = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+    [](double t, const Snapshot& keyframe) { return t < keyframe.time; });
+  if (itr == m_keyframes.begin()) {
+    return nullptr;
+  }
+  return &*(itr - 1);
+}
+
+void Timeline::recordStep(unsigned long long step, float stepSize) {
+  if (step < m_firstRecordedStep) {
+    return;
+  }
+  unsigned long long index = step - m_firstRecordedStep;
+  if (index == m_stepSizes.size()) {
+    m_stepSizes.push_back(stepSize);
+  }
+  else if (index < m_stepSizes.size()) {
+    m_stepSizes[index] = stepSize;
+  }
+}
+
+bool Timeline::getRecordedStepSize(unsigned long long step, float& stepSize) {
+  if (step < m_firstRecordedStep || step - m_firstRecordedStep >= m_stepSizes.size()) {
+    return false;
+  }
+  stepSize = m_stepSizes[step - m_firstRecordedStep];
+  return true;
+}
+
+unsigned long long Timeline::getRecordedStepCount() {
+  return m_firstRecordedStep + m_stepSizes.size();
+}
+
+unsigned long long Timeline::getFirstRecordedStep() {
+  return m_firstRecordedStep;
+}
+
+unsigned int Timeline::getKeyframeInterval() {
+  return m_keyframeInterval;
+}
+
+size_t Timeline::getKeyframeCount() {
+  return m_keyframes.size();
+}
+
+size_t Timeline::getMemoryUsage() {
+  return m_keyframeBytes + getStepSizeBytes();
+}
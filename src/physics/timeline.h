@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include "snapshot.h"
+
+// In-memory history used to seek the simulation to any earlier (or already simulated) time.
+// Keeps a snapshot every m_keyframeInterval steps plus the size of every step taken. Restoring the
+// keyframe before a target and replaying the recorded step sizes reproduces the original run exactly.
+// The budget covers keyframes and step sizes together and is checked whenever a keyframe is added.
+// While the keyframes take most of it every other one is dropped and the interval doubles, so history is kept and
+// seeks just replay further. Once the step sizes take most of it, the oldest keyframe goes along with the step sizes
+// before the next one, as those steps could no longer be reached.
+class Timeline {
+private:
+  std::deque<Snapshot> m_keyframes; // Ordered by step
+  std::deque<float> m_stepSizes; // m_stepSizes[i] is the size of step m_firstRecordedStep + i
+  unsigned long long m_firstRecordedStep;
+  size_t m_memoryBudget; // Bytes
+  unsigned int m_keyframeInterval;
+  size_t m_keyframeBytes;
+
+  void thinKeyframes();
+  void dropOldestKeyframe();
+  size_t getStepSizeBytes();
+
+public:
+  Timeline();
+  void configure(size_t memoryBudget, unsigned int keyframeInterval);
+  void clear();
+
+  bool isKeyframeDue(unsigned long long step);
+  void addKeyframe(Snapshot&& keyframe);
+  // Latest keyframe at or before time, nullptr if time precedes the first one
+  const Snapshot* findKeyframe(double time);
+
+  void recordStep(unsigned long long step, float stepSize);
+  // True (and sets stepSize) if step has been taken before and is still in the history
+  bool getRecordedStepSize(unsigned long long step, float& stepSize);
+  // The first step not recorded yet
+  unsigned long long getRecordedStepCount();
+  unsigned long long getFirstRecordedStep();
+
+  unsigned int getKeyframeInterval();
+  size_t getKeyframeCount();
+  size_t getMemoryUsage();
+};
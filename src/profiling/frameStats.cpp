@@ -0,0 +1,126 @@
+#include "frameStats.h"
+#include <algorithm>
+#include <cmath>
+
+FrameStats* FrameStats::m_instance = nullptr;
+
+FrameStats::FrameStats() {
+  setHistoryLength(240);
+}
+
+FrameStats* FrameStats::getInstance() {
+  if (m_instance == nullptr) {
+    m_instance = new FrameStats();
+  }
+  return m_instance;
+}
+
+const char* FrameStats::getSectionName(PerfSection section) {
+  switch (section) {
+    case PERF_FRAME: return "Frame";
+    case PERF_PHYSICS: return "Physics";
+    case PERF_MODEL_MATRICES: return "Model matrices";
+    case PERF_SCENE_DRAW: return "Scene draw";
+    case PERF_BLOOM: return "Bloom";
+    case PERF_LUMINANCE: return "Luminance";
+    case PERF_GUI: return "GUI";
+    default: return "";
+  }
+}
+
+void FrameStats::setHistoryLength(size_t frames) {
+  m_historyLength = std::max<size_t>(frames, 1);
+  for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+    m_cpu[i] = History();
+    m_cpu[i].samples.resize(m_historyLength);
+    m_gpu[i] = History();
+    m_gpu[i].samples.resize(m_historyLength);
+    m_pendingCpu[i] = 0.0;
+    m_pendingUsed[i] = false;
+  }
+}
+
+size_t FrameStats::getHistoryLength() {
+  return m_historyLength;
+}
+
+void FrameStats::push(History& history, float value) {
+  history.samples[history.next] = value;
+  history.next = (history.next + 1) % m_historyLength;
+  history.count = std::min(history.count + 1, m_historyLength);
+}
+
+void FrameStats::addCpuTime(PerfSection section, double milliseconds) {
+  m_pendingCpu[section] += milliseconds;
+  m_pendingUsed[section] = true;
+}
+
+void FrameStats::addGpuTime(PerfSection section, double milliseconds) {
+  push(m_gpu[section], (float)milliseconds);
+}
+
+void FrameStats::endFrame() {
+  for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+    // Sections that didn't run this frame (e.g. bloom while disabled) leave no sample
+    if (m_pendingUsed[i]) {
+      push(m_cpu[i], (float)m_pendingCpu[i]);
+    }
+    m_pendingCpu[i] = 0.0;
+    m_pendingUsed[i] = false;
+  }
+}
+
+FramePercentiles FrameStats::percentiles(const History& history) {
+  FramePercentiles result;
+  result.sampleCount = history.count;
+  if (history.count == 0) {
+    return result;
+  }
+
+  std::vector<float> sorted(history.samples.begin(), history.samples.begin() + history.count);
+  std::sort(sorted.begin(), sorted.end());
+
+  // Nearest rank
+  auto rank = [&sorted](double percentile) {
+    size_t index = (size_t)std::ceil(percentile * sorted.size()) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+  };
+  result.p50 = rank(0.50);
+  result.p95 = rank(0.95);
+  result.p99 = rank(0.99);
+  return result;
+}
+
+FramePercentiles FrameStats::getCpuPercentiles(PerfSection section) {
+  return percentiles(m_cpu[section]);
+}
+
+FramePercentiles FrameStats::getGpuPercentiles(PerfSection section) {
+  return percentiles(m_gpu[section]);
+}
+
+void FrameStats::copyHistory(const History& history, std::vector<float>& samples) {
+  samples.clear();
+  size_t first = (history.next + m_historyLength - history.count) % m_historyLength;
+  for (size_t i = 0; i < history.count; i++) {
+    samples.push_back(history.samples[(first + i) % m_historyLength]);
+  }
+}
+
+void FrameStats::getCpuHistory(PerfSection section, std::vector<float>& samples) {
+  copyHistory(m_cpu[section], samples);
+}
+
+void FrameStats::getGpuHistory(PerfSection section, std::vector<float>& samples) {
+  copyHistory(m_gpu[section], samples);
+}
+
+CpuSectionTimer::CpuSectionTimer(PerfSection section) {
+  m_section = section;
+  m_start = std::chrono::steady_clock::now();
+}
+
+CpuSectionTimer::~CpuSectionTimer() {
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+  FrameStats::getInstance()->addCpuTime(m_section, elapsed.count());
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+// Parts of a frame tracked by the performance HUD
+enum PerfSection {
+  PERF_FRAME,
+  PERF_PHYSICS,
+  PERF_MODEL_MATRICES,
+  PERF_SCENE_DRAW,
+  PERF_BLOOM,
+  PERF_LUMINANCE,
+  PERF_GUI,
+  PERF_SECTION_COUNT
+};
+
+struct FramePercentiles {
+  float p50 = 0.0f;
+  float p95 = 0.0f;
+  float p99 = 0.0f;
+  size_t sampleCount = 0;
+};
+
+// Rolling per-section frame times (milliseconds) for the last m_historyLength frames.
+// CPU time of a section is summed over the frame (a section may run once per instance group) and committed by endFrame().
+// GPU times arrive a few frames late from GpuProfiler and are added as they resolve.
+class FrameStats {
+private:
+  struct History {
+    std::vector<float> samples; // Ring buffer
+    size_t next = 0;
+    size_t count = 0;
+  };
+
+  static FrameStats* m_instance;
+
+  size_t m_historyLength;
+  History m_cpu[PERF_SECTION_COUNT];
+  History m_gpu[PERF_SECTION_COUNT];
+  double m_pendingCpu[PERF_SECTION_COUNT];
+  bool m_pendingUsed[PERF_SECTION_COUNT];
+
+  FrameStats();
+  void push(History& history, float value);
+  FramePercentiles percentiles(const History& history);
+  void copyHistory(const History& history, std::vector<float>& samples);
+
+public:
+  static FrameStats* getInstance();
+  static const char* getSectionName(PerfSection section);
+
+  void addCpuTime(PerfSection section, double milliseconds);
+  void addGpuTime(PerfSection section, double milliseconds);
+  void endFrame();
+  void setHistoryLength(size_t frames);
+  size_t getHistoryLength();
+
+  FramePercentiles getCpuPercentiles(PerfSection section);
+  FramePercentiles getGpuPercentiles(PerfSection section);
+  // Oldest first
+  void getCpuHistory(PerfSection section, std::vector<float>& samples);
+  void getGpuHistory(PerfSection section, std::vector<float>& samples);
+};
+
+// Adds the lifetime of the scope to a section's CPU time for this frame
+class CpuSectionTimer {
+private:
+  PerfSection m_section;
+  std::chrono::steady_clock::time_point m_start;
+
+public:
+  CpuSectionTimer(PerfSection section);
+  ~CpuSectionTimer();
+};
@@ -0,0 +1,111 @@
+#include <GL/glew.h>
+#include "gpuProfiler.h"
+
+GpuProfiler* GpuProfiler::m_instance = nullptr;
+
+GpuProfiler::GpuProfiler() {
+  m_enabled = false;
+  m_frameIndex = 0;
+  for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+    m_openRange[i] = -1;
+  }
+}
+
+GpuProfiler* GpuProfiler::getInstance() {
+  if (m_instance == nullptr) {
+    m_instance = new GpuProfiler();
+  }
+  return m_instance;
+}
+
+void GpuProfiler::setEnabled(bool enabled) {
+  m_enabled = enabled;
+}
+
+bool GpuProfiler::isEnabled() {
+  return m_enabled;
+}
+
+unsigned int GpuProfiler::takeQuery() {
+  Frame& frame = m_frames[m_frameIndex];
+  if (frame.usedQueries == frame.queries.size()) {
+    unsigned int query;
+    glGenQueries(1, &query);
+    frame.queries.push_back(query);
+  }
+  return frame.queries[frame.usedQueries++];
+}
+
+void GpuProfiler::begin(PerfSection section) {
+  if (!m_enabled || m_openRange[section] != -1) {
+    return;
+  }
+  Range range;
+  range.section = section;
+  range.beginQuery = takeQuery();
+  range.endQuery = takeQuery();
+  glQueryCounter(range.beginQuery, GL_TIMESTAMP);
+
+  Frame& frame = m_frames[m_frameIndex];
+  m_openRange[section] = frame.ranges.size();
+  frame.ranges.push_back(range);
+}
+
+void GpuProfiler::end(PerfSection section) {
+  if (m_openRange[section] == -1) {
+    return;
+  }
+  Frame& frame = m_frames[m_frameIndex];
+  glQueryCounter(frame.ranges[m_openRange[section]].endQuery, GL_TIMESTAMP);
+  m_openRange[section] = -1;
+}
+
+void GpuProfiler::resolve(Frame& frame) {
+  if (frame.ranges.empty()) {
+    return;
+  }
+
+  // Queries complete in order, so if the last one is done they all are. If not, drop the frame rather than wait.
+  GLint available = 0;
+  glGetQueryObjectiv(frame.ranges.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available) {
+    double totals[PERF_SECTION_COUNT] = {};
+    bool used[PERF_SECTION_COUNT] = {};
+    for (auto const& range : frame.ranges) {
+      GLuint64 beginTime = 0, endTime = 0;
+      glGetQueryObjectui64v(range.beginQuery, GL_QUERY_RESULT, &beginTime);
+      glGetQueryObjectui64v(range.endQuery, GL_QUERY_RESULT, &endTime);
+      totals[range.section] += (endTime - beginTime) / 1e6;
+      used[range.section] = true;
+    }
+
+    FrameStats* frameStats = FrameStats::getInstance();
+    for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+      if (used[i]) {
+        frameStats->addGpuTime((PerfSection)i, totals[i]);
+      }
+    }
+  }
+
+  frame.ranges.clear();
+  frame.usedQueries = 0;
+}
+
+void GpuProfiler::endFrame() {
+  // Close anything left open so its queries are complete
+  for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+    end((PerfSection)i);
+  }
+
+  m_frameIndex = (m_frameIndex + 1) % FRAMES_IN_FLIGHT;
+  resolve(m_frames[m_frameIndex]);
+}
+
+PerfScope::PerfScope(PerfSection section) : m_cpuTimer(section) {
+  m_section = section;
+  GpuProfiler::getInstance()->begin(section);
+}
+
+PerfScope::~PerfScope() {
+  GpuProfiler::getInstance()->end(m_section);
+}
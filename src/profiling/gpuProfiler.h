@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include "frameStats.h"
+
+// Measures GPU time per PerfSection with GL_TIMESTAMP queries and feeds it to FrameStats.
+// Queries of a frame are only read back FRAMES_IN_FLIGHT frames later, once the GPU has long finished them,
+// so profiling never stalls the pipeline. Timestamps (not GL_TIME_ELAPSED) are used so sections may nest
+// and may be entered several times per frame; the time of every entry is summed.
+class GpuProfiler {
+private:
+  static const unsigned int FRAMES_IN_FLIGHT = 4;
+
+  struct Range {
+    PerfSection section;
+    unsigned int beginQuery;
+    unsigned int endQuery;
+  };
+
+  struct Frame {
+    std::vector<unsigned int> queries; // Pool reused every FRAMES_IN_FLIGHT frames
+    std::vector<Range> ranges;
+    size_t usedQueries = 0;
+  };
+
+  static GpuProfiler* m_instance;
+
+  bool m_enabled;
+  Frame m_frames[FRAMES_IN_FLIGHT];
+  unsigned int m_frameIndex;
+  int m_openRange[PERF_SECTION_COUNT]; // Index into the current frame's ranges, -1 when closed
+
+  GpuProfiler();
+  unsigned int takeQuery();
+  void resolve(Frame& frame);
+
+public:
+  static GpuProfiler* getInstance();
+  void setEnabled(bool enabled);
+  bool isEnabled();
+  void begin(PerfSection section);
+  void end(PerfSection section);
+  // Call once per frame after the last section
+  void endFrame();
+};
+
+// Times the scope on both CPU and GPU
+class PerfScope {
+private:
+  CpuSectionTimer m_cpuTimer;
+  PerfSection m_section;
+
+public:
+  PerfScope(PerfSection section);
+  ~PerfScope();
+};
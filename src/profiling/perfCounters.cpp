@@ -0,0 +1,114 @@
+#include "perfCounters.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+  int openCounter(unsigned int type, unsigned long long config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1; // Threads started later count towards this one
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+}
+#endif
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    m_fileDescriptors[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  close();
+}
+
+bool PerfCounters::open() {
+  close();
+#ifdef __linux__
+  m_fileDescriptors[PERF_COUNTER_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  m_fileDescriptors[PERF_COUNTER_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  m_fileDescriptors[PERF_COUNTER_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  m_fileDescriptors[PERF_COUNTER_LLC_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  m_fileDescriptors[PERF_COUNTER_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (m_fileDescriptors[i] == -1) {
+      std::cout << "Performance counter " << getCounterName((PerfCounter)i) << " is not available" << std::endl;
+    }
+    else {
+      ioctl(m_fileDescriptors[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fileDescriptors[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#else
+  std::cout << "Performance counters are only supported on Linux" << std::endl;
+#endif
+  return isOpen();
+}
+
+void PerfCounters::close() {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+#ifdef __linux__
+    if (m_fileDescriptors[i] != -1) {
+      ::close(m_fileDescriptors[i]);
+    }
+#endif
+    m_fileDescriptors[i] = -1;
+  }
+}
+
+bool PerfCounters::isOpen() {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (m_fileDescriptors[i] != -1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PerfCounterValues PerfCounters::read() {
+  PerfCounterValues result;
+#ifdef __linux__
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    // value, time enabled, time running
+    unsigned long long data[3];
+    if (m_fileDescriptors[i] == -1 || ::read(m_fileDescriptors[i], data, sizeof(data)) != sizeof(data)) {
+      continue;
+    }
+    result.available[i] = true;
+    if (data[2] != 0 && data[2] < data[1]) {
+      // Multiplexed: extrapolate to the whole time the counter was enabled
+      result.values[i] = (unsigned long long)((double)data[0] * data[1] / data[2]);
+    }
+    else {
+      result.values[i] = data[0];
+    }
+  }
+#endif
+  return result;
+}
+
+const char* PerfCounters::getCounterName(PerfCounter counter) {
+  switch (counter) {
+    case PERF_COUNTER_CYCLES: return "cycles";
+    case PERF_COUNTER_INSTRUCTIONS: return "instructions";
+    case PERF_COUNTER_L1D_MISSES: return "l1d_misses";
+    case PERF_COUNTER_LLC_MISSES: return "llc_misses";
+    case PERF_COUNTER_BRANCH_MISSES: return "branch_misses";
+    default: return "";
+  }
+}
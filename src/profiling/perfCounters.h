@@ -0,0 +1,35 @@
+#pragma once
+
+enum PerfCounter {
+  PERF_COUNTER_CYCLES,
+  PERF_COUNTER_INSTRUCTIONS,
+  PERF_COUNTER_L1D_MISSES, // L1 data cache read misses
+  PERF_COUNTER_LLC_MISSES, // Last level cache misses
+  PERF_COUNTER_BRANCH_MISSES,
+  PERF_COUNTER_COUNT
+};
+
+struct PerfCounterValues {
+  unsigned long long values[PERF_COUNTER_COUNT] = {};
+  bool available[PERF_COUNTER_COUNT] = {};
+};
+
+// Hardware event counts through Linux perf_event_open, user space only.
+// Counts the thread that opens them plus every thread it starts afterwards, so open before starting worker threads.
+// Counters the CPU, VM or kernel.perf_event_paranoid don't allow are marked unavailable; other platforms have none.
+// When more events are requested than the PMU has slots, the kernel multiplexes them and the counts are scaled up.
+class PerfCounters {
+private:
+  int m_fileDescriptors[PERF_COUNTER_COUNT];
+
+public:
+  PerfCounters();
+  ~PerfCounters();
+  // True if at least one counter could be opened
+  bool open();
+  void close();
+  bool isOpen();
+  // Counts since open
+  PerfCounterValues read();
+  static const char* getCounterName(PerfCounter counter);
+};
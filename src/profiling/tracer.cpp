@@ -0,0 +1,151 @@
+#include "tracer.h"
+#include <fstream>
+#include <iostream>
+
+thread_local Tracer::ThreadBuffer* Tracer::m_threadBuffer = nullptr;
+
+namespace {
+  std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+      }
+      escaped += c;
+    }
+    return escaped;
+  }
+}
+
+Tracer::Tracer() {
+  m_epoch = std::chrono::steady_clock::now();
+  m_eventsPerThread = 1 << 16;
+}
+
+Tracer* Tracer::getInstance() {
+  // Function local static so worker threads racing on their first event still create a single tracer
+  static Tracer* instance = new Tracer();
+  return instance;
+}
+
+uint64_t Tracer::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+Tracer::ThreadBuffer* Tracer::getThreadBuffer() {
+  if (m_threadBuffer == nullptr) {
+    ThreadBuffer* buffer = new ThreadBuffer();
+    buffer->events.reset(new Slot[m_eventsPerThread]);
+    for (size_t i = 0; i < m_eventsPerThread; i++) {
+      buffer->events[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    buffer->head = 0;
+
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    buffer->threadId = m_buffers.size() + 1;
+    buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+    m_buffers.push_back(buffer);
+    m_threadBuffer = buffer;
+  }
+  return m_threadBuffer;
+}
+
+void Tracer::record(const char* name, uint64_t start, uint64_t end) {
+  ThreadBuffer* buffer = getThreadBuffer();
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  Slot& slot = buffer->events[head & (m_eventsPerThread - 1)];
+  slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.start.store(start, std::memory_order_relaxed);
+  slot.duration.store(end - start, std::memory_order_relaxed);
+  slot.sequence.store(2 * (head + 1), std::memory_order_release);
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(std::string name) {
+  ThreadBuffer* buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock(m_registryMutex);
+  buffer->threadName = name;
+}
+
+std::vector<std::pair<unsigned int, TraceEvent>> Tracer::collect() {
+  std::vector<std::pair<unsigned int, TraceEvent>> events;
+  std::lock_guard<std::mutex> lock(m_registryMutex);
+
+  for (auto buffer : m_buffers) {
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t first = 0;
+    if (head > m_eventsPerThread) {
+      first = head - m_eventsPerThread;
+    }
+    for (uint64_t i = first; i < head; i++) {
+      const Slot& slot = buffer->events[i & (m_eventsPerThread - 1)];
+      uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != 2 * (i + 1)) {
+        continue; // Already overwritten by a newer event
+      }
+      TraceEvent event;
+      event.name = slot.name.load(std::memory_order_relaxed);
+      event.start = slot.start.load(std::memory_order_relaxed);
+      event.duration = slot.duration.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        continue; // Overwritten while we were reading it
+      }
+      events.push_back(std::make_pair(buffer->threadId, event));
+    }
+  }
+  return events;
+}
+
+bool Tracer::writeChromeTrace(std::string filePath) {
+  std::vector<std::pair<unsigned int, TraceEvent>> events = collect();
+
+  std::ofstream file(filePath, std::ios::trunc);
+  if (!file) {
+    std::cout << "Could not open trace file: " << filePath << std::endl;
+    return false;
+  }
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  {
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    for (auto buffer : m_buffers) {
+      file << (first ? "" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+        << ",\"args\":{\"name\":\"" << escapeJson(buffer->threadName) << "\"}}";
+      first = false;
+    }
+  }
+
+  // Complete ("X") events, timestamps in microseconds
+  file.precision(3);
+  file << std::fixed;
+  for (auto const& entry : events) {
+    const TraceEvent& event = entry.second;
+    file << (first ? "" : ",\n")
+      << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << entry.first
+      << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+    first = false;
+  }
+  file << "\n]}\n";
+
+  if (!file) {
+    std::cout << "Failed writing trace file: " << filePath << std::endl;
+    return false;
+  }
+  std::cout << "Wrote " << events.size() << " trace events to " << filePath << std::endl;
+  return true;
+}
+
+ScopedTimer::ScopedTimer(const char* name) {
+  m_name = name;
+  m_start = Tracer::getInstance()->now();
+}
+
+ScopedTimer::~ScopedTimer() {
+  Tracer* tracer = Tracer::getInstance();
+  tracer->record(m_name, m_start, tracer->now());
+}
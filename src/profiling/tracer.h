@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scope based instrumentation. Build with -DENABLE_TRACING (cmake -DENABLE_TRACING=ON) to turn the
+// TRACE_* macros on; otherwise they expand to nothing and cost nothing.
+//
+//   void Scene::render() {
+//     TRACE_SCOPE("Scene::render");
+//     ...
+//   }
+//
+// Names must be string literals (or otherwise outlive the tracer), only the pointer is stored.
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) ScopedTimer TRACE_CONCAT(scopedTimer, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__FUNCTION__)
+#define TRACE_THREAD_NAME(name) Tracer::getInstance()->setThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_FUNCTION()
+#define TRACE_THREAD_NAME(name)
+#endif
+
+struct TraceEvent {
+  const char* name;
+  uint64_t start; // Nanoseconds since the tracer was created
+  uint64_t duration;
+};
+
+// Collects timed scopes from every thread and exports them in the Chrome trace event format,
+// which chrome://tracing and ui.perfetto.dev both open.
+// Each thread appends to its own fixed size ring buffer, so recording never takes a lock or allocates;
+// once full the oldest events are overwritten.
+class Tracer {
+private:
+  // Written by one thread and read by collect() while it may be overwriting it, so the fields are atomics and
+  // the sequence tells the reader whether it got a whole event: odd while being written, 2 * (index + 1) once done
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> duration;
+  };
+
+  struct ThreadBuffer {
+    std::unique_ptr<Slot[]> events;
+    std::atomic<uint64_t> head; // Total events ever written, the writing thread is the only one to advance it
+    unsigned int threadId;
+    std::string threadName;
+  };
+
+  static thread_local ThreadBuffer* m_threadBuffer;
+
+  std::chrono::steady_clock::time_point m_epoch;
+  size_t m_eventsPerThread; // Power of two
+  std::mutex m_registryMutex; // Only taken when a thread records for the first time, or on export
+  std::vector<ThreadBuffer*> m_buffers; // Kept after their threads exit so their events can still be exported
+
+  Tracer();
+  ThreadBuffer* getThreadBuffer();
+
+public:
+  static Tracer* getInstance();
+  uint64_t now();
+  void record(const char* name, uint64_t start, uint64_t end);
+  void setThreadName(std::string name);
+
+  // Copies out everything currently in the ring buffers, ordered by thread.
+  // Safe while threads are still recording; events overwritten during the copy are left out.
+  std::vector<std::pair<unsigned int, TraceEvent>> collect();
+  bool writeChromeTrace(std::string filePath);
+};
+
+class ScopedTimer {
+private:
+  const char* m_name;
+  uint64_t m_start;
+
+public:
+  ScopedTimer(const char* name);
+  ~ScopedTimer();
+};
@@ -0,0 +1,118 @@
+#include "instanceAllocator.h"
+#include <algorithm>
+
+InstanceAllocator::InstanceAllocator(size_t minimumRangeCapacity) {
+  m_minimumRangeCapacity = std::max(minimumRangeCapacity, (size_t)1);
+  m_capacity = 0;
+  m_end = 0;
+  m_used = 0;
+}
+
+// Smallest power of two multiple of the minimum capacity that holds count
+size_t InstanceAllocator::getRangeCapacityFor(size_t count) {
+  size_t capacity = m_minimumRangeCapacity;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+// Packs the ranges to the front, in their current order, and sizes the pool to twice what they use
+void InstanceAllocator::compact() {
+  std::vector<unsigned int> order;
+  for (unsigned int i = 0; i < m_ranges.size(); i++) {
+    if (m_ranges[i].capacity > 0) {
+      order.push_back(i);
+    }
+  }
+  std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+    return m_ranges[a].offset < m_ranges[b].offset;
+  });
+
+  m_end = 0;
+  for (unsigned int i : order) {
+    m_ranges[i].offset = m_end;
+    m_end += m_ranges[i].capacity;
+  }
+  m_capacity = m_used == 0 ? 0 : getRangeCapacityFor(2 * m_used);
+}
+
+unsigned int InstanceAllocator::addRange() {
+  m_ranges.push_back({ m_end, 0 });
+  return m_ranges.size() - 1;
+}
+
+InstanceAllocation InstanceAllocator::resize(unsigned int range, size_t count) {
+  Range& r = m_ranges[range];
+
+  if (count <= r.capacity) {
+    if (r.capacity == m_minimumRangeCapacity || count > r.capacity / 4) {
+      return INSTANCE_RANGE_UNCHANGED;
+    }
+    // Release the tail, keeping room to grow back to double the count
+    size_t capacity = getRangeCapacityFor(2 * count);
+    if (r.offset + r.capacity == m_end) {
+      m_end = r.offset + capacity;
+    }
+    m_used -= r.capacity - capacity;
+    r.capacity = capacity;
+    if (m_used * 4 < m_capacity) {
+      compact();
+      return INSTANCE_POOL_RESIZED;
+    }
+    return INSTANCE_RANGE_UNCHANGED;
+  }
+
+  size_t capacity = getRangeCapacityFor(count);
+  m_used += capacity - r.capacity;
+
+  // The last range can grow into the free space after it
+  if (r.capacity > 0 && r.offset + r.capacity == m_end && r.offset + capacity <= m_capacity) {
+    r.capacity = capacity;
+    m_end = r.offset + capacity;
+    return INSTANCE_RANGE_UNCHANGED;
+  }
+
+  // Others move to the end, leaving a hole that's reclaimed the next time the pool is compacted
+  if (m_end + capacity <= m_capacity) {
+    r.offset = m_end;
+    r.capacity = capacity;
+    m_end += capacity;
+    return INSTANCE_RANGE_MOVED;
+  }
+
+  r.capacity = capacity;
+  r.offset = m_end; // Keeps it after the existing ranges when compacting
+  compact();
+  return INSTANCE_POOL_RESIZED;
+}
+
+InstanceAllocation InstanceAllocator::removeRange(unsigned int range) {
+  Range& r = m_ranges[range];
+  if (r.offset + r.capacity == m_end) {
+    m_end = r.offset;
+  }
+  m_used -= r.capacity;
+  r.capacity = 0;
+  if (m_used * 4 < m_capacity) {
+    compact();
+    return INSTANCE_POOL_RESIZED;
+  }
+  return INSTANCE_RANGE_UNCHANGED;
+}
+
+size_t InstanceAllocator::getOffset(unsigned int range) {
+  return m_ranges[range].offset;
+}
+
+size_t InstanceAllocator::getRangeCapacity(unsigned int range) {
+  return m_ranges[range].capacity;
+}
+
+size_t InstanceAllocator::getCapacity() {
+  return m_capacity;
+}
+
+size_t InstanceAllocator::getUsed() {
+  return m_used;
+}
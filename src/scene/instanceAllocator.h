@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// What a resize did to the layout of the pool
+enum InstanceAllocation {
+  INSTANCE_RANGE_UNCHANGED, // The range kept its offset (it may have grown or shrunk in place)
+  INSTANCE_RANGE_MOVED, // Only this range moved, to unused space within the pool
+  INSTANCE_POOL_RESIZED // The pool was compacted into a new size, every range may have moved
+};
+
+// Hands out ranges of one shared instance buffer, counted in instances so the caller picks the record size.
+// Ranges grow by doubling, at the end of the pool when they can't grow in place, and the pool is compacted to
+// about twice what its ranges use whenever it runs out of room or falls below a quarter full.
+// Only does the bookkeeping: the caller moves the data (or re-uploads it) according to the returned InstanceAllocation.
+class InstanceAllocator {
+private:
+  struct Range {
+    size_t offset;
+    size_t capacity; // 0 for ranges that haven't been sized yet or were removed
+  };
+
+  std::vector<Range> m_ranges;
+  size_t m_minimumRangeCapacity;
+  size_t m_capacity; // Instances in the pool
+  size_t m_end; // Instances up to the end of the last range
+  size_t m_used; // Instances held by ranges
+
+  size_t getRangeCapacityFor(size_t count);
+  void compact();
+
+public:
+  InstanceAllocator(size_t minimumRangeCapacity = 64);
+  unsigned int addRange();
+  // Makes the range hold at least count instances, shrinking it when count is under a quarter of its capacity
+  InstanceAllocation resize(unsigned int range, size_t count);
+  InstanceAllocation removeRange(unsigned int range);
+
+  size_t getOffset(unsigned int range);
+  size_t getRangeCapacity(unsigned int range);
+  size_t getCapacity();
+  size_t getUsed();
+};
@@ -0,0 +1,166 @@
+#include "instanceBVH.h"
+#include <algorithm>
+#include <cmath>
+
+const uint32_t InstanceBVH::LEAF_SIZE;
+
+InstanceBVH::InstanceBVH() {
+  m_builtSize = 0.0f;
+}
+
+void InstanceBVH::fitLeaf(Node& node, const glm::vec4* spheres) {
+  node.min = glm::vec3(INFINITY);
+  node.max = glm::vec3(-INFINITY);
+  for (uint32_t i = node.first; i < node.first + node.count; i++) {
+    const glm::vec4& sphere = spheres[m_indices[i]];
+    glm::vec3 center = glm::vec3(sphere.x, sphere.y, sphere.z);
+    node.min = glm::min(node.min, center - glm::vec3(sphere.w));
+    node.max = glm::max(node.max, center + glm::vec3(sphere.w));
+  }
+}
+
+// Splits the node at the median center along the axis its centers spread most on
+void InstanceBVH::subdivide(uint32_t nodeIndex, const glm::vec4* spheres, std::vector<glm::vec3>& centers) {
+  fitLeaf(m_nodes[nodeIndex], spheres);
+  Node node = m_nodes[nodeIndex];
+  if (node.count <= LEAF_SIZE) {
+    return;
+  }
+
+  glm::vec3 centerMin = glm::vec3(INFINITY);
+  glm::vec3 centerMax = glm::vec3(-INFINITY);
+  for (uint32_t i = node.first; i < node.first + node.count; i++) {
+    centerMin = glm::min(centerMin, centers[m_indices[i]]);
+    centerMax = glm::max(centerMax, centers[m_indices[i]]);
+  }
+  glm::vec3 extent = centerMax - centerMin;
+  int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+  uint32_t half = node.count / 2;
+  std::nth_element(m_indices.begin() + node.first, m_indices.begin() + node.first + half, m_indices.begin() + node.first + node.count,
+    [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+
+  uint32_t left = m_nodes.size();
+  m_nodes[nodeIndex].left = left;
+  m_nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, node.first, half });
+  m_nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, node.first + half, node.count - half });
+  subdivide(left, spheres, centers);
+  subdivide(left + 1, spheres, centers);
+}
+
+float InstanceBVH::getSize() {
+  float size = 0.0f;
+  for (const Node& node : m_nodes) {
+    glm::vec3 extent = node.max - node.min;
+    size += extent.x + extent.y + extent.z;
+  }
+  return size;
+}
+
+void InstanceBVH::build(const glm::vec4* spheres, size_t count) {
+  m_nodes.clear();
+  m_indices.resize(count);
+  std::vector<glm::vec3> centers(count);
+  for (uint32_t i = 0; i < count; i++) {
+    m_indices[i] = i;
+    centers[i] = glm::vec3(spheres[i].x, spheres[i].y, spheres[i].z);
+  }
+  if (count == 0) {
+    m_builtSize = 0.0f;
+    return;
+  }
+
+  m_nodes.reserve(2 * count / LEAF_SIZE + 1);
+  m_nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), 0, 0, (uint32_t)count });
+  subdivide(0, spheres, centers);
+  m_builtSize = getSize();
+}
+
+// Children come after their parents, so walking backwards fits every child before its parent
+void InstanceBVH::refit(const glm::vec4* spheres) {
+  for (size_t i = m_nodes.size(); i-- > 0;) {
+    Node& node = m_nodes[i];
+    if (node.left == 0) {
+      fitLeaf(node, spheres);
+    }
+    else {
+      node.min = glm::min(m_nodes[node.left].min, m_nodes[node.left + 1].min);
+      node.max = glm::max(m_nodes[node.left].max, m_nodes[node.left + 1].max);
+    }
+  }
+}
+
+bool InstanceBVH::needsRebuild() {
+  return getSize() > 2.0f * m_builtSize;
+}
+
+size_t InstanceBVH::getCount() {
+  return m_indices.size();
+}
+
+// Gribb and Hartmann: each plane is the last row of the matrix plus or minus one of the others
+void InstanceBVH::getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+  glm::vec4 rows[4];
+  for (int row = 0; row < 4; row++) {
+    rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    planes[2 * axis] = rows[3] + rows[axis];
+    planes[2 * axis + 1] = rows[3] - rows[axis];
+  }
+  for (int i = 0; i < 6; i++) {
+    float length = glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+    planes[i] = planes[i] * (1.0f / length);
+  }
+}
+
+bool InstanceBVH::intersectsFrustum(const glm::vec4 planes[6], const glm::vec4& sphere) {
+  glm::vec3 center = glm::vec3(sphere.x, sphere.y, sphere.z);
+  for (int p = 0; p < 6; p++) {
+    if (glm::dot(glm::vec3(planes[p].x, planes[p].y, planes[p].z), center) + planes[p].w < -sphere.w) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void InstanceBVH::cull(const glm::vec4 planes[6], const glm::vec4* spheres, std::vector<uint32_t>& visible) {
+  if (m_nodes.empty()) {
+    return;
+  }
+
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+
+    // Test the box corner furthest along each plane's normal, and the nearest one to see if it's entirely inside
+    bool inside = true;
+    bool outside = false;
+    for (int i = 0; i < 6 && !outside; i++) {
+      glm::vec3 normal = glm::vec3(planes[i].x, planes[i].y, planes[i].z);
+      glm::vec3 furthest = glm::vec3(normal.x >= 0 ? node.max.x : node.min.x, normal.y >= 0 ? node.max.y : node.min.y, normal.z >= 0 ? node.max.z : node.min.z);
+      glm::vec3 nearest = glm::vec3(normal.x >= 0 ? node.min.x : node.max.x, normal.y >= 0 ? node.min.y : node.max.y, normal.z >= 0 ? node.min.z : node.max.z);
+      outside = glm::dot(normal, furthest) + planes[i].w < 0.0f;
+      inside = inside && glm::dot(normal, nearest) + planes[i].w >= 0.0f;
+    }
+
+    if (outside) {
+      continue;
+    }
+    if (inside) {
+      visible.insert(visible.end(), m_indices.begin() + node.first, m_indices.begin() + node.first + node.count);
+    }
+    else if (node.left != 0) {
+      stack.push_back(node.left);
+      stack.push_back(node.left + 1);
+    }
+    else {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (intersectsFrustum(planes, spheres[m_indices[i]])) {
+          visible.push_back(m_indices[i]);
+        }
+      }
+    }
+  }
+}
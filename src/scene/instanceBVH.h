@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Bounding volume hierarchy of axis aligned boxes over instance bounding spheres, for frustum culling.
+// The tree is built once and refit to the spheres each frame. Refitting keeps the culling exact but the boxes
+// loosen as instances drift apart, so needsRebuild() reports when the tree has grown to twice its built size.
+class InstanceBVH {
+private:
+  struct Node {
+    glm::vec3 min;
+    glm::vec3 max;
+    uint32_t left; // Children are left and left + 1, 0 for leaves
+    uint32_t first; // The node's instances are m_indices[first, first + count)
+    uint32_t count;
+  };
+
+  std::vector<Node> m_nodes; // Children always come after their parent
+  std::vector<uint32_t> m_indices;
+  float m_builtSize; // Sum of the node extents right after building
+
+  void subdivide(uint32_t nodeIndex, const glm::vec4* spheres, std::vector<glm::vec3>& centers);
+  void fitLeaf(Node& node, const glm::vec4* spheres);
+  float getSize();
+
+public:
+  static const uint32_t LEAF_SIZE = 4;
+
+  InstanceBVH();
+  // spheres[i] is the center (xyz) and radius (w) of instance i
+  void build(const glm::vec4* spheres, size_t count);
+  void refit(const glm::vec4* spheres);
+  bool needsRebuild();
+  size_t getCount();
+
+  // Planes (xyz normal pointing inwards, w distance) of the frustum of a projection * view matrix
+  static void getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+  static bool intersectsFrustum(const glm::vec4 planes[6], const glm::vec4& sphere);
+  // Appends the index of every instance whose sphere intersects the frustum
+  void cull(const glm::vec4 planes[6], const glm::vec4* spheres, std::vector<uint32_t>& visible);
+};
@@ -2,16 +2,50 @@
 #include "scene.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <mutex>
 #include <glm/gtc/type_ptr.hpp>
-#include "nlohmann/json.hpp"
 #include "../graphics/shader/shaderManager.h"
 #include "../graphics/mesh/meshManager.h"
 #include "../graphics/texture/textureManager.h"
 #include "../config.h"
+#include "../profiling/tracer.h"
+#include "../profiling/gpuProfiler.h"
+#include "../io/sceneFile.h"
+#include "../io/sceneJSONReader.h"
+#include "../threading/threadPool.h"
 
 Scene::Scene(GLFWwindow* window) {
   m_universeScaleFactor = 1.0f;
-  m_numFloatsPerModelData = 16 * 4; // mat4 (scale, rot, transform, modelMatrix)
+  m_physicsSystem.applyConfig();
+  m_modelBuffer = 0;
+  m_materialBuffer = 0;
+  m_materialsDirty = false;
+  glGenBuffers(1, &m_materialDataBuffer);
+  glGenBuffers(1, &m_visibleBuffer);
+  m_visibleBufferCapacity = 0;
+
+  // Cluster splats are drawn straight from the octree cells: center of mass, body count and radius
+  glGenVertexArrays(1, &m_clusterVAO);
+  glGenBuffers(1, &m_clusterBuffer);
+  m_clusterBufferCapacity = 0;
+  glBindVertexArray(m_clusterVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_clusterBuffer);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(OctreeCell), (void*)offsetof(OctreeCell, centerOfMass));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(OctreeCell), (void*)offsetof(OctreeCell, mass));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(OctreeCell), (void*)offsetof(OctreeCell, radius));
+  glEnableVertexAttribArray(2);
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &m_drawCommandBuffer);
+  glGenBuffers(1, &m_drawDataBuffer);
+  glGenBuffers(1, &m_drawIdBuffer);
+  m_drawBufferCapacity = 0;
+
   genUniformBuffer();
 }
 
@@ -30,14 +64,53 @@ void Scene::genUniformBuffer() {
   glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-std::string Scene::getInstanceGroupKey(Object* obj) {
+// Returns the id of key, giving it the next free id the first time it's seen
+static uint32_t internKey(std::unordered_map<std::string, uint32_t>& ids, const std::string& key) {
+  auto const& itr = ids.find(key);
+  if (itr != ids.end()) {
+    return itr->second;
+  }
+  uint32_t id = ids.size();
+  ids[key] = id;
+  return id;
+}
+
+// Packs the shader, mesh and texture arrays ids into 21 bits each. Only called when objects are registered.
+// The textures are packed into their arrays here, so objects whose maps are the same sizes share a key.
+uint64_t Scene::getInstanceGroupKey(Object* obj) {
+  const uint64_t idBits = 21;
   auto shaders = obj->getShaders();
-  auto material = obj->getTextures();
-  std::string materialName = "";
-  for (auto const& str : material) {
-    materialName += str;
+  std::vector<std::string> textures = obj->getTextures();
+  std::string textureArraysName = "";
+  for (size_t map = 0; map < textures.size(); map++) {
+    textureArraysName += std::to_string(TextureManager::getInstance()->getTextureArrayLayer(textures[map], (int)map).array) + '\n';
+  }
+  uint64_t shaderId = internKey(m_shaderIds, shaders.first + '\n' + shaders.second);
+  uint64_t meshId = internKey(m_meshIds, obj->getMesh());
+  uint64_t textureArraysId = internKey(m_textureArraysIds, textureArraysName);
+  if (std::max({ shaderId, meshId, textureArraysId }) >> idBits != 0) {
+    std::cout << "ERROR::SCENE::TOO_MANY_DISTINCT_SHADERS_MESHES_OR_TEXTURE_SIZES" << std::endl;
   }
-  return shaders.first + shaders.second + obj->getMesh() + materialName;
+  return (shaderId << (2 * idBits)) | (meshId << idBits) | textureArraysId;
+}
+
+// Returns the index in m_materials of the object's layers and strengths, adding them the first time they're seen
+uint32_t Scene::getMaterialId(Object* obj) {
+  std::vector<std::string> textures = obj->getTextures();
+  std::vector<float> textureStrengths = obj->getTextureStrengths();
+  MaterialData material;
+  for (int map = 0; map < 4; map++) {
+    TextureArrayLayer textureLayer = TextureManager::getInstance()->getTextureArrayLayer(textures[map], map);
+    material.textureStrengths[map] = textureLayer.array == -1 ? 0.0f : textureStrengths[map];
+    material.layers[map] = textureLayer.layer;
+  }
+
+  uint32_t materialId = internKey(m_materialIds, std::string((const char*)&material, sizeof(MaterialData)));
+  if (materialId == m_materials.size()) {
+    m_materials.push_back(material);
+    m_materialsDirty = true;
+  }
+  return materialId;
 }
 
 System* Scene::getPhysicsSystem() {
@@ -53,186 +126,465 @@ float Scene::getUniverseScaleFactor() {
 }
 
 void Scene::loadScene(std::string sceneFilePath) {
+  TRACE_SCOPE("Scene::loadScene");
 
-  using namespace nlohmann; // json lib namespace
-
-  // Load scene from json file
-  std::ifstream file(sceneFilePath);
-  std::string scene;
-  std::getline(file, scene, '\0');
-  json jScene = json::parse(scene);
-
-  // Get units
-  m_universeScaleFactor = jScene["UniverseScaleFactor"].get<float>();
-  float SIUnitScaleFactor = jScene["SIUnitScaleFactor"].get<float>();
-
-  // Setup camera
-  m_camera.setCameraPosition(
-    glm::vec3(
-      jScene["CameraPosition"]["x"].get<float>() / SIUnitScaleFactor,
-      jScene["CameraPosition"]["y"].get<float>() / SIUnitScaleFactor,
-      jScene["CameraPosition"]["z"].get<float>() / SIUnitScaleFactor
-    )
-  );
-
-  // Setup lighting data in uniform
-  m_ambientStrength = jScene["ambientStrength"].get<float>();
-  m_specularStrength = jScene["specularStrength"].get<float>();
-  m_phongExponent = jScene["phongExponent"].get<float>();
-
-  // Setup physics
-  m_physicsSystem.setSIUnitScaleFactor(SIUnitScaleFactor);
-
-  // Construct scene. In units specified in SI units of json
-  for (auto gravBodyJSON : jScene["GravBodies"]) {
-    GravBody* body = new GravBody(SIUnitScaleFactor, gravBodyJSON);
-    m_physicsSystem.addBody(body); // Add gravBody to physics system
-
-    // Tell scene to register this object
-    registerObjectToScene(body);
+  // Compiled scenes (see src/tools/sceneCompiler) are mapped. JSON scenes are streamed into the same
+  // layout in memory, so neither builds a DOM and both construct the bodies on the thread pool.
+  SceneFile sceneFile;
+  if (SceneFile::isSceneFile(sceneFilePath)) {
+    if (!sceneFile.open(sceneFilePath)) {
+      return;
+    }
+  }
+  else {
+    std::vector<unsigned char> encoded;
+    if (!SceneJSONReader::read(sceneFilePath, encoded) || !sceneFile.open(std::move(encoded))) {
+      return;
+    }
+  }
+
+  // Everything is stored in system units already
+  m_universeScaleFactor = sceneFile.getUniverseScaleFactor();
+  m_camera.setCameraPosition(sceneFile.getCameraPosition());
+  m_ambientStrength = sceneFile.getAmbientStrength();
+  m_specularStrength = sceneFile.getSpecularStrength();
+  m_phongExponent = sceneFile.getPhongExponent();
 
+  m_physicsSystem.loadBodies(sceneFile);
+  for (auto body : m_physicsSystem.getBodies()) {
+    registerObjectToScene(body);
   }
 
-  // Construct lights
-  for (auto lightJSON : jScene["Lights"]) {
+  for (size_t i = 0; i < sceneFile.getLightCount(); i++) {
+    SceneLight sceneLight = sceneFile.getLight(i);
     Light light;
+    light.setPosition(sceneLight.position.x, sceneLight.position.y, sceneLight.position.z);
+    light.setColor(sceneLight.color.x, sceneLight.color.y, sceneLight.color.z);
+    light.setIntensity(sceneLight.intensity);
+    m_lights.push_back(light);
+  }
+}
+
+// Replaces the model buffer with one of the allocator's capacity. Every group is re-sent from its CPU copy.
+void Scene::resizeModelBuffer() {
+  glDeleteBuffers(1, &m_modelBuffer);
+  glGenBuffers(1, &m_modelBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_modelBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceAllocator.getCapacity(), nullptr, GL_DYNAMIC_DRAW);
+  glDeleteBuffers(1, &m_materialBuffer);
+  glGenBuffers(1, &m_materialBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_materialBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * m_instanceAllocator.getCapacity(), nullptr, GL_DYNAMIC_DRAW);
+
+  for (auto& itr : m_objects_map) {
+    itr.second.dirtyBegin = 0;
+    itr.second.dirtyEnd = itr.second.objects.size();
+    itr.second.materialsDirty = true;
+  }
+}
 
-    light.setPosition(
-      lightJSON["position"]["x"].get<float>() / SIUnitScaleFactor,
-      lightJSON["position"]["y"].get<float>() / SIUnitScaleFactor,
-      lightJSON["position"]["z"].get<float>() / SIUnitScaleFactor
-    );
+size_t Scene::getModelDataOffset(const InstanceGroup& group) {
+  return sizeof(InstanceData) * m_instanceAllocator.getOffset(group.range);
+}
 
-    light.setColor(
-      lightJSON["color"]["red"].get<float>(),
-      lightJSON["color"]["green"].get<float>(),
-      lightJSON["color"]["blue"].get<float>()
-    );
+// Returns the scale, rotation and position of the object, default.vs builds the model matrix from them
+InstanceData Scene::getInstanceData(Object* obj) {
 
-    light.setIntensity(lightJSON["intensity"].get<float>());
+  InstanceData instance;
+  instance.positionScale = glm::vec4(obj->getPosition() / m_universeScaleFactor, obj->getScale());
+  glm::quat rotation = obj->getRotation();
+  instance.rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+  return instance;
 
-    m_lights.push_back(light);
+}
+
+void Scene::registerObjectToScene(Object* obj) {
+
+  uint64_t instanceGroupKey = getInstanceGroupKey(obj);
+
+  // Make this object's mesh current, its textures were loaded into their arrays with the key
+  MeshManager::getInstance()->bindMesh(obj->getMesh());
 
+  // Determine if a group has been created for these instances
+  auto sameInstances = m_objects_map.find(instanceGroupKey);
+  if (sameInstances == m_objects_map.end()) {
+    // Give this instanceGroup a range of the model buffer
+    InstanceGroup group;
+    group.range = m_instanceAllocator.addRange();
+    group.dirtyBegin = 0;
+    group.dirtyEnd = 0;
+    group.boundingRadius = MeshManager::getInstance()->getBoundingRadius(obj->getMesh());
+    for (unsigned int lod = 0; lod <= MAX_MESH_LODS; lod++) {
+      group.visibleOffset[lod] = 0;
+      group.visibleCount[lod] = 0;
+    }
+    group.clusterOffset = 0;
+    group.clusterCount = 0;
+    group.materialsDirty = false;
+    std::vector<std::string> textures = obj->getTextures();
+    for (size_t map = 0; map < textures.size(); map++) {
+      group.textureArrays.push_back(TextureManager::getInstance()->getTextureArrayLayer(textures[map], (int)map).array);
+    }
+
+    // The object's mesh is bound, followed by whatever coarser versions of it exist
+    MeshManager* meshManager = MeshManager::getInstance();
+    std::vector<unsigned int> bufferInfo = meshManager->getBufferInfo();
+    group.lods.push_back({ bufferInfo[3], bufferInfo[2] });
+    for (std::string lodPath : meshManager->getLodMeshPaths(obj->getMesh())) {
+      if (group.lods.size() == MAX_MESH_LODS) {
+        break;
+      }
+      meshManager->bindMesh(lodPath);
+      bufferInfo = meshManager->getBufferInfo();
+      group.lods.push_back({ bufferInfo[3], bufferInfo[2] });
+    }
+    sameInstances = m_objects_map.emplace(instanceGroupKey, group).first;
+  }
+
+  // Add the instance data (loc, rot, scale) at the end of the group, it's sent to vram with the group's next upload
+  InstanceGroup& group = sameInstances->second;
+  size_t index = group.objects.size();
+  InstanceData instance = getInstanceData(obj);
+  group.objects.push_back(obj);
+  group.instances.push_back(instance);
+  group.materials.push_back(getMaterialId(obj));
+  group.materialsDirty = true;
+  group.bounds.push_back(glm::vec4(instance.positionScale.x, instance.positionScale.y, instance.positionScale.z, instance.positionScale.w * group.boundingRadius));
+  group.dirtyBegin = std::min(group.dirtyBegin, index);
+  group.dirtyEnd = index + 1;
+
+  // Make room for it, re-sending whatever the allocator moved
+  InstanceAllocation allocation = m_instanceAllocator.resize(group.range, group.objects.size());
+  if (allocation == INSTANCE_POOL_RESIZED) {
+    resizeModelBuffer();
+  }
+  else if (allocation == INSTANCE_RANGE_MOVED) {
+    group.dirtyBegin = 0;
   }
 
 }
 
-unsigned int Scene::createModelBuffer() {
-  unsigned int SSBO;
-  glGenBuffers(1, &SSBO);
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO);
-  glBufferData(GL_SHADER_STORAGE_BUFFER, m_numFloatsPerModelData * 1000000 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-  return SSBO;
+// update the scale, rotation and position of the group's objects in its CPU copy, widening the dirty range to those that moved.
+// Objects are split across the thread pool. Note that particles are calculated on the gpu, and their data will be reset by this operation.
+void Scene::updateInstanceGroup(InstanceGroup& group) {
+
+  std::mutex dirtyMutex;
+  ThreadPool::getInstance()->parallelFor(group.objects.size(), 4096, [&](size_t begin, size_t end) {
+    size_t dirtyBegin = end;
+    size_t dirtyEnd = begin;
+    for (size_t i = begin; i < end; i++) {
+      InstanceData instance = getInstanceData(group.objects[i]);
+      if (std::memcmp(&group.instances[i], &instance, sizeof(InstanceData)) != 0) {
+        group.instances[i] = instance;
+        group.bounds[i] = glm::vec4(instance.positionScale.x, instance.positionScale.y, instance.positionScale.z, instance.positionScale.w * group.boundingRadius);
+        dirtyBegin = std::min(dirtyBegin, i);
+        dirtyEnd = i + 1;
+      }
+    }
+    if (dirtyBegin < dirtyEnd) {
+      std::lock_guard<std::mutex> lock(dirtyMutex);
+      group.dirtyBegin = std::min(group.dirtyBegin, dirtyBegin);
+      group.dirtyEnd = std::max(group.dirtyEnd, dirtyEnd);
+    }
+  });
+
 }
 
-// Returns the scale, rotation and translation of the object
-std::vector<glm::mat4> Scene::getModelMatrices(Object* obj) {
+// Sends the group's dirty range to vram in one transfer, and its materials when objects were added or moved
+void Scene::uploadInstanceGroup(InstanceGroup& group) {
 
-  glm::mat4 scale = glm::mat4(1.0);
-  scale = glm::scale(scale, glm::vec3(obj->getScale()));
-  glm::mat4 rotation = obj->getRotationMat();
-  glm::mat4 translation = glm::mat4(1.0f);
-  translation = glm::translate(translation, obj->getPosition() / m_universeScaleFactor);
+  if (group.materialsDirty) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_materialBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(uint32_t) * m_instanceAllocator.getOffset(group.range), sizeof(uint32_t) * group.materials.size(), group.materials.data());
+    group.materialsDirty = false;
+  }
 
-  return { scale, rotation, translation };
+  if (group.dirtyBegin >= group.dirtyEnd) {
+    return;
+  }
 
-}
+  glBindBuffer(GL_ARRAY_BUFFER, m_modelBuffer);
+  glBufferSubData(GL_ARRAY_BUFFER, getModelDataOffset(group) + sizeof(InstanceData) * group.dirtyBegin, sizeof(InstanceData) * (group.dirtyEnd - group.dirtyBegin), &group.instances[group.dirtyBegin]);
 
-void Scene::registerObjectToScene(Object* obj) {
+  group.dirtyBegin = group.objects.size();
+  group.dirtyEnd = 0;
 
-  std::string instanceGroupKey = getInstanceGroupKey(obj);
+}
 
-  // Make this object's VAO the current context
-  obj->bind();
+// Culls a large group through a screen space cut of its octree, so the bodies and splats it leaves scale with the
+// resolution rather than the number of bodies. Bodies in the cut are appended to m_culledIndices and cells to
+// m_clusterCells when they intersect the frustum. The tree is refit when instances moved, like the BVH.
+void Scene::cutInstanceGroup(InstanceGroup& group, const glm::vec4 frustumPlanes[6], glm::vec3 eye, float pixelsPerUnit) {
+
+  size_t movedBegin = group.dirtyBegin;
+  size_t movedEnd = group.dirtyEnd;
+  const bool added = group.clusterPositions.size() != group.objects.size();
+  if (added) {
+    group.clusterPositions.resize(group.objects.size());
+    group.clusterWeights.assign(group.objects.size(), 1.0f);
+    movedBegin = 0;
+    movedEnd = group.objects.size();
+  }
+  for (size_t i = movedBegin; i < movedEnd; i++) {
+    group.clusterPositions[i] = glm::vec3(group.bounds[i].x, group.bounds[i].y, group.bounds[i].z);
+  }
+  if (added) {
+    group.clusterTree.build(group.clusterPositions, group.clusterWeights);
+  }
+  else if (movedBegin < movedEnd) {
+    group.clusterTree.refit();
+    if (group.clusterTree.needsRebuild()) {
+      group.clusterTree.build(group.clusterPositions, group.clusterWeights);
+    }
+  }
 
-  // Get the modelData (loc, rot, scale)
-  std::vector<glm::mat4> modelData = getModelMatrices(obj);
+  m_cutBodies.clear();
+  group.clusterTree.collectRenderCut(eye, Config::getInstance()->getClusterPixelSize() / pixelsPerUnit, m_clusterCells, m_cutBodies);
+  for (int body : m_cutBodies) {
+    if (InstanceBVH::intersectsFrustum(frustumPlanes, group.bounds[body])) {
+      m_culledIndices.push_back(body);
+    }
+  }
 
-  // Determine if an SSBO has been created for these instances
-  auto const& sameInstances = m_objects_map.find(instanceGroupKey);
-  unsigned int offset = 0;
-  unsigned int SSBO;
+  // Cells were appended past this frame's earlier groups, keep the visible ones in place
+  size_t kept = group.clusterOffset;
+  for (size_t i = group.clusterOffset; i < m_clusterCells.size(); i++) {
+    const OctreeCell& cell = m_clusterCells[i];
+    if (InstanceBVH::intersectsFrustum(frustumPlanes, glm::vec4(cell.centerOfMass, cell.radius))) {
+      m_clusterCells[kept++] = cell;
+    }
+  }
+  m_clusterCells.resize(kept);
+  group.clusterCount = kept - group.clusterOffset;
 
-  if (sameInstances == m_objects_map.end()) {
+}
 
-    // setup an ssbo for this instanceGroup
-    SSBO = createModelBuffer();
-    std::unordered_map<Object*, unsigned int> modelBufferInfo;
-    modelBufferInfo[obj] = 0;
+// Appends the group's instances that intersect the view frustum to m_visibleIndices, sorted by the level of detail
+// their projected radius calls for. The BVH is refit when instances moved and rebuilt when objects were added or
+// refitting has loosened it too much.
+void Scene::cullInstanceGroup(InstanceGroup& group, const glm::vec4 frustumPlanes[6], const glm::mat4& view, glm::vec3 eye, float pixelsPerUnit) {
 
-    m_objects_map[instanceGroupKey] = std::make_pair(SSBO, modelBufferInfo);
+  // Particles are already single quads moved on the gpu, so they skip the impostors and clusters.
+  Config* config = Config::getInstance();
+  const bool particles = group.objects[0]->isParticle();
+  m_culledIndices.clear();
+  group.clusterOffset = m_clusterCells.size();
+  group.clusterCount = 0;
 
+  if (!particles && group.objects.size() >= config->getClusterMinimumBodies()) {
+    cutInstanceGroup(group, frustumPlanes, eye, pixelsPerUnit);
   }
   else {
-    // Determine the ssbo and offset for this object
-    SSBO = sameInstances->second.first;
-    offset = sameInstances->second.second.size() * m_numFloatsPerModelData;
-    sameInstances->second.second[obj] = offset;
-  }
-
-  // Send the data to the vram
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO);
-  glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * offset, sizeof(glm::mat4) * modelData.size(), &modelData[0]);
-
-  // Set Dynamic attributes for each instance
-  glBindBuffer(GL_ARRAY_BUFFER, SSBO);
-  glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 4 * 4)));
-  glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 3 * 4)));
-  glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 2 * 4)));
-  glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 1 * 4)));
-  glVertexAttribDivisor(4, 1);
-  glVertexAttribDivisor(5, 1);
-  glVertexAttribDivisor(6, 1);
-  glVertexAttribDivisor(7, 1);
-
-  glEnableVertexAttribArray(4);
-  glEnableVertexAttribArray(5);
-  glEnableVertexAttribArray(6);
-  glEnableVertexAttribArray(7);
+    if (group.bvh.getCount() != group.objects.size()) {
+      group.bvh.build(group.bounds.data(), group.bounds.size());
+    }
+    else if (group.dirtyBegin < group.dirtyEnd) {
+      group.bvh.refit(group.bounds.data());
+      if (group.bvh.needsRebuild()) {
+        group.bvh.build(group.bounds.data(), group.bounds.size());
+      }
+    }
+    group.bvh.cull(frustumPlanes, group.bounds.data(), m_culledIndices);
+  }
+
+  // Pick each visible instance's level from its radius in pixels at its distance from the camera.
+  const float lodPixelRadius = config->getMeshLodPixelRadius();
+  const float impostorPixelRadius = particles ? 0.0f : config->getImpostorPixelRadius();
+  const unsigned int coarsestLod = group.lods.size() - 1;
+  size_t counts[MAX_MESH_LODS + 1] = { 0 };
+  m_culledLods.resize(m_culledIndices.size());
+  for (size_t i = 0; i < m_culledIndices.size(); i++) {
+    const glm::vec4& sphere = group.bounds[m_culledIndices[i]];
+    float distance = glm::length(glm::vec3(view * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f)));
+    float pixelRadius = distance > sphere.w ? sphere.w * pixelsPerUnit / distance : INFINITY;
+
+    unsigned int lod = 0;
+    if (pixelRadius < impostorPixelRadius) {
+      lod = IMPOSTOR_LOD;
+    }
+    else {
+      for (float threshold = lodPixelRadius; lod < coarsestLod && pixelRadius < threshold; threshold /= 4.0f) {
+        lod++;
+      }
+    }
+    m_culledLods[i] = lod;
+    counts[lod]++;
+  }
+
+  // Counting sort into this group's part of m_visibleIndices, offset to the group's range of the model buffer
+  const uint32_t modelOffset = m_instanceAllocator.getOffset(group.range);
+  size_t offset = m_visibleIndices.size();
+  size_t next[MAX_MESH_LODS + 1];
+  for (unsigned int lod = 0; lod <= MAX_MESH_LODS; lod++) {
+    group.visibleOffset[lod] = offset;
+    group.visibleCount[lod] = counts[lod];
+    next[lod] = offset;
+    offset += counts[lod];
+  }
+  m_visibleIndices.resize(offset);
+  for (size_t i = 0; i < m_culledIndices.size(); i++) {
+    m_visibleIndices[next[m_culledLods[i]]++] = modelOffset + m_culledIndices[i];
+  }
 
 }
 
-// update the scale, rotation and position of an object in the scene.
-// Note that particles are calculated on the gpu, and their data will be reset by this operation.
-void Scene::updateObjectInScene(Object* obj) {
+// Sends every group's visible indices in one transfer, growing the buffer when needed
+void Scene::uploadVisibleIndices() {
+
+  if (m_visibleIndices.empty()) {
+    return;
+  }
 
-  std::string instanceGroupKey = getInstanceGroupKey(obj);
+  glBindBuffer(GL_ARRAY_BUFFER, m_visibleBuffer);
+  if (m_visibleIndices.size() > m_visibleBufferCapacity) {
+    m_visibleBufferCapacity = std::max(m_visibleIndices.size(), 2 * m_visibleBufferCapacity);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * m_visibleBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(uint32_t) * m_visibleIndices.size(), m_visibleIndices.data());
 
-  // Make the object's context current
-  bindObjectWithModelMatrix(obj);
+}
 
-  std::vector<glm::mat4> modelData = getModelMatrices(obj);
+// Sends the materials when objects brought new ones
+void Scene::uploadMaterials() {
 
-  // Find the offset of the object within the SSBO
-  auto const& groupedInstances = m_objects_map[instanceGroupKey];
-  unsigned int SSBO = groupedInstances.first;
-  unsigned int SSBO_OFFSET = sizeof(float) * groupedInstances.second.at(obj);
+  if (!m_materialsDirty) {
+    return;
+  }
 
-  // Upload the new data to vram
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO);
-  glBufferSubData(GL_SHADER_STORAGE_BUFFER, SSBO_OFFSET, sizeof(glm::mat4) * modelData.size(), &modelData[0]);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialDataBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MaterialData) * m_materials.size(), m_materials.data(), GL_STATIC_DRAW);
+  m_materialsDirty = false;
 
 }
 
-void Scene::bindObjectWithModelMatrix(Object* obj) {
+// Sends every group's cluster splats in one transfer, growing the buffer when needed
+void Scene::uploadClusters() {
 
-  obj->bind();
+  if (m_clusterCells.empty()) {
+    return;
+  }
 
-  // Set vertex attribute for model matrix instances
-  unsigned int SSBO = m_objects_map[getInstanceGroupKey(obj)].first;
-  glBindBuffer(GL_ARRAY_BUFFER, SSBO);
-  glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 4 * 4)));
-  glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 3 * 4)));
-  glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 2 * 4)));
-  glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(float) * m_numFloatsPerModelData, (void*)(sizeof(float) * (m_numFloatsPerModelData - 1 * 4)));
+  glBindBuffer(GL_ARRAY_BUFFER, m_clusterBuffer);
+  if (m_clusterCells.size() > m_clusterBufferCapacity) {
+    m_clusterBufferCapacity = std::max(m_clusterCells.size(), 2 * m_clusterBufferCapacity);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(OctreeCell) * m_clusterBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(OctreeCell) * m_clusterCells.size(), m_clusterCells.data());
 
 }
 
-void Scene::render() {
+// Turns every group's visible levels of detail into indirect commands, sorted so that draws with the same shader and
+// texture arrays are consecutive and each run of them becomes one batch. Meshes are ignored, they all live in one
+// vertex buffer, and materials are read per instance.
+void Scene::buildDrawBatches() {
+
+  const uint64_t idBits = 21;
+  const uint64_t meshMask = ((1ull << idBits) - 1) << idBits;
+  const uint64_t textureArraysMask = (1ull << idBits) - 1;
+  const uint64_t impostorBit = 1ull << 63; // Above the three ids, impostors share a shader whatever the group's is
+
+  m_pendingDraws.clear();
+  for (auto const& itr : m_objects_map) {
+    auto const& group = itr.second;
+    for (unsigned int lod = 0; lod < group.lods.size(); lod++) {
+      if (group.visibleCount[lod] != 0) {
+        m_pendingDraws.push_back({ itr.first & ~meshMask, &group, lod });
+      }
+    }
+    if (group.visibleCount[IMPOSTOR_LOD] != 0) {
+      m_pendingDraws.push_back({ impostorBit | (itr.first & textureArraysMask), &group, IMPOSTOR_LOD });
+    }
+  }
+  std::sort(m_pendingDraws.begin(), m_pendingDraws.end(), [](const PendingDraw& a, const PendingDraw& b) { return a.batchKey < b.batchKey; });
+
+  m_drawCommands.clear();
+  m_drawData.clear();
+  m_drawBatches.clear();
+  for (size_t i = 0; i < m_pendingDraws.size(); i++) {
+    const PendingDraw& draw = m_pendingDraws[i];
+    const InstanceGroup& group = *draw.group;
+    const bool impostors = draw.lod == IMPOSTOR_LOD;
+    if (i == 0 || draw.batchKey != m_pendingDraws[i - 1].batchKey) {
+      m_drawBatches.push_back({ &group, impostors, m_drawCommands.size(), 0 });
+    }
+    m_drawBatches.back().drawCount++;
+
+    // Impostors are one point per instance
+    uint32_t drawIndex = m_drawCommands.size();
+    if (impostors) {
+      m_drawCommands.push_back({ 1, (uint32_t)group.visibleCount[draw.lod], 0, drawIndex });
+    }
+    else {
+      m_drawCommands.push_back({ group.lods[draw.lod].vertexCount, (uint32_t)group.visibleCount[draw.lod], group.lods[draw.lod].firstVertex, drawIndex });
+    }
+    m_drawData.push_back({ (uint32_t)group.visibleOffset[draw.lod] });
+  }
+
+}
+
+// Sends the commands and their data in one transfer each, growing the buffers when needed
+void Scene::uploadDraws() {
+
+  if (m_drawCommands.empty()) {
+    return;
+  }
+
+  if (m_drawCommands.size() > m_drawBufferCapacity) {
+    m_drawBufferCapacity = std::max(m_drawCommands.size(), 2 * m_drawBufferCapacity);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * m_drawBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawData) * m_drawBufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+
+    std::vector<uint32_t> drawIds(m_drawBufferCapacity);
+    for (uint32_t i = 0; i < drawIds.size(); i++) {
+      drawIds[i] = i;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * drawIds.size(), drawIds.data(), GL_STATIC_DRAW);
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawCommand) * m_drawCommands.size(), m_drawCommands.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawData) * m_drawData.size(), m_drawData.data());
+
+}
+
+// Binds the batch's shader and texture arrays. Bodies below a pixel or so are drawn as round point sprites with the
+// average colour of their maps, see impostor.vs
+void Scene::bindDrawBatch(const DrawBatch& batch, float pixelsPerUnit) {
 
-  // Get shaderProgram
   ShaderManager* shaderManager = ShaderManager::getInstance();
-  MeshManager* meshManager = MeshManager::getInstance();
+  if (batch.impostors) {
+    shaderManager->bindShader("../assets/shaders/impostor.vs", "../assets/shaders/impostor.fs");
+    glUniform1f(glGetUniformLocation(shaderManager->getBoundShader(), "pixelsPerUnit"), pixelsPerUnit);
+  }
+  else {
+    auto shaders = batch.group->objects[0]->getShaders();
+    shaderManager->bindShader(shaders.first, shaders.second);
+  }
+  TextureManager::getInstance()->bindTextureArrays(batch.group->textureArrays);
+
+}
+
+// Distant clusters are drawn as soft splats with the light of the bodies they hold, see cluster.vs
+void Scene::bindClusters(const InstanceGroup& group, float pixelsPerUnit) {
+
+  ShaderManager* shaderManager = ShaderManager::getInstance();
+  shaderManager->bindShader("../assets/shaders/cluster.vs", "../assets/shaders/cluster.fs");
+  glUniform1f(glGetUniformLocation(shaderManager->getBoundShader(), "pixelsPerUnit"), pixelsPerUnit);
+
+  // Clusters take the colour of the group's first body
+  glUniform1ui(glGetUniformLocation(shaderManager->getBoundShader(), "material"), group.materials[0]);
+  TextureManager::getInstance()->bindTextureArrays(group.textureArrays);
+
+  glBindVertexArray(m_clusterVAO);
+
+}
+
+void Scene::render() {
+  TRACE_SCOPE("Scene::render");
 
   // Get view projection for the entire draw call
   glm::mat4 view = m_camera.getViewTransform();
@@ -271,44 +623,88 @@ void Scene::render() {
   glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4) + sizeof(float) * 3, sizeof(unsigned int), &numOfLights);
   glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4) + sizeof(float) * 4, sizeof(float) * lightData.size(), &(lightData[0]));
 
-  // Loop through the groups, then calculate their model matrices and render
-  for (auto const& itr : m_objects_map) {
+  // Only instances in the view frustum are drawn, with meshes as detailed as their size on screen needs
+  glm::vec4 frustumPlanes[6];
+  InstanceBVH::getFrustumPlanes(projection * view, frustumPlanes);
+  const float pixelsPerUnit = projection[1][1] * SCR_HEIGHT / 2.0f; // Pixels covered by a unit length at unit distance
+  const glm::vec3 eye = m_camera.getCameraPosition();
+  m_visibleIndices.clear();
+  m_clusterCells.clear();
 
-    auto const& instanceGroupKey = itr.first;
-    auto const& groupedInstances = itr.second;
-    unsigned int SSBO = groupedInstances.first;
-    auto const& objs = groupedInstances.second;
+  // Loop through the groups, update their instances and find the visible ones
+  for (auto& itr : m_objects_map) {
 
-    auto const& objsItr = objs.begin();
-    Object* instance = objsItr->first;
+    auto& group = itr.second;
+    PerfScope perfScope(PERF_MODEL_MATRICES);
 
-    // Update vram if the object is not a particles
-    if (!instance->isParticle()) {
-      for (const auto& itr : objs) {
-        updateObjectInScene(itr.first);
+    // Update the model data if the object is not a particles, then send what changed (or was just registered) to vram
+    if (!group.objects[0]->isParticle()) {
+      updateInstanceGroup(group);
+    }
+    cullInstanceGroup(group, frustumPlanes, view, eye, pixelsPerUnit);
+    uploadInstanceGroup(group);
+
+  }
+  uploadVisibleIndices();
+  uploadClusters();
+
+  uploadMaterials();
+  buildDrawBatches();
+  uploadDraws();
+
+  // Then render them, one multi draw per shader and set of texture arrays
+  PerfScope perfScope(PERF_SCENE_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_materialBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_materialDataBuffer);
+  if (!m_drawCommands.empty()) {
+
+    // Every batch reads the same buffers. Attribute 4 gives each draw its baseInstance: a divisor no instance count
+    // reaches keeps it on the first element, which the commands offset to their own index.
+    glBindVertexArray(MeshManager::getInstance()->getSharedVAO());
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glVertexAttribDivisor(4, 0xFFFFFFFFu);
+    glEnableVertexAttribArray(4);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_modelBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_drawDataBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_visibleBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+
+    for (const DrawBatch& batch : m_drawBatches) {
+      bindDrawBatch(batch, pixelsPerUnit);
+      if (batch.impostors) {
+        glEnable(GL_PROGRAM_POINT_SIZE);
+      }
+      glMultiDrawArraysIndirect(batch.impostors ? GL_POINTS : GL_TRIANGLES, (void*)(sizeof(DrawCommand) * batch.firstDraw), batch.drawCount, 0);
+      if (batch.impostors) {
+        glDisable(GL_PROGRAM_POINT_SIZE);
       }
     }
 
-    // Bind and calculate the model matrix for all objects in this instanceGroup
-    unsigned int workerGroupSize = 1;
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, SSBO);
-    shaderManager->bindComputeShader("../assets/shaders/compute/calculateModel.comp");
-    glDispatchCompute(objs.size(), 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-    // Bind an instance's shader,mesh,mat
-    bindObjectWithModelMatrix(instance);
-    
-    // Render
-    std::vector<unsigned int> bufferInfo = meshManager->getBufferInfo();
-    const unsigned int numVertices = bufferInfo[2];
-    glDrawArraysInstanced(GL_TRIANGLES, 0, numVertices, objs.size());
+  }
 
+  // Splats add up light over what is already drawn, without hiding each other
+  if (!m_clusterCells.empty()) {
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+    for (auto& itr : m_objects_map) {
+      auto const& group = itr.second;
+      if (group.clusterCount != 0) {
+        bindClusters(group, pixelsPerUnit);
+        glDrawArrays(GL_POINTS, group.clusterOffset, group.clusterCount);
+      }
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
   }
 
 }
 
 void Scene::renderSkybox() {
+  TRACE_SCOPE("Scene::renderSkybox");
 
   Config* config = Config::getInstance();
 
@@ -2,11 +2,28 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <cstdint>
 #include "../physics/system.h"
 #include "../graphics/light/light.h"
 #include "../camera/camera.h"
 #include "GLFW/glfw3.h"
 #include "../graphics/skybox/skybox.h"
+#include "instanceAllocator.h"
+#include "instanceBVH.h"
+#include "../physics/octree.h"
+#include "../graphics/texture/textureManager.h"
+
+// Per instance record read by default.vs, which builds the model matrix from it
+struct InstanceData {
+  glm::vec4 positionScale; // Position in render units, uniform scale in w
+  glm::vec4 rotation; // Quaternion as (x, y, z, w)
+};
+
+// An object's maps as layers of the texture arrays its group binds, read by the shaders through each instance's material
+struct MaterialData {
+  glm::vec4 textureStrengths; // Diffuse, normal, specular and emissive, 0 for missing maps
+  int32_t layers[4]; // Layer of each map in the group's texture arrays
+};
 
 class Scene {
   private:
@@ -22,15 +39,110 @@ class Scene {
     float m_specularStrength;
     float m_phongExponent;
 
-    unsigned int m_numFloatsPerModelData;
-    // The m_objects_map contains all objects registered to render in the scene, as well as their offset in the modelBuffer
-    // [ groupInstanceKey (shader+mesh+material) ] -> std::pair< SSBO, uMap< Object*, SSBO_ID > >
-    std::unordered_map< std::string, 
-      std::pair< 
-        unsigned int, 
-        std::unordered_map<Object*, unsigned int> 
-      > 
-    > m_objects_map;
+    // A mesh an instance group can be drawn with, as a range of MeshManager's shared vertex buffer
+    struct MeshLod {
+      unsigned int firstVertex;
+      unsigned int vertexCount;
+    };
+    static const unsigned int MAX_MESH_LODS = 4;
+    static const unsigned int IMPOSTOR_LOD = MAX_MESH_LODS; // Visible instance slot of the bodies drawn as point sprites
+
+    // Objects sharing a shader, mesh and texture arrays, drawn with one indirect command per level of detail.
+    // Objects whose maps are layers of the same arrays share a group whatever their materials.
+    struct InstanceGroup {
+      unsigned int range; // The group's part of m_modelBuffer, from m_instanceAllocator
+      std::vector<Object*> objects; // objects[i]'s InstanceData is at index i of the range
+      std::vector<InstanceData> instances; // CPU copy of the range
+      std::vector<uint32_t> materials; // Index in m_materials of each instance, stored at the same indices of m_materialBuffer
+      bool materialsDirty;
+      std::vector<int> textureArrays; // TextureManager array of each map, -1 for none
+      size_t dirtyBegin; // Range of objects whose model data changed since the last upload
+      size_t dirtyEnd;
+      float boundingRadius; // Of the mesh at scale 1
+      std::vector<glm::vec4> bounds; // Bounding sphere of each instance (center, radius)
+      InstanceBVH bvh;
+      std::vector<MeshLod> lods; // The object's mesh, then its coarser levels of detail
+      // This frame's visible instances drawn with lods[i] are m_visibleIndices[visibleOffset[i], visibleOffset[i] + visibleCount[i]),
+      // as indices into the whole model buffer
+      size_t visibleOffset[MAX_MESH_LODS + 1];
+      size_t visibleCount[MAX_MESH_LODS + 1];
+      // Groups of at least Config's cluster minimum bodies are culled through a cut of an octree over their instances
+      // instead of the BVH, and its distant cells are drawn as splats
+      Octree clusterTree;
+      std::vector<glm::vec3> clusterPositions; // Instance centers, what clusterTree refers to
+      std::vector<float> clusterWeights; // 1 per instance, so a cell's mass is the number of bodies in it
+      // This frame's splats are m_clusterCells[clusterOffset, clusterOffset + clusterCount)
+      size_t clusterOffset;
+      size_t clusterCount;
+    };
+
+    // Shader pairs, meshes, texture array sets and materials are interned to ids when an object is registered,
+    // so the render loop never builds or hashes their paths
+    std::unordered_map<std::string, uint32_t> m_shaderIds;
+    std::unordered_map<std::string, uint32_t> m_meshIds;
+    std::unordered_map<std::string, uint32_t> m_textureArraysIds;
+    std::unordered_map<std::string, uint32_t> m_materialIds;
+
+    // Every distinct set of layers and strengths, indexed by the instances' materials
+    std::vector<MaterialData> m_materials;
+    bool m_materialsDirty;
+    unsigned int m_materialDataBuffer;
+
+    // The m_objects_map contains all objects registered to render in the scene
+    // [ groupInstanceKey (shader id, mesh id, texture arrays id) ] -> InstanceGroup
+    std::unordered_map<uint64_t, InstanceGroup> m_objects_map;
+
+    // One buffer holds the InstanceData of every group, sized to the instances registered
+    unsigned int m_modelBuffer;
+    unsigned int m_materialBuffer; // Each instance's material, laid out like m_modelBuffer
+    InstanceAllocator m_instanceAllocator;
+
+    // Indices of the instances left after frustum culling, per group, drawn through an instanced attribute
+    std::vector<uint32_t> m_visibleIndices;
+    std::vector<uint32_t> m_culledIndices; // Scratch for one group before sorting by level of detail
+    std::vector<uint8_t> m_culledLods;
+    unsigned int m_visibleBuffer;
+    size_t m_visibleBufferCapacity;
+
+    // Distant clusters of every group, drawn as points straight from the cells
+    std::vector<OctreeCell> m_clusterCells;
+    std::vector<int> m_cutBodies; // Scratch for one group's bodies left on their own by the cut
+    unsigned int m_clusterVAO;
+    unsigned int m_clusterBuffer;
+    size_t m_clusterBufferCapacity;
+
+    // Layout of glMultiDrawArraysIndirect's commands
+    struct DrawCommand {
+      uint32_t count;
+      uint32_t instanceCount;
+      uint32_t first;
+      uint32_t baseInstance; // The draw's index, read by the shaders as a stand in for gl_DrawID
+    };
+    // Per draw parameters, read by default.vs and impostor.vs by the draw's index
+    struct DrawData {
+      uint32_t visibleOffset; // The draw's instances start at m_visibleIndices[visibleOffset]
+    };
+    // Consecutive draws with the same shader and texture arrays, submitted with one glMultiDrawArraysIndirect
+    struct DrawBatch {
+      const InstanceGroup* group; // Whose shader (unless impostors) and texture arrays the batch binds
+      bool impostors;
+      size_t firstDraw;
+      size_t drawCount;
+    };
+    // A group's level of detail with visible instances, sorted by its batch before the commands are written
+    struct PendingDraw {
+      uint64_t batchKey;
+      const InstanceGroup* group;
+      unsigned int lod;
+    };
+    std::vector<PendingDraw> m_pendingDraws;
+    std::vector<DrawCommand> m_drawCommands;
+    std::vector<DrawData> m_drawData;
+    std::vector<DrawBatch> m_drawBatches;
+    unsigned int m_drawCommandBuffer;
+    unsigned int m_drawDataBuffer;
+    unsigned int m_drawIdBuffer; // 0, 1, 2, ... read through the commands' baseInstance
+    size_t m_drawBufferCapacity;
 
     System m_physicsSystem;
     float m_universeScaleFactor; // Used to scale the distance between objects in scene.
@@ -38,12 +150,23 @@ class Scene {
 
     void genUniformBuffer();
     unsigned int getUBOSize();
-    std::string getInstanceGroupKey(Object* obj);
-    unsigned int createModelBuffer();
-    std::vector<glm::mat4> getModelMatrices(Object* obj);
+    uint64_t getInstanceGroupKey(Object* obj);
+    uint32_t getMaterialId(Object* obj);
+    void uploadMaterials();
+    void resizeModelBuffer();
+    size_t getModelDataOffset(const InstanceGroup& group); // Bytes
+    InstanceData getInstanceData(Object* obj);
     void registerObjectToScene(Object* obj);
-    void updateObjectInScene(Object* obj);
-    void bindObjectWithModelMatrix(Object* obj);
+    void updateInstanceGroup(InstanceGroup& group);
+    void uploadInstanceGroup(InstanceGroup& group);
+    void cullInstanceGroup(InstanceGroup& group, const glm::vec4 frustumPlanes[6], const glm::mat4& view, glm::vec3 eye, float pixelsPerUnit);
+    void cutInstanceGroup(InstanceGroup& group, const glm::vec4 frustumPlanes[6], glm::vec3 eye, float pixelsPerUnit);
+    void uploadVisibleIndices();
+    void uploadClusters();
+    void buildDrawBatches();
+    void uploadDraws();
+    void bindDrawBatch(const DrawBatch& batch, float pixelsPerUnit);
+    void bindClusters(const InstanceGroup& group, float pixelsPerUnit);
 
   public:
     Scene(GLFWwindow* window);
@@ -0,0 +1,97 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <cmath>
+#include "../physics/diagnostics.h"
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+
+TEST_CASE("Conservation sample of a circular two body orbit") {
+	// Equal masses orbiting their centre of mass: v^2 = G m / (4 r) at radius r
+	const float G = 1.0f, m = 2.0f, r = 1.0f;
+	const float v = std::sqrt(G * m / (4 * r));
+	Snapshot snapshot;
+	snapshot.resize(2);
+	snapshot.masses = { m, m };
+	snapshot.positions = { glm::vec3(-r, 0, 0), glm::vec3(r, 0, 0) };
+	snapshot.velocities = { glm::vec3(0, -v, 0), glm::vec3(0, v, 0) };
+
+	Octree octree;
+	ConservationSample sample = DiagnosticsMonitor::computeSample(snapshot, G, 0.0f, 100, octree);
+	REQUIRE(sample.kineticEnergy == Approx(m * v * v));
+	REQUIRE(sample.potentialEnergy == Approx(-G * m * m / (2 * r)));
+	REQUIRE(sample.virialRatio == Approx(1.0));
+	REQUIRE(glm::length(sample.linearMomentum) == Approx(0.0).margin(1e-9));
+	REQUIRE(sample.angularMomentum.z == Approx(2 * m * v * r));
+}
+
+TEST_CASE("Octree potential energy matches direct summation") {
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = 3000;
+	InitialConditions::generate(&system, parameters);
+	Snapshot snapshot;
+	system.captureSnapshot(snapshot);
+
+	Octree octree;
+	const float G = system.getGravitationalConstant();
+	ConservationSample direct = DiagnosticsMonitor::computeSample(snapshot, G, 1e8f, snapshot.getBodyCount(), octree);
+	ConservationSample tree = DiagnosticsMonitor::computeSample(snapshot, G, 1e8f, 0, octree);
+	REQUIRE(tree.potentialEnergy == Approx(direct.potentialEnergy).epsilon(1e-3));
+	REQUIRE(tree.kineticEnergy == direct.kineticEnergy);
+	REQUIRE(octree.getNodeCount() > snapshot.getBodyCount());
+}
+
+TEST_CASE("Diagnostics monitor samples in the background") {
+	DiagnosticsMonitor monitor;
+	ConservationSample sample;
+	REQUIRE_FALSE(monitor.getLatest(sample));
+
+	monitor.configure(true, 10, 100, "");
+	REQUIRE(monitor.isDue(20));
+	REQUIRE_FALSE(monitor.isDue(21));
+
+	for (int i = 0; i < 2; i++) {
+		Snapshot* buffer = monitor.acquireBuffer();
+		REQUIRE(buffer != nullptr);
+		buffer->resize(2);
+		buffer->step = i;
+		buffer->masses = { 1.0f, 1.0f };
+		buffer->positions = { glm::vec3(0.0f), glm::vec3(1.0f + i, 0.0f, 0.0f) };
+		buffer->velocities = { glm::vec3(0.0f), glm::vec3(0.0f) };
+		monitor.submit(1.0f, 0.0f);
+		monitor.flush();
+	}
+
+	// The first sample is the energy reference: -1 then -0.5
+	REQUIRE(monitor.getLatest(sample));
+	REQUIRE(sample.step == 1);
+	REQUIRE(sample.totalEnergy == Approx(-0.5));
+	REQUIRE(sample.energyDrift == Approx(0.5));
+}
+
+TEST_CASE("Resetting the diagnostics baseline drops the sample in flight") {
+	DiagnosticsMonitor monitor;
+	monitor.configure(true, 1, 100, "");
+
+	// Whether or not the first sample is done when the baseline resets, it must not become the reference
+	for (int i = 0; i < 2; i++) {
+		Snapshot* buffer = monitor.acquireBuffer();
+		REQUIRE(buffer != nullptr);
+		buffer->resize(2);
+		buffer->step = i;
+		buffer->masses = { 1.0f, 1.0f };
+		buffer->positions = { glm::vec3(0.0f), glm::vec3(1.0f + i, 0.0f, 0.0f) };
+		buffer->velocities = { glm::vec3(0.0f), glm::vec3(0.0f) };
+		monitor.submit(1.0f, 0.0f);
+		if (i == 0) {
+			monitor.resetBaseline();
+		}
+		monitor.flush();
+	}
+
+	ConservationSample sample;
+	REQUIRE(monitor.getLatest(sample));
+	REQUIRE(sample.step == 1);
+	REQUIRE(sample.energyDrift == 0.0);
+}
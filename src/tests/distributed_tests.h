@@ -0,0 +1,152 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <thread>
+#include <functional>
+#include "../distributed/loopbackTransport.h"
+#include "../distributed/distributedSystem.h"
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+
+// Runs body(transport) on one thread per rank of a loopback hub
+static void runLoopbackRanks(int size, const std::function<void(Transport*)>& body) {
+	LoopbackHub hub(size);
+	std::vector<LoopbackTransport> transports;
+	for (int rank = 0; rank < size; rank++) {
+		transports.push_back(LoopbackTransport(&hub, rank));
+	}
+	std::vector<std::thread> threads;
+	for (int rank = 0; rank < size; rank++) {
+		threads.push_back(std::thread([&, rank]() { body(&transports[rank]); }));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+TEST_CASE("Loopback transport exchanges, gathers and reduces") {
+	const int size = 3;
+	std::vector<std::vector<int>> exchanged(size);
+	std::vector<std::vector<int>> gathered(size);
+	std::vector<std::vector<double>> reduced(size);
+	runLoopbackRanks(size, [&](Transport* transport) {
+		const int rank = transport->getRank();
+		// Rank r sends r * 10 + destination to every destination
+		std::vector<std::vector<char>> send(size);
+		for (int r = 0; r < size; r++) {
+			packBuffer(std::vector<int>{ rank * 10 + r }, send[r]);
+		}
+		std::vector<std::vector<char>> received;
+		transport->exchange(send, received);
+		for (int r = 0; r < size; r++) {
+			std::vector<int> value;
+			unpackBuffer(received[r], value);
+			exchanged[rank].push_back(value[0]);
+		}
+
+		std::vector<char> own;
+		packBuffer(std::vector<int>(rank + 1, rank), own);
+		transport->allGather(own, received);
+		for (int r = 0; r < size; r++) {
+			gathered[rank].push_back((int)(received[r].size() / sizeof(int)));
+		}
+
+		std::vector<double> values = { 1.0, (double)rank };
+		transport->allReduceSum(values);
+		reduced[rank] = values;
+	});
+
+	for (int rank = 0; rank < size; rank++) {
+		for (int r = 0; r < size; r++) {
+			REQUIRE(exchanged[rank][r] == r * 10 + rank);
+			REQUIRE(gathered[rank][r] == r + 1);
+		}
+		REQUIRE(reduced[rank][0] == 3.0);
+		REQUIRE(reduced[rank][1] == 3.0);
+	}
+}
+
+TEST_CASE("Distributed Barnes-Hut matches direct summation across ranks") {
+	// Reference system, handed out round robin so the first evaluation has to migrate almost every body
+	const size_t bodyCount = 2000;
+	System reference;
+	reference.setSIUnitScaleFactor(1e3f);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = bodyCount;
+	InitialConditions::generate(&reference, parameters);
+
+	const int size = 4;
+	std::vector<size_t> localCounts(size);
+	std::vector<std::vector<DistributedBody>> results(size);
+	std::vector<size_t> globalCounts(size);
+	runLoopbackRanks(size, [&](Transport* transport) {
+		DistributedSystem system(transport);
+		system.setSIUnitScaleFactor(1e3f);
+		system.setTheta(0.5f);
+		system.setThreadCount(1);
+		std::vector<DistributedBody> bodies;
+		for (size_t i = transport->getRank(); i < bodyCount; i += size) {
+			GravBody* body = reference.getBodies()[i];
+			DistributedBody distributedBody;
+			distributedBody.position = body->getPosition();
+			distributedBody.velocity = body->getVelocity();
+			distributedBody.acceleration = glm::vec3(0.0f);
+			distributedBody.mass = body->getMass();
+			distributedBody.work = 1.0f;
+			distributedBody.id = i;
+			bodies.push_back(distributedBody);
+		}
+		system.addBodies(bodies);
+		system.computeAccelerations();
+		localCounts[transport->getRank()] = system.getBodies().size();
+		results[transport->getRank()] = system.getBodies();
+		globalCounts[transport->getRank()] = system.getGlobalBodyCount();
+	});
+
+	// Every body ends up on exactly one rank, and the work is shared out
+	size_t total = 0;
+	for (int rank = 0; rank < size; rank++) {
+		total += localCounts[rank];
+		REQUIRE(globalCounts[rank] == bodyCount);
+		REQUIRE(localCounts[rank] > bodyCount / size / 4);
+	}
+	REQUIRE(total == bodyCount);
+
+	double errorSum = 0.0;
+	for (auto const& rankBodies : results) {
+		for (auto const& body : rankBodies) {
+			glm::dvec3 direct = glm::dvec3(reference.computeDirectAcceleration(body.id));
+			errorSum += glm::length(glm::dvec3(body.acceleration) - direct) / glm::length(direct);
+		}
+	}
+	REQUIRE(errorSum / bodyCount < 1e-2);
+}
+
+TEST_CASE("Distributed steps conserve bodies and momentum") {
+	const int size = 3;
+	std::vector<double> momentumDrift(size);
+	std::vector<size_t> counts(size);
+	runLoopbackRanks(size, [&](Transport* transport) {
+		DistributedSystem system(transport);
+		system.setSIUnitScaleFactor(1e3f);
+		system.setThreadCount(1);
+		InitialConditionParameters parameters;
+		parameters.bodyCount = 600;
+		system.generate(parameters);
+
+		double mass, kineticEnergy;
+		glm::dvec3 before, after;
+		system.computeTotals(mass, kineticEnergy, before);
+		for (int i = 0; i < 5; i++) {
+			system.step(100.0f);
+		}
+		system.computeTotals(mass, kineticEnergy, after);
+		// Relative to the momentum scale M * sqrt(2K / M)
+		momentumDrift[transport->getRank()] = glm::length(after - before) / std::sqrt(2.0 * kineticEnergy * mass);
+		counts[transport->getRank()] = system.getGlobalBodyCount();
+	});
+	for (int rank = 0; rank < size; rank++) {
+		REQUIRE(counts[rank] == 600);
+		REQUIRE(momentumDrift[rank] < 1e-2);
+		REQUIRE(momentumDrift[rank] == momentumDrift[0]);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <cstdio>
+#include "../physics/ensemble.h"
+
+TEST_CASE("Ensemble perturbations are deterministic and only touch the named bodies") {
+	Snapshot base;
+	base.resize(3);
+	for (size_t i = 0; i < 3; i++) {
+		base.masses[i] = 1.0f + i;
+		base.positions[i] = glm::vec3(10.0f * i, 0.0f, 0.0f);
+		base.velocities[i] = glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+	std::vector<std::string> names = { "Sun", "Earth", "Mars" };
+	EnsemblePerturbation perturbation;
+	perturbation.bodies = { "Earth" };
+	perturbation.positionSigma = 1e3;
+	perturbation.velocitySigma = 1e2;
+	std::vector<EnsemblePerturbation> perturbations = { perturbation };
+
+	Snapshot a = base;
+	Snapshot b = base;
+	Snapshot c = base;
+	Ensemble::applyPerturbations(a, names, perturbations, 1e3f, 7);
+	Ensemble::applyPerturbations(b, names, perturbations, 1e3f, 7);
+	Ensemble::applyPerturbations(c, names, perturbations, 1e3f, 8);
+
+	REQUIRE(a.positions == b.positions);
+	REQUIRE(a.velocities == b.velocities);
+	REQUIRE(a.positions[1] != c.positions[1]);
+	REQUIRE(a.positions[1] != base.positions[1]);
+	REQUIRE(a.positions[0] == base.positions[0]);
+	REQUIRE(a.positions[2] == base.positions[2]);
+	REQUIRE(a.masses == base.masses);
+}
+
+TEST_CASE("Ensemble runs perturbed copies of a scene") {
+	// Sun and Earth, member 0 is the unperturbed base
+	const char* scenePath = "ensemble_test_scene.json";
+	{
+		std::ofstream scene(scenePath);
+		scene << R"({ "SIUnitScaleFactor": 1e7, "GravBodies": [
+			{ "name": "Sun", "mass": 1.989e30, "radius": 6.9e8, "position": { "x": 0, "y": 0, "z": 0 }, "velocity": { "x": 0, "y": 0, "z": 0 },
+			  "tilt": 0, "rotationPeriod": 600, "meshFilePath": "sphere.obj", "vertexShaderPath": "default.vs", "fragmentShaderPath": "default.fs" },
+			{ "name": "Earth", "mass": 5.97e24, "radius": 6.4e6, "position": { "x": 1.496e11, "y": 0, "z": 0 }, "velocity": { "x": 0, "y": 0, "z": 29780 },
+			  "tilt": 23.4, "rotationPeriod": 24, "meshFilePath": "sphere.obj", "vertexShaderPath": "default.vs", "fragmentShaderPath": "default.fs" }
+		] })";
+	}
+
+	EnsembleSpec spec;
+	spec.scenePath = scenePath;
+	spec.members = 4;
+	spec.duration = 3.15576e7 / 4;
+	spec.stepSize = 3600.0f;
+	spec.forceMethod = FORCE_NAIVE;
+	EnsemblePerturbation perturbation;
+	perturbation.bodies = { "Earth" };
+	perturbation.velocitySigma = 100.0;
+	spec.perturbations.push_back(perturbation);
+
+	Ensemble ensemble;
+	REQUIRE(ensemble.prepare(spec));
+	ensemble.run();
+	std::vector<EnsembleMemberSummary> summaries = ensemble.getSummaries();
+	REQUIRE(summaries.size() == 4);
+	for (unsigned int i = 0; i < 4; i++) {
+		REQUIRE(summaries[i].member == i);
+		REQUIRE(summaries[i].bodyCount == 2);
+		REQUIRE(summaries[i].steps == 2192);
+		REQUIRE(std::abs(summaries[i].energyDrift) < 1e-3);
+		REQUIRE(summaries[i].ejected == 0);
+	}
+	REQUIRE(summaries[1].initialEnergy != summaries[0].initialEnergy);
+
+	// Same spec, same results
+	Ensemble again;
+	REQUIRE(again.prepare(spec));
+	again.run();
+	for (unsigned int i = 0; i < 4; i++) {
+		REQUIRE(again.getSummaries()[i].finalEnergy == summaries[i].finalEnergy);
+	}
+	std::remove(scenePath);
+}
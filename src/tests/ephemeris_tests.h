@@ -0,0 +1,106 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include "../physics/ephemeris.h"
+#include "../io/ephemerisFile.h"
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+
+TEST_CASE("Ephemeris series evaluate positions and velocities") {
+	Ephemeris ephemeris;
+	ephemeris.reset(100.0, 10.0, 2, 2, 1);
+	std::vector<double>& coefficients = ephemeris.getCoefficients();
+
+	// First interval: x = 1 + T1, y = T2. Second interval: z = 5
+	coefficients[0] = 1.0;
+	coefficients[1] = 1.0;
+	coefficients[5] = 1.0;
+	coefficients[9 + 6] = 5.0;
+
+	glm::vec3 position, velocity;
+	REQUIRE(ephemeris.evaluate(0, 107.5, position, velocity));
+	REQUIRE(position.x == Approx(1.5f));
+	REQUIRE(position.y == Approx(2.0f * 0.25f - 1.0f));
+	REQUIRE(velocity.x == Approx(0.2f));
+	REQUIRE(velocity.y == Approx(4.0f * 0.5f * 0.2f));
+
+	REQUIRE(ephemeris.contains(120.0));
+	REQUIRE_FALSE(ephemeris.contains(120.5));
+	REQUIRE(ephemeris.getPosition(0, 115.0).z == Approx(5.0f));
+	REQUIRE(ephemeris.getPosition(0, 1e9).z == Approx(5.0f));
+	REQUIRE_FALSE(ephemeris.evaluate(1, 100.0, position, velocity));
+
+	const std::string path = "ephemeris_test.eph";
+	REQUIRE(EphemerisFile::write(path, ephemeris));
+	Ephemeris loaded;
+	REQUIRE(EphemerisFile::read(path, loaded));
+	REQUIRE(loaded.getStartTime() == 100.0);
+	REQUIRE(loaded.getEndTime() == 120.0);
+	REQUIRE(loaded.getCoefficients() == coefficients);
+	std::remove(path.c_str());
+}
+
+TEST_CASE("Ephemeris built from a circular two body orbit follows it") {
+	// Equal masses orbiting their centre of mass: v^2 = G m / (4 r) at radius r
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	system.setForceMethod(FORCE_NAIVE);
+	system.setIntegrator(INTEGRATOR_LEAPFROG);
+	const double r = 1e4, m = 1e24;
+	const double v = std::sqrt(system.getGravitationalConstant() * m / (4 * r));
+	const double period = 2.0 * 3.14159265358979 * r / v;
+	for (int side = -1; side <= 1; side += 2) {
+		GravBody* body = new GravBody();
+		body->setMass(m);
+		body->setPosition(side * r, 0.0f, 0.0f);
+		body->setVelocity(0.0f, side * v, 0.0f);
+		system.addBody(body);
+	}
+
+	Ephemeris ephemeris;
+	const unsigned int samplesPerInterval = 16;
+	REQUIRE(ephemeris.build(&system, period, period / 8, 8, samplesPerInterval));
+	REQUIRE(ephemeris.getIntervalCount() == 8);
+	REQUIRE(system.getBodies()[1]->getPosition().x == Approx(r));
+
+	// Step the same integration again and compare at every sample and between them against the circle
+	const float stepSize = (float)(period / 8 / samplesPerInterval);
+	for (int k = 1; k <= 8 * samplesPerInterval; k++) {
+		system.step(stepSize);
+		glm::vec3 integrated = system.getBodies()[1]->getPosition();
+		REQUIRE(glm::length(ephemeris.getPosition(1, k * stepSize) - integrated) < 1e-3 * r);
+
+		double t = (k - 0.5) * stepSize;
+		double angle = 2.0 * 3.14159265358979 * t / period;
+		glm::vec3 circle = glm::vec3(r * std::cos(angle), r * std::sin(angle), 0.0);
+		glm::vec3 position, velocity;
+		REQUIRE(ephemeris.evaluate(1, t, position, velocity));
+		REQUIRE(glm::length(position - circle) < 1e-2 * r);
+		REQUIRE(glm::length(velocity) == Approx(v).epsilon(1e-2));
+	}
+}
+
+TEST_CASE("Building an ephemeris leaves the system's tuner and stats alone") {
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = 200;
+	InitialConditions::generate(&system, parameters);
+	system.getThetaTuner()->configure(true, 5e-3, 1, 32, 0.1f, 1.5f);
+	system.resetStats();
+	Snapshot before;
+	system.captureSnapshot(before);
+
+	Ephemeris ephemeris;
+	REQUIRE(ephemeris.build(&system, 8e6, 4e6, 4, 4));
+
+	// No theta was recorded for the sample steps, so the real run tunes from its own first step
+	float theta = 0.0f;
+	REQUIRE_FALSE(system.getThetaTuner()->getRecordedTheta(0, theta));
+	REQUIRE(system.getTheta() == 1.5f);
+	REQUIRE(system.getStats().forceEvaluations == 0);
+	Snapshot after;
+	system.captureSnapshot(after);
+	REQUIRE(after.step == before.step);
+	REQUIRE(after.positions == before.positions);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../profiling/frameStats.h"
+
+TEST_CASE("Frame stats report percentiles over a rolling window") {
+	FrameStats* frameStats = FrameStats::getInstance();
+	frameStats->setHistoryLength(100);
+
+	// Times within a frame add up, e.g. one model matrix dispatch per instance group
+	for (int frame = 1; frame <= 150; frame++) {
+		frameStats->addCpuTime(PERF_SCENE_DRAW, frame / 2.0);
+		frameStats->addCpuTime(PERF_SCENE_DRAW, frame / 2.0);
+		frameStats->endFrame();
+	}
+
+	// Only the last 100 frames (51..150) remain
+	FramePercentiles stats = frameStats->getCpuPercentiles(PERF_SCENE_DRAW);
+	REQUIRE(stats.sampleCount == 100);
+	REQUIRE(stats.p50 == Approx(100.0f));
+	REQUIRE(stats.p95 == Approx(145.0f));
+	REQUIRE(stats.p99 == Approx(149.0f));
+
+	std::vector<float> history;
+	frameStats->getCpuHistory(PERF_SCENE_DRAW, history);
+	REQUIRE(history.size() == 100);
+	REQUIRE(history.front() == Approx(51.0f));
+	REQUIRE(history.back() == Approx(150.0f));
+
+	// Sections that never ran have no samples
+	REQUIRE(frameStats->getCpuPercentiles(PERF_BLOOM).sampleCount == 0);
+
+	frameStats->addGpuTime(PERF_BLOOM, 2.0);
+	REQUIRE(frameStats->getGpuPercentiles(PERF_BLOOM).p99 == Approx(2.0f));
+
+	frameStats->setHistoryLength(240);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../physics/initialConditions.h"
+#include "../physics/diagnostics.h"
+#include "../threading/threadPool.h"
+
+namespace {
+	const float IC_TEST_G = 6.67430e-11f / (1e3f * 1e3f);
+
+	double virialRatio(const Snapshot& snapshot) {
+		Octree octree;
+		return DiagnosticsMonitor::computeSample(snapshot, IC_TEST_G, 0.0f, snapshot.getBodyCount(), octree).virialRatio;
+	}
+}
+
+TEST_CASE("Generated initial conditions don't depend on the thread count") {
+	InitialConditionParameters parameters;
+	parameters.distribution = DISTRIBUTION_NFW;
+	parameters.bodyCount = 40000; // Several random streams
+	Snapshot single, parallel;
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ parameters }, IC_TEST_G, single, 1);
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ parameters }, IC_TEST_G, parallel, 0);
+	REQUIRE(single.getBodyCount() == 40000);
+	REQUIRE(single.positions == parallel.positions);
+	REQUIRE(single.velocities == parallel.velocities);
+
+	parameters.seed = 2;
+	Snapshot other;
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ parameters }, IC_TEST_G, other);
+	REQUIRE(other.positions != single.positions);
+}
+
+TEST_CASE("Halos are generated close to virial equilibrium") {
+	const Distribution distributions[] = { DISTRIBUTION_PLUMMER, DISTRIBUTION_HERNQUIST, DISTRIBUTION_NFW };
+	for (Distribution distribution : distributions) {
+		InitialConditionParameters parameters;
+		parameters.distribution = distribution;
+		parameters.bodyCount = 3000;
+		Snapshot snapshot;
+		InitialConditions::generate(std::vector<InitialConditionParameters>{ parameters }, IC_TEST_G, snapshot);
+		double ratio = virialRatio(snapshot);
+		INFO(InitialConditions::getDistributionName(distribution) << " virial ratio " << ratio);
+		REQUIRE(ratio > 0.8);
+		REQUIRE(ratio < 1.2);
+	}
+}
+
+TEST_CASE("Belts follow their orbital elements around the central mass") {
+	InitialConditionParameters belt;
+	belt.distribution = DISTRIBUTION_BELT;
+	belt.bodyCount = 2000;
+	belt.totalMass = 1e10f; // Negligible next to the star
+	belt.centralMass = 2e27f;
+	belt.innerRadius = 3e8f;
+	belt.radius = 5e8f;
+	belt.maxEccentricity = 0.2f;
+	Snapshot snapshot;
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ belt }, IC_TEST_G, snapshot);
+	REQUIRE(snapshot.getBodyCount() == 2001);
+	REQUIRE(snapshot.masses[0] == belt.centralMass);
+
+	// Semi-major axis and eccentricity back from the state vectors relative to the star
+	const double mu = (double)IC_TEST_G * belt.centralMass;
+	for (size_t i = 1; i < snapshot.getBodyCount(); i++) {
+		glm::dvec3 r = glm::dvec3(snapshot.positions[i] - snapshot.positions[0]);
+		glm::dvec3 v = glm::dvec3(snapshot.velocities[i] - snapshot.velocities[0]);
+		double energy = 0.5 * glm::dot(v, v) - mu / glm::length(r);
+		REQUIRE(energy < 0.0);
+		double a = -mu / (2.0 * energy);
+		REQUIRE(a > 0.99 * belt.innerRadius);
+		REQUIRE(a < 1.01 * belt.radius);
+		glm::dvec3 h = glm::cross(r, v);
+		double e = std::sqrt(std::max(1.0 - glm::dot(h, h) / (mu * a), 0.0));
+		REQUIRE(e < 0.21);
+	}
+}
+
+TEST_CASE("Disks rotate faster inside a halo") {
+	InitialConditionParameters disk;
+	disk.distribution = DISTRIBUTION_DISK;
+	disk.bodyCount = 1000;
+	InitialConditionParameters halo;
+	halo.distribution = DISTRIBUTION_NFW;
+	halo.bodyCount = 1000;
+	halo.totalMass = 10.0f * disk.totalMass;
+	halo.radius = 2.0f * disk.radius;
+
+	Snapshot alone, embedded;
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ disk }, IC_TEST_G, alone);
+	InitialConditions::generate(std::vector<InitialConditionParameters>{ disk, halo }, IC_TEST_G, embedded);
+	REQUIRE(embedded.getBodyCount() == 2000);
+
+	// The same disk positions, since the disk is the first component with the same seed
+	double aloneSpeed = 0.0, embeddedSpeed = 0.0;
+	for (size_t i = 0; i < 1000; i++) {
+		aloneSpeed += glm::length(alone.velocities[i]);
+		embeddedSpeed += glm::length(embedded.velocities[i]);
+	}
+	REQUIRE(embeddedSpeed > 1.5 * aloneSpeed);
+	REQUIRE(virialRatio(embedded) > 0.7);
+	REQUIRE(virialRatio(embedded) < 1.3);
+}
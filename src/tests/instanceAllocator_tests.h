@@ -0,0 +1,89 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include "../scene/instanceAllocator.h"
+
+namespace {
+	// True when no two sized ranges overlap and all fit in the pool
+	bool instanceRangesAreDisjoint(InstanceAllocator& allocator, std::vector<unsigned int> ranges) {
+		std::vector<std::pair<size_t, size_t>> spans;
+		for (unsigned int range : ranges) {
+			if (allocator.getRangeCapacity(range) > 0) {
+				spans.push_back({ allocator.getOffset(range), allocator.getOffset(range) + allocator.getRangeCapacity(range) });
+			}
+		}
+		std::sort(spans.begin(), spans.end());
+		for (size_t i = 0; i < spans.size(); i++) {
+			if (spans[i].second > allocator.getCapacity() || (i > 0 && spans[i].first < spans[i - 1].second)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST_CASE("Instance ranges grow geometrically within one pool") {
+	InstanceAllocator allocator(64);
+	REQUIRE(allocator.getCapacity() == 0);
+
+	unsigned int stars = allocator.addRange();
+	unsigned int planets = allocator.addRange();
+	REQUIRE(allocator.resize(stars, 1) == INSTANCE_POOL_RESIZED);
+	REQUIRE(allocator.getRangeCapacity(stars) == 64);
+	REQUIRE(allocator.getCapacity() == 128);
+
+	// Fits in the free space after the first range
+	REQUIRE(allocator.resize(planets, 9) == INSTANCE_RANGE_MOVED);
+	REQUIRE(allocator.getOffset(planets) == 64);
+	REQUIRE(instanceRangesAreDisjoint(allocator, { stars, planets }));
+
+	// Adding one instance at a time only reallocates a logarithmic number of times
+	int resizes = 0;
+	for (size_t count = 2; count <= 100000; count++) {
+		InstanceAllocation allocation = allocator.resize(stars, count);
+		if (allocation != INSTANCE_RANGE_UNCHANGED) {
+			resizes++;
+		}
+		REQUIRE(allocator.getRangeCapacity(stars) >= count);
+	}
+	REQUIRE(resizes < 20);
+	REQUIRE(allocator.getRangeCapacity(planets) == 64);
+	REQUIRE(instanceRangesAreDisjoint(allocator, { stars, planets }));
+
+	// The pool tracks what is used, not a fixed worst case per group
+	REQUIRE(allocator.getUsed() == allocator.getRangeCapacity(stars) + allocator.getRangeCapacity(planets));
+	REQUIRE(allocator.getCapacity() <= 4 * allocator.getUsed());
+	REQUIRE(allocator.getCapacity() < 1000000);
+}
+
+TEST_CASE("Instance pool compacts when ranges shrink or go away") {
+	InstanceAllocator allocator(64);
+	std::vector<unsigned int> ranges;
+	for (int i = 0; i < 12; i++) {
+		ranges.push_back(allocator.addRange());
+		allocator.resize(ranges.back(), 1000 * (i + 1));
+	}
+	REQUIRE(instanceRangesAreDisjoint(allocator, ranges));
+	size_t fullCapacity = allocator.getCapacity();
+
+	// Small changes keep their ranges in place
+	REQUIRE(allocator.resize(ranges[3], 3500) == INSTANCE_RANGE_UNCHANGED);
+
+	bool compacted = false;
+	for (int i = 0; i < 11; i++) {
+		compacted |= allocator.removeRange(ranges[i]) == INSTANCE_POOL_RESIZED;
+	}
+	REQUIRE(compacted);
+	REQUIRE(allocator.getRangeCapacity(ranges[11]) >= 12000);
+	REQUIRE(allocator.getCapacity() <= 4 * allocator.getUsed());
+	REQUIRE(allocator.getCapacity() <= fullCapacity / 4);
+
+	REQUIRE(allocator.resize(ranges[11], 10) == INSTANCE_POOL_RESIZED);
+	REQUIRE(allocator.getOffset(ranges[11]) == 0);
+	REQUIRE(allocator.getRangeCapacity(ranges[11]) == 64);
+	REQUIRE(allocator.getCapacity() == 128);
+
+	REQUIRE(allocator.removeRange(ranges[11]) == INSTANCE_POOL_RESIZED);
+	REQUIRE(allocator.getCapacity() == 0);
+	REQUIRE(allocator.getUsed() == 0);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <random>
+#include "../scene/instanceBVH.h"
+
+namespace {
+	std::vector<uint32_t> cullByBruteForce(const glm::vec4 planes[6], const std::vector<glm::vec4>& spheres) {
+		std::vector<uint32_t> visible;
+		for (uint32_t i = 0; i < spheres.size(); i++) {
+			bool intersects = true;
+			for (int p = 0; p < 6; p++) {
+				intersects = intersects && glm::dot(glm::vec3(planes[p].x, planes[p].y, planes[p].z), glm::vec3(spheres[i].x, spheres[i].y, spheres[i].z)) + planes[p].w >= -spheres[i].w;
+			}
+			if (intersects) {
+				visible.push_back(i);
+			}
+		}
+		return visible;
+	}
+
+	std::vector<uint32_t> cullSorted(InstanceBVH& bvh, const glm::vec4 planes[6], const std::vector<glm::vec4>& spheres) {
+		std::vector<uint32_t> visible;
+		bvh.cull(planes, spheres.data(), visible);
+		std::sort(visible.begin(), visible.end());
+		return visible;
+	}
+}
+
+TEST_CASE("Frustum culling through the BVH matches testing every instance") {
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> radius(0.01f, 0.5f);
+	std::vector<glm::vec4> spheres(20000);
+	for (auto& sphere : spheres) {
+		sphere = glm::vec4(position(rng), position(rng), position(rng), radius(rng));
+	}
+
+	// The frustum of an identity matrix is the [-1, 1] cube, this one is [-3, 1] x [-2, 2] x [1, 3]
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	viewProjection[0][0] = 0.5f;
+	viewProjection[3][0] = 0.5f;
+	viewProjection[1][1] = 0.5f;
+	viewProjection[3][2] = -2.0f;
+	glm::vec4 planes[6];
+	InstanceBVH::getFrustumPlanes(viewProjection, planes);
+	REQUIRE(planes[0].x == Approx(1.0f));
+	REQUIRE(planes[0].w == Approx(3.0f));
+
+	InstanceBVH bvh;
+	bvh.build(spheres.data(), spheres.size());
+	REQUIRE(bvh.getCount() == spheres.size());
+	std::vector<uint32_t> expected = cullByBruteForce(planes, spheres);
+	REQUIRE(expected.size() > 100);
+	REQUIRE(expected.size() < spheres.size() / 10);
+	REQUIRE(cullSorted(bvh, planes, spheres) == expected);
+
+	// Refitting keeps culling exact after the instances move, and small moves don't call for a rebuild
+	for (auto& sphere : spheres) {
+		sphere.x += 0.05f * position(rng);
+		sphere.y += 0.05f * position(rng);
+	}
+	bvh.refit(spheres.data());
+	REQUIRE_FALSE(bvh.needsRebuild());
+	REQUIRE(cullSorted(bvh, planes, spheres) == cullByBruteForce(planes, spheres));
+
+	// Shuffling every instance still culls correctly, but the tree has degraded
+	std::shuffle(spheres.begin(), spheres.end(), rng);
+	bvh.refit(spheres.data());
+	REQUIRE(bvh.needsRebuild());
+	REQUIRE(cullSorted(bvh, planes, spheres) == cullByBruteForce(planes, spheres));
+	bvh.build(spheres.data(), spheres.size());
+	REQUIRE_FALSE(bvh.needsRebuild());
+	REQUIRE(cullSorted(bvh, planes, spheres) == cullByBruteForce(planes, spheres));
+}
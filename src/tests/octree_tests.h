@@ -0,0 +1,54 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <random>
+#include <algorithm>
+#include "../physics/octree.h"
+
+TEST_CASE("Octree render cut keeps every body once and scales with angular size") {
+	std::mt19937 rng(5);
+	std::normal_distribution<float> spread(0.0f, 100.0f);
+	std::vector<glm::vec3> positions(100000);
+	std::vector<float> weights(positions.size(), 1.0f);
+	for (auto& position : positions) {
+		position = glm::vec3(spread(rng), spread(rng), 0.1f * spread(rng));
+	}
+	Octree octree;
+	octree.build(positions, weights);
+
+	// Every body is drawn either on its own or as part of exactly one cell, whose sphere passes the criterion
+	auto checkCut = [&](glm::vec3 eye, float maxAngularSize) {
+		std::vector<OctreeCell> cells;
+		std::vector<int> bodies;
+		octree.collectRenderCut(eye, maxAngularSize, cells, bodies);
+		double total = bodies.size();
+		for (const OctreeCell& cell : cells) {
+			float distance = glm::length(cell.centerOfMass - eye);
+			REQUIRE(distance > cell.radius);
+			REQUIRE(2.0f * cell.radius < maxAngularSize * distance * 1.0001f);
+			total += cell.mass;
+		}
+		REQUIRE(total == Approx(positions.size()));
+		std::sort(bodies.begin(), bodies.end());
+		REQUIRE(std::unique(bodies.begin(), bodies.end()) == bodies.end());
+		return cells.size() + bodies.size();
+	};
+
+	size_t far = checkCut(glm::vec3(0.0f, 0.0f, 5000.0f), 0.01f);
+	size_t finer = checkCut(glm::vec3(0.0f, 0.0f, 5000.0f), 0.0025f);
+	REQUIRE(far < positions.size() / 20);
+	REQUIRE(finer > far);
+	REQUIRE(checkCut(glm::vec3(0.0f), 0.01f) < positions.size());
+
+	// Refitting moves the moments with the bodies and the radii still bound them
+	for (auto& position : positions) {
+		position += glm::vec3(50.0f, 0.0f, 0.0f) + 0.01f * glm::vec3(spread(rng), spread(rng), spread(rng));
+	}
+	octree.refit();
+	checkCut(glm::vec3(0.0f, 0.0f, 5000.0f), 0.01f);
+	checkCut(glm::vec3(50.0f, 0.0f, 0.0f), 0.01f);
+	REQUIRE_FALSE(octree.needsRebuild());
+	std::shuffle(positions.begin(), positions.end(), rng);
+	octree.refit();
+	REQUIRE(octree.needsRebuild());
+	checkCut(glm::vec3(0.0f, 0.0f, 5000.0f), 0.01f);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../profiling/perfCounters.h"
+
+TEST_CASE("Performance counters only report what could be opened") {
+	PerfCounters counters;
+	PerfCounterValues closed = counters.read();
+	for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+		REQUIRE_FALSE(closed.available[i]);
+	}
+
+	// Hardware counters are often unavailable (containers, VMs, paranoid kernels), which must not be an error
+	if (counters.open()) {
+		PerfCounterValues before = counters.read();
+		volatile double sum = 0.0;
+		for (int i = 0; i < 100000; i++) {
+			sum += i * 0.5;
+		}
+		PerfCounterValues after = counters.read();
+		for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+			REQUIRE(before.available[i] == after.available[i]);
+			if (after.available[i]) {
+				REQUIRE(after.values[i] >= before.values[i]);
+			}
+		}
+		counters.close();
+		REQUIRE_FALSE(counters.isOpen());
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+#include "../threading/threadPool.h"
+
+namespace {
+	void makeCluster(System& system, Distribution distribution, size_t bodyCount) {
+		system.setSIUnitScaleFactor(1e3f);
+		InitialConditionParameters parameters;
+		parameters.distribution = distribution;
+		parameters.bodyCount = bodyCount;
+		InitialConditions::generate(&system, parameters);
+	}
+
+	double meanForceError(System& system) {
+		std::vector<glm::vec3> accelerations;
+		system.computeAccelerations(accelerations);
+		double sum = 0.0;
+		for (size_t i = 0; i < accelerations.size(); i++) {
+			glm::vec3 reference = system.computeDirectAcceleration(i);
+			sum += glm::length(accelerations[i] - reference) / glm::length(reference);
+		}
+		return sum / accelerations.size();
+	}
+}
+
+TEST_CASE("Initial conditions are centred and deterministic") {
+	System a, b;
+	makeCluster(a, DISTRIBUTION_DISK, 300);
+	makeCluster(b, DISTRIBUTION_DISK, 300);
+	REQUIRE(a.getBodies().size() == 300);
+
+	glm::vec3 centre = glm::vec3(0.0f);
+	for (size_t i = 0; i < 300; i++) {
+		centre += a.getBodies()[i]->getPosition() / 300.0f;
+		REQUIRE(a.getBodies()[i]->getPosition() == b.getBodies()[i]->getPosition());
+	}
+	REQUIRE(glm::length(centre) < 1e5f);
+}
+
+TEST_CASE("Barnes-Hut forces approach direct summation as theta shrinks") {
+	System system;
+	makeCluster(system, DISTRIBUTION_PLUMMER, 400);
+
+	system.setForceMethod(FORCE_NAIVE);
+	REQUIRE(meanForceError(system) < 1e-4);
+
+	system.setForceMethod(FORCE_BARNES_HUT);
+	system.setTheta(0.0f); // Opens every cell
+	REQUIRE(meanForceError(system) < 1e-4);
+
+	system.setTheta(0.5f);
+	double fineError = meanForceError(system);
+	system.setTheta(1.5f);
+	double coarseError = meanForceError(system);
+	REQUIRE(fineError < 0.05);
+	REQUIRE(fineError < coarseError);
+
+	// Every body-body or body-cell term is counted
+	system.resetStats();
+	std::vector<glm::vec3> accelerations;
+	system.computeAccelerations(accelerations);
+	REQUIRE(system.getStats().forceEvaluations == 1);
+	REQUIRE(system.getStats().interactions > 0);
+	REQUIRE(system.getStats().interactions < 400 * 399);
+}
+
+TEST_CASE("Force pass gives identical results on any thread count") {
+	ThreadPool::getInstance()->setThreadCount(4);
+	System system;
+	makeCluster(system, DISTRIBUTION_UNIFORM, 2000);
+
+	std::vector<glm::vec3> single, parallel;
+	system.setThreadCount(1);
+	system.computeAccelerations(single);
+	system.setThreadCount(4);
+	system.computeAccelerations(parallel);
+	REQUIRE(single == parallel);
+}
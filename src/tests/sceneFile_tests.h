@@ -0,0 +1,214 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "../io/sceneFile.h"
+#include "../io/sceneJSONReader.h"
+#include "../io/snapshotFile.h"
+#include "../physics/system.h"
+
+namespace {
+	nlohmann::json sceneFileTestScene() {
+		nlohmann::json jScene = {
+			{ "SIUnitScaleFactor", 1e7 },
+			{ "UniverseScaleFactor", 40.0 },
+			{ "CameraPosition", { { "x", 0.0 }, { "y", 1e9 }, { "z", 3e10 } } },
+			{ "ambientStrength", 1e-3 },
+			{ "specularStrength", 0.1 },
+			{ "phongExponent", 70.0 },
+			{ "Lights", { {
+				{ "position", { { "x", 1e8 }, { "y", 0.0 }, { "z", 0.0 } } },
+				{ "color", { { "red", 1.0 }, { "green", 0.5 }, { "blue", 0.25 } } },
+				{ "intensity", 3.0 }
+			} } },
+			{ "GravBodies", nlohmann::json::array() }
+		};
+		for (int i = 0; i < 50; i++) {
+			nlohmann::json body = {
+				{ "name", "Body " + std::to_string(i) },
+				{ "radius", 6e6 + i },
+				{ "mass", 5.97e24 * (i + 1) },
+				{ "position", { { "x", 1.5e11 * i }, { "y", -3e9 }, { "z", 7.0 * i } } },
+				{ "velocity", { { "x", 0.0 }, { "y", 29.8e3 + i }, { "z", -1.0 } } },
+				{ "tilt", 0.5 * i },
+				{ "rotationPeriod", 24.0 + i },
+				{ "meshFilePath", "../assets/models/sphere.obj" },
+				{ "vertexShaderPath", "../assets/shaders/default.vs" },
+				{ "fragmentShaderPath", "../assets/shaders/default.fs" },
+				{ "diffuseMap", i % 2 == 0 ? "../assets/textures/earth.jpg" : "../assets/textures/mars.jpg" }
+			};
+			if (i % 5 == 0) {
+				body["emissiveMap"] = "../assets/textures/sun_emissive.jpg";
+				body["emissiveMapStrength"] = 5e4;
+				body["Type"] = "Terrestrial";
+				body["Length of Day"] = "24 hours";
+			}
+			jScene["GravBodies"].push_back(body);
+		}
+		return jScene;
+	}
+}
+
+TEST_CASE("Compiled scenes load the same bodies as their JSON") {
+	nlohmann::json jScene = sceneFileTestScene();
+	SceneFile sceneFile;
+	REQUIRE(sceneFile.open(SceneFile::encode(jScene)));
+	REQUIRE(sceneFile.getBodyCount() == 50);
+	// Paths are stored once however many bodies use them
+	REQUIRE(sceneFile.getStringCount() == 50 + 6 + 2);
+	REQUIRE(sceneFile.getUniverseScaleFactor() == 40.0f);
+	REQUIRE(sceneFile.getCameraPosition() == glm::vec3(0.0f, 1e9f / 1e7f, 3e10f / 1e7f));
+	REQUIRE(sceneFile.getLightCount() == 1);
+	REQUIRE(sceneFile.getLight(0).position == glm::vec3(1e8f / 1e7f, 0.0f, 0.0f));
+	REQUIRE(sceneFile.getLight(0).color == glm::vec3(1.0f, 0.5f, 0.25f));
+
+	System fromJSON, fromSceneFile;
+	fromJSON.loadBodies(jScene);
+	fromSceneFile.loadBodies(sceneFile);
+	REQUIRE(fromSceneFile.getSIUnitScaleFactor() == fromJSON.getSIUnitScaleFactor());
+	auto expected = fromJSON.getBodies();
+	auto bodies = fromSceneFile.getBodies();
+	REQUIRE(bodies.size() == expected.size());
+	for (size_t i = 0; i < bodies.size(); i++) {
+		REQUIRE(bodies[i]->getName() == expected[i]->getName());
+		REQUIRE(bodies[i]->getMass() == expected[i]->getMass());
+		REQUIRE(bodies[i]->getScale() == expected[i]->getScale());
+		REQUIRE(bodies[i]->getPosition() == expected[i]->getPosition());
+		REQUIRE(bodies[i]->getVelocity() == expected[i]->getVelocity());
+		REQUIRE(bodies[i]->getAxis() == expected[i]->getAxis());
+		REQUIRE(bodies[i]->getRotationSpeed() == expected[i]->getRotationSpeed());
+		REQUIRE(bodies[i]->getRotation() == expected[i]->getRotation());
+		REQUIRE(bodies[i]->getMesh() == expected[i]->getMesh());
+		REQUIRE(bodies[i]->getShaders() == expected[i]->getShaders());
+		REQUIRE(bodies[i]->getTextures() == expected[i]->getTextures());
+		REQUIRE(bodies[i]->getTextureStrengths() == expected[i]->getTextureStrengths());
+		REQUIRE(bodies[i]->getPlanetInfo() == expected[i]->getPlanetInfo());
+	}
+}
+
+TEST_CASE("Compiled scenes are mapped from disk and checked") {
+	const std::string jsonPath = "sceneFile_test.json";
+	const std::string path = "sceneFile_test.scene";
+	{
+		std::ofstream file(jsonPath);
+		file << sceneFileTestScene().dump();
+	}
+	REQUIRE(SceneFile::compile(jsonPath, path));
+	REQUIRE(SceneFile::isSceneFile(path));
+	REQUIRE_FALSE(SceneFile::isSceneFile(jsonPath));
+
+	SceneFile sceneFile;
+	REQUIRE(sceneFile.open(path));
+	REQUIRE(sceneFile.getBodyCount() == 50);
+	REQUIRE(sceneFile.getString(sceneFile.getStringId(SCENE_STRING_NAME, 7)) == "Body 7");
+	REQUIRE(sceneFile.getStringId(SCENE_STRING_NORMAL_MAP, 7) == SceneFile::NO_STRING);
+	REQUIRE(sceneFile.getPositions()[3].x == (float)(1.5e11 * 3) / 1e7f);
+
+	// Truncated files, trailing data and other versions are rejected
+	std::vector<unsigned char> encoded = SceneFile::encode(sceneFileTestScene());
+	SceneFile invalid;
+	REQUIRE_FALSE(invalid.open(std::vector<unsigned char>(encoded.begin(), encoded.end() - 8)));
+	std::vector<unsigned char> longer = encoded;
+	longer.resize(longer.size() + 8, 0);
+	REQUIRE_FALSE(invalid.open(longer));
+	std::vector<unsigned char> otherVersion = encoded;
+	otherVersion[8] ^= 0xFF;
+	REQUIRE_FALSE(invalid.open(otherVersion));
+	REQUIRE(invalid.open(encoded));
+
+	std::remove(jsonPath.c_str());
+	std::remove(path.c_str());
+}
+
+TEST_CASE("Streamed JSON scenes encode the same as parsed ones") {
+	nlohmann::json jScene = sceneFileTestScene();
+	jScene["GravBodies"][3]["cloudMap"] = "../assets/textures/clouds.jpg"; // Unknown keys are skipped
+	jScene["GravBodies"][4]["extra"] = { { "x", 1 }, { "list", { 1, 2, 3 } } };
+	std::vector<unsigned char> expected = SceneFile::encode(jScene);
+
+	std::vector<unsigned char> streamed;
+	std::stringstream stream(jScene.dump());
+	REQUIRE(SceneJSONReader::read(stream, streamed));
+	REQUIRE(streamed == expected);
+
+	// Units may come after the bodies they apply to
+	std::string text = jScene.dump();
+	std::string units = "\"SIUnitScaleFactor\":10000000.0,";
+	REQUIRE(text.find(units) != std::string::npos);
+	text.erase(text.find(units), units.size());
+	text.insert(text.size() - 1, "," + units.substr(0, units.size() - 1));
+	std::stringstream reordered(text);
+	REQUIRE(SceneJSONReader::read(reordered, streamed));
+	REQUIRE(streamed == expected);
+}
+
+TEST_CASE("Streamed JSON scenes reject missing and mistyped keys") {
+	std::vector<unsigned char> encoded;
+	nlohmann::json missingMass = sceneFileTestScene();
+	missingMass["GravBodies"][10].erase("mass");
+	std::stringstream missingMassStream(missingMass.dump());
+	REQUIRE_FALSE(SceneJSONReader::read(missingMassStream, encoded));
+
+	nlohmann::json missingCamera = sceneFileTestScene();
+	missingCamera["CameraPosition"].erase("z");
+	std::stringstream missingCameraStream(missingCamera.dump());
+	REQUIRE_FALSE(SceneJSONReader::read(missingCameraStream, encoded));
+
+	nlohmann::json mistyped = sceneFileTestScene();
+	mistyped["GravBodies"][2]["meshFilePath"] = 3;
+	std::stringstream mistypedStream(mistyped.dump());
+	REQUIRE_FALSE(SceneJSONReader::read(mistypedStream, encoded));
+
+	std::stringstream truncated(sceneFileTestScene().dump().substr(0, 500));
+	REQUIRE_FALSE(SceneJSONReader::read(truncated, encoded));
+}
+
+TEST_CASE("Snapshots compile to scenes dressed from a template") {
+	Snapshot snapshot;
+	snapshot.resize(3);
+	for (size_t i = 0; i < 3; i++) {
+		// Already in system units, as icgen writes them
+		snapshot.masses[i] = 1e30f * (i + 1);
+		snapshot.positions[i] = glm::vec3(1e9f * i, 2.0f, -3.0f);
+		snapshot.velocities[i] = glm::vec3(0.0f, 5.0f * i, 0.0f);
+	}
+	const std::string snapshotPath = "template_test.snap";
+	const std::string templatePath = "template_test.json";
+	const std::string scenePath = "template_test.scene";
+	REQUIRE(SnapshotFile::write(snapshotPath, snapshot, true));
+	{
+		std::ofstream templateFile(templatePath);
+		templateFile << sceneFileTestScene().dump();
+	}
+
+	REQUIRE(SceneFile::compileSnapshot(snapshotPath, templatePath, scenePath));
+	{
+		SceneFile sceneFile;
+		REQUIRE(sceneFile.open(scenePath));
+		REQUIRE(sceneFile.getBodyCount() == 3);
+		REQUIRE(sceneFile.getSIUnitScaleFactor() == 1e7f);
+		REQUIRE(sceneFile.getLightCount() == 1);
+		REQUIRE(sceneFile.getLight(0).position == glm::vec3(1e8f / 1e7f, 0.0f, 0.0f));
+		for (size_t i = 0; i < 3; i++) {
+			REQUIRE(sceneFile.getMasses()[i] == snapshot.masses[i]);
+			REQUIRE(sceneFile.getPositions()[i] == snapshot.positions[i]);
+			REQUIRE(sceneFile.getVelocities()[i] == snapshot.velocities[i]);
+			REQUIRE(sceneFile.getScales()[i] == Approx(6e6f / 1e7f));
+			REQUIRE(sceneFile.getString(sceneFile.getStringId(SCENE_STRING_NAME, i)) == "Body 0");
+			REQUIRE(sceneFile.getString(sceneFile.getStringId(SCENE_STRING_EMISSIVE_MAP, i)) == "../assets/textures/sun_emissive.jpg");
+			REQUIRE(sceneFile.getMapStrengths(SCENE_STRENGTH_EMISSIVE)[i] == 5e4f);
+			REQUIRE(sceneFile.getPlanetInfoIds(i).size() == 2);
+		}
+		REQUIRE(sceneFile.getString(sceneFile.getPlanetInfoIds(0)[0]) == "Type: Terrestrial");
+
+		// The scene loads its bodies without the snapshot
+		System system;
+		system.loadBodies(sceneFile);
+		REQUIRE(system.getBodies().size() == 3);
+		REQUIRE(system.getBodies()[2]->getMass() == snapshot.masses[2]);
+	}
+	std::remove(snapshotPath.c_str());
+	std::remove(templatePath.c_str());
+	std::remove(scenePath.c_str());
+}
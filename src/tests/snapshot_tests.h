@@ -0,0 +1,48 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <cstring>
+#include "../io/compression.h"
+#include "../io/snapshotFile.h"
+
+TEST_CASE("Compression round trips repetitive and random data") {
+	std::vector<unsigned char> data;
+	for (int i = 0; i < 50000; i++) {
+		data.push_back((unsigned char)(i % 7 == 0 ? (i * 31) & 0xFF : i % 13));
+	}
+
+	std::vector<unsigned char> compressed = Compression::compress(data.data(), data.size());
+	std::vector<unsigned char> restored;
+	REQUIRE(Compression::decompress(compressed.data(), compressed.size(), data.size(), restored));
+	REQUIRE(restored == data);
+	REQUIRE(compressed.size() < data.size());
+
+	std::vector<unsigned char> empty;
+	compressed = Compression::compress(empty.data(), 0);
+	REQUIRE(Compression::decompress(compressed.data(), compressed.size(), 0, restored));
+	REQUIRE(restored.empty());
+}
+
+TEST_CASE("Snapshots survive encoding") {
+	Snapshot snapshot;
+	snapshot.resize(100);
+	snapshot.time = 12345.5;
+	snapshot.step = 42;
+	for (int i = 0; i < 100; i++) {
+		snapshot.masses[i] = 1e3f + i;
+		snapshot.positions[i] = glm::vec3(i, -2.0f * i, 0.5f * i);
+		snapshot.velocities[i] = glm::vec3(0.1f * i, 0.0f, -1.0f);
+		snapshot.rotations[i] = glm::angleAxis(0.01f * i, glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+
+	for (bool compress : { false, true }) {
+		std::vector<unsigned char> encoded = SnapshotFile::encode(snapshot, compress);
+		Snapshot decoded;
+		REQUIRE(SnapshotFile::decode(encoded.data(), encoded.size(), decoded));
+		REQUIRE(decoded.time == snapshot.time);
+		REQUIRE(decoded.step == snapshot.step);
+		REQUIRE(decoded.masses == snapshot.masses);
+		REQUIRE(decoded.positions == snapshot.positions);
+		REQUIRE(decoded.velocities == snapshot.velocities);
+		REQUIRE(decoded.rotations[7] == snapshot.rotations[7]);
+	}
+}
@@ -2,3 +2,20 @@
 
 // Including the test files here causes them to be run
 #include "./GPUQuadTree_tests.h"
+#include "./snapshot_tests.h"
+#include "./trajectory_tests.h"
+#include "./ephemeris_tests.h"
+#include "./timeline_tests.h"
+#include "./tracer_tests.h"
+#include "./frameStats_tests.h"
+#include "./physics_tests.h"
+#include "./perfCounters_tests.h"
+#include "./thetaTuner_tests.h"
+#include "./diagnostics_tests.h"
+#include "./octree_tests.h"
+#include "./ensemble_tests.h"
+#include "./distributed_tests.h"
+#include "./initialConditions_tests.h"
+#include "./sceneFile_tests.h"
+#include "./instanceAllocator_tests.h"
+#include "./instanceBVH_tests.h"
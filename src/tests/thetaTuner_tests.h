@@ -0,0 +1,93 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../physics/thetaTuner.h"
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+
+TEST_CASE("Theta tuner trades accuracy for cost around the target") {
+	ThetaTuner tuner;
+	tuner.configure(true, 1e-2, 10, 16, 0.1f, 1.5f);
+
+	REQUIRE(tuner.isDue(0));
+	REQUIRE_FALSE(tuner.isDue(5));
+
+	// Too inaccurate: theta shrinks, but never by more than half at once
+	float theta = tuner.adjust(0, 1.0f, 0.2);
+	REQUIRE(theta < 1.0f);
+	REQUIRE(theta >= 0.5f);
+
+	// Inside the band: left alone
+	REQUIRE(tuner.adjust(10, theta, 0.007) == theta);
+
+	// Well under the target: theta grows back, up to the maximum
+	float grown = tuner.adjust(20, theta, 1e-5);
+	REQUIRE(grown > theta);
+	REQUIRE(tuner.adjust(30, 1.5f, 1e-5) == 1.5f);
+
+	// Already measured steps are not measured again and replay the recorded theta
+	REQUIRE_FALSE(tuner.isDue(20));
+	REQUIRE(tuner.isDue(40));
+	float recorded = 0.0f;
+	REQUIRE(tuner.getRecordedTheta(0, recorded));
+	REQUIRE(recorded == 1.0f);
+	REQUIRE(tuner.getRecordedTheta(15, recorded));
+	REQUIRE(recorded == theta);
+	REQUIRE(tuner.getRecordedTheta(21, recorded));
+	REQUIRE(recorded == grown);
+	REQUIRE_FALSE(tuner.getRecordedTheta(100, recorded));
+}
+
+TEST_CASE("System tunes theta to the force error target") {
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = 500;
+	InitialConditions::generate(&system, parameters);
+
+	// Measuring every body takes sampling noise out of the comparison
+	const double target = 5e-3;
+	system.getThetaTuner()->configure(true, target, 1, parameters.bodyCount, 0.1f, 1.5f);
+	system.step(1e6f);
+	const double startingError = system.getThetaTuner()->getLastError();
+	REQUIRE(startingError > target);
+	for (int i = 0; i < 20; i++) {
+		system.step(1e6f);
+	}
+
+	REQUIRE(system.getTheta() < 1.5f);
+	REQUIRE(system.getThetaTuner()->getLastError() < target);
+}
+
+TEST_CASE("Leapfrog replays from just after a theta change reproduce the first run") {
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	system.setIntegrator(INTEGRATOR_LEAPFROG);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = 300;
+	InitialConditions::generate(&system, parameters);
+	system.getThetaTuner()->configure(true, 5e-3, 2, parameters.bodyCount, 0.1f, 1.5f);
+
+	// Keep the state after every step and note the first step that opens with a new theta
+	std::vector<Snapshot> states(13);
+	system.captureSnapshot(states[0]);
+	int changed = -1;
+	for (int i = 0; i < 12; i++) {
+		float theta = system.getTheta();
+		system.step(1e6f);
+		system.captureSnapshot(states[i + 1]);
+		if (changed == -1 && system.getTheta() != theta) {
+			changed = i + 1;
+		}
+	}
+	REQUIRE(changed != -1);
+
+	// Seek to the step that opens with the new theta and replay, the bodies must land on the same positions
+	REQUIRE(system.restoreSnapshot(states[changed]));
+	for (int i = changed; i < 12; i++) {
+		system.step(1e6f);
+	}
+	Snapshot replayed;
+	system.captureSnapshot(replayed);
+	REQUIRE(replayed.positions == states[12].positions);
+	REQUIRE(replayed.velocities == states[12].velocities);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include "../physics/timeline.h"
+
+TEST_CASE("Timeline keeps keyframes within its memory budget") {
+	Timeline timeline;
+	Snapshot probe;
+	probe.resize(10);
+	const size_t keyframeSize = probe.getSizeBytes();
+
+	// Room for four keyframes
+	timeline.configure(keyframeSize * 4, 10);
+
+	for (unsigned long long step = 0; step < 200; step++) {
+		if (timeline.isKeyframeDue(step)) {
+			Snapshot keyframe;
+			keyframe.resize(10);
+			keyframe.step = step;
+			keyframe.time = step * 2.0;
+			timeline.addKeyframe(std::move(keyframe));
+		}
+		timeline.recordStep(step, 2.0f);
+	}
+
+	REQUIRE(timeline.getKeyframeCount() <= 4);
+	REQUIRE(timeline.getKeyframeInterval() > 10);
+	REQUIRE(timeline.getRecordedStepCount() == 200);
+
+	// The first keyframe survives thinning so any recorded time stays reachable
+	REQUIRE(timeline.findKeyframe(-1.0) == nullptr);
+	REQUIRE(timeline.findKeyframe(0.0)->step == 0);
+	const Snapshot* keyframe = timeline.findKeyframe(300.0);
+	REQUIRE(keyframe != nullptr);
+	REQUIRE(keyframe->time <= 300.0);
+	REQUIRE(keyframe->step % timeline.getKeyframeInterval() == 0);
+
+	// Already recorded steps are not keyframed again when replaying
+	REQUIRE_FALSE(timeline.isKeyframeDue(0));
+
+	float stepSize = 0.0f;
+	REQUIRE(timeline.getRecordedStepSize(199, stepSize));
+	REQUIRE(stepSize == 2.0f);
+	REQUIRE_FALSE(timeline.getRecordedStepSize(200, stepSize));
+}
+
+TEST_CASE("Timeline step sizes count towards its memory budget") {
+	Timeline timeline;
+	Snapshot probe;
+	probe.resize(1);
+	const size_t budget = probe.getSizeBytes() * 4 + 4096;
+	const unsigned int interval = 10;
+	timeline.configure(budget, interval);
+
+	const unsigned long long steps = 100000;
+	for (unsigned long long step = 0; step < steps; step++) {
+		if (timeline.isKeyframeDue(step)) {
+			Snapshot keyframe;
+			keyframe.resize(1);
+			keyframe.step = step;
+			keyframe.time = step * 2.0;
+			timeline.addKeyframe(std::move(keyframe));
+		}
+		timeline.recordStep(step, 2.0f);
+	}
+
+	// Checked when keyframes are added, so at most one interval of step sizes over
+	REQUIRE(timeline.getMemoryUsage() <= budget + timeline.getKeyframeInterval() * sizeof(float));
+	REQUIRE(timeline.getRecordedStepCount() == steps);
+
+	// The oldest history went, what is left starts at a keyframe and can still be replayed
+	const unsigned long long first = timeline.getFirstRecordedStep();
+	REQUIRE(first > 0);
+	REQUIRE(timeline.findKeyframe(first * 2.0)->step == first);
+	REQUIRE(timeline.findKeyframe(first * 2.0 - 1.0) == nullptr);
+	float stepSize = 0.0f;
+	REQUIRE(timeline.getRecordedStepSize(first, stepSize));
+	REQUIRE(timeline.getRecordedStepSize(steps - 1, stepSize));
+	REQUIRE_FALSE(timeline.getRecordedStepSize(first - 1, stepSize));
+}
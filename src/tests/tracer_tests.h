@@ -0,0 +1,73 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include "nlohmann/json.hpp"
+#include "../profiling/tracer.h"
+
+TEST_CASE("Scoped timers export as Chrome trace events") {
+	Tracer* tracer = Tracer::getInstance();
+	{
+		ScopedTimer outer("Outer");
+		ScopedTimer inner("Inner");
+	}
+	std::thread worker([tracer] {
+		tracer->setThreadName("Worker");
+		ScopedTimer timer("Worker scope");
+	});
+	worker.join();
+
+	const std::string path = "trace_test.json";
+	REQUIRE(tracer->writeChromeTrace(path));
+
+	std::ifstream file(path);
+	nlohmann::json trace = nlohmann::json::parse(file);
+	file.close();
+	std::remove(path.c_str());
+
+	int outerTid = -1, workerTid = -1;
+	bool namedWorker = false;
+	for (auto const& event : trace["traceEvents"]) {
+		if (event["ph"] == "X" && event["name"] == "Outer") {
+			outerTid = event["tid"];
+			REQUIRE(event["dur"].get<double>() >= 0.0);
+		}
+		if (event["ph"] == "X" && event["name"] == "Worker scope") {
+			workerTid = event["tid"];
+		}
+		if (event["ph"] == "M" && event["args"]["name"] == "Worker") {
+			namedWorker = true;
+		}
+	}
+	REQUIRE(outerTid != -1);
+	REQUIRE(workerTid != -1);
+	REQUIRE(outerTid != workerTid);
+	REQUIRE(namedWorker);
+}
+
+TEST_CASE("Collecting while a thread wraps its buffer only returns whole events") {
+	Tracer* tracer = Tracer::getInstance();
+	std::atomic<bool> done(false);
+	std::thread writer([tracer, &done] {
+		// Every event has duration == start, so a torn read shows up as a mismatch
+		for (uint64_t i = 1; i <= 4000000; i++) {
+			tracer->record("Wrap", i, 2 * i);
+		}
+		done = true;
+	});
+
+	size_t checked = 0, torn = 0;
+	while (!done) {
+		for (auto const& entry : tracer->collect()) {
+			if (entry.second.name != nullptr && std::string(entry.second.name) == "Wrap") {
+				torn += entry.second.duration != entry.second.start;
+				checked++;
+			}
+		}
+	}
+	writer.join();
+	REQUIRE(checked > 0);
+	REQUIRE(torn == 0);
+}
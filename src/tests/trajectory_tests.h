@@ -0,0 +1,96 @@
+#pragma once
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include "../io/trajectoryWriter.h"
+#include "../io/trajectoryReader.h"
+#include "../physics/system.h"
+#include "../physics/initialConditions.h"
+
+TEST_CASE("Trajectories can be read back by frame, time and body") {
+	const std::string path = "trajectory_test.traj";
+	const size_t bodyCount = 10;
+
+	TrajectoryWriter writer;
+	writer.configure(true, path, 1, 4, 3, 1e-3, 1e-6);
+
+	Snapshot frame;
+	frame.resize(bodyCount);
+	for (int f = 0; f < 10; f++) {
+		frame.time = 100.0 * f;
+		frame.step = f;
+		for (int i = 0; i < bodyCount; i++) {
+			frame.positions[i] = glm::vec3(i + 0.25f * f, -2.0f * i, f);
+			frame.velocities[i] = glm::vec3(0.001f * f, 0.5f, -i);
+		}
+		writer.appendFrame(frame);
+
+		// Chunks become visible to readers as soon as the writer finishes them
+		if (f == 5) {
+			writer.flush();
+			TrajectoryReader reader;
+			REQUIRE(reader.open(path));
+			REQUIRE(reader.getFrameCount() == 6);
+		}
+	}
+	writer.flush();
+
+	TrajectoryReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.getBodyCount() == bodyCount);
+	REQUIRE(reader.getFrameCount() == 10);
+	REQUIRE(reader.getFrameTime(7) == 700.0);
+	REQUIRE(reader.findFrame(650.0) == 6);
+	REQUIRE(reader.findFrame(-1.0) == 0);
+	REQUIRE(reader.findFrame(1e9) == 9);
+
+	glm::vec3 position, velocity;
+	REQUIRE(reader.readBody(8, 7, position, velocity));
+	REQUIRE(position.x == Approx(9.75f).margin(1e-3));
+	REQUIRE(position.y == Approx(-16.0f).margin(1e-3));
+	REQUIRE(velocity.x == Approx(0.007f).margin(1e-6));
+	REQUIRE(velocity.z == Approx(-8.0f).margin(1e-6));
+
+	std::vector<glm::vec3> positions, velocities;
+	REQUIRE(reader.readFrame(9, positions, velocities));
+	REQUIRE(positions.size() == bodyCount);
+	REQUIRE(positions[9].z == Approx(9.0f).margin(1e-3));
+
+	std::vector<double> times;
+	REQUIRE(reader.readBodyHistory(2, times, positions, velocities));
+	REQUIRE(times.size() == 10);
+	REQUIRE(positions[4].x == Approx(3.0f).margin(1e-3));
+
+	REQUIRE_FALSE(reader.readBody(bodyCount, 0, position, velocity));
+	REQUIRE_FALSE(reader.readBody(0, 10, position, velocity));
+
+	std::remove(path.c_str());
+	std::remove((path + ".idx").c_str());
+}
+
+TEST_CASE("A System's trajectory starts with the state before its first step") {
+	const std::string path = "trajectory_start_test.traj";
+	System system;
+	system.setSIUnitScaleFactor(1e3f);
+	InitialConditionParameters parameters;
+	parameters.bodyCount = 50;
+	InitialConditions::generate(&system, parameters);
+	glm::vec3 initialPosition = system.getBodies()[7]->getPosition();
+	system.getTrajectoryWriter()->configure(true, path, 5, 4, 16, 1e-3, 1e-6);
+
+	for (int step = 0; step < 12; step++) {
+		system.update(1.0f / 60.0f);
+	}
+	system.getTrajectoryWriter()->flush();
+
+	// Steps 0, 5 and 10
+	TrajectoryReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.getFrameCount() == 3);
+	REQUIRE(reader.getFrameTime(0) == 0.0);
+	glm::vec3 position, velocity;
+	REQUIRE(reader.readBody(7, 0, position, velocity));
+	REQUIRE(glm::length(position - initialPosition) < 1e-2f);
+
+	std::remove(path.c_str());
+	std::remove((path + ".idx").c_str());
+}
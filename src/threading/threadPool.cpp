@@ -0,0 +1,127 @@
+#include "threadPool.h"
+#include <algorithm>
+#include <atomic>
+#include "../profiling/tracer.h"
+
+ThreadPool* ThreadPool::m_instance = nullptr;
+
+ThreadPool::ThreadPool() {
+  m_running = false;
+  setThreadCount(0);
+}
+
+ThreadPool::~ThreadPool() {
+  stopWorkers();
+}
+
+ThreadPool* ThreadPool::getInstance() {
+  if (m_instance == nullptr) {
+    m_instance = new ThreadPool();
+  }
+  return m_instance;
+}
+
+void ThreadPool::setThreadCount(unsigned int threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  if (threadCount == getThreadCount() && m_running) {
+    return;
+  }
+  stopWorkers();
+  startWorkers(threadCount - 1); // The caller of parallelFor is the last thread
+}
+
+unsigned int ThreadPool::getThreadCount() {
+  return m_workers.size() + 1;
+}
+
+void ThreadPool::startWorkers(unsigned int workerCount) {
+  m_running = true;
+  for (unsigned int i = 0; i < workerCount; i++) {
+    m_workers.push_back(std::thread(&ThreadPool::run, this));
+  }
+}
+
+void ThreadPool::stopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_condition.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+void ThreadPool::run() {
+  TRACE_THREAD_NAME("Worker");
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this] { return !m_tasks.empty() || !m_running; });
+      if (m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body, unsigned int maxThreads) {
+  if (count == 0) {
+    return;
+  }
+
+  grainSize = std::max<size_t>(grainSize, 1);
+  size_t threads = getThreadCount();
+  if (maxThreads != 0) {
+    threads = std::min<size_t>(threads, maxThreads);
+  }
+  threads = std::min(threads, (count + grainSize - 1) / grainSize);
+  if (threads <= 1) {
+    body(0, count);
+    return;
+  }
+
+  // A few chunks per thread so a slow chunk doesn't leave the others idle
+  const size_t chunkSize = std::max(grainSize, count / (threads * 4));
+  std::atomic<size_t> nextIndex(0);
+  size_t helpersRunning = threads - 1;
+  std::mutex doneMutex;
+  std::condition_variable done;
+
+  auto work = [&]() {
+    while (true) {
+      size_t begin = nextIndex.fetch_add(chunkSize);
+      if (begin >= count) {
+        return;
+      }
+      body(begin, std::min(begin + chunkSize, count));
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < threads - 1; i++) {
+      m_tasks.push_back([&]() {
+        work();
+        std::lock_guard<std::mutex> doneLock(doneMutex);
+        if (--helpersRunning == 0) {
+          done.notify_one();
+        }
+      });
+    }
+  }
+  m_condition.notify_all();
+
+  work();
+
+  // The helpers reference this stack frame, so wait for every one of them even if there was nothing left to do
+  std::unique_lock<std::mutex> lock(doneMutex);
+  done.wait(lock, [&] { return helpersRunning == 0; });
+}
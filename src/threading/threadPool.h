@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads shared by everything that wants to split work across cores.
+// parallelFor hands out chunks of an index range on demand, so uneven work per index (e.g. tree walks) still balances.
+// The calling thread works on chunks too and parallelFor must not be called from inside one of its own chunks.
+class ThreadPool {
+private:
+  static ThreadPool* m_instance;
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_running;
+
+  ThreadPool();
+  void startWorkers(unsigned int workerCount);
+  void stopWorkers();
+  void run();
+
+public:
+  static ThreadPool* getInstance();
+  ~ThreadPool();
+  // Threads taking part in a parallelFor, including the caller. 0 uses every hardware thread.
+  void setThreadCount(unsigned int threadCount);
+  unsigned int getThreadCount();
+  // Calls body(begin, end) over [0, count) in chunks of at least grainSize and returns once all are done.
+  // maxThreads limits how many threads take part, 0 means all of them.
+  void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body, unsigned int maxThreads = 0);
+};
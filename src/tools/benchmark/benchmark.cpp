@@ -0,0 +1,511 @@
+// Physics benchmark: sweeps body count, force method, theta, thread count and integrator over synthetic
+// distributions and writes the results as CSV and JSON, for picking crossover points and catching regressions.
+//
+//   benchmark [--n 1000,10000,...] [--engines naive,tree] [--theta 0.5,1,1.5] [--threads 1,8]
+//             [--integrators euler,leapfrog] [--distributions plummer,uniform,disk] [--steps 3]
+//             [--error-samples 128] [--max-step-seconds 30] [--csv benchmark.csv] [--json benchmark.json]
+//             [--counters]
+//
+// Each configuration starts from the same initial state. Force error is the relative difference from direct
+// summation (in double) for a fixed sample of bodies. Configurations whose step time, extrapolated from the
+// previous body count, would exceed --max-step-seconds are skipped, so the default sweep to 10M finishes.
+// Bodies are full GravBody objects, so 10M bodies needs several GB of memory.
+//
+// --counters adds hardware counters (Linux perf_event_open) per phase of the force evaluation: cycles, instructions,
+// L1D and LLC misses and branch misses per evaluation, IPC, and misses per interaction of the walk.
+// Counting usually needs kernel.perf_event_paranoid <= 2 and hardware counters exposed to the VM, if any.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include "nlohmann/json.hpp"
+
+#include "../../physics/system.h"
+#include "../../physics/initialConditions.h"
+#include "../../threading/threadPool.h"
+#include "../../profiling/perfCounters.h"
+
+namespace {
+
+  struct Options {
+    std::vector<size_t> bodyCounts = { 1000, 10000, 100000, 1000000, 10000000 };
+    std::vector<ForceMethod> engines = { FORCE_NAIVE, FORCE_BARNES_HUT };
+    std::vector<float> thetas = { 0.5f, 1.0f, 1.5f };
+    std::vector<unsigned int> threadCounts;
+    std::vector<Integrator> integrators = { INTEGRATOR_SEMI_IMPLICIT_EULER, INTEGRATOR_LEAPFROG };
+    std::vector<Distribution> distributions = { DISTRIBUTION_PLUMMER, DISTRIBUTION_UNIFORM, DISTRIBUTION_DISK };
+    unsigned int steps = 3;
+    size_t errorSamples = 128;
+    double maxStepSeconds = 30.0;
+    std::string csvPath = "benchmark.csv";
+    std::string jsonPath = "benchmark.json";
+    bool counters = false;
+  };
+
+  struct Result {
+    std::string distribution;
+    size_t bodyCount;
+    std::string engine;
+    float theta; // 0 for naive
+    unsigned int threads;
+    std::string integrator;
+    unsigned int steps;
+    double seconds;
+    double stepsPerSecond;
+    double interactionsPerStep;
+    double interactionsPerSecond;
+    double interactionsPerEvaluation;
+    double buildMilliseconds; // Per force evaluation
+    double aggregateMilliseconds;
+    double walkMilliseconds;
+    double forceErrorMean;
+    double forceErrorP99;
+    double forceErrorMax;
+    // Hardware counts per force evaluation, when requested and available
+    bool hasCounters = false;
+    bool counterAvailable[PERF_COUNTER_COUNT] = {};
+    double counters[PHYSICS_PHASE_COUNT][PERF_COUNTER_COUNT] = {};
+  };
+
+  // Sums the counter deltas over every phase of the timed steps
+  class CounterListener : public PhysicsPhaseListener {
+  private:
+    PerfCounters* m_counters;
+    PerfCounterValues m_phaseStart;
+
+  public:
+    unsigned long long totals[PHYSICS_PHASE_COUNT][PERF_COUNTER_COUNT];
+    bool available[PERF_COUNTER_COUNT];
+
+    CounterListener(PerfCounters* counters) {
+      m_counters = counters;
+      reset();
+    }
+
+    void reset() {
+      for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        available[i] = false;
+        for (int phase = 0; phase < PHYSICS_PHASE_COUNT; phase++) {
+          totals[phase][i] = 0;
+        }
+      }
+    }
+
+    void beginPhase(PhysicsPhase) override {
+      m_phaseStart = m_counters->read();
+    }
+
+    void endPhase(PhysicsPhase phase) override {
+      PerfCounterValues end = m_counters->read();
+      for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (end.available[i] && m_phaseStart.available[i]) {
+          available[i] = true;
+          totals[phase][i] += end.values[i] - m_phaseStart.values[i];
+        }
+      }
+    }
+  };
+
+  const char* phaseName(int phase) {
+    switch (phase) {
+      case PHYSICS_PHASE_BUILD: return "build";
+      case PHYSICS_PHASE_AGGREGATE: return "aggregate";
+      default: return "walk";
+    }
+  }
+
+  double instructionsPerCycle(const Result& r, int phase) {
+    double cycles = r.counters[phase][PERF_COUNTER_CYCLES];
+    return cycles > 0.0 ? r.counters[phase][PERF_COUNTER_INSTRUCTIONS] / cycles : 0.0;
+  }
+
+  // Walk phase count per body-body or body-cell term
+  double perInteraction(const Result& r, PerfCounter counter) {
+    return r.interactionsPerEvaluation > 0.0 ? r.counters[PHYSICS_PHASE_WALK][counter] / r.interactionsPerEvaluation : 0.0;
+  }
+
+  const float SI_UNIT_SCALE_FACTOR = 1e3f;
+  const float TOTAL_MASS = 1e24f;
+  const float SCALE_RADIUS = 1e9f;
+
+  std::string engineName(ForceMethod engine) {
+    return engine == FORCE_NAIVE ? "naive" : "tree";
+  }
+
+  std::string integratorName(Integrator integrator) {
+    return integrator == INTEGRATOR_LEAPFROG ? "leapfrog" : "euler";
+  }
+
+  std::vector<std::string> split(std::string list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      if (!item.empty()) {
+        items.push_back(item);
+      }
+    }
+    return items;
+  }
+
+  void printUsage() {
+    std::cout << "Usage: benchmark [--n list] [--engines naive,tree] [--theta list] [--threads list]" << std::endl;
+    std::cout << "                 [--integrators euler,leapfrog] [--distributions plummer,uniform,disk]" << std::endl;
+    std::cout << "                 [--steps n] [--error-samples n] [--max-step-seconds s] [--csv path] [--json path]" << std::endl;
+    std::cout << "                 [--counters]" << std::endl;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      std::string flag = argv[i];
+      if (flag == "--counters") {
+        options.counters = true;
+        continue;
+      }
+      if (flag == "--help" || i + 1 >= argc) {
+        return false;
+      }
+      std::string value = argv[++i];
+      std::vector<std::string> items = split(value);
+
+      if (flag == "--n") {
+        options.bodyCounts.clear();
+        for (auto& item : items) options.bodyCounts.push_back(std::stoull(item));
+      }
+      else if (flag == "--engines") {
+        options.engines.clear();
+        for (auto& item : items) {
+          if (item == "naive") options.engines.push_back(FORCE_NAIVE);
+          else if (item == "tree") options.engines.push_back(FORCE_BARNES_HUT);
+          else {
+            std::cout << "Unknown engine " << item << " (only naive and tree exist)" << std::endl;
+            return false;
+          }
+        }
+      }
+      else if (flag == "--theta") {
+        options.thetas.clear();
+        for (auto& item : items) options.thetas.push_back(std::stof(item));
+      }
+      else if (flag == "--threads") {
+        options.threadCounts.clear();
+        for (auto& item : items) options.threadCounts.push_back(std::stoul(item));
+      }
+      else if (flag == "--integrators") {
+        options.integrators.clear();
+        for (auto& item : items) {
+          if (item == "euler") options.integrators.push_back(INTEGRATOR_SEMI_IMPLICIT_EULER);
+          else if (item == "leapfrog") options.integrators.push_back(INTEGRATOR_LEAPFROG);
+          else {
+            std::cout << "Unknown integrator " << item << std::endl;
+            return false;
+          }
+        }
+      }
+      else if (flag == "--distributions") {
+        options.distributions.clear();
+        for (auto& item : items) {
+          Distribution distribution;
+          if (!InitialConditions::parseDistribution(item, distribution)) {
+            std::cout << "Unknown distribution " << item << std::endl;
+            return false;
+          }
+          options.distributions.push_back(distribution);
+        }
+      }
+      else if (flag == "--steps") options.steps = std::max(std::stoul(value), 1ul);
+      else if (flag == "--error-samples") options.errorSamples = std::stoull(value);
+      else if (flag == "--max-step-seconds") options.maxStepSeconds = std::stod(value);
+      else if (flag == "--csv") options.csvPath = value;
+      else if (flag == "--json") options.jsonPath = value;
+      else {
+        std::cout << "Unknown option " << flag << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Relative error of the system's force method against direct summation for an evenly spaced sample of bodies
+  void measureForceError(System* system, size_t samples, Result& result) {
+    result.forceErrorMean = result.forceErrorP99 = result.forceErrorMax = 0.0;
+    size_t bodyCount = system->getBodies().size();
+    if (samples == 0 || bodyCount == 0) {
+      return;
+    }
+
+    std::vector<glm::vec3> accelerations;
+    system->computeAccelerations(accelerations);
+
+    std::vector<double> errors;
+    size_t stride = std::max<size_t>(bodyCount / samples, 1);
+    for (size_t i = 0; i < bodyCount && errors.size() < samples; i += stride) {
+      glm::dvec3 reference = glm::dvec3(system->computeDirectAcceleration(i));
+      double referenceLength = glm::length(reference);
+      if (referenceLength > 0.0) {
+        errors.push_back(glm::length(glm::dvec3(accelerations[i]) - reference) / referenceLength);
+      }
+    }
+    if (errors.empty()) {
+      return;
+    }
+
+    std::sort(errors.begin(), errors.end());
+    double sum = 0.0;
+    for (double error : errors) sum += error;
+    result.forceErrorMean = sum / errors.size();
+    result.forceErrorP99 = errors[std::min((size_t)std::ceil(0.99 * errors.size()) - 1, errors.size() - 1)];
+    result.forceErrorMax = errors.back();
+  }
+
+  // Counters are only sampled over the timed steps when a listener is given
+  void runConfiguration(System* system, const Snapshot& initialState, float stepSize, const Options& options,
+                        CounterListener* counterListener, Result& result) {
+    system->restoreSnapshot(initialState);
+    measureForceError(system, options.errorSamples, result);
+
+    // One untimed step so leapfrog's first force evaluation and cold caches don't count
+    system->restoreSnapshot(initialState);
+    system->step(stepSize);
+    system->resetStats();
+    if (counterListener != nullptr) {
+      counterListener->reset();
+      system->setPhaseListener(counterListener);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < options.steps; i++) {
+      system->step(stepSize);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    system->setPhaseListener(nullptr);
+
+    PhysicsStats stats = system->getStats();
+    double evaluations = std::max<double>(stats.forceEvaluations, 1);
+    result.steps = options.steps;
+    result.seconds = elapsed.count();
+    result.stepsPerSecond = options.steps / result.seconds;
+    result.interactionsPerStep = stats.interactions / (double)options.steps;
+    result.interactionsPerSecond = stats.interactions / result.seconds;
+    result.buildMilliseconds = stats.buildMilliseconds / evaluations;
+    result.aggregateMilliseconds = stats.aggregateMilliseconds / evaluations;
+    result.walkMilliseconds = stats.walkMilliseconds / evaluations;
+    result.interactionsPerEvaluation = stats.interactions / evaluations;
+
+    if (counterListener != nullptr) {
+      result.hasCounters = true;
+      for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        result.counterAvailable[i] = counterListener->available[i];
+        for (int phase = 0; phase < PHYSICS_PHASE_COUNT; phase++) {
+          result.counters[phase][i] = counterListener->totals[phase][i] / evaluations;
+        }
+      }
+    }
+  }
+
+  bool writeCsv(std::string path, const std::vector<Result>& results, bool counters) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      std::cout << "Could not open " << path << std::endl;
+      return false;
+    }
+    file << "distribution,n,engine,theta,threads,integrator,steps,seconds,steps_per_sec,interactions_per_step,"
+         << "interactions_per_sec,build_ms,aggregate_ms,walk_ms,force_error_mean,force_error_p99,force_error_max";
+    if (counters) {
+      for (int phase = 0; phase < PHYSICS_PHASE_COUNT; phase++) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+          file << "," << phaseName(phase) << "_" << PerfCounters::getCounterName((PerfCounter)i);
+        }
+        file << "," << phaseName(phase) << "_ipc";
+      }
+      for (int i = PERF_COUNTER_L1D_MISSES; i < PERF_COUNTER_COUNT; i++) {
+        file << "," << PerfCounters::getCounterName((PerfCounter)i) << "_per_interaction";
+      }
+    }
+    file << "\n";
+    for (auto const& r : results) {
+      file << r.distribution << "," << r.bodyCount << "," << r.engine << "," << r.theta << "," << r.threads << ","
+           << r.integrator << "," << r.steps << "," << r.seconds << "," << r.stepsPerSecond << ","
+           << r.interactionsPerStep << "," << r.interactionsPerSecond << "," << r.buildMilliseconds << ","
+           << r.aggregateMilliseconds << "," << r.walkMilliseconds << "," << r.forceErrorMean << ","
+           << r.forceErrorP99 << "," << r.forceErrorMax;
+      if (counters) {
+        // Unavailable counters are left empty rather than reported as zero
+        for (int phase = 0; phase < PHYSICS_PHASE_COUNT; phase++) {
+          for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+            file << ",";
+            if (r.counterAvailable[i]) file << r.counters[phase][i];
+          }
+          file << ",";
+          if (r.counterAvailable[PERF_COUNTER_CYCLES] && r.counterAvailable[PERF_COUNTER_INSTRUCTIONS]) file << instructionsPerCycle(r, phase);
+        }
+        for (int i = PERF_COUNTER_L1D_MISSES; i < PERF_COUNTER_COUNT; i++) {
+          file << ",";
+          if (r.counterAvailable[i]) file << perInteraction(r, (PerfCounter)i);
+        }
+      }
+      file << "\n";
+    }
+    return true;
+  }
+
+  bool writeJson(std::string path, const std::vector<Result>& results) {
+    nlohmann::json json;
+    json["hardware_threads"] = std::thread::hardware_concurrency();
+    json["results"] = nlohmann::json::array();
+    for (auto const& r : results) {
+      json["results"].push_back({
+        { "distribution", r.distribution }, { "n", r.bodyCount }, { "engine", r.engine }, { "theta", r.theta },
+        { "threads", r.threads }, { "integrator", r.integrator }, { "steps", r.steps }, { "seconds", r.seconds },
+        { "steps_per_sec", r.stepsPerSecond }, { "interactions_per_step", r.interactionsPerStep },
+        { "interactions_per_sec", r.interactionsPerSecond }, { "build_ms", r.buildMilliseconds },
+        { "aggregate_ms", r.aggregateMilliseconds }, { "walk_ms", r.walkMilliseconds },
+        { "force_error_mean", r.forceErrorMean }, { "force_error_p99", r.forceErrorP99 },
+        { "force_error_max", r.forceErrorMax }
+      });
+
+      if (r.hasCounters) {
+        nlohmann::json counters;
+        for (int phase = 0; phase < PHYSICS_PHASE_COUNT; phase++) {
+          nlohmann::json phaseCounters = nlohmann::json::object();
+          for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+            if (r.counterAvailable[i]) phaseCounters[PerfCounters::getCounterName((PerfCounter)i)] = r.counters[phase][i];
+          }
+          if (r.counterAvailable[PERF_COUNTER_CYCLES] && r.counterAvailable[PERF_COUNTER_INSTRUCTIONS]) {
+            phaseCounters["ipc"] = instructionsPerCycle(r, phase);
+          }
+          counters[phaseName(phase)] = phaseCounters;
+        }
+        nlohmann::json perInteractionCounts = nlohmann::json::object();
+        for (int i = PERF_COUNTER_L1D_MISSES; i < PERF_COUNTER_COUNT; i++) {
+          if (r.counterAvailable[i]) perInteractionCounts[PerfCounters::getCounterName((PerfCounter)i)] = perInteraction(r, (PerfCounter)i);
+        }
+        counters["per_interaction"] = perInteractionCounts;
+        json["results"].back()["counters"] = counters;
+      }
+    }
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      std::cout << "Could not open " << path << std::endl;
+      return false;
+    }
+    file << json.dump(2) << std::endl;
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  if (options.threadCounts.empty()) {
+    unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    options.threadCounts.push_back(1);
+    if (hardwareThreads > 1) {
+      options.threadCounts.push_back(hardwareThreads);
+    }
+  }
+  std::sort(options.bodyCounts.begin(), options.bodyCounts.end());
+
+  // Opened before the pool starts its workers so their counts are included
+  PerfCounters perfCounters;
+  CounterListener counterListener(&perfCounters);
+  if (options.counters && !perfCounters.open()) {
+    std::cout << "No performance counters available, continuing without them" << std::endl;
+  }
+  CounterListener* listener = perfCounters.isOpen() ? &counterListener : nullptr;
+
+  ThreadPool::getInstance()->setThreadCount(*std::max_element(options.threadCounts.begin(), options.threadCounts.end()));
+
+  std::vector<Result> results;
+  // Seconds per step at the last body count of each configuration, to skip ones that would take too long
+  std::map<std::string, std::pair<size_t, double>> lastStepTimes;
+
+  for (Distribution distribution : options.distributions) {
+    for (size_t bodyCount : options.bodyCounts) {
+      System* system = new System();
+      system->setSIUnitScaleFactor(SI_UNIT_SCALE_FACTOR);
+      system->getThetaTuner()->setEnabled(false); // Theta is what's being swept
+
+      InitialConditionParameters parameters;
+      parameters.distribution = distribution;
+      parameters.bodyCount = bodyCount;
+      parameters.totalMass = TOTAL_MASS;
+      parameters.radius = SCALE_RADIUS;
+      InitialConditions::generate(system, parameters);
+
+      Snapshot initialState;
+      system->captureSnapshot(initialState);
+
+      // A small fraction of the dynamical time, so every distribution evolves comparably
+      float dynamicalTime = std::sqrt(std::pow(SCALE_RADIUS, 3.0f) / (system->getGravitationalConstant() * TOTAL_MASS));
+      float stepSize = 1e-3f * dynamicalTime;
+
+      for (ForceMethod engine : options.engines) {
+        std::vector<float> thetas = options.thetas;
+        if (engine == FORCE_NAIVE) {
+          thetas = { 0.0f };
+        }
+        for (float theta : thetas) {
+          for (unsigned int threads : options.threadCounts) {
+            for (Integrator integrator : options.integrators) {
+              Result result;
+              result.distribution = InitialConditions::getDistributionName(distribution);
+              result.bodyCount = bodyCount;
+              result.engine = engineName(engine);
+              result.theta = theta;
+              result.threads = threads;
+              result.integrator = integratorName(integrator);
+
+              std::stringstream key;
+              key << result.distribution << "/" << result.engine << "/" << theta << "/" << threads << "/" << result.integrator;
+              auto last = lastStepTimes.find(key.str());
+              if (last != lastStepTimes.end()) {
+                double exponent = engine == FORCE_NAIVE ? 2.0 : 1.2;
+                double predicted = last->second.second * std::pow((double)bodyCount / last->second.first, exponent);
+                if (predicted > options.maxStepSeconds) {
+                  std::cout << "Skipping " << key.str() << " n=" << bodyCount << ", predicted " << predicted << " s/step" << std::endl;
+                  continue;
+                }
+              }
+
+              system->setForceMethod(engine);
+              system->setTheta(theta);
+              system->setThreadCount(threads);
+              system->setIntegrator(integrator);
+              runConfiguration(system, initialState, stepSize, options, listener, result);
+              results.push_back(result);
+              lastStepTimes[key.str()] = std::make_pair(bodyCount, result.seconds / result.steps);
+
+              std::cout << key.str() << " n=" << bodyCount << ": " << result.stepsPerSecond << " steps/s, "
+                        << result.interactionsPerSecond << " interactions/s, build " << result.buildMilliseconds
+                        << " ms, walk " << result.walkMilliseconds << " ms, error p99 " << result.forceErrorP99;
+              if (result.counterAvailable[PERF_COUNTER_CYCLES] && result.counterAvailable[PERF_COUNTER_INSTRUCTIONS]) {
+                std::cout << ", walk IPC " << instructionsPerCycle(result, PHYSICS_PHASE_WALK);
+              }
+              std::cout << std::endl;
+            }
+          }
+        }
+      }
+
+      for (auto body : system->getBodies()) {
+        delete body;
+      }
+      delete system;
+    }
+  }
+
+  bool written = writeCsv(options.csvPath, results, listener != nullptr);
+  written = writeJson(options.jsonPath, results) && written;
+  return written ? 0 : 1;
+}
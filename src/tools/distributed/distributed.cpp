@@ -0,0 +1,186 @@
+// Distributed Barnes-Hut run: generates a distribution split over every rank and steps it with domain decomposition
+// and local essential tree exchange (see src/distributed/distributedSystem.h).
+//
+//   distributed [--transport loopback|mpi] [--ranks 4] [--n 1000000] [--distribution plummer] [--steps 10]
+//               [--theta 0.7] [--threads 0] [--seed 1]
+//
+// loopback runs every rank as a thread of this process, for testing on one machine. mpi needs a build with
+// ENABLE_MPI and is launched through the MPI launcher, e.g. mpirun -n 16 ./distributed --transport mpi --n 100000000.
+// Rank 0 prints the per step timings of the slowest rank and conservation of momentum at the end.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "../../distributed/distributedSystem.h"
+#include "../../distributed/loopbackTransport.h"
+#include "../../distributed/mpiTransport.h"
+#include "../../threading/threadPool.h"
+
+namespace {
+
+  struct Options {
+    std::string transport = "loopback";
+    int ranks = 4;
+    size_t bodyCount = 1000000;
+    Distribution distribution = DISTRIBUTION_PLUMMER;
+    unsigned int steps = 10;
+    float theta = 0.7f;
+    unsigned int threads = 0;
+    unsigned int seed = 1;
+  };
+
+  const float SI_UNIT_SCALE_FACTOR = 1e3f;
+  const float TOTAL_MASS = 1e24f;
+  const float SCALE_RADIUS = 1e9f;
+
+  void printUsage() {
+    std::cout << "Usage: distributed [--transport loopback|mpi] [--ranks n] [--n bodies] [--distribution plummer|uniform|disk|hernquist|nfw]" << std::endl;
+    std::cout << "                   [--steps n] [--theta t] [--threads n] [--seed n]" << std::endl;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      std::string flag = argv[i];
+      if (flag == "--help" || i + 1 >= argc) {
+        return false;
+      }
+      std::string value = argv[++i];
+      if (flag == "--transport") options.transport = value;
+      else if (flag == "--ranks") options.ranks = std::max(std::stoi(value), 1);
+      else if (flag == "--n") options.bodyCount = std::stoull(value);
+      else if (flag == "--distribution") {
+        if (!InitialConditions::parseDistribution(value, options.distribution)) {
+          std::cout << "Unknown distribution " << value << std::endl;
+          return false;
+        }
+      }
+      else if (flag == "--steps") options.steps = std::stoul(value);
+      else if (flag == "--theta") options.theta = std::stof(value);
+      else if (flag == "--threads") options.threads = std::stoul(value);
+      else if (flag == "--seed") options.seed = std::stoul(value);
+      else {
+        std::cout << "Unknown option " << flag << std::endl;
+        return false;
+      }
+    }
+    if (options.transport != "loopback" && options.transport != "mpi") {
+      std::cout << "Unknown transport " << options.transport << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Largest value over every rank, for the per step timings the slowest rank decides
+  double maxOverRanks(Transport* transport, double value) {
+    std::vector<char> buffer;
+    packBuffer(std::vector<double>{ value }, buffer);
+    std::vector<std::vector<char>> received;
+    transport->allGather(buffer, received);
+    double result = value;
+    for (auto const& rankBuffer : received) {
+      std::vector<double> other;
+      unpackBuffer(rankBuffer, other);
+      result = std::max(result, other[0]);
+    }
+    return result;
+  }
+
+  void runRank(Transport* transport, const Options& options) {
+    const bool print = transport->getRank() == 0;
+    DistributedSystem system(transport);
+    system.setSIUnitScaleFactor(SI_UNIT_SCALE_FACTOR);
+    system.setTheta(options.theta);
+    // Loopback ranks share the pool, so each one only walks on its own thread
+    system.setThreadCount(options.transport == "loopback" ? 1 : options.threads);
+
+    InitialConditionParameters parameters;
+    parameters.distribution = options.distribution;
+    parameters.bodyCount = options.bodyCount;
+    parameters.totalMass = TOTAL_MASS;
+    parameters.radius = SCALE_RADIUS;
+    parameters.seed = options.seed;
+    system.generate(parameters);
+
+    const float dynamicalTime = std::sqrt(std::pow(SCALE_RADIUS, 3.0f) / (system.getGravitationalConstant() * TOTAL_MASS));
+    const float stepSize = 1e-3f * dynamicalTime;
+
+    double mass, kineticEnergy;
+    glm::dvec3 initialMomentum;
+    system.computeTotals(mass, kineticEnergy, initialMomentum);
+    size_t bodyCount = system.getGlobalBodyCount();
+    if (print) {
+      std::cout << transport->getSize() << " ranks, " << bodyCount << " bodies, theta " << options.theta << std::endl;
+    }
+
+    for (unsigned int i = 0; i < options.steps; i++) {
+      system.resetStats();
+      auto start = std::chrono::steady_clock::now();
+      system.step(stepSize);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      // The first step also evaluates the starting forces, so it does twice the work
+      DistributedStats stats = system.getStats();
+      double maxSeconds = maxOverRanks(transport, seconds);
+      double maxDecompose = maxOverRanks(transport, stats.decomposeMilliseconds);
+      double maxEssential = maxOverRanks(transport, stats.essentialMilliseconds);
+      double maxWalk = maxOverRanks(transport, stats.buildMilliseconds + stats.walkMilliseconds);
+      double maxBodies = maxOverRanks(transport, (double)system.getBodies().size());
+      std::vector<double> totals = { (double)stats.interactions, (double)stats.migratedBodies, (double)stats.importedEssential };
+      transport->allReduceSum(totals);
+      if (print) {
+        double meanBodies = (double)options.bodyCount / transport->getSize();
+        std::cout << "Step " << i << ": " << maxSeconds << " s (decompose " << maxDecompose << " ms, essential " << maxEssential
+          << " ms, walk " << maxWalk << " ms), " << totals[0] << " interactions, " << totals[1] << " migrated, "
+          << totals[2] << " imported, imbalance " << (meanBodies > 0.0 ? maxBodies / meanBodies : 0.0) << std::endl;
+      }
+    }
+
+    glm::dvec3 finalMomentum;
+    system.computeTotals(mass, kineticEnergy, finalMomentum);
+    if (print) {
+      double momentumScale = std::sqrt(2.0 * kineticEnergy * mass);
+      std::cout << "Momentum drift " << (momentumScale > 0.0 ? glm::length(finalMomentum - initialMomentum) / momentumScale : 0.0) << std::endl;
+    }
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  if (options.threads != 0) {
+    ThreadPool::getInstance()->setThreadCount(options.threads);
+  }
+
+  if (options.transport == "mpi") {
+#ifdef ENABLE_MPI
+    MPITransport transport(&argc, &argv);
+    runRank(&transport, options);
+    return 0;
+#else
+    std::cout << "Built without MPI, configure with -DENABLE_MPI=ON" << std::endl;
+    return 1;
+#endif
+  }
+
+  LoopbackHub hub(options.ranks);
+  std::vector<LoopbackTransport> transports;
+  for (int rank = 0; rank < options.ranks; rank++) {
+    transports.push_back(LoopbackTransport(&hub, rank));
+  }
+  std::vector<std::thread> threads;
+  for (int rank = 0; rank < options.ranks; rank++) {
+    threads.push_back(std::thread([&, rank]() { runRank(&transports[rank], options); }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return 0;
+}
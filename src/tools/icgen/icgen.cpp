@@ -0,0 +1,152 @@
+// Initial conditions generator: samples one or more components in parallel and writes them as a snapshot file.
+//
+//   icgen --component <distribution>[:key=value,...] [--component ...] [--scale 1e3] [--seed 1] [--threads n]
+//         [--out initial.snap] [--uncompressed]
+//
+// Distributions are plummer, uniform, disk, hernquist, nfw and belt. Keys, in SI units:
+//   n        body count (default 1000)
+//   mass     total mass in kg, without the central mass
+//   radius   scale radius in m, largest semi-major axis for belts
+//   inner    smallest semi-major axis of a belt in m
+//   c        NFW concentration
+//   e        largest belt eccentricity
+//   i        largest belt inclination in degrees
+//   central  mass of an extra body at the centre in kg
+// For example a galaxy with a black hole, bulge, disk and halo:
+//   icgen --component disk:n=8000000,mass=1e41,radius=1e20,central=8e36 --component hernquist:n=1000000,mass=2e40,radius=5e19
+//         --component nfw:n=1000000,mass=1e42,radius=4e20,c=10 --scale 1e11
+// Positions, velocities and masses are stored divided by --scale, the SIUnitScaleFactor of the scene that loads them.
+// Snapshots only hold the bodies' state, sceneCompiler --snapshot turns one into a scene using a template scene JSON.
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../../physics/initialConditions.h"
+#include "../../io/snapshotFile.h"
+#include "../../threading/threadPool.h"
+
+namespace {
+
+  struct Options {
+    std::vector<std::string> componentTexts; // Parsed once the scale is known
+    std::vector<InitialConditionParameters> components;
+    float SIUnitScaleFactor = 1e3f;
+    unsigned int seed = 1;
+    unsigned int threads = 0;
+    std::string outPath = "initial.snap";
+    bool compress = true;
+  };
+
+  void printUsage() {
+    std::cout << "Usage: icgen --component <distribution>[:key=value,...] [--component ...] [--scale s] [--seed n]" << std::endl;
+    std::cout << "             [--threads n] [--out path] [--uncompressed]" << std::endl;
+    std::cout << "Distributions: plummer, uniform, disk, hernquist, nfw, belt" << std::endl;
+    std::cout << "Keys: n, mass, radius, inner, c, e, i, central" << std::endl;
+  }
+
+  // SI values are divided by the scale in double, galaxy masses don't fit in a float before that
+  bool parseComponent(std::string text, double scale, InitialConditionParameters& component) {
+    size_t colon = text.find(':');
+    std::string name = text.substr(0, colon);
+    if (!InitialConditions::parseDistribution(name, component.distribution)) {
+      std::cout << "Unknown distribution " << name << std::endl;
+      return false;
+    }
+    if (colon == std::string::npos) {
+      return true;
+    }
+
+    std::stringstream stream(text.substr(colon + 1));
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      size_t equals = item.find('=');
+      if (equals == std::string::npos) {
+        std::cout << "Expected key=value, got " << item << std::endl;
+        return false;
+      }
+      std::string key = item.substr(0, equals);
+      double value = std::stod(item.substr(equals + 1));
+      if (key == "n") component.bodyCount = (size_t)value;
+      else if (key == "mass") component.totalMass = (float)(value / scale);
+      else if (key == "radius") component.radius = (float)(value / scale);
+      else if (key == "inner") component.innerRadius = (float)(value / scale);
+      else if (key == "c") component.concentration = (float)value;
+      else if (key == "e") component.maxEccentricity = (float)value;
+      else if (key == "i") component.maxInclination = (float)value;
+      else if (key == "central") component.centralMass = (float)(value / scale);
+      else {
+        std::cout << "Unknown key " << key << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      std::string flag = argv[i];
+      if (flag == "--uncompressed") {
+        options.compress = false;
+        continue;
+      }
+      if (flag == "--help" || i + 1 >= argc) {
+        return false;
+      }
+      std::string value = argv[++i];
+      if (flag == "--component") options.componentTexts.push_back(value);
+      else if (flag == "--scale") options.SIUnitScaleFactor = std::stof(value);
+      else if (flag == "--seed") options.seed = std::stoul(value);
+      else if (flag == "--threads") options.threads = std::stoul(value);
+      else if (flag == "--out") options.outPath = value;
+      else {
+        std::cout << "Unknown option " << flag << std::endl;
+        return false;
+      }
+    }
+    for (auto const& text : options.componentTexts) {
+      InitialConditionParameters component;
+      component.totalMass = (float)(1e27 / options.SIUnitScaleFactor);
+      component.radius = (float)(1e12 / options.SIUnitScaleFactor);
+      component.seed = options.seed;
+      if (!parseComponent(text, options.SIUnitScaleFactor, component)) {
+        return false;
+      }
+      options.components.push_back(component);
+    }
+    return !options.components.empty();
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  if (options.threads != 0) {
+    ThreadPool::getInstance()->setThreadCount(options.threads);
+  }
+
+  // Same units as GravBody's scene constructor
+  const float scale = options.SIUnitScaleFactor;
+  const float G = 6.67430e-11f / scale / scale;
+
+  auto start = std::chrono::steady_clock::now();
+  Snapshot snapshot;
+  InitialConditions::generate(options.components, G, snapshot);
+  double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Generated " << snapshot.getBodyCount() << " bodies in " << generateSeconds << " s on "
+    << ThreadPool::getInstance()->getThreadCount() << " threads" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  if (!SnapshotFile::write(options.outPath, snapshot, options.compress)) {
+    std::cout << "Could not write " << options.outPath << std::endl;
+    return 1;
+  }
+  double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Wrote " << options.outPath << " in " << writeSeconds << " s (SIUnitScaleFactor " << scale << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,47 @@
+// Scene compiler: converts a scene JSON file to the binary scene format (see src/io/sceneFile.h).
+//
+//   sceneCompiler <scene.json> [out.scene]
+//   sceneCompiler --snapshot <bodies.snap> <template.json> [out.scene]
+//
+// The output defaults to the input path with a .scene extension. Scene::loadScene accepts either format,
+// compiled scenes are memory mapped and skip JSON parsing and per body key lookups entirely.
+// With --snapshot the bodies come from a snapshot file, e.g. one written by icgen, and the scene constants, lights
+// and the look of every body from the template scene and its first body. The template's SIUnitScaleFactor must be
+// the --scale the snapshot was generated with.
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "../../io/sceneFile.h"
+
+int main(int argc, char** argv) {
+  const bool fromSnapshot = argc > 1 && std::string(argv[1]) == "--snapshot";
+  const int inputCount = fromSnapshot ? 3 : 1;
+  if (argc < inputCount + 1 || argc > inputCount + 2 || std::string(argv[1]) == "--help") {
+    std::cout << "Usage: sceneCompiler <scene.json> [out.scene]" << std::endl;
+    std::cout << "       sceneCompiler --snapshot <bodies.snap> <template.json> [out.scene]" << std::endl;
+    return 1;
+  }
+  std::string inputFilePath = argv[fromSnapshot ? 2 : 1];
+  std::string filePath = argc == inputCount + 2 ? argv[inputCount + 1] : inputFilePath.substr(0, inputFilePath.find_last_of('.')) + ".scene";
+
+  auto start = std::chrono::steady_clock::now();
+  bool compiled = fromSnapshot ? SceneFile::compileSnapshot(inputFilePath, argv[3], filePath) : SceneFile::compile(inputFilePath, filePath);
+  if (!compiled) {
+    return 1;
+  }
+  double compileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Open the result again, to check it and show what loading costs now
+  start = std::chrono::steady_clock::now();
+  SceneFile sceneFile;
+  if (!sceneFile.open(filePath)) {
+    return 1;
+  }
+  double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "Compiled " << inputFilePath << " to " << filePath << " in " << compileSeconds << " s: "
+    << sceneFile.getBodyCount() << " bodies, " << sceneFile.getLightCount() << " lights, "
+    << sceneFile.getStringCount() << " distinct strings. Opened in " << openSeconds * 1e3 << " ms" << std::endl;
+  return 0;
+}